@@ -23,7 +23,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_kernel_utility.hpp>
-#include <srs_app_rtmp_conn.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_protocol_utility.hpp>
 
 #define SRS_HTTP_FLV_STREAM_BUFFER 4096
@@ -95,8 +95,10 @@ void SrsAppCasterFlv::remove(ISrsResource* c)
 
 srs_error_t SrsAppCasterFlv::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
+    // The connection of message is the http connection, which is owned by the dynamic connection.
     SrsHttpMessage* msg = dynamic_cast<SrsHttpMessage*>(r);
-    SrsDynamicHttpConn* conn = dynamic_cast<SrsDynamicHttpConn*>(msg->connection());
+    SrsHttpConn* hc = dynamic_cast<SrsHttpConn*>(msg->connection());
+    SrsDynamicHttpConn* conn = dynamic_cast<SrsDynamicHttpConn*>(hc->handler());
     srs_assert(conn);
     
     std::string app = srs_path_dirname(r->path());
@@ -130,7 +132,7 @@ SrsDynamicHttpConn::SrsDynamicHttpConn(ISrsResourceManager* cm, srs_netfd_t fd,
     _srs_context->set_id(_srs_context->generate_id());
 
     manager = cm;
-    sdk = NULL;
+    publisher = NULL;
     pprint = SrsPithyPrint::create_caster();
     skt = new SrsTcpConnection(fd);
     conn = new SrsHttpConn(this, skt, m, cip, cport);
@@ -146,7 +148,7 @@ SrsDynamicHttpConn::~SrsDynamicHttpConn()
 
     srs_freep(conn);
     srs_freep(skt);
-    srs_freep(sdk);
+    srs_freep(publisher);
     srs_freep(pprint);
 }
 
@@ -179,7 +181,7 @@ srs_error_t SrsDynamicHttpConn::proxy(ISrsHttpResponseWriter* w, ISrsHttpMessage
     }
     
     err = do_proxy(rr, &dec);
-    sdk->close();
+    publisher->unpublish();
     
     return err;
 }
@@ -188,17 +190,10 @@ srs_error_t SrsDynamicHttpConn::do_proxy(ISrsHttpResponseReader* rr, SrsFlvDecod
 {
     srs_error_t err = srs_success;
     
-    srs_freep(sdk);
+    srs_freep(publisher);
+    publisher = srs_create_live_publisher(output, ip);
     
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(output, cto, sto);
-    
-    if ((err = sdk->connect()) != srs_success) {
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", output.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
+    if ((err = publisher->publish()) != srs_success) {
         return srs_error_wrap(err, "publish");
     }
     
@@ -220,12 +215,12 @@ srs_error_t SrsDynamicHttpConn::do_proxy(ISrsHttpResponseReader* rr, SrsFlvDecod
         }
         
         SrsSharedPtrMessage* msg = NULL;
-        if ((err = srs_rtmp_create_msg(type, time, data, size, sdk->sid(), &msg)) != srs_success) {
+        if ((err = srs_rtmp_create_msg(type, time, data, size, 0, &msg)) != srs_success) {
             return srs_error_wrap(err, "create message");
         }
         
         // TODO: FIXME: for post flv, reconnect when error.
-        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+        if ((err = publisher->send_and_free_message(msg)) != srs_success) {
             return srs_error_wrap(err, "send message");
         }
         
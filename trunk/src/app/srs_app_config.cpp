@@ -39,6 +39,7 @@ using namespace std;
 #include <srs_app_http_hooks.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_rtmp_stack.hpp>
+#include <srs_kernel_balance.hpp>
 
 using namespace srs_internal;
 
@@ -2839,6 +2840,8 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
             
             if (sdir->name == "ffmpeg") {
                 transcode->set("ffmpeg", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "pipe") {
+                transcode->set("pipe", sdir->dumps_arg0_to_boolean());
             } else if (sdir->name == "engine") {
                 SrsJsonObject* engine = SrsJsonAny::object();
                 engines->append(engine);
@@ -3617,7 +3620,9 @@ srs_error_t SrsConfig::check_normal_config()
             && n != "ff_log_level" && n != "grace_final_wait" && n != "force_grace_quit"
             && n != "grace_start_wait" && n != "empty_ip_ok" && n != "disable_daemon_for_docker"
             && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "tcmalloc_release_rate"
-            && n != "circuit_breaker" && n != "is_full"
+            && n != "circuit_breaker" && n != "is_full" && n != "srs_log_async" && n != "srs_log_async_buffer"
+            && n != "srs_log_async_policy" && n != "srs_log_format" && n != "workers"
+            && n != "crypto_workers"
             ) {
             return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal directive %s", n.c_str());
         }
@@ -3645,7 +3650,7 @@ srs_error_t SrsConfig::check_normal_config()
         SrsConfDirective* conf = root->get("http_server");
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
-            if (n != "enabled" && n != "listen" && n != "dir" && n != "crossdomain" && n != "https") {
+            if (n != "enabled" && n != "listen" && n != "dir" && n != "crossdomain" && n != "https" && n != "cache") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_stream.%s", n.c_str());
             }
         }
@@ -3688,12 +3693,37 @@ srs_error_t SrsConfig::check_normal_config()
             string n = conf->at(i)->name;
             if (n != "enabled" && n != "listen" && n != "dir" && n != "candidate" && n != "ecdsa"
                 && n != "encrypt" && n != "reuseport" && n != "merge_nalus" && n != "black_hole"
-                && n != "ip_family") {
+                && n != "ip_family" && n != "srtp_gcm") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal rtc_server.%s", n.c_str());
             }
         }
     }
     
+    if (true) {
+        SrsConfDirective* conf = root->get("workers");
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "count" && n != "relay_port") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal workers.%s", n.c_str());
+            }
+        }
+    }
+    
+    ////////////////////////////////////////////////////////////////////////
+    // check workers, the RTC session is bind to the worker which serves the SDP.
+    ////////////////////////////////////////////////////////////////////////
+    if (get_workers_enabled()) {
+        if (get_rtc_server_enabled()) {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "workers conflicts with rtc_server");
+        }
+        if (get_workers_count() < 0) {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid workers.count=%d", get_workers_count());
+        }
+        if (get_workers_relay_port() <= 0) {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "invalid workers.relay_port=%d", get_workers_relay_port());
+        }
+    }
+    
     ////////////////////////////////////////////////////////////////////////
     // check listen for rtmp.
     ////////////////////////////////////////////////////////////////////////
@@ -3865,7 +3895,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "mode" && m != "origin" && m != "token_traverse" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
-                        && m != "origin_cluster") {
+                        && m != "origin_cluster" && m != "origin_balance" && m != "pull_linger") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3949,7 +3979,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     SrsConfDirective* trans = conf->at(j);
                     string m = trans->name.c_str();
-                    if (m != "enabled" && m != "ffmpeg" && m != "engine") {
+                    if (m != "enabled" && m != "ffmpeg" && m != "pipe" && m != "engine") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.transcode.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                     if (m == "engine") {
@@ -3979,7 +4009,8 @@ srs_error_t SrsConfig::check_normal_config()
                     if (m != "enabled" && m != "nack" && m != "twcc" && m != "nack_no_copy"
                         && m != "bframe" && m != "aac" && m != "stun_timeout" && m != "stun_strict_check"
                         && m != "dtls_role" && m != "dtls_version" && m != "drop_for_pt" && m != "rtc_to_rtmp"
-                        && m != "pli_for_rtmp") {
+                        && m != "pli_for_rtmp" && m != "gop_cache" && m != "pacer" && m != "fec"
+                        && m != "pli_window" && m != "pli_interval") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.rtc.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -4007,6 +4038,15 @@ srs_error_t SrsConfig::check_normal_config()
             ids.push_back(id);
         }
     }
+
+    // check the algorithm to select origin, which falls back to round-robin silently if unknown.
+    for (int i = 0; i < (int)vhosts.size(); i++) {
+        SrsConfDirective* vhost = vhosts[i];
+        string strategy = get_vhost_edge_origin_balance(vhost->arg0());
+        if (!srs_lb_is_valid(strategy)) {
+            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.origin_balance %s of %s", strategy.c_str(), vhost->arg0().c_str());
+        }
+    }
     
     ////////////////////////////////////////////////////////////////////////
     // check chunk size
@@ -4372,6 +4412,91 @@ bool SrsConfig::get_circuit_breaker()
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_crypto_workers_enabled()
+{
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = root->get("crypto_workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_crypto_workers_threads()
+{
+    static int DEFAULT = 2;
+
+    SrsConfDirective* conf = root->get("crypto_workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("threads");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(1, ::atoi(conf->arg0().c_str()));
+}
+
+bool SrsConfig::get_workers_enabled()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_workers_count()
+{
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("count");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_workers_relay_port()
+{
+    static int DEFAULT = 19350;
+
+    SrsConfDirective* conf = root->get("workers");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("relay_port");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 int SrsConfig::get_high_threshold()
 {
     static int DEFAULT = 90;
@@ -4722,6 +4847,23 @@ bool SrsConfig::get_rtc_server_encrypt()
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_rtc_server_srtp_gcm()
+{
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("srtp_gcm");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
 int SrsConfig::get_rtc_server_reuseport()
 {
     int v = get_rtc_server_reuseport2();
@@ -5003,6 +5145,23 @@ srs_utime_t SrsConfig::get_rtc_pli_for_rtmp(string vhost)
     return v;
 }
 
+bool SrsConfig::get_rtc_gop_cache(string vhost)
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("gop_cache");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 bool SrsConfig::get_rtc_nack_enabled(string vhost)
 {
     static bool DEFAULT = true;
@@ -5054,6 +5213,86 @@ bool SrsConfig::get_rtc_twcc_enabled(string vhost)
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_rtc_pacer_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("pacer");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_rtc_fec_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("fec");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_rtc_pli_window(string vhost)
+{
+    static srs_utime_t DEFAULT = 500 * SRS_UTIME_MILLISECONDS;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("pli_window");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    srs_utime_t v = (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    if (v < 0 || v > 10 * SRS_UTIME_SECONDS) {
+        srs_warn("Reset pli window %dms to %dms", srsu2msi(v), srsu2msi(DEFAULT));
+        return DEFAULT;
+    }
+
+    return v;
+}
+
+srs_utime_t SrsConfig::get_rtc_pli_interval(string vhost)
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("pli_interval");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    srs_utime_t v = (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    if (v < 0 || v > 30 * SRS_UTIME_SECONDS) {
+        srs_warn("Reset pli interval %dms to %dms", srsu2msi(v), srsu2msi(DEFAULT));
+        return DEFAULT;
+    }
+
+    return v;
+}
+
 SrsConfDirective* SrsConfig::get_vhost(string vhost, bool try_default_vhost)
 {
     srs_assert(root);
@@ -6001,6 +6240,50 @@ string SrsConfig::get_vhost_edge_transform_vhost(string vhost)
     return conf->arg0();
 }
 
+string SrsConfig::get_vhost_edge_origin_balance(string vhost)
+{
+    static string DEFAULT = "round_robin";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("origin_balance");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+srs_utime_t SrsConfig::get_vhost_edge_pull_linger(string vhost)
+{
+    static srs_utime_t DEFAULT = 0;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("pull_linger");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_vhost_origin_cluster(string vhost)
 {
     static bool DEFAULT = false;
@@ -6124,6 +6407,22 @@ string SrsConfig::get_transcode_ffmpeg(SrsConfDirective* conf)
     return conf->arg0();
 }
 
+bool SrsConfig::get_transcode_pipe(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("pipe");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 vector<SrsConfDirective*> SrsConfig::get_transcode_engines(SrsConfDirective* conf)
 {
     vector<SrsConfDirective*> engines;
@@ -6706,6 +7005,55 @@ string SrsConfig::get_log_file()
     return conf->arg0();
 }
 
+bool SrsConfig::get_log_format_binary()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("srs_log_format");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0() == "binary";
+}
+
+bool SrsConfig::get_log_async()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("srs_log_async");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_log_async_buffer()
+{
+    static int DEFAULT = 1024 * 1024;
+
+    SrsConfDirective* conf = root->get("srs_log_async_buffer");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    // The config is in KB.
+    return ::atoi(conf->arg0().c_str()) * 1024;
+}
+
+bool SrsConfig::get_log_async_block()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("srs_log_async_policy");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0() == "block";
+}
+
 bool SrsConfig::get_ff_log_enabled()
 {
     string log = get_ff_log_dir();
@@ -8041,6 +8389,67 @@ string SrsConfig::get_https_stream_ssl_cert()
     return conf->arg0();
 }
 
+SrsConfDirective* SrsConfig::get_http_stream_cache()
+{
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return NULL;
+    }
+
+    return conf->get("cache");
+}
+
+bool SrsConfig::get_http_stream_cache_enabled()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_http_stream_cache();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int64_t SrsConfig::get_http_stream_cache_max_size()
+{
+    static int64_t DEFAULT = 64 * 1024 * 1024;
+
+    SrsConfDirective* conf = get_http_stream_cache();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (int64_t)::atoi(conf->arg0().c_str()) * 1024 * 1024;
+}
+
+int64_t SrsConfig::get_http_stream_cache_max_file()
+{
+    static int64_t DEFAULT = 4 * 1024 * 1024;
+
+    SrsConfDirective* conf = get_http_stream_cache();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_file");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (int64_t)::atoi(conf->arg0().c_str()) * 1024 * 1024;
+}
+
 bool SrsConfig::get_vhost_http_enabled(string vhost)
 {
     static bool DEFAULT = false;
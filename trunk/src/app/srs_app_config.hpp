@@ -475,6 +475,20 @@ public:
     virtual bool auto_reload_for_docker();
     // For tcmalloc, get the release rate.
     virtual double tcmalloc_release_rate();
+// Workers section.
+public:
+    // Whether enable the multiple processes mode.
+    virtual bool get_workers_enabled();
+    // Get the number of workers, 0 for the number of CPUs.
+    virtual int get_workers_count();
+    // Get the base port of the private RTMP listener of workers.
+    virtual int get_workers_relay_port();
+// Crypto workers section.
+public:
+    // Whether offload the crypto of TLS handshake to threads.
+    virtual bool get_crypto_workers_enabled();
+    // Get the number of crypto threads.
+    virtual int get_crypto_workers_threads();
 // Thread pool section.
 public:
     virtual bool get_circuit_breaker();
@@ -512,6 +526,7 @@ public:
     virtual std::string get_rtc_server_ip_family();
     virtual bool get_rtc_server_ecdsa();
     virtual bool get_rtc_server_encrypt();
+    virtual bool get_rtc_server_srtp_gcm();
     virtual int get_rtc_server_reuseport();
     virtual bool get_rtc_server_merge_nalus();
 public:
@@ -532,9 +547,14 @@ public:
     int get_rtc_drop_for_pt(std::string vhost);
     bool get_rtc_to_rtmp(std::string vhost);
     srs_utime_t get_rtc_pli_for_rtmp(std::string vhost);
+    bool get_rtc_gop_cache(std::string vhost);
     bool get_rtc_nack_enabled(std::string vhost);
     bool get_rtc_nack_no_copy(std::string vhost);
     bool get_rtc_twcc_enabled(std::string vhost);
+    bool get_rtc_pacer_enabled(std::string vhost);
+    bool get_rtc_fec_enabled(std::string vhost);
+    srs_utime_t get_rtc_pli_window(std::string vhost);
+    srs_utime_t get_rtc_pli_interval(std::string vhost);
 
 // vhost specified section
 public:
@@ -751,6 +771,10 @@ public:
     // Get the transformed vhost for edge,
     // @see https://github.com/ossrs/srs/issues/372
     virtual std::string get_vhost_edge_transform_vhost(std::string vhost);
+    // Get the algorithm to select the origin of edge, round_robin, least_conn, ewma(rtt_load) or hash.
+    virtual std::string get_vhost_edge_origin_balance(std::string vhost);
+    // Get the time to keep pulling from origin after all players stopped, 0 to stop immediately.
+    virtual srs_utime_t get_vhost_edge_pull_linger(std::string vhost);
     // Whether enable the origin cluster.
     // @see https://github.com/ossrs/srs/wiki/v3_EN_OriginCluster
     virtual bool get_vhost_origin_cluster(std::string vhost);
@@ -779,6 +803,8 @@ public:
     virtual bool get_transcode_enabled(SrsConfDirective* conf);
     // Get the ffmpeg tool path of transcode.
     virtual std::string get_transcode_ffmpeg(SrsConfDirective* conf);
+    // Whether feed the stream to ffmpeg by pipe, and transcode all engines by one ffmpeg.
+    virtual bool get_transcode_pipe(SrsConfDirective* conf);
     // Get the engines of transcode.
     virtual std::vector<SrsConfDirective*> get_transcode_engines(SrsConfDirective* conf);
     // Whether the engine is enabled.
@@ -867,6 +893,14 @@ public:
     virtual std::string get_log_level();
     // Get the log file path.
     virtual std::string get_log_file();
+    // Whether write binary log file, which is rendered to text by srs_log_decoder.
+    virtual bool get_log_format_binary();
+    // Whether write log file asynchronously by a background thread.
+    virtual bool get_log_async();
+    // Get the size in bytes of ring buffer for each thread, for async log.
+    virtual int get_log_async_buffer();
+    // Whether block util the ring is drained when it's full, or drop the log.
+    virtual bool get_log_async_block();
     // Whether ffmpeg log enabled
     virtual bool get_ff_log_enabled();
     // The ffmpeg log dir.
@@ -1030,6 +1064,16 @@ public:
     virtual std::string get_https_stream_listen();
     virtual std::string get_https_stream_ssl_key();
     virtual std::string get_https_stream_ssl_cert();
+// The hot file cache of http stream section.
+private:
+    SrsConfDirective* get_http_stream_cache();
+public:
+    // Whether cache the hot files, for example, HLS segments and playlists.
+    virtual bool get_http_stream_cache_enabled();
+    // The max bytes of all cached files.
+    virtual int64_t get_http_stream_cache_max_size();
+    // The max bytes of a file to cache, the larger file is not cached.
+    virtual int64_t get_http_stream_cache_max_file();
 public:
     // Get whether vhost enabled http stream
     virtual bool get_vhost_http_enabled(std::string vhost);
@@ -8,8 +8,12 @@
 
 #include <netinet/tcp.h>
 #include <algorithm>
+#include <map>
 using namespace std;
 
+#include <openssl/rand.h>
+#include <openssl/err.h>
+
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_app_utility.hpp>
@@ -20,12 +24,17 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 
 #include <srs_protocol_kbps.hpp>
+#include <srs_http_stack.hpp>
+#include <srs_app_threads.hpp>
 
 SrsPps* _srs_pps_ids = NULL;
 SrsPps* _srs_pps_fids = NULL;
 SrsPps* _srs_pps_fids_level0 = NULL;
 SrsPps* _srs_pps_dispose = NULL;
 
+SrsPps* _srs_pps_tls_handshakes = NULL;
+SrsPps* _srs_pps_tls_resumed = NULL;
+
 ISrsDisposingHandler::ISrsDisposingHandler()
 {
 }
@@ -578,6 +587,149 @@ srs_error_t SrsTcpConnection::writev(const iovec *iov, int iov_size, ssize_t* nw
     return skt->writev(iov, iov_size, nwrite);
 }
 
+srs_error_t SrsTcpConnection::sendfile(int fd, int64_t offset, int64_t size, ssize_t* nwrite)
+{
+    return skt->sendfile(fd, offset, size, nwrite);
+}
+
+// The ticket keys shared by all SSL contexts, generated before fork, so that all workers could
+// decrypt the tickets issued by each other.
+static uint8_t _srs_ssl_ticket_keys[128];
+static bool _srs_ssl_ticket_keys_ready = false;
+
+srs_error_t srs_ssl_ticket_keys_initialize()
+{
+    if (RAND_bytes(_srs_ssl_ticket_keys, sizeof(_srs_ssl_ticket_keys)) != 1) {
+        return srs_error_new(ERROR_HTTPS_KEY_CRT, "generate ticket keys");
+    }
+
+    _srs_ssl_ticket_keys_ready = true;
+    return srs_success;
+}
+
+// The SSL context shared by connections with the same key and cert, which parses the key and
+// cert only once, and keeps the session cache for resumption.
+struct SrsSslSharedContext
+{
+    SSL_CTX* ctx;
+    // The ETag of key and cert file, to build a new context when file changed.
+    std::string etag;
+};
+static std::map<std::string, SrsSslSharedContext> _srs_ssl_ctxs;
+
+static srs_error_t srs_ssl_build_ctx(string key_file, string crt_file, SSL_CTX** pctx)
+{
+    srs_error_t err = srs_success;
+
+    // For HTTPS, try to connect over security transport.
+#if (OPENSSL_VERSION_NUMBER < 0x10002000L) // v1.0.2
+    SSL_CTX* ctx = SSL_CTX_new(TLS_method());
+#else
+    SSL_CTX* ctx = SSL_CTX_new(TLSv1_2_method());
+#endif
+    if (!ctx) {
+        return srs_error_new(ERROR_HTTPS_HANDSHAKE, "SSL_CTX_new");
+    }
+
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+    srs_assert(SSL_CTX_set_cipher_list(ctx, "ALL") == 1);
+
+    // Setup the key and cert file for server.
+    int r0;
+    if ((r0 = SSL_CTX_use_certificate_file(ctx, crt_file.c_str(), SSL_FILETYPE_PEM)) != 1) {
+        err = srs_error_new(ERROR_HTTPS_KEY_CRT, "use cert %s", crt_file.c_str());
+    } else if ((r0 = SSL_CTX_use_RSAPrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM)) != 1) {
+        err = srs_error_new(ERROR_HTTPS_KEY_CRT, "use key %s", key_file.c_str());
+    } else if ((r0 = SSL_CTX_check_private_key(ctx)) != 1) {
+        err = srs_error_new(ERROR_HTTPS_KEY_CRT, "check key %s with cert %s", key_file.c_str(), crt_file.c_str());
+    }
+    if (err != srs_success) {
+        SSL_CTX_free(ctx);
+        return err;
+    }
+
+    // Enable the server session cache, for clients to resume by session id.
+    // @see https://www.openssl.org/docs/man1.1.1/man3/SSL_CTX_set_session_cache_mode.html
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_session_id_context(ctx, (const unsigned char*)"srs", 3);
+
+    // Session tickets are enabled by default, use the keys shared by workers if ready.
+    // @see https://www.openssl.org/docs/man1.1.1/man3/SSL_CTX_set_tlsext_ticket_keys.html
+    long nn_keys = SSL_CTX_get_tlsext_ticket_keys(ctx, NULL, 0);
+    if (_srs_ssl_ticket_keys_ready && nn_keys > 0 && nn_keys <= (long)sizeof(_srs_ssl_ticket_keys)) {
+        SSL_CTX_set_tlsext_ticket_keys(ctx, _srs_ssl_ticket_keys, nn_keys);
+    }
+
+    *pctx = ctx;
+    srs_trace("ssl: build ctx by key %s and cert %s, tickets=%d/%d", key_file.c_str(), crt_file.c_str(),
+        _srs_ssl_ticket_keys_ready, (int)nn_keys);
+
+    return err;
+}
+
+// Fetch the shared SSL context, build it when the key or cert file changed.
+static srs_error_t srs_ssl_fetch_ctx(string key_file, string crt_file, SSL_CTX** pctx)
+{
+    srs_error_t err = srs_success;
+
+    string key_etag, crt_etag;
+    if (!srs_http_file_etag(key_file, key_etag)) {
+        return srs_error_new(ERROR_HTTPS_KEY_CRT, "stat key %s", key_file.c_str());
+    }
+    if (!srs_http_file_etag(crt_file, crt_etag)) {
+        return srs_error_new(ERROR_HTTPS_KEY_CRT, "stat cert %s", crt_file.c_str());
+    }
+
+    string id = key_file + "|" + crt_file;
+    string etag = key_etag + "|" + crt_etag;
+
+    std::map<std::string, SrsSslSharedContext>::iterator it = _srs_ssl_ctxs.find(id);
+    if (it != _srs_ssl_ctxs.end() && it->second.etag == etag) {
+        *pctx = it->second.ctx;
+        return err;
+    }
+
+    SSL_CTX* ctx = NULL;
+    if ((err = srs_ssl_build_ctx(key_file, crt_file, &ctx)) != srs_success) {
+        return srs_error_wrap(err, "build ctx");
+    }
+
+    // The SSL objects hold references of the stale context, so it's safe to free it.
+    if (it != _srs_ssl_ctxs.end()) {
+        SSL_CTX_free(it->second.ctx);
+    }
+
+    SrsSslSharedContext& shared = _srs_ssl_ctxs[id];
+    shared.ctx = ctx;
+    shared.etag = etag;
+
+    *pctx = ctx;
+    return err;
+}
+
+// The step of TLS handshake run by crypto workers, which does the asymmetric crypto.
+class SrsSslHandshakeTask : public ISrsCryptoTask
+{
+public:
+    SSL* ssl;
+    int r0;
+    int r1;
+public:
+    SrsSslHandshakeTask(SSL* s) {
+        ssl = s;
+        r0 = r1 = 0;
+    }
+    virtual ~SrsSslHandshakeTask() {
+    }
+public:
+    virtual void run() {
+        // The error queue of openssl is thread-local, so we must get the error in the same thread.
+        ERR_clear_error();
+        r0 = SSL_do_handshake(ssl);
+        r1 = SSL_get_error(ssl, r0);
+    }
+};
+
 SrsSslConnection::SrsSslConnection(ISrsProtocolReadWriter* c)
 {
     transport = c;
@@ -588,29 +740,28 @@ SrsSslConnection::SrsSslConnection(ISrsProtocolReadWriter* c)
 SrsSslConnection::~SrsSslConnection()
 {
     if (ssl) {
+        // The connection is closed without close_notify, mark it as shutdown, or openssl removes the
+        // session from cache, see ssl_clear_bad_session.
+        if (SSL_is_init_finished(ssl)) {
+            SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        }
+
         // this function will free bio_in and bio_out
         SSL_free(ssl);
         ssl = NULL;
     }
 
-    if (ssl_ctx) {
-        SSL_CTX_free(ssl_ctx);
-        ssl_ctx = NULL;
-    }
+    // The ssl_ctx is shared by connections, never free it.
+    ssl_ctx = NULL;
 }
 
 srs_error_t SrsSslConnection::handshake(string key_file, string crt_file)
 {
     srs_error_t err = srs_success;
 
-    // For HTTPS, try to connect over security transport.
-#if (OPENSSL_VERSION_NUMBER < 0x10002000L) // v1.0.2
-    ssl_ctx = SSL_CTX_new(TLS_method());
-#else
-    ssl_ctx = SSL_CTX_new(TLSv1_2_method());
-#endif
-    SSL_CTX_set_verify(ssl_ctx, SSL_VERIFY_NONE, NULL);
-    srs_assert(SSL_CTX_set_cipher_list(ssl_ctx, "ALL") == 1);
+    if ((err = srs_ssl_fetch_ctx(key_file, crt_file, &ssl_ctx)) != srs_success) {
+        return srs_error_wrap(err, "fetch ctx");
+    }
 
     // TODO: Setup callback, see SSL_set_ex_data and SSL_set_info_callback
     if ((ssl = SSL_new(ssl_ctx)) == NULL) {
@@ -635,65 +786,37 @@ srs_error_t SrsSslConnection::handshake(string key_file, string crt_file)
     uint8_t* data = NULL;
     int r0, r1, size;
 
-    // Setup the key and cert file for server.
-    if ((r0 = SSL_use_certificate_file(ssl, crt_file.c_str(), SSL_FILETYPE_PEM)) != 1) {
-        return srs_error_new(ERROR_HTTPS_KEY_CRT, "use cert %s", crt_file.c_str());
-    }
-
-    if ((r0 = SSL_use_RSAPrivateKey_file(ssl, key_file.c_str(), SSL_FILETYPE_PEM)) != 1) {
-        return srs_error_new(ERROR_HTTPS_KEY_CRT, "use key %s", key_file.c_str());
-    }
-
-    if ((r0 = SSL_check_private_key(ssl)) != 1) {
-        return srs_error_new(ERROR_HTTPS_KEY_CRT, "check key %s with cert %s",
-            key_file.c_str(), crt_file.c_str());
-    }
-    srs_info("ssl: use key %s and cert %s", key_file.c_str(), crt_file.c_str());
-
-    // Receive ClientHello
+    // Drive the handshake by flights, because the number of flights depends on whether the session
+    // is resumed: the full handshake ends by client Finished, while the abbreviated handshake, by
+    // session id or ticket, ends by server Finished.
     while (true) {
-        char buf[1024]; ssize_t nn = 0;
-        if ((err = transport->read(buf, sizeof(buf), &nn)) != srs_success) {
-            return srs_error_wrap(err, "handshake: read");
-        }
-
-        if ((r0 = BIO_write(bio_in, buf, nn)) <= 0) {
-            // TODO: 0 or -1 maybe block, use BIO_should_retry to check.
-            return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_write r0=%d, data=%p, size=%d", r0, buf, nn);
-        }
-
-        r0 = SSL_do_handshake(ssl); r1 = SSL_get_error(ssl, r0);
-        if (r0 != -1 || r1 != SSL_ERROR_WANT_READ) {
-            return srs_error_new(ERROR_HTTPS_HANDSHAKE, "handshake r0=%d, r1=%d", r0, r1);
+        // Run by crypto workers, to not block other connections.
+        SrsSslHandshakeTask task(ssl);
+        if ((err = _srs_crypto_workers->execute(&task)) != srs_success) {
+            return srs_error_wrap(err, "handshake: crypto");
         }
+        r0 = task.r0; r1 = task.r1;
 
+        // Send the flight generated by SSL, if any.
         if ((size = BIO_get_mem_data(bio_out, &data)) > 0) {
-            // OK, reset it for the next write.
-            if ((r0 = BIO_reset(bio_in)) != 1) {
-                return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_reset r0=%d", r0);
+            if ((err = transport->write(data, size, NULL)) != srs_success) {
+                return srs_error_wrap(err, "handshake: write data=%p, size=%d", data, size);
+            }
+            int r2;
+            if ((r2 = BIO_reset(bio_out)) != 1) {
+                return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_reset r2=%d", r2);
             }
-            break;
         }
-    }
-
-    srs_info("https: ClientHello done");
 
-    // Send ServerHello, Certificate, Server Key Exchange, Server Hello Done
-    size = BIO_get_mem_data(bio_out, &data);
-    if (!data || size <= 0) {
-        return srs_error_new(ERROR_HTTPS_HANDSHAKE, "handshake data=%p, size=%d", data, size);
-    }
-    if ((err = transport->write(data, size, NULL)) != srs_success) {
-        return srs_error_wrap(err, "handshake: write data=%p, size=%d", data, size);
-    }
-    if ((r0 = BIO_reset(bio_out)) != 1) {
-        return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_reset r0=%d", r0);
-    }
+        if (r1 == SSL_ERROR_NONE) {
+            break;
+        }
 
-    srs_info("https: ServerHello done");
+        if (r1 != SSL_ERROR_WANT_READ) {
+            return srs_error_new(ERROR_HTTPS_HANDSHAKE, "handshake r0=%d, r1=%d", r0, r1);
+        }
 
-    // Receive Client Key Exchange, Change Cipher Spec, Encrypted Handshake Message
-    while (true) {
+        // Receive the next flight from client.
         char buf[1024]; ssize_t nn = 0;
         if ((err = transport->read(buf, sizeof(buf), &nn)) != srs_success) {
             return srs_error_wrap(err, "handshake: read");
@@ -701,42 +824,15 @@ srs_error_t SrsSslConnection::handshake(string key_file, string crt_file)
 
         if ((r0 = BIO_write(bio_in, buf, nn)) <= 0) {
             // TODO: 0 or -1 maybe block, use BIO_should_retry to check.
-            return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_write r0=%d, data=%p, size=%d", r0, buf, nn);
-        }
-
-        r0 = SSL_do_handshake(ssl); r1 = SSL_get_error(ssl, r0);
-        if (r0 == 1 && r1 == SSL_ERROR_NONE) {
-            break;
-        }
-
-        if (r0 != -1 || r1 != SSL_ERROR_WANT_READ) {
-            return srs_error_new(ERROR_HTTPS_HANDSHAKE, "handshake r0=%d, r1=%d", r0, r1);
-        }
-
-        if ((size = BIO_get_mem_data(bio_out, &data)) > 0) {
-            // OK, reset it for the next write.
-            if ((r0 = BIO_reset(bio_in)) != 1) {
-                return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_reset r0=%d", r0);
-            }
-            break;
+            return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_write r0=%d, data=%p, size=%d", r0, buf, (int)nn);
         }
     }
 
-    srs_info("https: Client done");
-
-    // Send New Session Ticket, Change Cipher Spec, Encrypted Handshake Message
-    size = BIO_get_mem_data(bio_out, &data);
-    if (!data || size <= 0) {
-        return srs_error_new(ERROR_HTTPS_HANDSHAKE, "handshake data=%p, size=%d", data, size);
+    ++_srs_pps_tls_handshakes->sugar;
+    if (SSL_session_reused(ssl)) {
+        ++_srs_pps_tls_resumed->sugar;
     }
-    if ((err = transport->write(data, size, NULL)) != srs_success) {
-        return srs_error_wrap(err, "handshake: write data=%p, size=%d", data, size);
-    }
-    if ((r0 = BIO_reset(bio_out)) != 1) {
-        return srs_error_new(ERROR_HTTPS_HANDSHAKE, "BIO_reset r0=%d", r0);
-    }
-
-    srs_info("https: Server done");
+    srs_info("https: handshake done, reused=%d", SSL_session_reused(ssl));
 
     return err;
 }
@@ -147,7 +147,7 @@ public:
 // The basic connection of SRS, for TCP based protocols,
 // all connections accept from listener must extends from this base class,
 // server will add the connection to manager, and delete it when remove.
-class SrsTcpConnection : public ISrsProtocolReadWriter
+class SrsTcpConnection : public ISrsProtocolReadWriter, public ISrsProtocolFileWriter
 {
 private:
     // The underlayer st fd handler.
@@ -176,8 +176,15 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsProtocolFileWriter
+public:
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, ssize_t* nwrite);
 };
 
+// Generate the TLS session ticket keys, which should be called before fork, so that the
+// tickets issued by a worker could be resumed by others.
+extern srs_error_t srs_ssl_ticket_keys_initialize();
+
 // The SSL connection over TCP transport, in server mode.
 class SrsSslConnection : public ISrsProtocolReadWriter
 {
@@ -185,6 +192,7 @@ private:
     // The under-layer plaintext transport.
     ISrsProtocolReadWriter* transport;
 private:
+    // The SSL context shared by connections, never free it.
     SSL_CTX* ssl_ctx;
     SSL* ssl;
     BIO* bio_in;
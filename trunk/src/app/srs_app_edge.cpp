@@ -29,6 +29,7 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_balance.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_workers.hpp>
 
 // when edge timeout, retry next.
 #define SRS_EDGE_INGESTER_TIMEOUT (5 * SRS_UTIME_SECONDS)
@@ -56,12 +57,15 @@ SrsEdgeRtmpUpstream::~SrsEdgeRtmpUpstream()
     close();
 }
 
-srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
+srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, ISrsLoadBalancer* lb)
 {
     srs_error_t err = srs_success;
     
     SrsRequest* req = r;
     
+    // The server of config to update the health, empty for redirect.
+    std::string origin;
+    
     std::string url;
     if (true) {
         SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
@@ -69,14 +73,18 @@ srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
         // @see https://github.com/ossrs/srs/issues/79
         // when origin is error, for instance, server is shutdown,
         // then user remove the vhost then reload, the conf is empty.
-        if (!conf) {
+        // @remark For relay of workers, there is no origin and the redirect is the worker.
+        if (!conf && redirect.empty()) {
             return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
         }
         
         // select the origin.
-        std::string server = lb->select(conf->args);
+        std::string server;
         int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
-        srs_parse_hostport(server, server, port);
+        if (conf) {
+            server = origin = lb->select(conf->args);
+            srs_parse_hostport(server, server, port);
+        }
         
         // override the origin info by redirect.
         if (!redirect.empty()) {
@@ -86,6 +94,7 @@ srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
             
             server = _host;
             port = _port;
+            origin = "";
         }
 
         // Remember the current selected server.
@@ -100,12 +109,19 @@ srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
         url = srs_generate_rtmp_url(server, port, req->host, vhost, req->app, req->stream, req->param);
     }
     
-    srs_freep(sdk);
+    close();
     srs_utime_t cto = SRS_EDGE_INGESTER_TIMEOUT;
     srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    // The time to connect and play, for the balancer to select the upstream.
+    srs_utime_t starttime = srs_get_system_time();
+    SrsLbHealth* health = SrsLbHealth::instance();
+    
     if ((err = sdk->connect()) != srs_success) {
+        if (!origin.empty()) {
+            health->on_failed(origin, srs_get_system_time());
+        }
         return srs_error_wrap(err, "edge pull %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
 
@@ -113,10 +129,22 @@ srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
     // so we publish without vhost in stream.
     string stream;
     if ((err = sdk->play(_srs_config->get_chunk_size(req->vhost), false, &stream)) != srs_success) {
+        if (!origin.empty()) {
+            health->on_failed(origin, srs_get_system_time());
+        }
         return srs_error_wrap(err, "edge pull %s stream failed", url.c_str());
     }
 
-    srs_trace("edge-pull publish url %s, stream=%s%s as %s", url.c_str(), req->stream.c_str(), req->param.c_str(), stream.c_str());
+    srs_utime_t rtt = srs_get_system_time() - starttime;
+    int load = sdk->server_info()->load;
+    if (!origin.empty()) {
+        health->on_connected(origin, rtt, load, srs_get_system_time());
+        health->acquire(origin);
+        connected_origin = origin;
+    }
+
+    srs_trace("edge-pull publish url %s, stream=%s%s as %s, rtt=%dms, load=%d", url.c_str(), req->stream.c_str(),
+        req->param.c_str(), stream.c_str(), srsu2msi(rtt), load);
     
     return err;
 }
@@ -133,6 +161,10 @@ srs_error_t SrsEdgeRtmpUpstream::decode_message(SrsCommonMessage* msg, SrsPacket
 
 void SrsEdgeRtmpUpstream::close()
 {
+    if (!connected_origin.empty()) {
+        SrsLbHealth::instance()->release(connected_origin);
+        connected_origin = "";
+    }
     srs_freep(sdk);
 }
 
@@ -159,7 +191,7 @@ SrsEdgeIngester::SrsEdgeIngester()
     req = NULL;
     
     upstream = new SrsEdgeRtmpUpstream("");
-    lb = new SrsLbRoundRobin();
+    lb = NULL;
     trd = new SrsDummyCoroutine();
 }
 
@@ -178,6 +210,10 @@ srs_error_t SrsEdgeIngester::initialize(SrsLiveSource* s, SrsPlayEdge* e, SrsReq
     edge = e;
     req = r;
     
+    srs_freep(lb);
+    std::string strategy = _srs_config->get_vhost_edge_origin_balance(req->vhost);
+    lb = srs_lb_create(strategy, req->get_stream_url(), SrsLbHealth::instance());
+    
     return srs_success;
 }
 
@@ -212,7 +248,7 @@ void SrsEdgeIngester::stop()
 
 string SrsEdgeIngester::get_curr_origin()
 {
-    return lb->selected();
+    return lb? lb->selected() : "";
 }
 
 // when error, edge ingester sleep for a while and retry.
@@ -234,6 +270,11 @@ srs_error_t SrsEdgeIngester::cycle()
             srs_freep(err);
         }
 
+        // The interrupt might be consumed by the recv in do_cycle, so check it again to stop fast.
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "edge ingester");
+        }
+
         srs_usleep(SRS_EDGE_INGESTER_CIMS);
     }
     
@@ -250,6 +291,15 @@ srs_error_t SrsEdgeIngester::do_cycle()
             return srs_error_wrap(err, "do cycle pull");
         }
         
+        // For workers, relay from the worker which owns the stream, which may change when republish.
+        if (!_srs_config->get_vhost_is_edge(req->vhost)) {
+            int port = _srs_workers->owner_port(req);
+            if (!port) {
+                return srs_error_new(ERROR_WORKERS_NO_OWNER, "no worker owns %s", req->get_stream_url().c_str());
+            }
+            redirect = "rtmp://127.0.0.1:" + srs_int2str(port) + "/" + req->app;
+        }
+
         srs_freep(upstream);
         upstream = new SrsEdgeRtmpUpstream(redirect);
         
@@ -432,7 +482,7 @@ SrsEdgeForwarder::SrsEdgeForwarder()
     source = NULL;
     
     sdk = NULL;
-    lb = new SrsLbRoundRobin();
+    lb = NULL;
     trd = new SrsDummyCoroutine();
     queue = new SrsMessageQueue();
 }
@@ -457,6 +507,10 @@ srs_error_t SrsEdgeForwarder::initialize(SrsLiveSource* s, SrsPublishEdge* e, Sr
     edge = e;
     req = r;
     
+    srs_freep(lb);
+    std::string strategy = _srs_config->get_vhost_edge_origin_balance(req->vhost);
+    lb = srs_lb_create(strategy, req->get_stream_url(), SrsLbHealth::instance());
+    
     return srs_success;
 }
 
@@ -467,13 +521,16 @@ srs_error_t SrsEdgeForwarder::start()
     // reset the error code.
     send_error_code = ERROR_SUCCESS;
     
+    // The origin in config to update the health.
+    std::string origin;
+    
     std::string url;
     if (true) {
         SrsConfDirective* conf = _srs_config->get_vhost_edge_origin(req->vhost);
         srs_assert(conf);
         
         // select the origin.
-        std::string server = lb->select(conf->args);
+        std::string server = origin = lb->select(conf->args);
         int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
         srs_parse_hostport(server, server, port);
         
@@ -486,12 +543,16 @@ srs_error_t SrsEdgeForwarder::start()
     }
     
     // open socket.
-    srs_freep(sdk);
+    close();
     srs_utime_t cto = SRS_EDGE_FORWARDER_TIMEOUT;
     srs_utime_t sto = SRS_CONSTS_RTMP_TIMEOUT;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    srs_utime_t starttime = srs_get_system_time();
+    SrsLbHealth* health = SrsLbHealth::instance();
+    
     if ((err = sdk->connect()) != srs_success) {
+        health->on_failed(origin, srs_get_system_time());
         return srs_error_wrap(err, "sdk connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
 
@@ -499,9 +560,14 @@ srs_error_t SrsEdgeForwarder::start()
     // so we publish without vhost in stream.
     string stream;
     if ((err = sdk->publish(_srs_config->get_chunk_size(req->vhost), false, &stream)) != srs_success) {
+        health->on_failed(origin, srs_get_system_time());
         return srs_error_wrap(err, "sdk publish");
     }
     
+    health->on_connected(origin, srs_get_system_time() - starttime, sdk->server_info()->load, srs_get_system_time());
+    health->acquire(origin);
+    connected_origin = origin;
+    
     srs_freep(trd);
     trd = new SrsSTCoroutine("edge-fwr", this, _srs_context->get_id());
     
@@ -518,6 +584,15 @@ void SrsEdgeForwarder::stop()
 {
     trd->stop();
     queue->clear();
+    close();
+}
+
+void SrsEdgeForwarder::close()
+{
+    if (!connected_origin.empty()) {
+        SrsLbHealth::instance()->release(connected_origin);
+        connected_origin = "";
+    }
     srs_freep(sdk);
 }
 
@@ -647,6 +722,8 @@ SrsPlayEdge::SrsPlayEdge()
 {
     state = SrsEdgeStateInit;
     ingester = new SrsEdgeIngester();
+    req = NULL;
+    idle_at_ = 0;
 }
 
 SrsPlayEdge::~SrsPlayEdge()
@@ -658,6 +735,8 @@ srs_error_t SrsPlayEdge::initialize(SrsLiveSource* source, SrsRequest* req)
 {
     srs_error_t err = srs_success;
     
+    this->req = req;
+    
     if ((err = ingester->initialize(source, this, req)) != srs_success) {
         return srs_error_wrap(err, "ingester(pull)");
     }
@@ -669,6 +748,12 @@ srs_error_t SrsPlayEdge::on_client_play()
 {
     srs_error_t err = srs_success;
     
+    // reuse the lingering pull.
+    if (idle_at_ > 0) {
+        srs_trace("edge reuse lingering pull, idle=%dms", srsu2msi(srs_get_system_time() - idle_at_));
+        idle_at_ = 0;
+    }
+    
     // start ingest when init state.
     if (state == SrsEdgeStateInit) {
         state = SrsEdgeStatePlay;
@@ -680,6 +765,37 @@ srs_error_t SrsPlayEdge::on_client_play()
 
 void SrsPlayEdge::on_all_client_stop()
 {
+    // keep pulling for a while, for the player which comes back soon.
+    srs_utime_t linger = _srs_config->get_vhost_edge_pull_linger(req->vhost);
+    if (linger > 0 && (state == SrsEdgeStatePlay || state == SrsEdgeStateIngestConnected)) {
+        if (idle_at_ <= 0) {
+            idle_at_ = srs_get_system_time();
+        }
+        return;
+    }
+    
+    stop();
+}
+
+void SrsPlayEdge::cycle()
+{
+    if (idle_at_ <= 0) {
+        return;
+    }
+    
+    srs_utime_t linger = _srs_config->get_vhost_edge_pull_linger(req->vhost);
+    if (srs_get_system_time() - idle_at_ < linger) {
+        return;
+    }
+    
+    srs_trace("edge stop lingering pull, linger=%dms", srsu2msi(linger));
+    stop();
+}
+
+void SrsPlayEdge::stop()
+{
+    idle_at_ = 0;
+    
     // when all client disconnected,
     // and edge is ingesting origin stream, abort it.
     if (state == SrsEdgeStatePlay || state == SrsEdgeStateIngestConnected) {
@@ -700,6 +816,11 @@ string SrsPlayEdge::get_curr_origin()
     return ingester->get_curr_origin();
 }
 
+bool SrsPlayEdge::is_pulling()
+{
+    return state != SrsEdgeStateInit;
+}
+
 srs_error_t SrsPlayEdge::on_ingest_play()
 {
     srs_error_t err = srs_success;
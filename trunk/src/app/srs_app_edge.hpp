@@ -24,7 +24,7 @@ class SrsCommonMessage;
 class SrsMessageQueue;
 class ISrsProtocolReadWriter;
 class SrsKbps;
-class SrsLbRoundRobin;
+class ISrsLoadBalancer;
 class SrsTcpClient;
 class SrsSimpleRtmpClient;
 class SrsPacket;
@@ -60,7 +60,7 @@ public:
     SrsEdgeUpstream();
     virtual ~SrsEdgeUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb) = 0;
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb) = 0;
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg) = 0;
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket) = 0;
     virtual void close() = 0;
@@ -81,12 +81,14 @@ private:
     // Current selected server, the ip:port.
     std::string selected_ip;
     int selected_port;
+    // The connected origin in config, for the balancer to count the connections.
+    std::string connected_origin;
 public:
     // @param rediect, override the server. ignore if empty.
     SrsEdgeRtmpUpstream(std::string r);
     virtual ~SrsEdgeRtmpUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
+    virtual srs_error_t connect(SrsRequest* r, ISrsLoadBalancer* lb);
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
     virtual void close();
@@ -104,7 +106,7 @@ private:
     SrsPlayEdge* edge;
     SrsRequest* req;
     SrsCoroutine* trd;
-    SrsLbRoundRobin* lb;
+    ISrsLoadBalancer* lb;
     SrsEdgeUpstream* upstream;
 public:
     SrsEdgeIngester();
@@ -133,7 +135,7 @@ private:
     SrsRequest* req;
     SrsCoroutine* trd;
     SrsSimpleRtmpClient* sdk;
-    SrsLbRoundRobin* lb;
+    ISrsLoadBalancer* lb;
     // we must ensure one thread one fd principle,
     // that is, a fd must be write/read by the one thread.
     // The publish service thread will proxy(msg), and the edge forward thread
@@ -141,6 +143,8 @@ private:
     SrsMessageQueue* queue;
     // error code of send, for edge proxy thread to query.
     int send_error_code;
+    // The connected origin in config, for the balancer to count the connections.
+    std::string connected_origin;
 public:
     SrsEdgeForwarder();
     virtual ~SrsEdgeForwarder();
@@ -150,6 +154,8 @@ public:
     virtual srs_error_t initialize(SrsLiveSource* s, SrsPublishEdge* e, SrsRequest* r);
     virtual srs_error_t start();
     virtual void stop();
+private:
+    virtual void close();
 // Interface ISrsReusableThread2Handler
 public:
     virtual srs_error_t cycle();
@@ -165,6 +171,9 @@ class SrsPlayEdge
 private:
     SrsEdgeState state;
     SrsEdgeIngester* ingester;
+    SrsRequest* req;
+    // The time when all clients stopped, to keep pulling for a while, 0 if not lingering.
+    srs_utime_t idle_at_;
 public:
     SrsPlayEdge();
     virtual ~SrsPlayEdge();
@@ -175,12 +184,18 @@ public:
     virtual srs_error_t initialize(SrsLiveSource* source, SrsRequest* req);
     // When client play stream on edge.
     virtual srs_error_t on_client_play();
-    // When all client stopped play, disconnect to origin.
+    // When all client stopped play, disconnect to origin, or linger for pull_linger.
     virtual void on_all_client_stop();
+    // Check the lingering pull, disconnect to origin if expired.
+    virtual void cycle();
     virtual std::string get_curr_origin();
+    // Whether the ingester is pulling stream from upstream.
+    virtual bool is_pulling();
 public:
     // When ingester start to play stream.
     virtual srs_error_t on_ingest_play();
+private:
+    virtual void stop();
 };
 
 // The publish edge control service.
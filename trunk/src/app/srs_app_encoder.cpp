@@ -6,6 +6,8 @@
 
 #include <srs_app_encoder.hpp>
 
+#include <unistd.h>
+#include <fcntl.h>
 #include <algorithm>
 using namespace std;
 
@@ -17,6 +19,15 @@ using namespace std;
 #include <srs_app_ffmpeg.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_core_performance.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_rtmp_msg_array.hpp>
+#include <srs_app_server.hpp>
+#include <srs_app_hybrid.hpp>
 
 // for encoder to detect the dead loop
 static std::vector<std::string> _transcoded_url;
@@ -50,7 +61,7 @@ srs_error_t SrsEncoder::on_publish(SrsRequest* req)
     }
     
     // return for error or no engine.
-    if (err != srs_success || ffmpegs.empty()) {
+    if (err != srs_success || (ffmpegs.empty() && pipes.empty())) {
         return err;
     }
     
@@ -101,6 +112,11 @@ srs_error_t SrsEncoder::cycle()
         ffmpeg->stop();
     }
     
+    for (int i = 0; i < (int)pipes.size(); i++) {
+        SrsPipeEncoder* pipe = pipes.at(i);
+        pipe->stop();
+    }
+    
     return err;
 }
 
@@ -123,31 +139,62 @@ srs_error_t SrsEncoder::do_cycle()
         }
     }
     
+    for (int i = 0; i < (int)pipes.size(); i++) {
+        SrsPipeEncoder* pipe = pipes.at(i);
+        
+        // start the ffmpeg and pipes.
+        if ((err = pipe->start()) != srs_success) {
+            return srs_error_wrap(err, "pipe start");
+        }
+        
+        // check ffmpeg and pipes status.
+        if ((err = pipe->check()) != srs_success) {
+            return srs_error_wrap(err, "pipe check");
+        }
+    }
+    
     // pithy print
     show_encode_log_message();
     
     return err;
 }
 
+// Remove the output of engine from the transcoded urls.
+void srs_encoder_remove_transcoded(SrsFFMPEG* ffmpeg)
+{
+    std::string output = ffmpeg->output();
+    
+    std::vector<std::string>::iterator tu_it;
+    tu_it = std::find(_transcoded_url.begin(), _transcoded_url.end(), output);
+    if (tu_it != _transcoded_url.end()) {
+        _transcoded_url.erase(tu_it);
+    }
+}
+
 void SrsEncoder::clear_engines()
 {
     std::vector<SrsFFMPEG*>::iterator it;
     
     for (it = ffmpegs.begin(); it != ffmpegs.end(); ++it) {
         SrsFFMPEG* ffmpeg = *it;
+        srs_encoder_remove_transcoded(ffmpeg);
+        srs_freep(ffmpeg);
+    }
+    
+    ffmpegs.clear();
+    
+    for (int i = 0; i < (int)pipes.size(); i++) {
+        SrsPipeEncoder* pipe = pipes.at(i);
         
-        std::string output = ffmpeg->output();
-        
-        std::vector<std::string>::iterator tu_it;
-        tu_it = std::find(_transcoded_url.begin(), _transcoded_url.end(), output);
-        if (tu_it != _transcoded_url.end()) {
-            _transcoded_url.erase(tu_it);
+        std::vector<SrsFFMPEG*>& engines = pipe->engines();
+        for (it = engines.begin(); it != engines.end(); ++it) {
+            srs_encoder_remove_transcoded(*it);
         }
         
-        srs_freep(ffmpeg);
+        srs_freep(pipe);
     }
     
-    ffmpegs.clear();
+    pipes.clear();
 }
 
 SrsFFMPEG* SrsEncoder::at(int index)
@@ -214,6 +261,13 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
         return err;
     }
     
+    // In pipe mode, all engines are done by one ffmpeg.
+    SrsPipeEncoder* pipe = NULL;
+    if (_srs_config->get_transcode_pipe(conf)) {
+        pipe = new SrsPipeEncoder(req);
+        pipes.push_back(pipe);
+    }
+    
     // create engine
     for (int i = 0; i < (int)engines.size(); i++) {
         SrsConfDirective* engine = engines[i];
@@ -228,7 +282,11 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
             return srs_error_wrap(err, "init ffmpeg");
         }
         
-        ffmpegs.push_back(ffmpeg);
+        if (pipe) {
+            pipe->append(ffmpeg);
+        } else {
+            ffmpegs.push_back(ffmpeg);
+        }
     }
     
     return err;
@@ -314,8 +372,466 @@ void SrsEncoder::show_encode_log_message()
     // reportable
     if (pprint->can_print()) {
         // TODO: FIXME: show more info.
-        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, input=%s",
-                  pprint->age(), (int)ffmpegs.size(), input_stream_name.c_str());
+        int nn_encoders = (int)ffmpegs.size();
+        for (int i = 0; i < (int)pipes.size(); i++) {
+            nn_encoders += (int)pipes.at(i)->engines().size();
+        }
+        
+        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, pipes=%d, input=%s",
+                  pprint->age(), nn_encoders, (int)pipes.size(), input_stream_name.c_str());
+    }
+}
+
+SrsPipeEncoderOutput::SrsPipeEncoderOutput(string url)
+{
+    output = url;
+    stfd = NULL;
+    skt = new SrsStSocket();
+    publisher = NULL;
+    trd = new SrsDummyCoroutine();
+}
+
+SrsPipeEncoderOutput::~SrsPipeEncoderOutput()
+{
+    stop();
+    
+    srs_freep(trd);
+    srs_freep(skt);
+}
+
+srs_error_t SrsPipeEncoderOutput::start(int fd)
+{
+    srs_error_t err = srs_success;
+    
+    if ((stfd = srs_netfd_open(fd)) == NULL) {
+        ::close(fd);
+        return srs_error_new(ERROR_ENCODER_PIPE, "open fd=%d", fd);
+    }
+    
+    if ((err = skt->initialize(stfd)) != srs_success) {
+        return srs_error_wrap(err, "init socket");
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("pipe-output", this);
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    return err;
+}
+
+void SrsPipeEncoderOutput::stop()
+{
+    trd->stop();
+    
+    if (publisher) {
+        publisher->unpublish();
+        srs_freep(publisher);
+    }
+    
+    srs_close_stfd(stfd);
+}
+
+srs_error_t SrsPipeEncoderOutput::pull()
+{
+    return trd->pull();
+}
+
+srs_error_t SrsPipeEncoderOutput::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    srs_trace("pipe: output %s terminated, err=%s", output.c_str(), srs_error_summary(err).c_str());
+    
+    return err;
+}
+
+srs_error_t SrsPipeEncoderOutput::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    SrsFlvDecoder dec;
+    if ((err = dec.initialize(this)) != srs_success) {
+        return srs_error_wrap(err, "init decoder");
+    }
+    
+    // Wait for ffmpeg to output the header, then we start to publish.
+    char header[9];
+    if ((err = dec.read_header(header)) != srs_success) {
+        return srs_error_wrap(err, "read header");
+    }
+    
+    char pps[4];
+    if ((err = dec.read_previous_tag_size(pps)) != srs_success) {
+        return srs_error_wrap(err, "read pts");
+    }
+    
+    srs_freep(publisher);
+    publisher = srs_create_live_publisher(output, "");
+    
+    if ((err = publisher->publish()) != srs_success) {
+        return srs_error_wrap(err, "publish %s", output.c_str());
+    }
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pipe output");
+        }
+        
+        char type;
+        int32_t size;
+        uint32_t time;
+        if ((err = dec.read_tag_header(&type, &size, &time)) != srs_success) {
+            return srs_error_wrap(err, "read tag header");
+        }
+        
+        char* data = new char[size];
+        if ((err = dec.read_tag_data(data, size)) != srs_success) {
+            srs_freepa(data);
+            return srs_error_wrap(err, "read tag data");
+        }
+        
+        SrsSharedPtrMessage* msg = NULL;
+        if ((err = srs_rtmp_create_msg(type, time, data, size, 0, &msg)) != srs_success) {
+            return srs_error_wrap(err, "create message");
+        }
+        
+        if ((err = publisher->send_and_free_message(msg)) != srs_success) {
+            return srs_error_wrap(err, "send message");
+        }
+        
+        if ((err = dec.read_previous_tag_size(pps)) != srs_success) {
+            return srs_error_wrap(err, "read pts");
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsPipeEncoderOutput::read(void* buf, size_t size, ssize_t* nread)
+{
+    // The decoder requires to read the whole tag, but the pipe might return partial.
+    return skt->read_fully(buf, size, nread);
+}
+
+SrsPipeEncoder::SrsPipeEncoder(SrsRequest* r)
+{
+    req = r->copy();
+    started = false;
+    
+    stfd = NULL;
+    skt = new SrsStSocket();
+    enc = new SrsFlvTransmuxer();
+    header_written = false;
+    consumer = NULL;
+    trd = new SrsDummyCoroutine();
+}
+
+SrsPipeEncoder::~SrsPipeEncoder()
+{
+    stop();
+    
+    srs_freep(trd);
+    srs_freep(enc);
+    srs_freep(skt);
+    
+    for (int i = 0; i < (int)outputs.size(); i++) {
+        SrsPipeEncoderOutput* output = outputs.at(i);
+        srs_freep(output);
+    }
+    outputs.clear();
+    
+    for (int i = 0; i < (int)ffmpegs.size(); i++) {
+        SrsFFMPEG* ffmpeg = ffmpegs.at(i);
+        srs_freep(ffmpeg);
+    }
+    ffmpegs.clear();
+    
+    srs_freep(req);
+}
+
+void SrsPipeEncoder::append(SrsFFMPEG* ffmpeg)
+{
+    // The child writes the output of engine to fd 3, 4, ...
+    ffmpeg->set_pipe_output(STDERR_FILENO + 1 + (int)ffmpegs.size());
+    
+    // The first engine forks the ffmpeg, to output all engines.
+    if (!ffmpegs.empty()) {
+        ffmpegs.at(0)->append_output(ffmpeg);
+    }
+    
+    ffmpegs.push_back(ffmpeg);
+    outputs.push_back(new SrsPipeEncoderOutput(ffmpeg->output()));
+}
+
+vector<SrsFFMPEG*>& SrsPipeEncoder::engines()
+{
+    return ffmpegs;
+}
+
+srs_error_t SrsPipeEncoder::start()
+{
+    srs_error_t err = srs_success;
+    
+    if (started || ffmpegs.empty()) {
+        return err;
+    }
+    started = true;
+    
+    // The fds for child process, which should be closed after forked.
+    std::vector<int> child_fds;
+    err = do_start(child_fds);
+    
+    for (int i = 0; i < (int)child_fds.size(); i++) {
+        ::close(child_fds.at(i));
+    }
+    
+    // Cleanup the pipes and ffmpeg, we will restart it later.
+    if (err != srs_success) {
+        stop();
+    }
+    
+    return err;
+}
+
+srs_error_t SrsPipeEncoder::check()
+{
+    srs_error_t err = srs_success;
+    
+    if (!started) {
+        return err;
+    }
+    
+    if ((err = ffmpegs.at(0)->cycle()) != srs_success) {
+        return srs_error_wrap(err, "ffmpeg cycle");
+    }
+    
+    // When ffmpeg quit, the pipes are broken, so we stop all to restart later.
+    if ((err = trd->pull()) != srs_success) {
+        stop();
+        return srs_error_wrap(err, "pipe input");
+    }
+    
+    for (int i = 0; i < (int)outputs.size(); i++) {
+        SrsPipeEncoderOutput* output = outputs.at(i);
+        if ((err = output->pull()) != srs_success) {
+            stop();
+            return srs_error_wrap(err, "pipe output");
+        }
+    }
+    
+    return err;
+}
+
+void SrsPipeEncoder::stop()
+{
+    if (!started) {
+        return;
+    }
+    started = false;
+    
+    trd->stop();
+    srs_freep(consumer);
+    
+    // Close the stdin, so ffmpeg got EOF.
+    srs_close_stfd(stfd);
+    header_written = false;
+    
+    if (!ffmpegs.empty()) {
+        ffmpegs.at(0)->stop();
+    }
+    
+    for (int i = 0; i < (int)outputs.size(); i++) {
+        SrsPipeEncoderOutput* output = outputs.at(i);
+        output->stop();
+    }
+}
+
+// Create a pipe, the fds should never be inherited by other processes, for example, another
+// ffmpeg which holds the write end will make the reader never get EOF.
+srs_error_t srs_encoder_create_pipe(int fds[2])
+{
+    srs_error_t err = srs_success;
+    
+    if (::pipe(fds) < 0) {
+        return srs_error_new(ERROR_ENCODER_PIPE, "create pipe");
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        if ((err = srs_fd_closeexec(fds[i])) != srs_success) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            return srs_error_wrap(err, "closeexec fd=%d", fds[i]);
+        }
+    }
+    
+    return err;
+}
+
+srs_error_t SrsPipeEncoder::do_start(std::vector<int>& child_fds)
+{
+    srs_error_t err = srs_success;
+    
+    SrsLiveSource* source = NULL;
+    if ((err = _srs_sources->fetch_or_create(req, _srs_hybrid->srs()->instance(), &source)) != srs_success) {
+        return srs_error_wrap(err, "source %s", req->get_stream_url().c_str());
+    }
+    
+    // The stdin of ffmpeg, we write the stream to fds[1].
+    int fds[2];
+    if ((err = srs_encoder_create_pipe(fds)) != srs_success) {
+        return srs_error_wrap(err, "stdin pipe");
+    }
+    child_fds.push_back(fds[0]);
+    
+    if ((stfd = srs_netfd_open(fds[1])) == NULL) {
+        ::close(fds[1]);
+        return srs_error_new(ERROR_ENCODER_PIPE, "open fd=%d", fds[1]);
+    }
+    
+    // The outputs of ffmpeg, which write the stream to fds[1].
+    std::vector<int> parent_fds;
+    for (int i = 0; i < (int)outputs.size(); i++) {
+        if ((err = srs_encoder_create_pipe(fds)) != srs_success) {
+            err = srs_error_wrap(err, "output pipe");
+            break;
+        }
+        parent_fds.push_back(fds[0]);
+        child_fds.push_back(fds[1]);
+    }
+    
+    // Always start outputs, which owns the fd to read.
+    for (int i = 0; i < (int)parent_fds.size(); i++) {
+        SrsPipeEncoderOutput* output = outputs.at(i);
+        srs_error_t r0 = output->start(parent_fds.at(i));
+        if (err == srs_success) {
+            err = r0;
+        } else {
+            srs_freep(r0);
+        }
     }
+    
+    if (err != srs_success) {
+        return srs_error_wrap(err, "start outputs");
+    }
+    
+    // Start the ffmpeg, the stdin and outputs of which are the pipes.
+    SrsFFMPEG* ffmpeg = ffmpegs.at(0);
+    std::vector<int> out_fds(child_fds.begin() + 1, child_fds.end());
+    ffmpeg->set_pipes(child_fds.at(0), out_fds);
+    
+    if ((err = ffmpeg->start()) != srs_success) {
+        return srs_error_wrap(err, "ffmpeg start");
+    }
+    
+    if ((err = skt->initialize(stfd)) != srs_success) {
+        return srs_error_wrap(err, "init socket");
+    }
+    
+    if ((err = enc->initialize(skt)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    // Feed the stream from the gop cache, so ffmpeg is able to decode it immediately.
+    srs_assert(!consumer);
+    if ((err = source->create_consumer(consumer)) != srs_success) {
+        return srs_error_wrap(err, "create consumer");
+    }
+    if ((err = source->consumer_dumps(consumer)) != srs_success) {
+        return srs_error_wrap(err, "dumps consumer");
+    }
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("pipe", this, _srs_context->get_id());
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+    
+    srs_trace("pipe: start ffmpeg for %s, outputs=%d", req->get_stream_url().c_str(), (int)outputs.size());
+    
+    return err;
+}
+
+srs_error_t SrsPipeEncoder::cycle()
+{
+    srs_error_t err = do_cycle();
+    
+    srs_trace("pipe: input %s terminated, err=%s", req->get_stream_url().c_str(), srs_error_summary(err).c_str());
+    
+    return err;
+}
+
+srs_error_t SrsPipeEncoder::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    SrsMessageArray msgs(SRS_PERF_MW_MSGS);
+    srs_utime_t mw_sleep = _srs_config->get_mw_sleep(req->vhost);
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "pipe input");
+        }
+        
+        // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
+        int count = 0;
+        if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
+            return srs_error_wrap(err, "consumer dump packets");
+        }
+        
+        if (count <= 0) {
+            srs_usleep(mw_sleep);
+            continue;
+        }
+        
+        // Block when the pipe is full, the consumer queues the messages for back-pressure.
+        if ((err = write_header(msgs.msgs, count)) == srs_success && header_written) {
+            err = enc->write_tags(msgs.msgs, count);
+        }
+        
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs.msgs[i];
+            srs_freep(msg);
+        }
+        
+        if (err != srs_success) {
+            return srs_error_wrap(err, "write tags");
+        }
+    }
+    
+    return err;
 }
 
+srs_error_t SrsPipeEncoder::write_header(SrsSharedPtrMessage** msgs, int count)
+{
+    srs_error_t err = srs_success;
+    
+    if (header_written) {
+        return err;
+    }
+    
+    // For ffmpeg to probe the streams, the header should specify the audio and video.
+    bool has_video = false;
+    bool has_audio = false;
+    for (int i = 0; i < count && (!has_video || !has_audio); i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        if (msg->is_video()) {
+            has_video = true;
+        } else if (msg->is_audio()) {
+            has_audio = true;
+        }
+    }
+    
+    // Drop data if no A+V.
+    if (!has_video && !has_audio) {
+        return err;
+    }
+    
+    if ((err = enc->write_header(has_video, has_audio)) != srs_success) {
+        return srs_error_wrap(err, "write header");
+    }
+    header_written = true;
+    
+    return err;
+}
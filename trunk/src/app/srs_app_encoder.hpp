@@ -13,11 +13,18 @@
 #include <vector>
 
 #include <srs_app_st.hpp>
+#include <srs_kernel_io.hpp>
 
 class SrsConfDirective;
 class SrsRequest;
 class SrsPithyPrint;
 class SrsFFMPEG;
+class SrsStSocket;
+class SrsLiveConsumer;
+class SrsFlvTransmuxer;
+class ISrsLivePublisher;
+class SrsPipeEncoder;
+class SrsSharedPtrMessage;
 
 // The encoder for a stream, may use multiple
 // ffmpegs to transcode the specified stream.
@@ -26,6 +33,8 @@ class SrsEncoder : public ISrsCoroutineHandler
 private:
     std::string input_stream_name;
     std::vector<SrsFFMPEG*> ffmpegs;
+    // The transcodes in pipe mode, each is a ffmpeg for all engines.
+    std::vector<SrsPipeEncoder*> pipes;
 private:
     SrsCoroutine* trd;
     SrsPithyPrint* pprint;
@@ -49,5 +58,81 @@ private:
     virtual void show_encode_log_message();
 };
 
+// The output of pipe encoder, which reads the transcoded FLV from a pipe, and publishes it to
+// the output stream of engine.
+class SrsPipeEncoderOutput : public ISrsCoroutineHandler, public ISrsReader
+{
+private:
+    std::string output;
+    // The read end of pipe, the child writes FLV to the other end.
+    srs_netfd_t stfd;
+    SrsStSocket* skt;
+    ISrsLivePublisher* publisher;
+    SrsCoroutine* trd;
+public:
+    SrsPipeEncoderOutput(std::string url);
+    virtual ~SrsPipeEncoderOutput();
+public:
+    // Start to read the transcoded stream from the read end of pipe, which is owned by us.
+    virtual srs_error_t start(int fd);
+    // Stop reading, unpublish the stream and close the pipe.
+    virtual void stop();
+    // Get the error if the output is terminated.
+    virtual srs_error_t pull();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+// Interface ISrsReader
+public:
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
+};
+
+// The encoder in pipe mode, which feeds the stream as FLV to stdin of ffmpeg, and reads the
+// FLV of each engine from a pipe, so there is no RTMP pulling and pushing over loopback. All
+// engines are done by one ffmpeg, that is, the input is decoded only once for all outputs.
+// @remark When ffmpeg is slower than realtime, the writing is blocked by the pipe, and the
+//      messages are queued by consumer, which shrinks the queue when overflow.
+class SrsPipeEncoder : public ISrsCoroutineHandler
+{
+private:
+    SrsRequest* req;
+    // The engines, the first one forks the ffmpeg which outputs all engines.
+    std::vector<SrsFFMPEG*> ffmpegs;
+    std::vector<SrsPipeEncoderOutput*> outputs;
+    bool started;
+private:
+    // The write end of pipe, to feed the stream to stdin of ffmpeg.
+    srs_netfd_t stfd;
+    SrsStSocket* skt;
+    SrsFlvTransmuxer* enc;
+    bool header_written;
+    SrsLiveConsumer* consumer;
+    SrsCoroutine* trd;
+public:
+    SrsPipeEncoder(SrsRequest* r);
+    virtual ~SrsPipeEncoder();
+public:
+    // Append an engine, which outputs to the next fd of child process.
+    // @remark We own the engine, user should never free it.
+    virtual void append(SrsFFMPEG* ffmpeg);
+    virtual std::vector<SrsFFMPEG*>& engines();
+public:
+    // Start the ffmpeg and pipes, ignore when already started.
+    virtual srs_error_t start();
+    // Check the ffmpeg and pipes, stop all when any terminated, user can restart it by start().
+    virtual srs_error_t check();
+    virtual void stop();
+private:
+    virtual srs_error_t do_start(std::vector<int>& child_fds);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual srs_error_t write_header(SrsSharedPtrMessage** msgs, int count);
+};
+
 #endif
 
@@ -54,6 +54,7 @@ SrsFFMPEG::SrsFFMPEG(std::string ffmpeg_bin)
     abitrate = 0;
     asample_rate = 0;
     achannels = 0;
+    output_fd = -1;
     
     process = new SrsProcess();
 }
@@ -80,6 +81,25 @@ string SrsFFMPEG::output()
     return _output;
 }
 
+void SrsFFMPEG::set_pipe_output(int fd)
+{
+    output_fd = fd;
+    
+    // The pipe is a stream, so we must use FLV which requires no seeking.
+    iformat = "flv";
+    oformat = "flv";
+}
+
+void SrsFFMPEG::append_output(SrsFFMPEG* engine)
+{
+    outputs.push_back(engine);
+}
+
+void SrsFFMPEG::set_pipes(int in, vector<int> outs)
+{
+    process->set_pipes(in, outs);
+}
+
 srs_error_t SrsFFMPEG::initialize(string in, string out, string log)
 {
     srs_error_t err = srs_success;
@@ -238,8 +258,36 @@ srs_error_t SrsFFMPEG::start()
     }
     
     params.push_back("-i");
-    params.push_back(input);
+    params.push_back((output_fd >= 0)? "pipe:0" : input);
+    
+    // Output for this engine, then others which share the input.
+    append_output_params(params);
+    for (int i = 0; i < (int)outputs.size(); i++) {
+        outputs[i]->append_output_params(params);
+    }
+    
+    // when specified the log file.
+    if (!log_file.empty()) {
+        // stdout
+        params.push_back("1");
+        params.push_back(">");
+        params.push_back(log_file);
+        // stderr
+        params.push_back("2");
+        params.push_back(">");
+        params.push_back(log_file);
+    }
+    
+    // initialize the process.
+    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
+        return srs_error_wrap(err, "init process");
+    }
     
+    return process->start();
+}
+
+void SrsFFMPEG::append_output_params(vector<string>& params)
+{
     // build the filter
     if (!vfilter.empty()) {
         std::vector<std::string>::iterator it;
@@ -367,26 +415,7 @@ srs_error_t SrsFFMPEG::start()
     }
     
     params.push_back("-y");
-    params.push_back(_output);
-    
-    // when specified the log file.
-    if (!log_file.empty()) {
-        // stdout
-        params.push_back("1");
-        params.push_back(">");
-        params.push_back(log_file);
-        // stderr
-        params.push_back("2");
-        params.push_back(">");
-        params.push_back(log_file);
-    }
-    
-    // initialize the process.
-    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
-        return srs_error_wrap(err, "init process");
-    }
-    
-    return process->start();
+    params.push_back((output_fd >= 0)? "pipe:" + srs_int2str(output_fd) : _output);
 }
 
 srs_error_t SrsFFMPEG::cycle()
@@ -49,6 +49,12 @@ private:
     std::vector<std::string>    aparams;
     std::string                 oformat;
     std::string                 _output;
+private:
+    // For pipe mode, the fd of child process to write the output to, -1 for the output url.
+    int output_fd;
+    // The engines to output together, which share the input and decoding of this one.
+    // @remark We don't own the engines.
+    std::vector<SrsFFMPEG*> outputs;
 public:
     SrsFFMPEG(std::string ffmpeg_bin);
     virtual ~SrsFFMPEG();
@@ -56,12 +62,21 @@ public:
     virtual void append_iparam(std::string iparam);
     virtual void set_oformat(std::string format);
     virtual std::string output();
+    // Read FLV stream from stdin, and write the output as FLV to the fd of child process.
+    virtual void set_pipe_output(int fd);
+    // Append the output of another engine, to decode the input once for multiple outputs.
+    virtual void append_output(SrsFFMPEG* engine);
+    // Redirect the stdin and fds of child process to pipes, see SrsProcess::set_pipes.
+    virtual void set_pipes(int in, std::vector<int> outs);
 public:
     virtual srs_error_t initialize(std::string in, std::string out, std::string log);
     virtual srs_error_t initialize_transcode(SrsConfDirective* engine);
     virtual srs_error_t initialize_copy();
 public:
     virtual srs_error_t start();
+private:
+    virtual void append_output_params(std::vector<std::string>& params);
+public:
     virtual srs_error_t cycle();
     virtual void stop();
 public:
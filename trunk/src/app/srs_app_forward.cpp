@@ -29,6 +29,7 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_kernel_balance.hpp>
 
 SrsForwarder::SrsForwarder(SrsOriginHub* h)
 {
@@ -202,7 +203,12 @@ srs_error_t SrsForwarder::do_cycle()
     srs_utime_t sto = SRS_CONSTS_RTMP_TIMEOUT;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    // Track the health of destination, which is shared with the balancer of edge.
+    srs_utime_t starttime = srs_get_system_time();
+    SrsLbHealth* health = SrsLbHealth::instance();
+    
     if ((err = sdk->connect()) != srs_success) {
+        health->on_failed(ep_forward, srs_get_system_time());
         return srs_error_wrap(err, "sdk connect url=%s, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
 
@@ -210,14 +216,21 @@ srs_error_t SrsForwarder::do_cycle()
     // so we publish without vhost in stream.
     string stream;
     if ((err = sdk->publish(_srs_config->get_chunk_size(req->vhost), false, &stream)) != srs_success) {
+        health->on_failed(ep_forward, srs_get_system_time());
         return srs_error_wrap(err, "sdk publish");
     }
     
+    health->on_connected(ep_forward, srs_get_system_time() - starttime, sdk->server_info()->load, srs_get_system_time());
+    
     if ((err = hub->on_forwarder_start(this)) != srs_success) {
         return srs_error_wrap(err, "notify hub start");
     }
     
-    if ((err = forward()) != srs_success) {
+    health->acquire(ep_forward);
+    err = forward();
+    health->release(ep_forward);
+    
+    if (err != srs_success) {
         return srs_error_wrap(err, "forward");
     }
 
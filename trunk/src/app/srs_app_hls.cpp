@@ -34,8 +34,12 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_app_http_hooks.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_kernel_kbps.hpp>
 #include <openssl/rand.h>
 
+// The histogram of the time to close and write the segment.
+SrsHistogram* _srs_histogram_segment = NULL;
+
 // drop the segment when duration of ts too small.
 // TODO: FIXME: Refine to time unit.
 #define SRS_HLS_SEGMENT_MIN_DURATION (100 * SRS_UTIME_MILLISECONDS)
@@ -575,7 +579,9 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
 
 srs_error_t SrsHlsMuxer::segment_close()
 {
+    srs_utime_t starttime = srs_get_tick();
     srs_error_t err = do_segment_close();
+    _srs_histogram_segment->update(srs_get_tick() - starttime);
 
     // We always cleanup current segment.
     srs_freep(current);
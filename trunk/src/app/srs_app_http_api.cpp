@@ -9,6 +9,7 @@
 #include <sstream>
 #include <stdlib.h>
 #include <signal.h>
+#include <limits.h>
 #include <unistd.h>
 using namespace std;
 
@@ -30,6 +31,8 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_metrics.hpp>
+#include <srs_kernel_kbps.hpp>
 
 srs_error_t srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, string data)
 {
@@ -161,6 +164,77 @@ srs_error_t srs_api_response_code(ISrsHttpResponseWriter* w, ISrsHttpMessage* r,
     return err;
 }
 
+// The number of items to dumps in a chunk, then sleep to serve other connections.
+#define SRS_API_DUMPS_CHUNK 100
+
+srs_error_t srs_api_response_list(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, const char* name,
+    _pfn_srs_stat_dumps dumps, int start, int count)
+{
+    srs_error_t err = srs_success;
+    
+    SrsStatistic* stat = SrsStatistic::instance();
+    
+    // Select the fields of items, for example, fields=id+name, because comma is the separator of query.
+    SrsJsonWriter jw;
+    string fields = r->query_get("fields");
+    if (!fields.empty()) {
+        jw.select(srs_string_split(fields, "+"), 3);
+    }
+    
+    // Response in chunked encoding without content length, because the size is unknown.
+    string callback = r->is_jsonp()? r->query_get("callback") : "";
+    w->header()->set_content_type(r->is_jsonp()? "text/javascript" : "application/json");
+    w->write_header(SRS_CONSTS_HTTP_OK);
+    
+    if (r->is_jsonp()) {
+        callback += "(";
+        if ((err = w->write((char*)callback.data(), (int)callback.length())) != srs_success) {
+            return srs_error_wrap(err, "write jsonp callback");
+        }
+    }
+    
+    jw.object_start();
+    jw.integer("code", ERROR_SUCCESS);
+    jw.str("server", stat->server_id());
+    jw.array_start(name);
+    
+    // Dumps in chunks, resume by the cursor because the items might change when sleeping.
+    string cursor;
+    for (int left = count; left > 0;) {
+        int nn = 0;
+        int limit = srs_min(left, SRS_API_DUMPS_CHUNK);
+        if ((err = (stat->*dumps)(&jw, start, limit, cursor, nn)) != srs_success) {
+            return srs_error_wrap(err, "dumps %s", name);
+        }
+        
+        if ((err = w->write(jw.bytes(), jw.length())) != srs_success) {
+            return srs_error_wrap(err, "write %s", name);
+        }
+        jw.reset();
+        
+        left -= nn;
+        if (nn < limit) {
+            break;
+        }
+        
+        // Sleep rather than yield, to let ST poll the IO of other connections.
+        srs_usleep(0);
+    }
+    
+    jw.array_end();
+    jw.object_end();
+    
+    if ((err = w->write(jw.bytes(), jw.length())) != srs_success) {
+        return srs_error_wrap(err, "write %s", name);
+    }
+    
+    if (r->is_jsonp() && (err = w->write((char*)")", 1)) != srs_success) {
+        return srs_error_wrap(err, "write jsonp right token");
+    }
+    
+    return w->final_request();
+}
+
 SrsGoApiRoot::SrsGoApiRoot()
 {
 }
@@ -194,6 +268,7 @@ srs_error_t SrsGoApiRoot::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage*
         v1->set("play", SrsJsonAny::str("Play stream"));
         v1->set("publish", SrsJsonAny::str("Publish stream"));
         v1->set("nack", SrsJsonAny::str("Simulate the NACK"));
+        v1->set("bwe", SrsJsonAny::str("The estimated bandwidth and simulcast layers of players, and keyframe requests of publishers"));
     }
 
     return srs_api_response(w, r, obj->dumps());
@@ -745,37 +820,34 @@ srs_error_t SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_STREAM_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
     
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+    // Dumps all streams if no count.
+    if (!stream) {
+        std::string rstart = r->query_get("start");
+        std::string rcount = r->query_get("count");
+        int start = srs_max(0, atoi(rstart.c_str()));
+        int count = rcount.empty()? INT_MAX : srs_max(1, atoi(rcount.c_str()));
+        return srs_api_response_list(w, r, "streams", &SrsStatistic::dumps_streams, start, count);
+    }
     
-    if (r->is_http_get()) {
-        if (!stream) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("streams", data);
-            
-            if ((err = stat->dumps_streams(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("stream", data);;
-            
-            if ((err = stream->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        }
-    } else {
-        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    SrsJsonWriter jw;
+    jw.object_start();
+    jw.integer("code", ERROR_SUCCESS);
+    jw.str("server", stat->server_id());
+    
+    jw.object_start("stream");
+    if ((err = stream->dumps(&jw)) != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
     }
+    jw.object_end();
+    jw.object_end();
     
-    return srs_api_response(w, r, obj->dumps());
+    return srs_api_response(w, r, string(jw.bytes(), jw.length()));
 }
 
 SrsGoApiClients::SrsGoApiClients()
@@ -801,36 +873,27 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+    SrsJsonWriter jw;
+    jw.object_start();
+    jw.integer("code", ERROR_SUCCESS);
+    jw.str("server", stat->server_id());
     
     if (r->is_http_get()) {
         if (!client) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("clients", data);
-            
             std::string rstart = r->query_get("start");
             std::string rcount = r->query_get("count");
             int start = srs_max(0, atoi(rstart.c_str()));
             int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_clients(data, start, count)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("client", data);;
-            
-            if ((err = client->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
+            return srs_api_response_list(w, r, "clients", &SrsStatistic::dumps_clients, start, count);
+        }
+        
+        jw.object_start("client");
+        if ((err = client->dumps(&jw)) != srs_success) {
+            int code = srs_error_code(err);
+            srs_error_reset(err);
+            return srs_api_response_code(w, r, code);
         }
+        jw.object_end();
     } else if (r->is_http_delete()) {
         if (!client) {
             return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
@@ -841,8 +904,9 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
     } else {
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
+    jw.object_end();
     
-    return srs_api_response(w, r, obj->dumps());
+    return srs_api_response(w, r, string(jw.bytes(), jw.length()));
 }
 
 SrsGoApiRaw::SrsGoApiRaw(SrsServer* svr)
@@ -1304,6 +1368,83 @@ srs_error_t SrsGoApiError::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage
     return srs_api_response_code(w, r, 100);
 }
 
+// The initial size of metrics buffer, which grows for lots of streams.
+#define SRS_METRICS_BUFFER_SIZE (64 * 1024)
+
+SrsGoApiMetrics::SrsGoApiMetrics()
+{
+    writer = new SrsMetricsWriter(SRS_METRICS_BUFFER_SIZE);
+}
+
+SrsGoApiMetrics::~SrsGoApiMetrics()
+{
+    srs_freep(writer);
+}
+
+srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    writer->reset();
+    srs_metrics_dumps(writer);
+    SrsStatistic::instance()->dumps_metrics(writer);
+
+    w->header()->set_content_type("text/plain; version=0.0.4; charset=utf-8");
+    w->header()->set_content_length(writer->length());
+    w->write_header(SRS_CONSTS_HTTP_OK);
+
+    if ((err = w->write(writer->bytes(), writer->length())) != srs_success) {
+        return srs_error_wrap(err, "write");
+    }
+
+    return err;
+}
+
+SrsGoApiLatencies::SrsGoApiLatencies()
+{
+}
+
+SrsGoApiLatencies::~SrsGoApiLatencies()
+{
+}
+
+srs_error_t SrsGoApiLatencies::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+
+    bool reset = r->query_get("reset") == "1";
+
+    std::vector<SrsHistogram*>& histograms = srs_histogram_registry();
+    for (int i = 0; i < (int)histograms.size(); i++) {
+        SrsHistogram* h = histograms.at(i);
+
+        SrsJsonObject* item = SrsJsonAny::object();
+        data->set(h->name(), item);
+
+        item->set("count", SrsJsonAny::integer(h->count()));
+        item->set("avg", SrsJsonAny::integer(h->count() ? h->sum() / h->count() : 0));
+        item->set("p50", SrsJsonAny::integer(h->percentile(0.5)));
+        item->set("p90", SrsJsonAny::integer(h->percentile(0.9)));
+        item->set("p99", SrsJsonAny::integer(h->percentile(0.99)));
+        item->set("max", SrsJsonAny::integer(h->max()));
+
+        if (reset) {
+            h->reset();
+        }
+    }
+
+    return srs_api_response(w, r, obj->dumps());
+}
+
 #ifdef SRS_GPERF
 #include <gperftools/malloc_extension.h>
 
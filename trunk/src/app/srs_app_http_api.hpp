@@ -19,6 +19,9 @@ class SrsSdp;
 class SrsRequest;
 class ISrsHttpResponseWriter;
 class SrsHttpConn;
+class SrsMetricsWriter;
+class SrsStatistic;
+class SrsJsonWriter;
 
 #include <string>
 
@@ -32,6 +35,14 @@ extern srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage*
 extern srs_error_t srs_api_response_code(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, int code);
 extern srs_error_t srs_api_response_code(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, srs_error_t code);
 
+// The function of stat to dumps the items in pages, for example, SrsStatistic::dumps_clients.
+typedef srs_error_t (SrsStatistic::*_pfn_srs_stat_dumps)(SrsJsonWriter* w, int start, int count, std::string& cursor, int& nn);
+
+// Response the items of stat as a list in name, in chunked encoding, and serve other connections
+// when dumps lots of items. The fields of items are selected by query fields=id+name if specified.
+extern srs_error_t srs_api_response_list(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, const char* name,
+    _pfn_srs_stat_dumps dumps, int start, int count);
+
 // For http root.
 class SrsGoApiRoot : public ISrsHttpHandler
 {
@@ -205,6 +216,30 @@ public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
+// The metrics in Prometheus text format, for monitor system to scrape.
+class SrsGoApiMetrics : public ISrsHttpHandler
+{
+private:
+    // The buffer is reused between scrapes.
+    SrsMetricsWriter* writer;
+public:
+    SrsGoApiMetrics();
+    virtual ~SrsGoApiMetrics();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The latency histograms in JSON, such as the stages of media pipeline, in us.
+// @remark Use reset=1 to clear the histograms after dumped, to measure a new period.
+class SrsGoApiLatencies : public ISrsHttpHandler
+{
+public:
+    SrsGoApiLatencies();
+    virtual ~SrsGoApiLatencies();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
 #ifdef SRS_GPERF
 class SrsGoApiTcmalloc : public ISrsHttpHandler
 {
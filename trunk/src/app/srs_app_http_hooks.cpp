@@ -21,6 +21,7 @@ using namespace std;
 #include <srs_app_http_conn.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_kernel_kbps.hpp>
 
 #define SRS_HTTP_RESPONSE_OK    SRS_XSTR(ERROR_SUCCESS)
 
@@ -31,6 +32,9 @@ using namespace std;
 // the timeout for hls notify, in srs_utime_t.
 #define SRS_HLS_NOTIFY_TIMEOUT (10 * SRS_UTIME_SECONDS)
 
+// The histogram of the latency of http hooks.
+SrsHistogram* _srs_histogram_hooks = NULL;
+
 SrsHttpHooks::SrsHttpHooks()
 {
 }
@@ -470,15 +474,26 @@ srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::strin
         path += "?" + uri.get_query();
     }
     
+    srs_utime_t starttime = srs_get_tick();
+    
     ISrsHttpMessage* msg = NULL;
-    if ((err = hc->post(path, req, &msg)) != srs_success) {
-        return srs_error_wrap(err, "http: client post");
-    }
+    err = hc->post(path, req, &msg);
     SrsAutoFree(ISrsHttpMessage, msg);
     
-    code = msg->status_code();
-    if ((err = msg->body_read_all(res)) != srs_success) {
-        return srs_error_wrap(err, "http: body read");
+    if (err == srs_success) {
+        code = msg->status_code();
+        if ((err = msg->body_read_all(res)) != srs_success) {
+            err = srs_error_wrap(err, "http: body read");
+        }
+    } else {
+        err = srs_error_wrap(err, "http: client post");
+    }
+    
+    // Update the latency even if failed, because the slow or timeout hooks block the clients too.
+    _srs_histogram_hooks->update(srs_get_tick() - starttime);
+    
+    if (err != srs_success) {
+        return err;
     }
     
     // ensure the http status is ok.
@@ -176,12 +176,14 @@ srs_error_t SrsVodStream::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMe
 SrsHttpStaticServer::SrsHttpStaticServer(SrsServer* svr)
 {
     server = svr;
+    cache = NULL;
     _srs_config->subscribe(this);
 }
 
 SrsHttpStaticServer::~SrsHttpStaticServer()
 {
     _srs_config->unsubscribe(this);
+    srs_freep(cache);
 }
 
 srs_error_t SrsHttpStaticServer::initialize()
@@ -189,6 +191,14 @@ srs_error_t SrsHttpStaticServer::initialize()
     srs_error_t err = srs_success;
     
     bool default_root_exists = false;
+
+    // The cache of hot files, shared by all vhosts.
+    if (_srs_config->get_http_stream_cache_enabled()) {
+        int64_t max_size = _srs_config->get_http_stream_cache_max_size();
+        int64_t max_file = _srs_config->get_http_stream_cache_max_file();
+        cache = new SrsHttpFileCache(max_size, max_file);
+        srs_trace("http: cache hot files, max_size=%dMB, max_file=%dMB", (int)(max_size / 1024 / 1024), (int)(max_file / 1024 / 1024));
+    }
     
     // http static file and flv vod stream mount for each vhost.
     SrsConfDirective* root = _srs_config->get_root();
@@ -215,7 +225,9 @@ srs_error_t SrsHttpStaticServer::initialize()
     if (!default_root_exists) {
         // add root
         std::string dir = _srs_config->get_http_stream_dir();
-        if ((err = mux.handle("/", new SrsVodStream(dir))) != srs_success) {
+        SrsVodStream* vod = new SrsVodStream(dir);
+        vod->set_cache(cache);
+        if ((err = mux.handle("/", vod)) != srs_success) {
             return srs_error_wrap(err, "mount root dir=%s", dir.c_str());
         }
         srs_trace("http: root mount to %s", dir.c_str());
@@ -254,7 +266,9 @@ srs_error_t SrsHttpStaticServer::mount_vhost(string vhost, string& pmount)
     }
     
     // mount the http of vhost.
-    if ((err = mux.handle(mount, new SrsVodStream(dir))) != srs_success) {
+    SrsVodStream* vod = new SrsVodStream(dir);
+    vod->set_cache(cache);
+    if ((err = mux.handle(mount, vod)) != srs_success) {
         return srs_error_wrap(err, "mux handle");
     }
     srs_trace("http: vhost=%s mount to %s at %s", vhost.c_str(), mount.c_str(), dir.c_str());
@@ -31,6 +31,8 @@ class SrsHttpStaticServer : public ISrsReloadHandler
 {
 private:
     SrsServer* server;
+    // The cache of hot files, NULL if disabled.
+    SrsHttpFileCache* cache;
 public:
     SrsHttpServeMux mux;
 public:
@@ -39,6 +39,10 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_app_recv_thread.hpp>
 #include <srs_app_http_hooks.hpp>
+#include <srs_kernel_kbps.hpp>
+
+extern SrsHistogram* _srs_histogram_stage_send;
+extern SrsHistogram* _srs_histogram_stage_e2e;
 
 SrsBufferCache::SrsBufferCache(SrsLiveSource* s, SrsRequest* r)
 {
@@ -668,6 +672,10 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
                 count, pprint->age(), SRS_PERF_MW_MIN_MSGS, srsu2msi(mw_sleep));
         }
         
+        // @remark Measure the e2e of the oldest message in batch, same to RTMP.
+        srs_utime_t recv_tick = msgs.msgs[0]->recv_tick;
+        srs_utime_t send_tick = srs_get_tick();
+
         // sendout all messages.
         if (ffe) {
             err = ffe->write_tags(msgs.msgs, count);
@@ -675,6 +683,14 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
             err = streaming_send_messages(enc, msgs.msgs, count);
         }
 
+        if (err == srs_success) {
+            srs_utime_t now = srs_get_tick();
+            _srs_histogram_stage_send->update(now - send_tick);
+            if (recv_tick > 0) {
+                _srs_histogram_stage_e2e->update(now - recv_tick);
+            }
+        }
+
         // TODO: FIXME: Update the stat.
 
         // free the messages.
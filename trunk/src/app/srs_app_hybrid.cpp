@@ -11,6 +11,7 @@
 #include <srs_kernel_error.hpp>
 #include <srs_service_st.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_log.hpp>
 
 using namespace std;
 
@@ -22,6 +23,15 @@ extern SrsPps* _srs_pps_pub;
 extern SrsPps* _srs_pps_conn;
 extern SrsPps* _srs_pps_dispose;
 
+extern SrsPps* _srs_pps_tls_handshakes;
+extern SrsPps* _srs_pps_tls_resumed;
+#ifdef SRS_RTC
+extern SrsPps* _srs_pps_dtls_handshakes;
+#endif
+
+SrsPps* _srs_pps_alogs = NULL;
+SrsPps* _srs_pps_alogs_drop = NULL;
+
 #if defined(SRS_DEBUG) && defined(SRS_DEBUG_STATS)
 extern unsigned long long _st_stat_recvfrom;
 extern unsigned long long _st_stat_recvfrom_eagain;
@@ -226,6 +236,12 @@ srs_error_t SrsHybridServer::initialize()
 {
     srs_error_t err = srs_success;
 
+    // Start the async log writer, we are running after daemon, so the thread is alive.
+    SrsFileLog* log = dynamic_cast<SrsFileLog*>(_srs_log);
+    if (log && (err = log->start_async()) != srs_success) {
+        return srs_error_wrap(err, "start async log");
+    }
+
     // Start the timer first.
     if ((err = timer20ms_->start()) != srs_success) {
         return srs_error_wrap(err, "start timer");
@@ -350,6 +366,19 @@ srs_error_t SrsHybridServer::on_timer(srs_utime_t interval)
         free_desc = buf;
     }
 
+    string tls_desc;
+    _srs_pps_tls_handshakes->update(); _srs_pps_tls_resumed->update();
+#ifdef SRS_RTC
+    _srs_pps_dtls_handshakes->update();
+    int dtls_handshakes = _srs_pps_dtls_handshakes->r10s();
+#else
+    int dtls_handshakes = 0;
+#endif
+    if (_srs_pps_tls_handshakes->r10s() || _srs_pps_tls_resumed->r10s() || dtls_handshakes) {
+        snprintf(buf, sizeof(buf), ", tls=%d,%d,%d", _srs_pps_tls_handshakes->r10s(), _srs_pps_tls_resumed->r10s(), dtls_handshakes);
+        tls_desc = buf;
+    }
+
     string recvfrom_desc;
 #if defined(SRS_DEBUG) && defined(SRS_DEBUG_STATS)
     _srs_pps_recvfrom->update(_st_stat_recvfrom); _srs_pps_recvfrom_eagain->update(_st_stat_recvfrom_eagain);
@@ -436,12 +465,23 @@ srs_error_t SrsHybridServer::on_timer(srs_utime_t interval)
     }
 #endif
 
-    srs_trace("Hybrid cpu=%.2f%%,%dMB%s%s%s%s%s%s%s%s%s%s%s",
+    string log_desc;
+    SrsFileLog* log = dynamic_cast<SrsFileLog*>(_srs_log);
+    SrsAsyncLogWriter* alog = log? log->async_writer() : NULL;
+    if (alog) {
+        _srs_pps_alogs->update(alog->nn_lines()); _srs_pps_alogs_drop->update(alog->nn_dropped());
+        if (_srs_pps_alogs->r10s() || _srs_pps_alogs_drop->r10s()) {
+            snprintf(buf, sizeof(buf), ", alog=%d,%d", _srs_pps_alogs->r10s(), _srs_pps_alogs_drop->r10s());
+            log_desc = buf;
+        }
+    }
+
+    srs_trace("Hybrid cpu=%.2f%%,%dMB%s%s%s%s%s%s%s%s%s%s%s%s%s",
         u->percent * 100, memory,
-        cid_desc.c_str(), timer_desc.c_str(),
+        cid_desc.c_str(), timer_desc.c_str(), tls_desc.c_str(),
         recvfrom_desc.c_str(), io_desc.c_str(), msg_desc.c_str(),
         epoll_desc.c_str(), sched_desc.c_str(), clock_desc.c_str(),
-        thread_desc.c_str(), free_desc.c_str(), objs_desc.c_str()
+        thread_desc.c_str(), free_desc.c_str(), objs_desc.c_str(), log_desc.c_str()
     );
 
     return err;
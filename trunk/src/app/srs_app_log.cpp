@@ -7,18 +7,23 @@
 #include <srs_app_log.hpp>
 
 #include <stdarg.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <sys/time.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 
 #include <srs_app_config.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_kernel_utility.hpp>
 
+using namespace std;
+
 // the max size of a line of log.
 #define LOG_MAX_SIZE 8192
 
@@ -27,6 +32,407 @@
 // reserved for the end of log data, it must be strlen(LOG_TAIL)
 #define LOG_TAIL_SIZE 1
 
+// The max iovecs to writev for each ring.
+#define SRS_ALOG_IOVS 2
+// The interval in us for writer thread to sleep when no log.
+#define SRS_ALOG_IDLE_US 10000
+// The interval in us for producer to wait for writer when ring is full.
+#define SRS_ALOG_BLOCK_US 100
+// The max retries to write the log file, when interrupted or no progress.
+#define SRS_ALOG_WRITE_RETRIES 3
+
+SrsLogRingBuffer::SrsLogRingBuffer(uint32_t capacity)
+{
+    // Align the capacity to power of 2.
+    capacity_ = 1;
+    while (capacity_ < capacity) {
+        capacity_ <<= 1;
+    }
+
+    data_ = new char[capacity_];
+    read_ = write_ = 0;
+    nn_lines_ = nn_dropped_ = 0;
+    next = NULL;
+}
+
+SrsLogRingBuffer::~SrsLogRingBuffer()
+{
+    srs_freepa(data_);
+}
+
+bool SrsLogRingBuffer::push(const char* data, int size)
+{
+    uint32_t r = __atomic_load_n(&read_, __ATOMIC_ACQUIRE);
+    uint32_t w = write_;
+
+    if (capacity_ - (w - r) < (uint32_t)size) {
+        return false;
+    }
+
+    // Copy the line, which maybe wrap to the start of ring.
+    uint32_t pos = w & (capacity_ - 1);
+    uint32_t first = srs_min(capacity_ - pos, (uint32_t)size);
+    memcpy(data_ + pos, data, first);
+    if (first < (uint32_t)size) {
+        memcpy(data_, data + first, size - first);
+    }
+
+    __atomic_store_n(&write_, w + size, __ATOMIC_RELEASE);
+    __atomic_store_n(&nn_lines_, nn_lines_ + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+void SrsLogRingBuffer::on_dropped()
+{
+    __atomic_store_n(&nn_dropped_, nn_dropped_ + 1, __ATOMIC_RELAXED);
+}
+
+int SrsLogRingBuffer::peek(iovec* iovs)
+{
+    uint32_t w = __atomic_load_n(&write_, __ATOMIC_ACQUIRE);
+    uint32_t r = read_;
+
+    uint32_t size = w - r;
+    if (!size) {
+        return 0;
+    }
+
+    uint32_t pos = r & (capacity_ - 1);
+    uint32_t first = srs_min(capacity_ - pos, size);
+
+    iovs[0].iov_base = data_ + pos;
+    iovs[0].iov_len = first;
+    if (first == size) {
+        return 1;
+    }
+
+    iovs[1].iov_base = data_;
+    iovs[1].iov_len = size - first;
+    return 2;
+}
+
+void SrsLogRingBuffer::consume(uint32_t size)
+{
+    __atomic_store_n(&read_, read_ + size, __ATOMIC_RELEASE);
+}
+
+uint64_t SrsLogRingBuffer::nn_lines()
+{
+    return __atomic_load_n(&nn_lines_, __ATOMIC_RELAXED);
+}
+
+uint64_t SrsLogRingBuffer::nn_dropped()
+{
+    return __atomic_load_n(&nn_dropped_, __ATOMIC_RELAXED);
+}
+
+// The ring of current thread, we only have one async writer.
+static __thread SrsLogRingBuffer* _srs_log_ring = NULL;
+
+SrsAsyncLogWriter::SrsAsyncLogWriter()
+{
+    started_ = false;
+    quit_ = false;
+
+    capacity_ = 0;
+    block_ = false;
+    st_thread_ = pthread_self();
+    utc_ = false;
+    binary_ = NULL;
+    rings_ = NULL;
+
+    fd_ = -1;
+    reopen_ = 0;
+    nn_reported_ = 0;
+    nn_failed_ = 0;
+
+    pthread_mutex_init(&lock_, NULL);
+}
+
+SrsAsyncLogWriter::~SrsAsyncLogWriter()
+{
+    stop();
+
+    SrsLogRingBuffer* p = rings_;
+    while (p) {
+        SrsLogRingBuffer* ring = p;
+        p = p->next;
+        srs_freep(ring);
+    }
+    _srs_log_ring = NULL;
+
+    if (fd_ > 0) {
+        ::close(fd_);
+    }
+
+    pthread_mutex_destroy(&lock_);
+}
+
+srs_error_t SrsAsyncLogWriter::initialize(string filename, int size, bool block, SrsBinaryLogEncoder* binary, bool utc)
+{
+    filename_ = filename;
+    binary_ = binary;
+    utc_ = utc;
+    // Should never be smaller than a line.
+    capacity_ = (uint32_t)srs_max(size, LOG_MAX_SIZE * 8);
+    block_ = block;
+
+    return srs_success;
+}
+
+srs_error_t SrsAsyncLogWriter::start()
+{
+    srs_error_t err = srs_success;
+
+    if (started_) {
+        return err;
+    }
+
+    do_reopen();
+    st_thread_ = pthread_self();
+
+    int r0 = pthread_create(&trd_, NULL, SrsAsyncLogWriter::pfn, this);
+    if (r0 != 0) {
+        return srs_error_new(ERROR_THREAD_CREATE, "create async log thread, r0=%d", r0);
+    }
+    started_ = true;
+
+    return err;
+}
+
+bool SrsAsyncLogWriter::running()
+{
+    return started_;
+}
+
+void SrsAsyncLogWriter::stop()
+{
+    if (!started_) {
+        return;
+    }
+
+    __atomic_store_n(&quit_, true, __ATOMIC_RELEASE);
+    pthread_join(trd_, NULL);
+    started_ = false;
+}
+
+void SrsAsyncLogWriter::reopen(string filename)
+{
+    pthread_mutex_lock(&lock_);
+    filename_ = filename;
+    pthread_mutex_unlock(&lock_);
+
+    __atomic_store_n(&reopen_, 1, __ATOMIC_RELEASE);
+}
+
+bool SrsAsyncLogWriter::write(const char* data, int size)
+{
+    SrsLogRingBuffer* ring = fetch_ring();
+
+    while (!ring->push(data, size)) {
+        // Drop the line if ring is full, the writer thread will report it. Never block the ST thread,
+        // which stalls all coroutines, and it's not safe to yield in log.
+        if (!block_ || !started_ || pthread_equal(pthread_self(), st_thread_)) {
+            ring->on_dropped();
+            return false;
+        }
+
+        // Wait for the writer thread to drain the ring.
+        usleep(SRS_ALOG_BLOCK_US);
+    }
+
+    return true;
+}
+
+uint64_t SrsAsyncLogWriter::nn_lines()
+{
+    uint64_t v = 0;
+    for (SrsLogRingBuffer* p = __atomic_load_n(&rings_, __ATOMIC_ACQUIRE); p; p = p->next) {
+        v += p->nn_lines();
+    }
+    return v;
+}
+
+uint64_t SrsAsyncLogWriter::nn_dropped()
+{
+    uint64_t v = __atomic_load_n(&nn_failed_, __ATOMIC_RELAXED);
+    for (SrsLogRingBuffer* p = __atomic_load_n(&rings_, __ATOMIC_ACQUIRE); p; p = p->next) {
+        v += p->nn_dropped();
+    }
+    return v;
+}
+
+SrsLogRingBuffer* SrsAsyncLogWriter::fetch_ring()
+{
+    if (_srs_log_ring) {
+        return _srs_log_ring;
+    }
+
+    SrsLogRingBuffer* ring = new SrsLogRingBuffer(capacity_);
+
+    // Register the ring to the head of list, lock-free.
+    ring->next = __atomic_load_n(&rings_, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&rings_, &ring->next, ring, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+    }
+
+    _srs_log_ring = ring;
+    return ring;
+}
+
+void* SrsAsyncLogWriter::pfn(void* arg)
+{
+    SrsAsyncLogWriter* writer = (SrsAsyncLogWriter*)arg;
+    writer->cycle();
+    return NULL;
+}
+
+void SrsAsyncLogWriter::cycle()
+{
+    while (true) {
+        // Drain the lines of old file before reopen.
+        if (__atomic_load_n(&reopen_, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&reopen_, 0, __ATOMIC_RELEASE);
+            drain();
+            do_reopen();
+        }
+
+        // Report the dropped lines, by writing a line to file directly.
+        uint64_t dropped = nn_dropped();
+        if (dropped > nn_reported_ && fd_ > 0 && !binary_) {
+            char buf[512];
+            int nn = 0;
+            if (srs_log_header(buf, sizeof(buf), utc_, false, NULL, SrsContextId(), "Warn", &nn)) {
+                nn += snprintf(buf + nn, sizeof(buf) - nn, "async log dropped %" PRIu64 " lines, total %" PRIu64 "\n",
+                    dropped - nn_reported_, dropped);
+                nn = srs_min(nn, (int)sizeof(buf) - 1);
+
+                iovec iov;
+                iov.iov_base = buf;
+                iov.iov_len = nn;
+                write_all(&iov, 1);
+            }
+        }
+        nn_reported_ = dropped;
+
+        // Quit util all rings are drained.
+        bool quit = __atomic_load_n(&quit_, __ATOMIC_ACQUIRE);
+        if (drain() > 0) {
+            continue;
+        }
+        if (quit) {
+            break;
+        }
+
+        usleep(SRS_ALOG_IDLE_US);
+    }
+}
+
+int SrsAsyncLogWriter::drain()
+{
+    int nn = 0;
+
+    iovec iovs[SRS_ALOG_IOVS];
+    for (SrsLogRingBuffer* p = __atomic_load_n(&rings_, __ATOMIC_ACQUIRE); p; p = p->next) {
+        int nn_iovs = p->peek(iovs);
+        if (!nn_iovs) {
+            continue;
+        }
+
+        ssize_t size = 0;
+        for (int i = 0; i < nn_iovs; i++) {
+            size += iovs[i].iov_len;
+        }
+
+        // Consume all bytes even if write failed, to avoid blocking the producer, but count the lost
+        // lines as dropped, or one for the binary log which we don't parse.
+        ssize_t left = (fd_ > 0)? write_all(iovs, nn_iovs) : size;
+        if (left > 0) {
+            uint64_t lost = binary_? 1 : 0;
+            for (int i = nn_iovs - 1; !binary_ && i >= 0 && left > 0; i--) {
+                ssize_t nb = srs_min(left, (ssize_t)iovs[i].iov_len);
+                char* end = (char*)iovs[i].iov_base + iovs[i].iov_len;
+                for (char* q = end - nb; q < end; q++) {
+                    lost += (*q == LOG_TAIL)? 1 : 0;
+                }
+                left -= nb;
+            }
+            __atomic_store_n(&nn_failed_, nn_failed_ + srs_max(lost, (uint64_t)1), __ATOMIC_RELAXED);
+        }
+
+        p->consume((uint32_t)size);
+        nn += (int)size;
+    }
+
+    return nn;
+}
+
+ssize_t SrsAsyncLogWriter::write_all(iovec* iovs, int nn_iovs)
+{
+    ssize_t left = 0;
+    for (int i = 0; i < nn_iovs; i++) {
+        left += iovs[i].iov_len;
+    }
+
+    // Copy the iovs, which are advanced for partial writes.
+    iovec vs[SRS_ALOG_IOVS];
+    nn_iovs = srs_min(nn_iovs, SRS_ALOG_IOVS);
+    memcpy(vs, iovs, sizeof(iovec) * nn_iovs);
+
+    iovec* p = vs;
+    for (int retry = 0; left > 0 && retry < SRS_ALOG_WRITE_RETRIES;) {
+        ssize_t nn = ::writev(fd_, p, nn_iovs);
+        if (nn < 0 && errno != EINTR && errno != EAGAIN) {
+            break;
+        }
+        if (nn <= 0) {
+            retry++;
+            continue;
+        }
+
+        retry = 0;
+        left -= nn;
+        while (nn_iovs > 0 && nn >= (ssize_t)p->iov_len) {
+            nn -= p->iov_len;
+            p++;
+            nn_iovs--;
+        }
+        if (nn_iovs > 0) {
+            p->iov_base = (char*)p->iov_base + nn;
+            p->iov_len -= nn;
+        }
+    }
+
+    return left;
+}
+
+void SrsAsyncLogWriter::do_reopen()
+{
+    pthread_mutex_lock(&lock_);
+    string filename = filename_;
+    pthread_mutex_unlock(&lock_);
+
+    if (fd_ > 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    if (filename.empty()) {
+        return;
+    }
+
+    fd_ = ::open(filename.c_str(),
+        O_RDWR | O_CREAT | O_APPEND,
+        S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH
+    );
+
+    // The binary log starts with the header and formats, before any lines in rings.
+    if (fd_ > 0 && binary_) {
+        string preamble = binary_->preamble();
+        ::write(fd_, preamble.data(), preamble.size());
+    }
+}
+
 SrsFileLog::SrsFileLog()
 {
     level = SrsLogLevelTrace;
@@ -35,11 +441,15 @@ SrsFileLog::SrsFileLog()
     fd = -1;
     log_to_file_tank = false;
     utc = false;
+    async_ = NULL;
+    binary_ = NULL;
 }
 
 SrsFileLog::~SrsFileLog()
 {
     srs_freepa(log_data);
+    srs_freep(async_);
+    srs_freep(binary_);
     
     if (fd > 0) {
         ::close(fd);
@@ -53,19 +463,63 @@ SrsFileLog::~SrsFileLog()
 
 srs_error_t SrsFileLog::initialize()
 {
+    srs_error_t err = srs_success;
+
     if (_srs_config) {
         _srs_config->subscribe(this);
         
         log_to_file_tank = _srs_config->get_log_tank_file();
         level = srs_get_log_level(_srs_config->get_log_level());
         utc = _srs_config->get_utc_time();
+
+        // Create the binary log encoder, only for file.
+        if (log_to_file_tank && _srs_config->get_log_format_binary()) {
+            srs_freep(binary_);
+            binary_ = new SrsBinaryLogEncoder(utc);
+        }
+
+        // Create the async writer, which is started after daemon.
+        if (log_to_file_tank && _srs_config->get_log_async()) {
+            srs_freep(async_);
+            async_ = new SrsAsyncLogWriter();
+            if ((err = async_->initialize(_srs_config->get_log_file(),
+                _srs_config->get_log_async_buffer(), _srs_config->get_log_async_block(), binary_, utc)) != srs_success) {
+                return srs_error_wrap(err, "init async log");
+            }
+        }
     }
     
-    return srs_success;
+    return err;
+}
+
+srs_error_t SrsFileLog::start_async()
+{
+    srs_error_t err = srs_success;
+
+    if (!async_) {
+        return err;
+    }
+
+    if ((err = async_->start()) != srs_success) {
+        return srs_error_wrap(err, "start async log");
+    }
+
+    return err;
+}
+
+SrsAsyncLogWriter* SrsFileLog::async_writer()
+{
+    return async_;
 }
 
 void SrsFileLog::reopen()
 {
+    // The async writer owns the log file, so notify it to reopen.
+    if (async_ && async_->running()) {
+        async_->reopen(_srs_config->get_log_file());
+        return;
+    }
+
     if (fd > 0) {
         ::close(fd);
     }
@@ -83,6 +537,14 @@ void SrsFileLog::verbose(const char* tag, SrsContextId context_id, const char* f
         return;
     }
     
+    if (binary_ && log_to_file_tank) {
+        va_list ap;
+        va_start(ap, fmt);
+        write_binary(tag, context_id, SrsLogLevelVerbose, fmt, ap);
+        va_end(ap);
+        return;
+    }
+    
     int size = 0;
     if (!srs_log_header(log_data, LOG_MAX_SIZE, utc, false, tag, context_id, "Verb", &size)) {
         return;
@@ -103,6 +565,14 @@ void SrsFileLog::info(const char* tag, SrsContextId context_id, const char* fmt,
         return;
     }
     
+    if (binary_ && log_to_file_tank) {
+        va_list ap;
+        va_start(ap, fmt);
+        write_binary(tag, context_id, SrsLogLevelInfo, fmt, ap);
+        va_end(ap);
+        return;
+    }
+    
     int size = 0;
     if (!srs_log_header(log_data, LOG_MAX_SIZE, utc, false, tag, context_id, "Debug", &size)) {
         return;
@@ -123,6 +593,14 @@ void SrsFileLog::trace(const char* tag, SrsContextId context_id, const char* fmt
         return;
     }
     
+    if (binary_ && log_to_file_tank) {
+        va_list ap;
+        va_start(ap, fmt);
+        write_binary(tag, context_id, SrsLogLevelTrace, fmt, ap);
+        va_end(ap);
+        return;
+    }
+    
     int size = 0;
     if (!srs_log_header(log_data, LOG_MAX_SIZE, utc, false, tag, context_id, "Trace", &size)) {
         return;
@@ -143,6 +621,14 @@ void SrsFileLog::warn(const char* tag, SrsContextId context_id, const char* fmt,
         return;
     }
     
+    if (binary_ && log_to_file_tank) {
+        va_list ap;
+        va_start(ap, fmt);
+        write_binary(tag, context_id, SrsLogLevelWarn, fmt, ap);
+        va_end(ap);
+        return;
+    }
+    
     int size = 0;
     if (!srs_log_header(log_data, LOG_MAX_SIZE, utc, true, tag, context_id, "Warn", &size)) {
         return;
@@ -163,6 +649,14 @@ void SrsFileLog::error(const char* tag, SrsContextId context_id, const char* fmt
         return;
     }
     
+    if (binary_ && log_to_file_tank) {
+        va_list ap;
+        va_start(ap, fmt);
+        write_binary(tag, context_id, SrsLogLevelError, fmt, ap);
+        va_end(ap);
+        return;
+    }
+    
     int size = 0;
     if (!srs_log_header(log_data, LOG_MAX_SIZE, utc, true, tag, context_id, "Error", &size)) {
         return;
@@ -241,6 +735,11 @@ srs_error_t SrsFileLog::on_reload_log_file()
     if (!log_to_file_tank) {
         return err;
     }
+
+    if (async_ && async_->running()) {
+        async_->reopen(_srs_config->get_log_file());
+        return err;
+    }
     
     if (fd > 0) {
         ::close(fd);
@@ -278,6 +777,31 @@ void SrsFileLog::write_log(int& fd, char *str_log, int size, int level)
         
         return;
     }
+
+    write_file(str_log, size);
+}
+
+void SrsFileLog::write_binary(const char* tag, SrsContextId context_id, int level, const char* fmt, va_list ap)
+{
+    // Save the errno, which maybe changed by encoder.
+    int err = errno;
+
+    int size = binary_->encode(log_data, LOG_MAX_SIZE, level, tag, context_id, err, fmt, ap);
+    if (size <= 0) {
+        binary_->on_written(false);
+        return;
+    }
+
+    bool written = write_file(log_data, size);
+    binary_->on_written(written);
+}
+
+bool SrsFileLog::write_file(char* data, int size)
+{
+    // write to ring, the writer thread will write it to file.
+    if (async_ && async_->running()) {
+        return async_->write(data, size);
+    }
     
     // open log file. if specified
     if (fd < 0) {
@@ -286,8 +810,10 @@ void SrsFileLog::write_log(int& fd, char *str_log, int size, int level)
     
     // write log to file.
     if (fd > 0) {
-        ::write(fd, str_log, size);
+        ::write(fd, data, size);
     }
+
+    return fd > 0;
 }
 
 void SrsFileLog::open_log_file()
@@ -306,5 +832,11 @@ void SrsFileLog::open_log_file()
         O_RDWR | O_CREAT | O_APPEND,
         S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH
     );
+
+    // The binary log starts with the header and formats.
+    if (fd > 0 && binary_) {
+        string preamble = binary_->preamble();
+        ::write(fd, preamble.data(), preamble.size());
+    }
 }
 
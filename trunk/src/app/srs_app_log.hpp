@@ -11,6 +11,9 @@
 
 #include <string.h>
 #include <string>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/uio.h>
 
 #include <srs_app_reload.hpp>
 #include <srs_service_log.hpp>
@@ -23,6 +26,114 @@
 #define TAG_RESOURCE_UNSUB "RESOURCE_UNSUB"
 #define TAG_LARGE_TIMER "LARGE_TIMER"
 
+// The lock-free ring buffer for async log, which is written by only one thread(the producer),
+// and read by only the async log writer thread(the consumer).
+// @remark The capacity must be power of 2, and the positions are free running.
+class SrsLogRingBuffer
+{
+private:
+    char* data_;
+    uint32_t capacity_;
+    // The read position, only updated by the consumer.
+    uint32_t read_;
+    // The write position, only updated by the producer.
+    uint32_t write_;
+    // The number of lines written and dropped, only updated by the producer.
+    uint64_t nn_lines_;
+    uint64_t nn_dropped_;
+public:
+    // The next ring in the list of writer, never changed after registered.
+    SrsLogRingBuffer* next;
+public:
+    SrsLogRingBuffer(uint32_t capacity);
+    virtual ~SrsLogRingBuffer();
+// For producer.
+public:
+    // Append a line to ring, return false if no enough space.
+    bool push(const char* data, int size);
+    void on_dropped();
+// For consumer.
+public:
+    // Get the readable bytes as iovecs, return the number of iovecs, 0, 1 or 2.
+    int peek(iovec* iovs);
+    // Consume the size of bytes, which has been written to file.
+    void consume(uint32_t size);
+// For statistic, read by any thread.
+public:
+    uint64_t nn_lines();
+    uint64_t nn_dropped();
+};
+
+// The async log writer, each thread writes log to its own lock-free ring buffer,
+// and a background thread drains all rings to the log file by writev.
+// @remark The writer thread must be started after daemon, because thread never survive fork.
+class SrsAsyncLogWriter
+{
+private:
+    pthread_t trd_;
+    bool started_;
+    // Set to notify the writer thread to quit.
+    bool quit_;
+private:
+    // The size of ring for each thread.
+    uint32_t capacity_;
+    // Whether wait for writer when ring is full, or drop the line.
+    // @remark The ST thread never waits, because it stalls all coroutines.
+    bool block_;
+    // The thread which starts the writer, which is the ST thread.
+    pthread_t st_thread_;
+    // Whether use UTC time in the header of dropped report.
+    bool utc_;
+    // The binary log encoder, NULL for text log. The dropped lines is reported to text log only.
+    SrsBinaryLogEncoder* binary_;
+    // The list of rings, a new ring is pushed to the head by CAS.
+    SrsLogRingBuffer* rings_;
+private:
+    // The log file, only accessed by the writer thread after started.
+    int fd_;
+    // Protect the filename, which is changed by reopen.
+    pthread_mutex_t lock_;
+    std::string filename_;
+    // Set to notify the writer thread to reopen the log file.
+    int reopen_;
+    // The number of dropped lines which has been reported, for writer thread only.
+    uint64_t nn_reported_;
+    // The number of lines failed to write to file, only updated by the writer thread.
+    uint64_t nn_failed_;
+public:
+    SrsAsyncLogWriter();
+    virtual ~SrsAsyncLogWriter();
+public:
+    // Initialize the writer, where the size is in bytes for each ring.
+    // @param binary The binary log encoder, NULL for text log.
+    // @param utc Whether use UTC time in the header of dropped report.
+    srs_error_t initialize(std::string filename, int size, bool block, SrsBinaryLogEncoder* binary, bool utc);
+    // Start the writer thread.
+    srs_error_t start();
+    // Whether writer thread is running.
+    bool running();
+    // Flush all lines and stop the writer thread.
+    void stop();
+    // Notify the writer to reopen the log file, for log rotate.
+    void reopen(std::string filename);
+public:
+    // Write a log line, called by any thread, return false if dropped.
+    bool write(const char* data, int size);
+public:
+    // The total number of lines written and dropped.
+    uint64_t nn_lines();
+    uint64_t nn_dropped();
+private:
+    SrsLogRingBuffer* fetch_ring();
+    static void* pfn(void* arg);
+    void cycle();
+    // Drain all rings to file, return the number of bytes.
+    int drain();
+    // Write all bytes of iovs to file, retry for partial writes, return the bytes not written.
+    ssize_t write_all(iovec* iovs, int nn_iovs);
+    void do_reopen();
+};
+
 // Use memory/disk cache and donot flush when write log.
 // it's ok to use it without config, which will log to console, and default trace level.
 // when you want to use different level, override this classs, set the protected _level.
@@ -39,6 +150,10 @@ private:
     bool log_to_file_tank;
     // Whether use utc time.
     bool utc;
+    // The async writer, NULL if write log synchronously.
+    SrsAsyncLogWriter* async_;
+    // The binary log encoder, NULL if write text log.
+    SrsBinaryLogEncoder* binary_;
 public:
     SrsFileLog();
     virtual ~SrsFileLog();
@@ -51,6 +166,11 @@ public:
     virtual void trace(const char* tag, SrsContextId context_id, const char* fmt, ...);
     virtual void warn(const char* tag, SrsContextId context_id, const char* fmt, ...);
     virtual void error(const char* tag, SrsContextId context_id, const char* fmt, ...);
+public:
+    // Start the async log writer if configured, which should be called after daemon.
+    virtual srs_error_t start_async();
+    // Get the async writer, NULL if disabled.
+    virtual SrsAsyncLogWriter* async_writer();
 // Interface ISrsReloadHandler.
 public:
     virtual srs_error_t on_reload_utc_time();
@@ -59,6 +179,8 @@ public:
     virtual srs_error_t on_reload_log_file();
 private:
     virtual void write_log(int& fd, char* str_log, int size, int level);
+    virtual void write_binary(const char* tag, SrsContextId context_id, int level, const char* fmt, va_list ap);
+    virtual bool write_file(char* data, int size);
     virtual void open_log_file();
 };
 
@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_metrics.hpp>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+using namespace std;
+
+#include <srs_kernel_kbps.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_utility.hpp>
+
+SrsMetricsWriter::SrsMetricsWriter(int size)
+{
+    size_ = srs_max(size, 1024);
+    buf_ = new char[size_];
+    pos_ = 0;
+}
+
+SrsMetricsWriter::~SrsMetricsWriter()
+{
+    srs_freepa(buf_);
+}
+
+void SrsMetricsWriter::reset()
+{
+    pos_ = 0;
+}
+
+char* SrsMetricsWriter::bytes()
+{
+    return buf_;
+}
+
+int SrsMetricsWriter::length()
+{
+    return pos_;
+}
+
+void SrsMetricsWriter::family(const char* name, const char* type, const char* help)
+{
+    printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void SrsMetricsWriter::sample(const char* name, const char* labels, int64_t v)
+{
+    if (labels) {
+        printf("%s{%s} %" PRId64 "\n", name, labels, v);
+    } else {
+        printf("%s %" PRId64 "\n", name, v);
+    }
+}
+
+void SrsMetricsWriter::sample(const char* name, const char* labels, double v)
+{
+    if (labels) {
+        printf("%s{%s} %.6f\n", name, labels, v);
+    } else {
+        printf("%s %.6f\n", name, v);
+    }
+}
+
+void SrsMetricsWriter::histogram(SrsHistogram* h, const char* help)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "srs_%s_seconds", h->name());
+    family(name, "histogram", help);
+
+    // The buckets are cumulative in Prometheus.
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_HISTOGRAM_BUCKETS; i++) {
+        nn += h->bucket(i);
+        printf("%s_bucket{le=\"%.6f\"} %" PRId64 "\n", name, SrsHistogram::bound(i) / (double)SRS_UTIME_SECONDS, nn);
+    }
+    nn += h->bucket(SRS_HISTOGRAM_BUCKETS);
+    printf("%s_bucket{le=\"+Inf\"} %" PRId64 "\n", name, nn);
+
+    printf("%s_sum %.6f\n", name, h->sum() / (double)SRS_UTIME_SECONDS);
+    printf("%s_count %" PRId64 "\n", name, h->count());
+}
+
+void SrsMetricsWriter::printf(const char* fmt, ...)
+{
+    while (true) {
+        va_list ap;
+        va_start(ap, fmt);
+        int r0 = vsnprintf(buf_ + pos_, size_ - pos_, fmt, ap);
+        va_end(ap);
+
+        if (r0 < 0) {
+            return;
+        }
+
+        if (r0 < size_ - pos_) {
+            pos_ += r0;
+            return;
+        }
+
+        // Not enough, grow the buffer which is kept for next time.
+        int size = srs_max(size_ * 2, pos_ + r0 + 1);
+        char* buf = new char[size];
+        memcpy(buf, buf_, pos_);
+        srs_freepa(buf_);
+        buf_ = buf;
+        size_ = size;
+    }
+}
+
+string SrsMetricsWriter::escape(const string& v)
+{
+    if (v.find_first_of("\\\"\n") == string::npos) {
+        return v;
+    }
+
+    string r;
+    for (int i = 0; i < (int)v.length(); i++) {
+        char ch = v.at(i);
+        if (ch == '\\') {
+            r += "\\\\";
+        } else if (ch == '"') {
+            r += "\\\"";
+        } else if (ch == '\n') {
+            r += "\\n";
+        } else {
+            r += ch;
+        }
+    }
+    return r;
+}
+
+void srs_metrics_dumps(SrsMetricsWriter* w)
+{
+    w->family("srs_info", "gauge", "The version of SRS.");
+    w->printf("srs_info{version=\"%s\",pid=\"%d\"} 1\n", RTMP_SIG_SRS_VERSION, (int)getpid());
+
+    w->family("srs_uptime_seconds", "gauge", "The time since SRS started.");
+    w->sample("srs_uptime_seconds", NULL, (int64_t)((srs_get_system_time() - srs_get_system_startup_time()) / SRS_UTIME_SECONDS));
+
+    SrsProcSelfStat* u = srs_get_self_proc_stat();
+    if (u->ok) {
+        w->family("srs_cpu_percent", "gauge", "The CPU usage of SRS, 0.153 is 15.3%.");
+        w->sample("srs_cpu_percent", NULL, (double)u->percent);
+
+        w->family("srs_memory_rss_bytes", "gauge", "The resident set size of SRS.");
+        w->sample("srs_memory_rss_bytes", NULL, (int64_t)u->rss * getpagesize());
+    }
+
+    // The events counted by pps, such as the syscalls and packets.
+    std::vector<SrsPps*>& pps = srs_pps_registry();
+    w->family("srs_events_total", "counter", "The number of events, see the name.");
+    for (int i = 0; i < (int)pps.size(); i++) {
+        SrsPps* p = pps.at(i);
+        w->printf("srs_events_total{name=\"%s\"} %" PRId64 "\n", p->name(), p->sugar);
+    }
+
+    std::vector<SrsHistogram*>& histograms = srs_histogram_registry();
+    for (int i = 0; i < (int)histograms.size(); i++) {
+        SrsHistogram* h = histograms.at(i);
+        w->histogram(h, "The latency histogram, see the name.");
+    }
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_METRICS_HPP
+#define SRS_APP_METRICS_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+class SrsHistogram;
+
+// The writer for metrics in Prometheus text format, which renders to a buffer reused
+// between scrapes, so it's cheap to scrape frequently.
+// @see https://prometheus.io/docs/instrumenting/exposition_formats/
+class SrsMetricsWriter
+{
+private:
+    char* buf_;
+    int size_;
+    int pos_;
+public:
+    // @param size The initial size of buffer, which grows when not enough.
+    SrsMetricsWriter(int size);
+    virtual ~SrsMetricsWriter();
+public:
+    // Reset the buffer to render again.
+    virtual void reset();
+    virtual char* bytes();
+    virtual int length();
+public:
+    // Declare the metric family, the type is counter, gauge or histogram.
+    virtual void family(const char* name, const char* type, const char* help);
+    // Write a sample of metric, the labels is formatted like a="x",b="y", or NULL.
+    virtual void sample(const char* name, const char* labels, int64_t v);
+    virtual void sample(const char* name, const char* labels, double v);
+    // Write the histogram, with the family declared.
+    virtual void histogram(SrsHistogram* h, const char* help);
+    // Write formatted text to buffer, checked by compiler like printf.
+    virtual void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+public:
+    // Escape the label value, for backslash, double-quote and line feed.
+    static std::string escape(const std::string& v);
+};
+
+// Dumps the metrics of server, such as pps and histograms, exclude the vhost and streams.
+extern void srs_metrics_dumps(SrsMetricsWriter* w);
+
+#endif
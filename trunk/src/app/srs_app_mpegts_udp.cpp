@@ -31,7 +31,7 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_raw_avc.hpp>
 #include <srs_app_pithy_print.hpp>
-#include <srs_app_rtmp_conn.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_protocol_utility.hpp>
 
 SrsMpegtsQueue::SrsMpegtsQueue()
@@ -114,7 +114,7 @@ SrsMpegtsOverUdp::SrsMpegtsOverUdp(SrsConfDirective* c)
     buffer = new SrsSimpleStream();
     output = _srs_config->get_stream_caster_output(c);
     
-    sdk = NULL;
+    publisher = NULL;
     
     avc = new SrsRawH264Stream();
     aac = new SrsRawAacStream();
@@ -558,7 +558,7 @@ srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, c
     
     SrsSharedPtrMessage* msg = NULL;
     
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, sdk->sid(), &msg)) != srs_success) {
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 0, &msg)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
     srs_assert(msg);
@@ -580,7 +580,7 @@ srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, c
         }
         
         // send out encoded msg.
-        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+        if ((err = publisher->send_and_free_message(msg)) != srs_success) {
             close();
             return srs_error_wrap(err, "send messages");
         }
@@ -594,22 +594,16 @@ srs_error_t SrsMpegtsOverUdp::connect()
     srs_error_t err = srs_success;
     
     // Ignore when connected.
-    if (sdk) {
+    if (publisher) {
         return err;
     }
     
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(output, cto, sto);
+    // publish, in process when the url is served by this server.
+    publisher = srs_create_live_publisher(output, "");
     
-    if ((err = sdk->connect()) != srs_success) {
+    if ((err = publisher->publish()) != srs_success) {
         close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", output.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        close();
-        return srs_error_wrap(err, "publish");
+        return srs_error_wrap(err, "publish %s", output.c_str());
     }
     
     return err;
@@ -617,6 +611,6 @@ srs_error_t SrsMpegtsOverUdp::connect()
 
 void SrsMpegtsOverUdp::close()
 {
-    srs_freep(sdk);
+    srs_freep(publisher);
 }
 
@@ -25,7 +25,7 @@ class SrsSharedPtrMessage;
 class SrsRawAacStream;
 struct SrsRawAacStreamCodec;
 class SrsPithyPrint;
-class SrsSimpleRtmpClient;
+class ISrsLivePublisher;
 
 #include <srs_app_st.hpp>
 #include <srs_kernel_ts.hpp>
@@ -57,7 +57,7 @@ private:
     SrsSimpleStream* buffer;
     std::string output;
 private:
-    SrsSimpleRtmpClient* sdk;
+    ISrsLivePublisher* publisher;
 private:
     SrsRawH264Stream* avc;
     std::string h264_sps;
@@ -91,9 +91,9 @@ private:
 private:
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 private:
-    // Connect to RTMP server.
+    // Publish the stream to RTMP server.
     virtual srs_error_t connect();
-    // Close the connection to RTMP server.
+    // Unpublish the stream.
     virtual void close();
 };
 
@@ -33,6 +33,7 @@ SrsProcess::SrsProcess()
     is_started         = false;
     fast_stopped       = false;
     pid                = -1;
+    stdin_fd           = -1;
 }
 
 SrsProcess::~SrsProcess()
@@ -124,6 +125,12 @@ srs_error_t SrsProcess::initialize(string binary, vector<string> argv)
     return err;
 }
 
+void SrsProcess::set_pipes(int in, vector<int> outs)
+{
+    stdin_fd = in;
+    pipe_fds = outs;
+}
+
 srs_error_t srs_redirect_output(string from_file, int to_fd)
 {
     srs_error_t err = srs_success;
@@ -153,6 +160,44 @@ srs_error_t srs_redirect_output(string from_file, int to_fd)
     return err;
 }
 
+srs_error_t srs_redirect_pipes(int in_fd, vector<int> out_fds)
+{
+    srs_error_t err = srs_success;
+    
+    // The fd to dup to, stdin for the in_fd, and 3, 4, ... for the out_fds.
+    vector<int> froms, tos;
+    if (in_fd >= 0) {
+        froms.push_back(in_fd);
+        tos.push_back(STDIN_FILENO);
+    }
+    for (int i = 0; i < (int)out_fds.size(); i++) {
+        froms.push_back(out_fds[i]);
+        tos.push_back(STDERR_FILENO + 1 + i);
+    }
+    
+    // Move all fds over the target fds, or dup2 might overwrite the fd we are going to dup.
+    int base = STDERR_FILENO + 1 + (int)out_fds.size();
+    for (int i = 0; i < (int)froms.size(); i++) {
+        int fd = fcntl(froms[i], F_DUPFD, base);
+        if (fd < 0) {
+            return srs_error_new(ERROR_FORK_DUP2_LOG, "dup fd=%d, base=%d", froms[i], base);
+        }
+        froms[i] = fd;
+    }
+    
+    // Note that dup2 clears the FD_CLOEXEC of the new fd, so it's inherited by exec.
+    for (int i = 0; i < (int)froms.size(); i++) {
+        int r0 = dup2(froms[i], tos[i]);
+        ::close(froms[i]);
+        
+        if (r0 < 0) {
+            return srs_error_new(ERROR_FORK_DUP2_LOG, "dup2 fd=%d, to=%d, r0=%d", froms[i], tos[i], r0);
+        }
+    }
+    
+    return err;
+}
+
 srs_error_t SrsProcess::start()
 {
     srs_error_t err = srs_success;
@@ -196,9 +241,14 @@ srs_error_t SrsProcess::start()
         }
 
         // No stdin for process, @bug https://github.com/ossrs/srs/issues/1592
-        if ((err = srs_redirect_output("/dev/null", STDIN_FILENO)) != srs_success) {
+        if (stdin_fd < 0 && (err = srs_redirect_output("/dev/null", STDIN_FILENO)) != srs_success) {
             return srs_error_wrap(err, "redirect input");
         }
+        
+        // Redirect the stdin and outputs to pipes, for encoder to feed and read the stream.
+        if ((err = srs_redirect_pipes(stdin_fd, pipe_fds)) != srs_success) {
+            return srs_error_wrap(err, "redirect pipes");
+        }
 
         // should never close the fd 3+, for it myabe used.
         // for fd should close at exec, use fnctl to set it.
@@ -36,6 +36,9 @@ private:
     std::string bin;
     std::string stdout_file;
     std::string stderr_file;
+    // The fds of pipes for child process, redirect to its stdin and fd 3, 4, ...
+    int stdin_fd;
+    std::vector<int> pipe_fds;
     std::vector<std::string> params;
     // The cli to fork process.
     std::string cli;
@@ -53,6 +56,11 @@ public:
     // @param argv the argv for binary path, the argv[0] generally is the binary.
     // @remark the argv[0] must be the binary.
     virtual srs_error_t initialize(std::string binary, std::vector<std::string> argv);
+    // Redirect the stdin of child process to fd in, and the fd 3, 4, ... to the outs.
+    // @param in The read end of pipe for stdin, -1 to use /dev/null.
+    // @param outs The write ends of pipes, for child to write outputs, such as pipe:3 of FFmpeg.
+    // @remark User should close the fds after started, which are dup to the child process.
+    virtual void set_pipes(int in, std::vector<int> outs);
 public:
     // Start the process, ignore when already started.
     virtual srs_error_t start();
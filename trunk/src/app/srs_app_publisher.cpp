@@ -0,0 +1,538 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_publisher.hpp>
+
+#include <string.h>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_protocol_amf0.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_service_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_server.hpp>
+#include <srs_app_hybrid.hpp>
+#include <srs_app_rtmp_conn.hpp>
+#include <srs_app_utility.hpp>
+#ifdef SRS_RTC
+#include <srs_app_rtc_source.hpp>
+#endif
+
+// Whether the RTMP url is served by this server, that is the host is this machine and the
+// port is one of the RTMP listens.
+bool srs_is_local_rtmp_url(string url)
+{
+    string tcUrl, stream;
+    srs_parse_rtmp_url(url, tcUrl, stream);
+
+    int port;
+    string schema, host, vhost, app, param;
+    srs_discovery_tc_url(tcUrl, schema, host, vhost, app, stream, port, param);
+
+    if (schema != "rtmp") {
+        return false;
+    }
+
+    // The local ips never contains the loopback.
+    bool local = (host == "localhost" || host == "127.0.0.1" || host == "::1");
+    vector<SrsIPAddress*>& ips = srs_get_local_ips();
+    for (int i = 0; !local && i < (int)ips.size(); i++) {
+        local = (ips[i]->ip == host);
+    }
+    if (!local) {
+        return false;
+    }
+
+    vector<string> listens = _srs_config->get_listens();
+    for (int i = 0; i < (int)listens.size(); i++) {
+        string ip;
+        int listen_port;
+        srs_parse_endpoint(listens[i], ip, listen_port);
+        if (listen_port == port) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+ISrsLivePublisher* srs_create_live_publisher(string url, string ip)
+{
+    if (srs_is_local_rtmp_url(url)) {
+        return new SrsLiveSourcePublisher(url, ip.empty()? "127.0.0.1" : ip);
+    }
+    return new SrsRtmpRelayPublisher(url);
+}
+
+ISrsLivePublisher::ISrsLivePublisher()
+{
+}
+
+ISrsLivePublisher::~ISrsLivePublisher()
+{
+}
+
+SrsLiveSourcePublisher::SrsLiveSourcePublisher(string url, string ip)
+{
+    url_ = url;
+    ip_ = ip;
+    cid_ = _srs_context->generate_id();
+    req_ = NULL;
+    source_ = NULL;
+    edge_ = false;
+    trd_ = new SrsSTCoroutine("publisher", this, _srs_context->get_id());
+
+    connected_ = false;
+    hooked_ = false;
+    acquired_ = false;
+    expired_ = false;
+
+    sstream_ = NULL;
+    nn_msgs_ = 0;
+    nn_bytes_ = 0;
+    nn_bytes_remarked_ = 0;
+}
+
+SrsLiveSourcePublisher::~SrsLiveSourcePublisher()
+{
+    trd_->stop();
+    unpublish();
+
+    srs_freep(trd_);
+    srs_freep(req_);
+}
+
+srs_error_t SrsLiveSourcePublisher::publish()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = do_publish()) != srs_success) {
+        return srs_error_wrap(err, "publish %s", url_.c_str());
+    }
+
+    if ((err = trd_->start()) != srs_success) {
+        return srs_error_wrap(err, "start publisher");
+    }
+
+    srs_trace("publisher: publish %s in process, ip=%s, cid=%s, edge=%d",
+        req_->get_stream_url().c_str(), ip_.c_str(), cid_.c_str(), edge_);
+
+    return err;
+}
+
+srs_error_t SrsLiveSourcePublisher::do_publish()
+{
+    srs_error_t err = srs_success;
+
+    srs_freep(req_);
+    req_ = new SrsRequest();
+    req_->ip = ip_;
+    connected_ = true;
+
+    // Parse the request like a RTMP client, see SrsRtmpServer::connect_app.
+    srs_parse_rtmp_url(url_, req_->tcUrl, req_->stream);
+    srs_discovery_tc_url(req_->tcUrl, req_->schema, req_->host, req_->vhost, req_->app, req_->stream, req_->port, req_->param);
+    req_->strip();
+
+    SrsConfDirective* vhost = _srs_config->get_vhost(req_->vhost, true);
+    if (vhost == NULL) {
+        return srs_error_new(ERROR_RTMP_VHOST_NOT_FOUND, "no vhost %s", req_->vhost.c_str());
+    }
+    if (!_srs_config->get_vhost_enabled(req_->vhost)) {
+        return srs_error_new(ERROR_RTMP_VHOST_NOT_FOUND, "vhost %s disabled", req_->vhost.c_str());
+    }
+    req_->vhost = vhost->arg0();
+
+    if (req_->stream.empty()) {
+        return srs_error_new(ERROR_RTMP_STREAM_NAME_EMPTY, "empty stream");
+    }
+
+    SrsSecurity security;
+    if ((err = security.check(SrsRtmpConnFMLEPublish, ip_, req_)) != srs_success) {
+        return srs_error_wrap(err, "security check");
+    }
+
+    // Call on_connect hooks before any other hooks, as RTMP does.
+    if (_srs_config->get_vhost_http_hooks_enabled(req_->vhost)) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_connect(req_->vhost);
+        vector<string> hooks = conf? conf->args : vector<string>();
+        for (int i = 0; i < (int)hooks.size(); i++) {
+            if ((err = SrsHttpHooks::on_connect(hooks.at(i), req_)) != srs_success) {
+                return srs_error_wrap(err, "on_connect %s", hooks.at(i).c_str());
+            }
+        }
+    }
+
+    edge_ = _srs_config->get_vhost_is_edge(req_->vhost);
+    if ((err = _srs_sources->fetch_or_create(req_, _srs_hybrid->srs()->instance(), &source_)) != srs_success) {
+        return srs_error_wrap(err, "fetch source");
+    }
+    srs_assert(source_);
+
+    // The publisher is a client of stream, which might be kicked off by API.
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(cid_.c_str(), req_, this, SrsRtmpConnFMLEPublish)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+    sstream_ = stat->fetch_stream(req_);
+
+    source_->set_cache(_srs_config->get_gop_cache(req_->vhost));
+
+    if ((err = http_hooks_on_publish()) != srs_success) {
+        return srs_error_wrap(err, "on_publish");
+    }
+    hooked_ = true;
+
+    if ((err = acquire_publish()) != srs_success) {
+        return srs_error_wrap(err, "acquire");
+    }
+
+    return err;
+}
+
+srs_error_t SrsLiveSourcePublisher::acquire_publish()
+{
+    srs_error_t err = srs_success;
+
+    if (!source_->can_publish(edge_)) {
+        return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "stream %s is busy", req_->get_stream_url().c_str());
+    }
+
+#ifdef SRS_RTC
+    SrsRtcSource* rtc = NULL;
+    bool rtc_server_enabled = _srs_config->get_rtc_server_enabled();
+    bool rtc_enabled = _srs_config->get_rtc_enabled(req_->vhost);
+    if (rtc_server_enabled && rtc_enabled && !edge_) {
+        if ((err = _srs_rtc_sources->fetch_or_create(req_, &rtc)) != srs_success) {
+            return srs_error_wrap(err, "create source");
+        }
+
+        if (!rtc->can_publish()) {
+            return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtc stream %s busy", req_->get_stream_url().c_str());
+        }
+    }
+#endif
+
+    // Now the source is ours, we must release it even when failed.
+    acquired_ = true;
+
+#if defined(SRS_RTC) && defined(SRS_FFMPEG_FIT)
+    if (rtc) {
+        SrsRtcFromRtmpBridger* bridger = new SrsRtcFromRtmpBridger(rtc);
+        if ((err = bridger->initialize(req_)) != srs_success) {
+            srs_freep(bridger);
+            return srs_error_wrap(err, "bridger init");
+        }
+
+        source_->set_bridger(bridger);
+    }
+#endif
+
+    if (edge_) {
+        return source_->on_edge_start_publish();
+    }
+    return source_->on_publish();
+}
+
+void SrsLiveSourcePublisher::unpublish()
+{
+    // Reset the state before the hooks, which might switch context.
+    if (acquired_) {
+        acquired_ = false;
+        release_publish();
+    }
+
+    if (hooked_) {
+        hooked_ = false;
+        http_hooks_on_unpublish();
+    }
+
+    if (!connected_) {
+        return;
+    }
+    connected_ = false;
+
+    // Always call on_close hooks, like the RTMP connection is closed.
+    SrsStatistic::instance()->on_disconnect(cid_.c_str());
+    sstream_ = NULL;
+
+    if (_srs_config->get_vhost_http_hooks_enabled(req_->vhost)) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_close(req_->vhost);
+        vector<string> hooks = conf? conf->args : vector<string>();
+        for (int i = 0; i < (int)hooks.size(); i++) {
+            SrsHttpHooks::on_close(hooks.at(i), req_, 0, nn_bytes_);
+        }
+    }
+
+    // The req is freed by destructor, for it might be used by hooks of other coroutine.
+    source_ = NULL;
+}
+
+void SrsLiveSourcePublisher::release_publish()
+{
+    if (edge_) {
+        source_->on_edge_proxy_unpublish();
+    } else {
+        source_->on_unpublish();
+    }
+}
+
+srs_error_t SrsLiveSourcePublisher::send_and_free_message(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    SrsAutoFree(SrsSharedPtrMessage, msg);
+
+    if (!acquired_) {
+        if (expired_) {
+            return srs_error_new(ERROR_THREAD_INTERRUPED, "publisher kicked off");
+        }
+        return srs_error_new(ERROR_SOCKET_TIMEOUT, "publisher unpublished");
+    }
+
+    nn_msgs_++;
+    nn_bytes_ += msg->size;
+    if (!msg->recv_tick) {
+        msg->recv_tick = srs_get_tick();
+    }
+
+    // For edge, directly proxy message to origin.
+    if (edge_) {
+        return on_edge_proxy(msg);
+    }
+
+    if (msg->is_audio()) {
+        return source_->on_frame(msg);
+    }
+
+    if (msg->is_video()) {
+        if (sstream_ && (err = SrsStatistic::instance()->on_video_frames(sstream_, 1)) != srs_success) {
+            return srs_error_wrap(err, "stat video frames");
+        }
+        return source_->on_frame(msg);
+    }
+
+    return on_meta_data(msg);
+}
+
+srs_error_t SrsLiveSourcePublisher::on_meta_data(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    SrsBuffer stream(msg->payload, msg->size);
+
+    // Ignore the script data except the onMetaData.
+    string name;
+    if ((err = srs_amf0_read_string(&stream, name)) != srs_success) {
+        return srs_error_wrap(err, "decode name");
+    }
+    if (name != SRS_CONSTS_RTMP_SET_DATAFRAME && name != SRS_CONSTS_RTMP_ON_METADATA) {
+        return err;
+    }
+    stream.skip(-1 * stream.pos());
+
+    SrsOnMetaDataPacket metadata;
+    if ((err = metadata.decode(&stream)) != srs_success) {
+        return srs_error_wrap(err, "decode metadata");
+    }
+
+    // The source only use the header of message, to build the metadata message.
+    SrsCommonMessage cm;
+    cm.header.initialize_amf0_script(msg->size, msg->stream_id);
+    cm.header.timestamp = msg->timestamp;
+    cm.size = msg->size;
+
+    if ((err = source_->on_meta_data(&cm, &metadata)) != srs_success) {
+        return srs_error_wrap(err, "consume metadata");
+    }
+
+    return err;
+}
+
+srs_error_t SrsLiveSourcePublisher::on_edge_proxy(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    // The edge forwarder owns the payload, so we copy it, which is not the critical path.
+    SrsCommonMessage cm;
+    if (msg->is_audio()) {
+        cm.header.initialize_audio(msg->size, (uint32_t)msg->timestamp, msg->stream_id);
+    } else if (msg->is_video()) {
+        cm.header.initialize_video(msg->size, (uint32_t)msg->timestamp, msg->stream_id);
+    } else {
+        cm.header.initialize_amf0_script(msg->size, msg->stream_id);
+        cm.header.timestamp = msg->timestamp;
+    }
+
+    cm.create_payload(msg->size);
+    memcpy(cm.payload, msg->payload, msg->size);
+    cm.size = msg->size;
+
+    if ((err = source_->on_edge_proxy_publish(&cm)) != srs_success) {
+        return srs_error_wrap(err, "proxy publish");
+    }
+
+    return err;
+}
+
+srs_error_t SrsLiveSourcePublisher::http_hooks_on_publish()
+{
+    srs_error_t err = srs_success;
+
+    if (!_srs_config->get_vhost_http_hooks_enabled(req_->vhost)) {
+        return err;
+    }
+
+    // Copy the hooks, for the config might be reloaded when calling hooks.
+    vector<string> hooks;
+    SrsConfDirective* conf = _srs_config->get_vhost_on_publish(req_->vhost);
+    if (conf) {
+        hooks = conf->args;
+    }
+
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = SrsHttpHooks::on_publish(url, req_)) != srs_success) {
+            return srs_error_wrap(err, "on_publish %s", url.c_str());
+        }
+    }
+
+    return err;
+}
+
+void SrsLiveSourcePublisher::http_hooks_on_unpublish()
+{
+    if (!_srs_config->get_vhost_http_hooks_enabled(req_->vhost)) {
+        return;
+    }
+
+    // Copy the hooks, for the config might be reloaded when calling hooks.
+    vector<string> hooks;
+    SrsConfDirective* conf = _srs_config->get_vhost_on_unpublish(req_->vhost);
+    if (conf) {
+        hooks = conf->args;
+    }
+
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        SrsHttpHooks::on_unpublish(url, req_);
+    }
+}
+
+srs_error_t SrsLiveSourcePublisher::cycle()
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t p1stpt = _srs_config->get_publish_1stpkt_timeout(req_->vhost);
+    srs_utime_t pnt = _srs_config->get_publish_normal_timeout(req_->vhost);
+
+    // Like the RTMP publisher, unpublish when there is no message for a while.
+    int64_t nn_msgs = 0;
+    while (true) {
+        srs_usleep(nn_msgs? pnt : p1stpt);
+
+        if ((err = trd_->pull()) != srs_success) {
+            break;
+        }
+
+        if (nn_msgs_ <= nn_msgs) {
+            err = srs_error_new(ERROR_SOCKET_TIMEOUT, "publish timeout %dms, nb_msgs=%d",
+                nn_msgs? srsu2msi(pnt) : srsu2msi(p1stpt), (int)nn_msgs);
+            break;
+        }
+        nn_msgs = nn_msgs_;
+    }
+
+    // When stopped by destructor, it will unpublish the stream.
+    if (!expired_ && srs_error_code(err) != ERROR_SOCKET_TIMEOUT) {
+        return err;
+    }
+
+    srs_warn("publisher: unpublish %s, expired=%d, code=%d", req_->get_stream_url().c_str(), expired_, srs_error_code(err));
+    srs_freep(err);
+
+    unpublish();
+
+    return err;
+}
+
+void SrsLiveSourcePublisher::expire()
+{
+    expired_ = true;
+    trd_->interrupt();
+}
+
+void SrsLiveSourcePublisher::remark(int64_t* in, int64_t* out)
+{
+    if (in) {
+        *in = nn_bytes_ - nn_bytes_remarked_;
+    }
+    if (out) {
+        *out = 0;
+    }
+    nn_bytes_remarked_ = nn_bytes_;
+}
+
+SrsRtmpRelayPublisher::SrsRtmpRelayPublisher(string url)
+{
+    url_ = url;
+    sdk_ = NULL;
+}
+
+SrsRtmpRelayPublisher::~SrsRtmpRelayPublisher()
+{
+    unpublish();
+}
+
+srs_error_t SrsRtmpRelayPublisher::publish()
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
+    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
+
+    srs_freep(sdk_);
+    sdk_ = new SrsSimpleRtmpClient(url_, cto, sto);
+
+    if ((err = sdk_->connect()) != srs_success) {
+        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", url_.c_str(), srsu2msi(cto), srsu2msi(sto));
+    }
+
+    if ((err = sdk_->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
+        return srs_error_wrap(err, "publish %s failed", url_.c_str());
+    }
+
+    return err;
+}
+
+void SrsRtmpRelayPublisher::unpublish()
+{
+    if (sdk_) {
+        sdk_->close();
+    }
+    srs_freep(sdk_);
+}
+
+srs_error_t SrsRtmpRelayPublisher::send_and_free_message(SrsSharedPtrMessage* msg)
+{
+    if (!sdk_) {
+        srs_freep(msg);
+        return srs_error_new(ERROR_RTMP_STREAM_NOT_FOUND, "not published");
+    }
+    return sdk_->send_and_free_message(msg);
+}
+
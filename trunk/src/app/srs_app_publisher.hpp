@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_PUBLISHER_HPP
+#define SRS_APP_PUBLISHER_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+#include <srs_app_st.hpp>
+#include <srs_app_conn.hpp>
+#include <srs_protocol_kbps.hpp>
+
+class SrsRequest;
+class SrsLiveSource;
+class SrsSharedPtrMessage;
+class SrsSimpleRtmpClient;
+class SrsCoroutine;
+struct SrsStatisticStream;
+
+// The publisher for stream casters, which demux the stream from other protocols and feed
+// the FLV tags to a live stream, see srs_create_live_publisher.
+class ISrsLivePublisher
+{
+public:
+    ISrsLivePublisher();
+    virtual ~ISrsLivePublisher();
+public:
+    // Start to publish the stream, should unpublish it even when failed.
+    virtual srs_error_t publish() = 0;
+    // Stop publishing, always safe to call multiple times.
+    virtual void unpublish() = 0;
+    // Feed an audio, video or script data FLV tag to stream.
+    // @remark The msg is always freed by publisher, even when failed.
+    virtual srs_error_t send_and_free_message(SrsSharedPtrMessage* msg) = 0;
+};
+
+// Create a publisher for the output url of caster. When the url points to this server, it
+// publishes to the live source in process, or relay the stream by a RTMP client.
+// @param ip The ip of client for hooks and security, use loopback if unknown.
+extern ISrsLivePublisher* srs_create_live_publisher(std::string url, std::string ip);
+
+// The in process publisher, which directly feeds messages to the live source, so there is
+// no RTMP encoding and decoding over loopback. It acts as a RTMP FMLE publisher, with the
+// same security check, hooks, statistic and publish timeout.
+class SrsLiveSourcePublisher : public ISrsLivePublisher, public ISrsCoroutineHandler
+    , public ISrsExpire, public ISrsKbpsDelta
+{
+private:
+    std::string url_;
+    std::string ip_;
+    // The id of publisher as statistic client.
+    SrsContextId cid_;
+    SrsRequest* req_;
+    SrsLiveSource* source_;
+    bool edge_;
+    // The coroutine to detect the publish timeout, and unpublish the stream.
+    SrsCoroutine* trd_;
+private:
+    // Whether connected to vhost, so we must call on_close hooks.
+    bool connected_;
+    // Whether on_publish hooks passed, so we must call on_unpublish hooks.
+    bool hooked_;
+    // Whether we acquired the source, so we must release it.
+    bool acquired_;
+    // Whether kicked off by API.
+    bool expired_;
+private:
+    // The pinned stream of statistic.
+    SrsStatisticStream* sstream_;
+    // The number and bytes of messages we received.
+    int64_t nn_msgs_;
+    int64_t nn_bytes_;
+    int64_t nn_bytes_remarked_;
+public:
+    SrsLiveSourcePublisher(std::string url, std::string ip);
+    virtual ~SrsLiveSourcePublisher();
+// Interface ISrsLivePublisher
+public:
+    virtual srs_error_t publish();
+    virtual void unpublish();
+    virtual srs_error_t send_and_free_message(SrsSharedPtrMessage* msg);
+private:
+    virtual srs_error_t do_publish();
+    virtual srs_error_t acquire_publish();
+    virtual void release_publish();
+    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* msg);
+    virtual srs_error_t on_edge_proxy(SrsSharedPtrMessage* msg);
+    virtual srs_error_t http_hooks_on_publish();
+    virtual void http_hooks_on_unpublish();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+// Interface ISrsExpire
+public:
+    virtual void expire();
+// Interface ISrsKbpsDelta
+public:
+    virtual void remark(int64_t* in, int64_t* out);
+};
+
+// The relay publisher, which publish the stream to other server by RTMP.
+class SrsRtmpRelayPublisher : public ISrsLivePublisher
+{
+private:
+    std::string url_;
+    SrsSimpleRtmpClient* sdk_;
+public:
+    SrsRtmpRelayPublisher(std::string url);
+    virtual ~SrsRtmpRelayPublisher();
+// Interface ISrsLivePublisher
+public:
+    virtual srs_error_t publish();
+    virtual void unpublish();
+    virtual srs_error_t send_and_free_message(SrsSharedPtrMessage* msg);
+};
+
+#endif
+
@@ -515,3 +515,70 @@ srs_error_t SrsGoApiRtcNACK::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMe
     return srs_success;
 }
 
+SrsGoApiRtcBWE::SrsGoApiRtcBWE(SrsRtcServer* server)
+{
+    server_ = server;
+}
+
+SrsGoApiRtcBWE::~SrsGoApiRtcBWE()
+{
+}
+
+srs_error_t SrsGoApiRtcBWE::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    SrsJsonObject* res = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, res);
+
+    res->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+
+    if ((err = do_serve_http(w, r, res)) != srs_success) {
+        srs_warn("RTC: BWE err %s", srs_error_desc(err).c_str());
+        res->set("code", SrsJsonAny::integer(srs_error_code(err)));
+        srs_freep(err);
+    }
+
+    return srs_api_response(w, r, res->dumps());
+}
+
+srs_error_t SrsGoApiRtcBWE::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsJsonObject* res)
+{
+    string username = r->query_get("username");
+
+    SrsJsonArray* sessions = SrsJsonAny::array();
+    res->set("sessions", sessions);
+
+    // Dumps the specified session.
+    if (!username.empty()) {
+        SrsRtcConnection* session = server_->find_session_by_username(username);
+        if (!session) {
+            return srs_error_new(ERROR_RTC_NO_SESSION, "no session username=%s", username.c_str());
+        }
+
+        // Select the layer of simulcast, auto to select by the estimated bandwidth.
+        string layer = r->query_get("layer");
+        if (!layer.empty()) {
+            session->set_layer(layer == "auto" ? "" : layer);
+        }
+
+        SrsJsonObject* obj = SrsJsonAny::object();
+        sessions->append(obj);
+        session->dumps_bwe(obj);
+        return srs_success;
+    }
+
+    // Dumps all sessions.
+    for (int i = 0; i < (int)_srs_rtc_manager->size(); i++) {
+        SrsRtcConnection* session = dynamic_cast<SrsRtcConnection*>(_srs_rtc_manager->at(i));
+        if (!session || session->disposing_) {
+            continue;
+        }
+
+        SrsJsonObject* obj = SrsJsonAny::object();
+        sessions->append(obj);
+        session->dumps_bwe(obj);
+    }
+
+    return srs_success;
+}
@@ -56,5 +56,19 @@ private:
     virtual srs_error_t do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsJsonObject* res);
 };
 
+// The API to query the estimated bandwidth and pacer of RTC players, by username or for all.
+class SrsGoApiRtcBWE : public ISrsHttpHandler
+{
+private:
+    SrsRtcServer* server_;
+public:
+    SrsGoApiRtcBWE(SrsRtcServer* server);
+    virtual ~SrsGoApiRtcBWE();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    virtual srs_error_t do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsJsonObject* res);
+};
+
 #endif
 
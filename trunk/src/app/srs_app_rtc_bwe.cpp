@@ -0,0 +1,619 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_rtc_bwe.hpp>
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_rtc_rtcp.hpp>
+#include <srs_protocol_json.hpp>
+
+// The number of samples for linear regression of trendline.
+const int kTrendlineWindowSize = 20;
+const double kTrendlineSmoothingCoeff = 0.9;
+const double kTrendlineThresholdGain = 4.0;
+// The adaptive threshold of overuse detector, in ms.
+const double kOveruseThresholdInit = 12.5;
+const double kOveruseThresholdMin = 6;
+const double kOveruseThresholdMax = 600;
+const double kOveruseThresholdUp = 0.0087;
+const double kOveruseThresholdDown = 0.039;
+const double kOverusingTimeThreshold = 10;
+
+// The packets sent in a burst of 5ms is a group.
+const srs_utime_t kBweGroupLength = 5 * SRS_UTIME_MILLISECONDS;
+const srs_utime_t kBweAckedWindow = 500 * SRS_UTIME_MILLISECONDS;
+const srs_utime_t kBweLossWindow = 1 * SRS_UTIME_SECONDS;
+const int kBweLossMinPackets = 20;
+const int64_t kBweStartBitrate = 300 * 1000;
+const int64_t kBweMinBitrate = 30 * 1000;
+const int64_t kBweMaxBitrate = 100 * 1000 * 1000;
+
+// The pacing rate is 2.5x of the estimated bandwidth, like libwebrtc.
+const double kPacingFactor = 2.5;
+// The max burst of budget, to send a few packets after sleep.
+const srs_utime_t kPacerMaxBurst = 20 * SRS_UTIME_MILLISECONDS;
+// The min time to sleep, to avoid switching context for each packet.
+const srs_utime_t kPacerMinDelay = 5 * SRS_UTIME_MILLISECONDS;
+const srs_utime_t kPacerMediaWindow = 500 * SRS_UTIME_MILLISECONDS;
+
+// The window to measure the bitrate of layers, and the interval to select layer.
+const srs_utime_t kLayerWindow = 1 * SRS_UTIME_SECONDS;
+const srs_utime_t kLayerUpdateInterval = 1 * SRS_UTIME_SECONDS;
+// The layer fits the estimate with some headroom, for audio and the variation of bitrate.
+const double kLayerHeadroom = 0.85;
+// The interval to probe the higher layer, doubled when probing failed.
+const srs_utime_t kLayerProbeMin = 5 * SRS_UTIME_SECONDS;
+const srs_utime_t kLayerProbeMax = 60 * SRS_UTIME_SECONDS;
+// The probing failed, if switched down in this duration after switched up.
+const srs_utime_t kLayerProbeFailed = 10 * SRS_UTIME_SECONDS;
+
+SrsRtcTrendlineEstimator::SrsRtcTrendlineEstimator()
+{
+    nn_deltas_ = 0;
+    first_arrival_ms_ = 0;
+    accumulated_delay_ = 0;
+    smoothed_delay_ = 0;
+    prev_trend_ = 0;
+
+    threshold_ = kOveruseThresholdInit;
+    last_update_ms_ = -1;
+    time_over_using_ = -1;
+    overuse_counter_ = 0;
+    state_ = SrsRtcBandwidthUsageNormal;
+}
+
+SrsRtcTrendlineEstimator::~SrsRtcTrendlineEstimator()
+{
+}
+
+void SrsRtcTrendlineEstimator::update(double send_delta, double arrival_delta, double arrival)
+{
+    if (nn_deltas_ == 0) {
+        first_arrival_ms_ = arrival;
+    }
+    nn_deltas_ = srs_min(nn_deltas_ + 1, 1000);
+
+    // Smooth the accumulated delay variation.
+    accumulated_delay_ += arrival_delta - send_delta;
+    smoothed_delay_ = kTrendlineSmoothingCoeff * smoothed_delay_ + (1 - kTrendlineSmoothingCoeff) * accumulated_delay_;
+
+    samples_.push_back(make_pair(arrival - first_arrival_ms_, smoothed_delay_));
+    if ((int)samples_.size() > kTrendlineWindowSize) {
+        samples_.pop_front();
+    }
+
+    // The trend is the slope of delay over time, by linear regression.
+    double trend = prev_trend_;
+    if ((int)samples_.size() == kTrendlineWindowSize) {
+        double sum_x = 0, sum_y = 0;
+        for (int i = 0; i < (int)samples_.size(); i++) {
+            sum_x += samples_[i].first;
+            sum_y += samples_[i].second;
+        }
+        double avg_x = sum_x / samples_.size(), avg_y = sum_y / samples_.size();
+
+        double numerator = 0, denominator = 0;
+        for (int i = 0; i < (int)samples_.size(); i++) {
+            double x = samples_[i].first, y = samples_[i].second;
+            numerator += (x - avg_x) * (y - avg_y);
+            denominator += (x - avg_x) * (x - avg_x);
+        }
+
+        if (denominator != 0) {
+            trend = numerator / denominator;
+        }
+    }
+
+    detect(trend, send_delta, arrival);
+}
+
+SrsRtcBandwidthUsage SrsRtcTrendlineEstimator::state()
+{
+    return state_;
+}
+
+void SrsRtcTrendlineEstimator::detect(double trend, double ts_delta, double now)
+{
+    if (nn_deltas_ < 2) {
+        state_ = SrsRtcBandwidthUsageNormal;
+        return;
+    }
+
+    double modified_trend = srs_min(nn_deltas_, 60) * trend * kTrendlineThresholdGain;
+
+    if (modified_trend > threshold_) {
+        if (time_over_using_ == -1) {
+            time_over_using_ = ts_delta / 2;
+        } else {
+            time_over_using_ += ts_delta;
+        }
+        overuse_counter_++;
+
+        // Overusing if the delay keeps increasing for a while.
+        if (time_over_using_ > kOverusingTimeThreshold && overuse_counter_ > 1 && trend >= prev_trend_) {
+            time_over_using_ = 0;
+            overuse_counter_ = 0;
+            state_ = SrsRtcBandwidthUsageOverusing;
+        }
+    } else if (modified_trend < -threshold_) {
+        time_over_using_ = -1;
+        overuse_counter_ = 0;
+        state_ = SrsRtcBandwidthUsageUnderusing;
+    } else {
+        time_over_using_ = -1;
+        overuse_counter_ = 0;
+        state_ = SrsRtcBandwidthUsageNormal;
+    }
+
+    prev_trend_ = trend;
+    update_threshold(modified_trend, now);
+}
+
+void SrsRtcTrendlineEstimator::update_threshold(double trend, double now)
+{
+    if (last_update_ms_ == -1) {
+        last_update_ms_ = now;
+    }
+
+    // Ignore the spike, which should not impact the threshold.
+    double v = fabs(trend);
+    if (v > threshold_ + 15) {
+        last_update_ms_ = now;
+        return;
+    }
+
+    double k = (v < threshold_) ? kOveruseThresholdDown : kOveruseThresholdUp;
+    double elapsed = srs_min(now - last_update_ms_, 100.0);
+    threshold_ += k * (v - threshold_) * elapsed;
+
+    threshold_ = srs_max(threshold_, kOveruseThresholdMin);
+    threshold_ = srs_min(threshold_, kOveruseThresholdMax);
+    last_update_ms_ = now;
+}
+
+SrsRtcBandwidthEstimator::SrsRtcBandwidthEstimator()
+{
+    history_ = new SrsRtcSentPacket[SRS_RTC_BWE_HISTORY_SIZE];
+    memset(history_, 0, sizeof(SrsRtcSentPacket) * SRS_RTC_BWE_HISTORY_SIZE);
+
+    has_group_ = has_prev_group_ = false;
+    group_first_sent_ = group_last_sent_ = group_last_arrival_ = 0;
+    prev_group_last_sent_ = prev_group_last_arrival_ = 0;
+    trendline_ = new SrsRtcTrendlineEstimator();
+
+    acked_bps_ = 0;
+    acked_bytes_ = 0;
+    acked_start_ = -1;
+
+    nn_loss_packets_ = nn_loss_lost_ = 0;
+    loss_start_ = 0;
+    loss_ = 0;
+    last_loss_decrease_ = 0;
+
+    delay_bps_ = loss_bps_ = kBweStartBitrate;
+    last_increase_ = last_decrease_ = 0;
+    nn_feedbacks_ = 0;
+}
+
+SrsRtcBandwidthEstimator::~SrsRtcBandwidthEstimator()
+{
+    srs_freepa(history_);
+    srs_freep(trendline_);
+}
+
+void SrsRtcBandwidthEstimator::on_sent(uint16_t sn, int size, srs_utime_t now)
+{
+    SrsRtcSentPacket& pkt = history_[sn % SRS_RTC_BWE_HISTORY_SIZE];
+    pkt.sn = sn;
+    pkt.valid = true;
+    pkt.size = size;
+    pkt.sent = now;
+}
+
+void SrsRtcBandwidthEstimator::on_feedback(SrsRtcpTWCC* twcc, srs_utime_t now)
+{
+    nn_feedbacks_++;
+
+    const map<uint16_t, srs_utime_t>& packets = twcc->get_recv_packets();
+
+    uint16_t base_sn = twcc->get_base_sn();
+    for (int i = 0; i < (int)twcc->get_packet_status_count(); i++) {
+        uint16_t sn = base_sn + i;
+
+        // Ignore the packet not sent by us, or acked by previous feedback.
+        SrsRtcSentPacket& pkt = history_[sn % SRS_RTC_BWE_HISTORY_SIZE];
+        if (!pkt.valid || pkt.sn != sn) {
+            continue;
+        }
+        pkt.valid = false;
+
+        nn_loss_packets_++;
+
+        map<uint16_t, srs_utime_t>::const_iterator it = packets.find(sn);
+        if (it == packets.end()) {
+            nn_loss_lost_++;
+            continue;
+        }
+
+        on_packet_acked(pkt.sent, it->second, pkt.size);
+    }
+
+    update_delay_based(now);
+    update_loss_based(now);
+}
+
+int64_t SrsRtcBandwidthEstimator::estimate()
+{
+    int64_t v = srs_min(delay_bps_, loss_bps_);
+    v = srs_max(v, kBweMinBitrate);
+    return srs_min(v, kBweMaxBitrate);
+}
+
+void SrsRtcBandwidthEstimator::dumps(SrsJsonObject* obj)
+{
+    SrsRtcBandwidthUsage state = trendline_->state();
+
+    obj->set("kbps", SrsJsonAny::integer(estimate() / 1000));
+    obj->set("delay_kbps", SrsJsonAny::integer(delay_bps_ / 1000));
+    obj->set("loss_kbps", SrsJsonAny::integer(loss_bps_ / 1000));
+    obj->set("acked_kbps", SrsJsonAny::integer(acked_bps_ / 1000));
+    obj->set("loss", SrsJsonAny::number(loss_));
+    obj->set("usage", SrsJsonAny::str(state == SrsRtcBandwidthUsageOverusing ? "overusing"
+        : (state == SrsRtcBandwidthUsageUnderusing ? "underusing" : "normal")));
+    obj->set("feedbacks", SrsJsonAny::integer(nn_feedbacks_));
+}
+
+void SrsRtcBandwidthEstimator::on_packet_acked(srs_utime_t sent, srs_utime_t arrival, int size)
+{
+    // Measure the acked bitrate in window, reset if the arrival time jumps back.
+    if (acked_start_ < 0 || arrival < acked_start_) {
+        acked_start_ = arrival;
+        acked_bytes_ = 0;
+    }
+    acked_bytes_ += size;
+
+    if (arrival - acked_start_ >= kBweAckedWindow) {
+        acked_bps_ = acked_bytes_ * 8 * SRS_UTIME_SECONDS / (arrival - acked_start_);
+        acked_start_ = arrival;
+        acked_bytes_ = 0;
+    }
+
+    // Start a new group.
+    if (!has_group_) {
+        has_group_ = true;
+        group_first_sent_ = group_last_sent_ = sent;
+        group_last_arrival_ = arrival;
+        return;
+    }
+
+    // Ignore the reordered packet of previous group.
+    if (sent < group_first_sent_) {
+        return;
+    }
+
+    // Append to current group, if in the burst.
+    if (sent - group_first_sent_ <= kBweGroupLength) {
+        group_last_sent_ = sent;
+        group_last_arrival_ = srs_max(group_last_arrival_, arrival);
+        return;
+    }
+
+    // The current group is completed, update the delay variation between groups.
+    if (has_prev_group_) {
+        srs_utime_t send_delta = group_last_sent_ - prev_group_last_sent_;
+        srs_utime_t arrival_delta = group_last_arrival_ - prev_group_last_arrival_;
+
+        // Ignore if the arrival time jumps, for example, the reference time wraps.
+        if (arrival_delta >= 0 && arrival_delta < 3 * SRS_UTIME_SECONDS) {
+            trendline_->update(send_delta / 1000.0, arrival_delta / 1000.0, group_last_arrival_ / 1000.0);
+        }
+    }
+
+    has_prev_group_ = true;
+    prev_group_last_sent_ = group_last_sent_;
+    prev_group_last_arrival_ = group_last_arrival_;
+
+    group_first_sent_ = group_last_sent_ = sent;
+    group_last_arrival_ = arrival;
+}
+
+void SrsRtcBandwidthEstimator::update_delay_based(srs_utime_t now)
+{
+    SrsRtcBandwidthUsage state = trendline_->state();
+
+    if (state == SrsRtcBandwidthUsageOverusing) {
+        // Decrease to 85% of the acked bitrate, about once for a RTT.
+        if (now - last_decrease_ >= 200 * SRS_UTIME_MILLISECONDS) {
+            int64_t base = acked_bps_ ? acked_bps_ : delay_bps_;
+            delay_bps_ = srs_min(delay_bps_, (int64_t)(base * 0.85));
+            last_decrease_ = now;
+        }
+    } else if (state == SrsRtcBandwidthUsageNormal) {
+        // The bitrate delivered without overusing, is always available.
+        delay_bps_ = srs_max(delay_bps_, acked_bps_);
+
+        // Increase 8% per second, multiplicatively.
+        if (last_increase_) {
+            double elapsed = srs_min(1.0, (now - last_increase_) / (double)SRS_UTIME_SECONDS);
+            delay_bps_ += srs_max((int64_t)1000, (int64_t)(delay_bps_ * (pow(1.08, elapsed) - 1)));
+        }
+
+        // We never probe, so never exceed too much over the acked bitrate.
+        if (acked_bps_) {
+            delay_bps_ = srs_min(delay_bps_, (int64_t)(1.5 * acked_bps_) + 10000);
+        }
+    }
+
+    // Hold the bitrate when underusing, the queue is draining.
+    last_increase_ = now;
+
+    delay_bps_ = srs_max(delay_bps_, kBweMinBitrate);
+    delay_bps_ = srs_min(delay_bps_, kBweMaxBitrate);
+}
+
+void SrsRtcBandwidthEstimator::update_loss_based(srs_utime_t now)
+{
+    if (!loss_start_) {
+        loss_start_ = now;
+    }
+
+    if (now - loss_start_ < kBweLossWindow || nn_loss_packets_ < kBweLossMinPackets) {
+        return;
+    }
+
+    loss_ = (double)nn_loss_lost_ / nn_loss_packets_;
+    nn_loss_packets_ = nn_loss_lost_ = 0;
+    loss_start_ = now;
+
+    if (loss_ < 0.02) {
+        // Increase when the loss is low, never limit the delay based estimate.
+        loss_bps_ = srs_max((int64_t)(loss_bps_ * 1.08) + 1000, delay_bps_);
+    } else if (loss_ > 0.1) {
+        // Decrease by the loss, at most once for 300ms.
+        if (now - last_loss_decrease_ >= 300 * SRS_UTIME_MILLISECONDS) {
+            loss_bps_ = (int64_t)(srs_min(loss_bps_, delay_bps_) * (1 - 0.5 * loss_));
+            last_loss_decrease_ = now;
+        }
+    }
+
+    loss_bps_ = srs_max(loss_bps_, kBweMinBitrate);
+    loss_bps_ = srs_min(loss_bps_, kBweMaxBitrate);
+}
+
+SrsRtcPacer::SrsRtcPacer()
+{
+    budget_ = 0;
+    last_update_ = 0;
+    estimate_bps_ = 0;
+
+    media_bps_ = 0;
+    window_bytes_ = 0;
+    window_start_ = 0;
+}
+
+SrsRtcPacer::~SrsRtcPacer()
+{
+}
+
+void SrsRtcPacer::set_estimate(int64_t bps)
+{
+    estimate_bps_ = bps;
+}
+
+srs_utime_t SrsRtcPacer::delay(srs_utime_t now)
+{
+    refill(now);
+
+    int64_t bps = pacing_bps();
+    if (!bps || budget_ >= 0) {
+        return 0;
+    }
+
+    srs_utime_t wait = (-budget_ * 8 * SRS_UTIME_SECONDS + bps - 1) / bps;
+    return srs_max(wait, kPacerMinDelay);
+}
+
+void SrsRtcPacer::on_sent(int size, srs_utime_t now)
+{
+    refill(now);
+
+    if (pacing_bps()) {
+        budget_ -= size;
+    }
+
+    // Measure the rate of media in window.
+    if (!window_start_) {
+        window_start_ = now;
+    }
+    window_bytes_ += size;
+
+    if (now - window_start_ >= kPacerMediaWindow) {
+        media_bps_ = window_bytes_ * 8 * SRS_UTIME_SECONDS / (now - window_start_);
+        window_start_ = now;
+        window_bytes_ = 0;
+    }
+}
+
+int64_t SrsRtcPacer::pacing_bps()
+{
+    // Never pace before we know the rate of media, for example, the burst of GOP cache.
+    if (!media_bps_) {
+        return 0;
+    }
+
+    return (int64_t)(srs_max(estimate_bps_, media_bps_) * kPacingFactor);
+}
+
+void SrsRtcPacer::dumps(SrsJsonObject* obj)
+{
+    obj->set("kbps", SrsJsonAny::integer(pacing_bps() / 1000));
+    obj->set("media_kbps", SrsJsonAny::integer(media_bps_ / 1000));
+    obj->set("budget", SrsJsonAny::integer(budget_));
+}
+
+void SrsRtcPacer::refill(srs_utime_t now)
+{
+    if (!last_update_) {
+        last_update_ = now;
+    }
+
+    srs_utime_t elapsed = now - last_update_;
+    last_update_ = now;
+
+    int64_t bps = pacing_bps();
+    if (!bps) {
+        budget_ = 0;
+        return;
+    }
+
+    budget_ += bps * elapsed / 8 / SRS_UTIME_SECONDS;
+    budget_ = srs_min(budget_, bps * kPacerMaxBurst / 8 / SRS_UTIME_SECONDS);
+}
+
+
+SrsRtcLayerSelector::SrsRtcLayerSelector()
+{
+    window_start_ = 0;
+    last_update_ = 0;
+    last_switch_ = 0;
+    last_up_ = 0;
+    probe_interval_ = kLayerProbeMin;
+}
+
+SrsRtcLayerSelector::~SrsRtcLayerSelector()
+{
+}
+
+void SrsRtcLayerSelector::on_packet(string rid, int size, srs_utime_t now)
+{
+    if (!window_start_) {
+        window_start_ = now;
+    }
+    bytes_[rid] += size;
+
+    if (now - window_start_ < kLayerWindow) {
+        return;
+    }
+
+    // The layer without packets in window is stopped by publisher, whose bitrate is 0.
+    for (map<string, int64_t>::iterator it = bytes_.begin(); it != bytes_.end(); ++it) {
+        bps_[it->first] = it->second * 8 * SRS_UTIME_SECONDS / (now - window_start_);
+        it->second = 0;
+    }
+    window_start_ = now;
+}
+
+string SrsRtcLayerSelector::update(int64_t estimate, srs_utime_t now)
+{
+    if (last_update_ && now - last_update_ < kLayerUpdateInterval) {
+        return target_;
+    }
+    last_update_ = now;
+
+    // The active layers, sorted by bitrate.
+    vector< pair<int64_t, string> > layers;
+    for (map<string, int64_t>::iterator it = bps_.begin(); it != bps_.end(); ++it) {
+        if (it->second > 0) {
+            layers.push_back(make_pair(it->second, it->first));
+        }
+    }
+    std::sort(layers.begin(), layers.end());
+
+    string target = target_;
+    if (!manual_.empty()) {
+        target = manual_;
+    } else if (layers.empty()) {
+        // Wait for the bitrate of layers.
+    } else if (estimate <= 0) {
+        // Without estimate, for example, no TWCC, send the best layer.
+        target = layers.back().second;
+    } else {
+        int current = -1, fit = 0;
+        for (int i = 0; i < (int)layers.size(); i++) {
+            if (layers.at(i).second == current_) {
+                current = i;
+            }
+            if (layers.at(i).first <= estimate * kLayerHeadroom) {
+                fit = i;
+            }
+        }
+
+        if (current < 0 || fit > current) {
+            // Switch to the best layer which fits, or the current layer is stopped by publisher.
+            target = layers.at(fit).second;
+        } else if (fit < current && estimate < layers.at(current).first) {
+            // Switch down when the current layer overuses the network, and backoff the probing if
+            // we just switched up.
+            target = layers.at(fit).second;
+            if (last_up_ && now - last_up_ < kLayerProbeFailed) {
+                probe_interval_ = srs_min(probe_interval_ * 2, kLayerProbeMax);
+            } else {
+                probe_interval_ = kLayerProbeMin;
+            }
+        } else if (target_ != current_ && is_active(target_)) {
+            // Wait for the keyframe of target layer.
+            target = target_;
+        } else if (current + 1 < (int)layers.size() && now - last_switch_ >= probe_interval_
+            && estimate >= layers.at(current).first) {
+            // Probe the higher layer when network is good.
+            target = layers.at(current + 1).second;
+            last_up_ = now;
+        } else {
+            target = current_;
+        }
+    }
+
+    if (target != target_) {
+        target_ = target;
+        last_switch_ = now;
+    }
+
+    return target_;
+}
+
+void SrsRtcLayerSelector::on_switched(string rid)
+{
+    current_ = rid;
+}
+
+void SrsRtcLayerSelector::set_manual(string rid)
+{
+    manual_ = rid;
+
+    // Select the layer immediately.
+    last_update_ = 0;
+}
+
+string SrsRtcLayerSelector::current()
+{
+    return current_;
+}
+
+void SrsRtcLayerSelector::dumps(SrsJsonObject* obj)
+{
+    obj->set("current", SrsJsonAny::str(current_.c_str()));
+    obj->set("target", SrsJsonAny::str(target_.c_str()));
+    obj->set("manual", SrsJsonAny::str(manual_.c_str()));
+    obj->set("probe", SrsJsonAny::integer(srsu2msi(probe_interval_)));
+
+    SrsJsonObject* layers = SrsJsonAny::object();
+    obj->set("kbps", layers);
+    for (map<string, int64_t>::iterator it = bps_.begin(); it != bps_.end(); ++it) {
+        layers->set(it->first, SrsJsonAny::integer(it->second / 1000));
+    }
+}
+
+bool SrsRtcLayerSelector::is_active(string rid)
+{
+    map<string, int64_t>::iterator it = bps_.find(rid);
+    return it != bps_.end() && it->second > 0;
+}
@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_RTC_BWE_HPP
+#define SRS_APP_RTC_BWE_HPP
+
+#include <srs_core.hpp>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+class SrsRtcpTWCC;
+class SrsJsonObject;
+
+// The max number of sent packets to match the TWCC feedback, about 4s for 1000pps.
+#define SRS_RTC_BWE_HISTORY_SIZE 4096
+
+// The state of network, detected by the trend of one way delay.
+enum SrsRtcBandwidthUsage
+{
+    SrsRtcBandwidthUsageNormal = 0,
+    SrsRtcBandwidthUsageUnderusing,
+    SrsRtcBandwidthUsageOverusing,
+};
+
+// The trendline filter and overuse detector of GCC, which detects the trend of delay variation
+// of packet groups, to identify whether the bottleneck queue is building up.
+// @see https://tools.ietf.org/html/draft-ietf-rmcat-gcc-02#section-5.3
+class SrsRtcTrendlineEstimator
+{
+private:
+    int nn_deltas_;
+    double first_arrival_ms_;
+    double accumulated_delay_;
+    double smoothed_delay_;
+    // The samples of (arrival time, smoothed delay) in ms, for linear regression.
+    std::deque<std::pair<double, double> > samples_;
+    double prev_trend_;
+private:
+    // The adaptive threshold of overuse detector, in ms.
+    double threshold_;
+    double last_update_ms_;
+    double time_over_using_;
+    int overuse_counter_;
+    SrsRtcBandwidthUsage state_;
+public:
+    SrsRtcTrendlineEstimator();
+    virtual ~SrsRtcTrendlineEstimator();
+public:
+    // Update the delay variation of a packet group, all in ms.
+    // @param send_delta The delta of send time between groups.
+    // @param arrival_delta The delta of arrival time between groups.
+    // @param arrival The arrival time of the group.
+    void update(double send_delta, double arrival_delta, double arrival);
+    SrsRtcBandwidthUsage state();
+private:
+    void detect(double trend, double ts_delta, double now);
+    void update_threshold(double trend, double now);
+};
+
+// The send side bandwidth estimator for a RTC connection, fed by the TWCC feedback of player.
+// The delay based estimate is AIMD controlled by the trendline detector, and the loss based
+// estimate decreases when the loss is over 10%, the estimate is the minimum of them.
+class SrsRtcBandwidthEstimator
+{
+private:
+    // The history of sent packets, indexed by transport-wide sequence number.
+    struct SrsRtcSentPacket {
+        uint16_t sn;
+        bool valid;
+        int size;
+        srs_utime_t sent;
+    };
+    SrsRtcSentPacket* history_;
+private:
+    // The packet group in 5ms burst, the last one and the current one.
+    bool has_group_;
+    bool has_prev_group_;
+    srs_utime_t group_first_sent_;
+    srs_utime_t group_last_sent_;
+    srs_utime_t group_last_arrival_;
+    srs_utime_t prev_group_last_sent_;
+    srs_utime_t prev_group_last_arrival_;
+    SrsRtcTrendlineEstimator* trendline_;
+private:
+    // The bitrate acked by player, measured by the arrival time.
+    int64_t acked_bps_;
+    int64_t acked_bytes_;
+    srs_utime_t acked_start_;
+private:
+    // The packets acked and lost in the loss window.
+    int nn_loss_packets_;
+    int nn_loss_lost_;
+    srs_utime_t loss_start_;
+    double loss_;
+    srs_utime_t last_loss_decrease_;
+private:
+    int64_t delay_bps_;
+    int64_t loss_bps_;
+    srs_utime_t last_increase_;
+    srs_utime_t last_decrease_;
+    uint64_t nn_feedbacks_;
+public:
+    SrsRtcBandwidthEstimator();
+    virtual ~SrsRtcBandwidthEstimator();
+public:
+    // When sent a packet with transport-wide sequence number.
+    void on_sent(uint16_t sn, int size, srs_utime_t now);
+    // When got the TWCC feedback from player.
+    void on_feedback(SrsRtcpTWCC* twcc, srs_utime_t now);
+    // Get the estimated bandwidth in bps.
+    int64_t estimate();
+    void dumps(SrsJsonObject* obj);
+private:
+    void on_packet_acked(srs_utime_t sent, srs_utime_t arrival, int size);
+    void update_delay_based(srs_utime_t now);
+    void update_loss_based(srs_utime_t now);
+};
+
+// The leaky bucket pacer for a RTC connection, to smooth the burst of packets, for example, the
+// keyframe. The pacing rate is a factor of the estimated bandwidth, and never less than the rate
+// of media, so the packets are never queued for long.
+class SrsRtcPacer
+{
+private:
+    // The budget in bytes to send, negative if exceed.
+    int64_t budget_;
+    srs_utime_t last_update_;
+    int64_t estimate_bps_;
+private:
+    // The rate of media we sent, in the last window.
+    int64_t media_bps_;
+    int64_t window_bytes_;
+    srs_utime_t window_start_;
+public:
+    SrsRtcPacer();
+    virtual ~SrsRtcPacer();
+public:
+    // Update the estimated bandwidth, 0 if unknown.
+    void set_estimate(int64_t bps);
+    // Get the time to wait before sending next packet, 0 to send it immediately.
+    srs_utime_t delay(srs_utime_t now);
+    // When sent a packet, including the retransmitted ones.
+    void on_sent(int size, srs_utime_t now);
+    // Get the pacing rate in bps, 0 if not pacing.
+    int64_t pacing_bps();
+    void dumps(SrsJsonObject* obj);
+private:
+    void refill(srs_utime_t now);
+};
+
+// The layer selector of simulcast for a player, which measures the bitrate of layers, and selects
+// the best layer for the estimated bandwidth, or the layer specified by API. Because the estimate
+// never grows much over the bitrate we sent, it probes the higher layer when network is good, and
+// backoff the probing when it fails.
+class SrsRtcLayerSelector
+{
+private:
+    // The bitrate of layers by RID, measured in window.
+    std::map<std::string, int64_t> bytes_;
+    std::map<std::string, int64_t> bps_;
+    srs_utime_t window_start_;
+private:
+    // The layer specified by API, empty for auto.
+    std::string manual_;
+    // The layer we are sending, and the target layer to switch to at keyframe.
+    std::string current_;
+    std::string target_;
+    srs_utime_t last_update_;
+    srs_utime_t last_switch_;
+    srs_utime_t last_up_;
+    srs_utime_t probe_interval_;
+public:
+    SrsRtcLayerSelector();
+    virtual ~SrsRtcLayerSelector();
+public:
+    // When got a packet of layer.
+    void on_packet(std::string rid, int size, srs_utime_t now);
+    // Select the target layer by the estimated bandwidth, 0 if unknown.
+    // @return The RID of target layer, empty if unknown, which means any layer.
+    std::string update(int64_t estimate, srs_utime_t now);
+    // When switched to the target layer at keyframe.
+    void on_switched(std::string rid);
+    // Set the layer by API, empty for auto.
+    void set_manual(std::string rid);
+    std::string current();
+    void dumps(SrsJsonObject* obj);
+private:
+    bool is_active(std::string rid);
+};
+
+#endif
+
@@ -17,6 +17,7 @@ using namespace std;
 #include <unistd.h>
 
 #include <queue>
+#include <algorithm>
 #include <sstream>
 
 #include <srs_core_autofree.hpp>
@@ -30,6 +31,8 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_app_config.hpp>
 #include <srs_app_rtc_queue.hpp>
+#include <srs_app_rtc_bwe.hpp>
+#include <srs_app_rtc_fec.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_server.hpp>
 #include <srs_service_utility.hpp>
@@ -41,6 +44,7 @@ using namespace std;
 #include <srs_app_rtc_server.hpp>
 #include <srs_app_rtc_source.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_protocol_json.hpp>
 #include <srs_app_threads.hpp>
 #include <srs_service_log.hpp>
 #include <srs_app_log.hpp>
@@ -66,6 +70,14 @@ extern SrsPps* _srs_pps_rnack2;
 extern SrsPps* _srs_pps_pub;
 extern SrsPps* _srs_pps_conn;
 
+// The latency of RTP packet from received to sent to player.
+SrsHistogram* _srs_histogram_rtc_e2e = NULL;
+
+// The unknown SSRC, for example, the probing SSRC of Chrome, is not bound by RID for a while.
+#define SRS_RTC_UNKNOWN_SSRC_TIMEOUT (1 * SRS_UTIME_SECONDS)
+// The max number of unknown SSRCs, cleared when exceed.
+#define SRS_RTC_UNKNOWN_SSRC_MAX 64
+
 ISrsRtcTransport::ISrsRtcTransport()
 {
 }
@@ -170,10 +182,13 @@ srs_error_t SrsSecurityTransport::srtp_initialize()
         return err;
     }
     
-    if ((err = srtp_->initialize(recv_key, send_key)) != srs_success) {
+    SrsSrtpProfile profile = dtls_->get_srtp_profile();
+    if ((err = srtp_->initialize(recv_key, send_key, profile)) != srs_success) {
         return srs_error_wrap(err, "srtp init");
     }
 
+    srs_trace("RTC: SRTP init, profile=%s", (profile == SrsSrtpProfileAeadAes128Gcm)? "AEAD_AES_128_GCM" : "AES128_CM_SHA1_80");
+
     return err;
 }
 
@@ -428,6 +443,11 @@ srs_error_t SrsRtcPlayStream::initialize(SrsRequest* req, std::map<uint32_t, Srs
         if (desc->type_ == "video") {
             SrsRtcVideoSendTrack* track = new SrsRtcVideoSendTrack(session_, desc);
             video_tracks_.insert(make_pair(ssrc, track));
+
+            // For simulcast, it's the first layer, and the others are bound when got packets.
+            if (track->is_simulcast()) {
+                track->add_layer(ssrc, desc->rid_);
+            }
         }
     }
 
@@ -593,6 +613,14 @@ srs_error_t SrsRtcPlayStream::cycle()
             continue;
         }
 
+        // Pace the packets to smooth the burst, for example, the keyframe.
+        if (session_->pacer_) {
+            srs_utime_t delay = session_->pacer_->delay(srs_get_tick());
+            if (delay > 0) {
+                srs_usleep(delay);
+            }
+        }
+
         // Send-out the RTP packet and do cleanup
         // @remark Note that the pkt might be set to NULL.
         if ((err = send_packet(pkt)) != srs_success) {
@@ -636,6 +664,8 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
             map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = video_tracks_.find(ssrc);
             if (it != video_tracks_.end()) {
                 track = it->second;
+            } else {
+                track = find_layer_track(ssrc);
             }
         }
 
@@ -659,11 +689,31 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
         return err;
     }
 
+    // For simulcast, only forward the packets of selected layer, and request keyframe to switch.
+    if (!pkt->is_audio() && ((SrsRtcVideoSendTrack*)track)->is_simulcast()) {
+        int64_t estimate = session_->bwe_ ? session_->bwe_->estimate() : 0;
+
+        uint32_t keyframe_ssrc = 0;
+        bool forward = ((SrsRtcVideoSendTrack*)track)->on_layer_rtp(pkt, estimate, &keyframe_ssrc);
+        if (keyframe_ssrc) {
+            pli_worker_->request_keyframe(keyframe_ssrc, cid_);
+        }
+
+        if (!forward) {
+            return err;
+        }
+    }
+
     // Consume packet by track.
     if ((err = track->on_rtp(pkt)) != srs_success) {
         return srs_error_wrap(err, "audio track, SSRC=%u, SEQ=%u", ssrc, pkt->header.get_sequence());
     }
 
+    // The latency from received to sent, for RTC publisher or RTMP bridger.
+    if (pkt->recv_tick > 0) {
+        _srs_histogram_rtc_e2e->update(srs_get_tick() - pkt->recv_tick);
+    }
+
     // For NACK to handle packet.
     // @remark Note that the pkt might be set to NULL.
     if (nack_enabled_) {
@@ -675,6 +725,33 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
     return err;
 }
 
+SrsRtcVideoSendTrack* SrsRtcPlayStream::find_layer_track(uint32_t ssrc)
+{
+    map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = layer_tracks_.find(ssrc);
+    if (it != layer_tracks_.end()) {
+        return it->second;
+    }
+
+    // Bind the layer to the track, because player only subscribes the first layer, and the SSRC
+    // of layer is unknown when negotiating, for simulcast by RID.
+    SrsRtcTrackDescription* desc = source_->find_layer_by_ssrc(ssrc);
+    if (!desc) {
+        return NULL;
+    }
+
+    for (it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
+        SrsRtcVideoSendTrack* track = it->second;
+        if (track->is_simulcast() && track->get_track_id() == desc->id_) {
+            track->add_layer(ssrc, desc->rid_);
+            layer_tracks_[ssrc] = track;
+            srs_trace("RTC: Bind layer rid=%s, ssrc=%u to track %s", desc->rid_.c_str(), ssrc, desc->id_.c_str());
+            return track;
+        }
+    }
+
+    return NULL;
+}
+
 void SrsRtcPlayStream::set_all_tracks_status(bool status)
 {
     std::ostringstream merged_log;
@@ -704,6 +781,27 @@ void SrsRtcPlayStream::set_all_tracks_status(bool status)
     srs_trace("RTC: Init tracks %s ok", merged_log.str().c_str());
 }
 
+void SrsRtcPlayStream::set_layer(std::string rid)
+{
+    for (map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
+        it->second->set_layer(rid);
+    }
+}
+
+void SrsRtcPlayStream::dumps_layers(SrsJsonArray* arr)
+{
+    for (map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
+        SrsRtcVideoSendTrack* track = it->second;
+        if (!track->is_simulcast()) {
+            continue;
+        }
+
+        SrsJsonObject* obj = SrsJsonAny::object();
+        arr->append(obj);
+        track->dumps_layers(obj);
+    }
+}
+
 srs_error_t SrsRtcPlayStream::on_rtcp(SrsRtcpCommon* rtcp)
 {
     if(SrsRtcpType_rr == rtcp->type()) {
@@ -731,7 +829,15 @@ srs_error_t SrsRtcPlayStream::on_rtcp_rr(SrsRtcpRR* rtcp)
 {
     srs_error_t err = srs_success;
 
-    // TODO: FIXME: Implements it.
+    // The loss reported by player, to adapt the protection of FEC.
+    uint32_t ssrc = rtcp->get_rb_ssrc();
+    for (map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
+        SrsRtcVideoSendTrack* track = it->second;
+        if (track->has_ssrc(ssrc)) {
+            track->on_recv_rr(rtcp->get_lost_rate());
+            break;
+        }
+    }
 
     return err;
 }
@@ -832,7 +938,9 @@ uint32_t SrsRtcPlayStream::get_video_publish_ssrc(uint32_t play_ssrc)
     std::map<uint32_t, SrsRtcVideoSendTrack*>::iterator it;
     for (it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
         if (it->second->has_ssrc(play_ssrc)) {
-            return it->first;
+            // For simulcast, request keyframe for the layer we are sending.
+            uint32_t ssrc = it->second->get_layer_ssrc();
+            return ssrc ? ssrc : it->first;
         }
     }
 
@@ -846,12 +954,8 @@ srs_error_t SrsRtcPlayStream::do_request_keyframe(uint32_t ssrc, SrsContextId ci
     // The source MUST exists, when PLI thread is running.
     srs_assert(source_);
 
-    ISrsRtcPublishStream* publisher = source_->publish_stream();
-    if (!publisher) {
-        return err;
-    }
-
-    publisher->request_keyframe(ssrc);
+    // The PLIs of all players are coalesced by source.
+    source_->request_keyframe(ssrc);
 
     return err;
 }
@@ -953,8 +1057,11 @@ SrsRtcPublishStream::SrsRtcPublishStream(SrsRtcConnection* session, const SrsCon
 
     nn_audio_frames = 0;
     twcc_enabled_ = false;
+    fec_enabled_ = false;
     twcc_id_ = 0;
     twcc_fb_count_ = 0;
+    rid_id_ = 0;
+    repaired_rid_id_ = 0;
     
     pli_worker_ = new SrsRtcPLIWorker(this);
     last_time_send_twcc_ = 0;
@@ -1031,17 +1138,29 @@ srs_error_t SrsRtcPublishStream::initialize(SrsRequest* r, SrsRtcSourceDescripti
         rtcp_twcc_.set_media_ssrc(media_ssrc);
     }
 
+    // For simulcast by RID, the SSRC of layers are bound by the RID extension.
+    for (int i = 0; i < (int)stream_desc->video_track_descs_.size(); ++i) {
+        SrsRtcTrackDescription* desc = stream_desc->video_track_descs_.at(i);
+        if (!desc->rid_.empty() && desc->get_rtp_extension_id(kRidExt)) {
+            rid_id_ = desc->get_rtp_extension_id(kRidExt);
+            repaired_rid_id_ = desc->get_rtp_extension_id(kRepairedRidExt);
+            break;
+        }
+    }
+
     nack_enabled_ = _srs_config->get_rtc_nack_enabled(req->vhost);
     nack_no_copy_ = _srs_config->get_rtc_nack_no_copy(req->vhost);
     pt_to_drop_ = (uint16_t)_srs_config->get_rtc_drop_for_pt(req->vhost);
     twcc_enabled_ = _srs_config->get_rtc_twcc_enabled(req->vhost);
+    fec_enabled_ = _srs_config->get_rtc_fec_enabled(req->vhost);
 
     // No TWCC when negotiate, disable it.
     if (twcc_id <= 0) {
         twcc_enabled_ = false;
     }
 
-    srs_trace("RTC publisher nack=%d, nnc=%d, pt-drop=%u, twcc=%u/%d", nack_enabled_, nack_no_copy_, pt_to_drop_, twcc_enabled_, twcc_id);
+    srs_trace("RTC publisher nack=%d, nnc=%d, pt-drop=%u, twcc=%u/%d, fec=%d", nack_enabled_, nack_no_copy_, pt_to_drop_,
+        twcc_enabled_, twcc_id, fec_enabled_);
 
     // Setup tracks.
     for (int i = 0; i < (int)audio_tracks_.size(); i++) {
@@ -1269,16 +1388,99 @@ srs_error_t SrsRtcPublishStream::on_rtp(char* data, int nb_data)
     return err;
 }
 
-srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaintext)
+bool SrsRtcPublishStream::bind_rid_ssrc(char* buf, int nb_buf, uint32_t ssrc)
 {
-    srs_error_t err = srs_success;
+    if (!rid_id_) {
+        return false;
+    }
+
+    // The RTP of layer carries the RID, while the RTX carries the repaired RID.
+    string rid;
+    bool repaired = false;
+    srs_error_t err = srs_rtp_fast_parse_rid(buf, nb_buf, rid_id_, rid);
+    if (err != srs_success && repaired_rid_id_) {
+        srs_freep(err);
+        err = srs_rtp_fast_parse_rid(buf, nb_buf, repaired_rid_id_, rid);
+        repaired = true;
+    }
+    if (err != srs_success) {
+        srs_freep(err);
+        return false;
+    }
+
+    for (int i = 0; i < (int)video_tracks_.size(); ++i) {
+        SrsRtcVideoRecvTrack* track = video_tracks_.at(i);
+        if (track->bind_rid_ssrc(rid, ssrc, repaired)) {
+            source->bind_rid_ssrc(track->get_track_id(), rid, ssrc, repaired);
+            srs_trace("RTC: Bind layer rid=%s, ssrc=%u, repaired=%d, track=%s", rid.c_str(), ssrc, repaired,
+                track->get_track_id().c_str());
+            return true;
+        }
+    }
 
+    return false;
+}
+
+srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaintext)
+{
     if (_srs_blackhole->blackhole) {
         _srs_blackhole->sendto(plaintext, nb_plaintext);
     }
 
-    // Allocate packet form cache.
-    SrsRtpPacket* pkt = new SrsRtpPacket();
+    // For video protected by ULPFEC, the media and FEC packets are in RED.
+    if (fec_enabled_) {
+        SrsRtcVideoRecvTrack* video_track = get_video_track(srs_rtp_fast_parse_ssrc(plaintext, nb_plaintext));
+        if (video_track && video_track->is_red(plaintext, nb_plaintext)) {
+            return on_rtp_red(video_track, plaintext, nb_plaintext);
+        }
+    }
+
+    return on_rtp_media(plaintext, nb_plaintext);
+}
+
+srs_error_t SrsRtcPublishStream::on_rtp_red(SrsRtcVideoRecvTrack* track, char* plaintext, int nb_plaintext)
+{
+    srs_error_t err = srs_success;
+
+    // The media packet is unwrapped in place, and the size is 0 if it's FEC.
+    int nb_media = nb_plaintext;
+    vector<SrsRtcFecPacket*> recovered;
+    if ((err = track->on_red(plaintext, &nb_media, recovered)) != srs_success) {
+        return srs_error_wrap(err, "on red");
+    }
+
+    // The FEC packet is not media, never NACK it.
+    if (!nb_media && nack_enabled_) {
+        SrsBuffer b(plaintext, nb_plaintext); SrsRtpHeader h; h.ignore_padding(true);
+        if ((err = h.decode(&b)) == srs_success) {
+            track->on_nack_ignored(h.get_sequence());
+        }
+        srs_freep(err);
+    }
+
+    if (nb_media) {
+        err = on_rtp_media(plaintext, nb_media);
+    }
+
+    // Handle the recovered packets as we received them.
+    for (int i = 0; i < (int)recovered.size(); i++) {
+        SrsRtcFecPacket* pkt = recovered.at(i);
+        if (err == srs_success) {
+            err = on_rtp_media(pkt->data_, pkt->size_);
+        }
+        srs_freep(pkt);
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcPublishStream::on_rtp_media(char* plaintext, int nb_plaintext)
+{
+    srs_error_t err = srs_success;
+
+    // Allocate packet form pool, with the buffer and payload to reuse.
+    SrsRtpPacket* pkt = session_->packet_pool()->allocate();
+    pkt->recv_tick = srs_get_tick();
 
     // Copy the packet body.
     char* p = pkt->wrap(plaintext, nb_plaintext);
@@ -1289,9 +1491,9 @@ srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaint
     // @remark Note that the pkt might be set to NULL.
     err = do_on_rtp_plaintext(pkt, &buf);
 
-    // Free the packet.
+    // Recycle the packet, or free it if it's referenced by consumers.
     // @remark Note that the pkt might be set to NULL.
-    srs_freep(pkt);
+    session_->packet_pool()->recycle(pkt);
 
     return err;
 }
@@ -1555,6 +1757,15 @@ srs_error_t SrsRtcPublishStream::do_request_keyframe(uint32_t ssrc, SrsContextId
     return err;
 }
 
+void SrsRtcPublishStream::dumps_keyframe(SrsJsonArray* arr)
+{
+    SrsJsonObject* obj = SrsJsonAny::object();
+    arr->append(obj);
+
+    obj->set("url", SrsJsonAny::str(req->get_stream_url().c_str()));
+    source->dumps_keyframe(obj);
+}
+
 void SrsRtcPublishStream::simulate_nack_drop(int nn)
 {
     nn_simulate_nack_drop = nn;
@@ -1673,6 +1884,7 @@ SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
     hijacker_ = NULL;
 
     sendonly_skt = NULL;
+    stun_responder_ = NULL;
     server_ = s;
     transport_ = new SrsSecurityTransport(this);
 
@@ -1687,6 +1899,10 @@ SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
     disposing_ = false;
 
     twcc_id_ = 0;
+    twcc_sn_ = 0;
+    bwe_ = NULL;
+    pacer_ = NULL;
+    packet_pool_ = new SrsRtpPacketPool(256);
     nn_simulate_player_nack_drop = 0;
     pp_address_change = new SrsErrorPithyPrint();
     pli_epp = new SrsErrorPithyPrint();
@@ -1710,6 +1926,7 @@ SrsRtcConnection::~SrsRtcConnection()
     }
     publishers_.clear();
     publishers_ssrc_map_.clear();
+    unknown_ssrcs_.clear();
 
     // Cleanup players.
     for(map<string, SrsRtcPlayStream*>::iterator it = players_.begin(); it != players_.end(); ++it) {
@@ -1736,6 +1953,11 @@ SrsRtcConnection::~SrsRtcConnection()
 
     srs_freep(transport_);
     srs_freep(req);
+    srs_freep(bwe_);
+    srs_freep(pacer_);
+    // Must free after publishers, which recycle packets to pool.
+    srs_freep(packet_pool_);
+    srs_freep(stun_responder_);
     srs_freep(pp_address_change);
     srs_freep(pli_epp);
 }
@@ -1966,6 +2188,23 @@ srs_error_t SrsRtcConnection::on_stun(SrsUdpMuxSocket* skt, SrsStunPacket* r)
         return err;
     }
 
+    // Setup the fast responder for the following binding requests, such as ICE consent freshness.
+    if (!stun_responder_) {
+        SrsStunResponder* responder = new SrsStunResponder();
+        if ((err = responder->initialize(get_local_sdp()->get_ice_pwd(), r->get_username())) != srs_success) {
+            srs_warn("RTC: ignore stun responder, username=%s, err %s", r->get_username().c_str(), srs_error_desc(err).c_str());
+            srs_freep(err);
+            srs_freep(responder);
+        }
+        stun_responder_ = responder;
+    }
+
+    // @see https://tools.ietf.org/html/rfc5389#section-10.1.2
+    bool strict_check = _srs_config->get_rtc_stun_strict_check(req->vhost);
+    if (strict_check && stun_responder_ && !stun_responder_->verify(skt->data(), skt->size())) {
+        return srs_error_new(ERROR_RTC_STUN, "invalid message integrity, username=%s", r->get_username().c_str());
+    }
+
     // We are running in the ice-lite(server) mode. If client have multi network interface,
     // we only choose one candidate pair which is determined by client.
     update_sendonly_socket(skt);
@@ -1982,6 +2221,50 @@ srs_error_t SrsRtcConnection::on_stun(SrsUdpMuxSocket* skt, SrsStunPacket* r)
     return err;
 }
 
+srs_error_t SrsRtcConnection::on_stun_fast(SrsUdpMuxSocket* skt, bool* pconsumed)
+{
+    srs_error_t err = srs_success;
+
+    // Only for the IPv4 address, and the session which has responded the first binding request.
+    uint64_t fast_id = skt->fast_id();
+    if (!fast_id || !stun_responder_ || state_ == WAITING_STUN) {
+        return err;
+    }
+
+    if (!stun_responder_->match(skt->data(), skt->size())) {
+        return err;
+    }
+    *pconsumed = true;
+
+    // Only update the address when changed, to avoid building the peer id.
+    if (!sendonly_skt || sendonly_skt->fast_id() != fast_id) {
+        update_sendonly_socket(skt);
+    }
+
+    if (_srs_blackhole->blackhole) {
+        _srs_blackhole->sendto(skt->data(), skt->size());
+    }
+
+    ++_srs_pps_sstuns->sugar;
+
+    char buf[kRtpPacketSize];
+    int nb_buf = sizeof(buf);
+    sockaddr_in* addr = skt->peer_addr();
+    if ((err = stun_responder_->respond(skt->data(), ntohl(addr->sin_addr.s_addr), ntohs(addr->sin_port), buf, &nb_buf)) != srs_success) {
+        return srs_error_wrap(err, "stun binding response build failed");
+    }
+
+    if ((err = sendonly_skt->sendto(buf, nb_buf, 0)) != srs_success) {
+        return srs_error_wrap(err, "stun binding response send failed");
+    }
+
+    if (_srs_blackhole->blackhole) {
+        _srs_blackhole->sendto(buf, nb_buf);
+    }
+
+    return err;
+}
+
 srs_error_t SrsRtcConnection::on_dtls(char* data, int nb_data)
 {
     return transport_->on_dtls(data, nb_data);
@@ -2032,7 +2315,8 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
 
     // For TWCC packet.
     if (SrsRtcpType_rtpfb == rtcp->type() && 15 == rtcp->get_rc()) {
-        return on_rtcp_feedback_twcc(rtcp->data(), rtcp->size());
+        SrsRtcpTWCC* twcc = dynamic_cast<SrsRtcpTWCC*>(rtcp);
+        return on_rtcp_feedback_twcc(twcc);
     }
 
     // For REMB packet.
@@ -2109,9 +2393,27 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
     return err;
 }
 
-srs_error_t SrsRtcConnection::on_rtcp_feedback_twcc(char* data, int nb_data)
+srs_error_t SrsRtcConnection::on_rtcp_feedback_twcc(SrsRtcpTWCC* rtcp)
 {
-    return srs_success;
+    srs_error_t err = srs_success;
+
+    // Ignore if not negotiated, or not a TWCC feedback.
+    if (!bwe_ || !rtcp) {
+        return err;
+    }
+
+    // Ignore the feedback without any packet, for example, the corrupt one.
+    if (!rtcp->get_packet_status_count()) {
+        return err;
+    }
+
+    bwe_->on_feedback(rtcp, srs_get_tick());
+
+    if (pacer_) {
+        pacer_->set_estimate(bwe_->estimate());
+    }
+
+    return err;
 }
 
 srs_error_t SrsRtcConnection::on_rtcp_feedback_remb(SrsRtcpPsfbCommon *rtcp)
@@ -2152,13 +2454,36 @@ srs_error_t SrsRtcConnection::find_publisher(char* buf, int size, SrsRtcPublishS
     }
 
     map<uint32_t, SrsRtcPublishStream*>::iterator it = publishers_ssrc_map_.find(ssrc);
-    if(it == publishers_ssrc_map_.end()) {
-        return srs_error_new(ERROR_RTC_NO_PUBLISHER, "no publisher for ssrc:%u", ssrc);
+    if(it != publishers_ssrc_map_.end()) {
+        *ppublisher = it->second;
+        return err;
     }
 
-    *ppublisher = it->second;
+    // Don't parse the RID of unknown SSRC for each packet.
+    srs_utime_t now = srs_get_system_time();
+    map<uint32_t, srs_utime_t>::iterator it3 = unknown_ssrcs_.find(ssrc);
+    if (it3 != unknown_ssrcs_.end() && now < it3->second) {
+        return srs_error_new(ERROR_RTC_NO_PUBLISHER, "no publisher for unknown ssrc:%u", ssrc);
+    }
+
+    // For simulcast by RID, the SSRC of layer is unknown until the first packet.
+    map<string, SrsRtcPublishStream*>::iterator it2;
+    for (it2 = publishers_.begin(); it2 != publishers_.end(); ++it2) {
+        SrsRtcPublishStream* publisher = it2->second;
+        if (publisher->bind_rid_ssrc(buf, size, ssrc)) {
+            publishers_ssrc_map_[ssrc] = publisher;
+            unknown_ssrcs_.erase(ssrc);
+            *ppublisher = publisher;
+            return err;
+        }
+    }
 
-    return err;
+    if (unknown_ssrcs_.size() >= SRS_RTC_UNKNOWN_SSRC_MAX) {
+        unknown_ssrcs_.clear();
+    }
+    unknown_ssrcs_[ssrc] = now + SRS_RTC_UNKNOWN_SSRC_TIMEOUT;
+
+    return srs_error_new(ERROR_RTC_NO_PUBLISHER, "no publisher for ssrc:%u", ssrc);
 }
 
 srs_error_t SrsRtcConnection::on_connection_established()
@@ -2520,9 +2845,21 @@ void SrsRtcConnection::simulate_player_drop_packet(SrsRtpHeader* h, int nn_bytes
 }
 
 srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
+{
+    return do_send_packet(pkt, NULL);
+}
+
+srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt, SrsRtcFecEncoder* fec)
 {
     srs_error_t err = srs_success;
 
+    // Stamp the transport-wide sequence number, for player to feedback by TWCC.
+    uint16_t twcc_sn = 0;
+    if (bwe_) {
+        twcc_sn = ++twcc_sn_;
+        pkt->header.set_twcc_sequence_number(twcc_id_, twcc_sn);
+    }
+
     // For this message, select the first iovec.
     iovec* iov = cache_iov_;
     iov->iov_len = kRtpPacketSize;
@@ -2536,6 +2873,15 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
         iov->iov_len = cache_buffer_->pos();
     }
 
+    // Protect the plaintext by FEC, which is wrapped in RED.
+    if (fec) {
+        int nn_red = (int)iov->iov_len;
+        if ((err = fec->protect((char*)iov->iov_base, &nn_red, kRtpPacketSize)) != srs_success) {
+            return srs_error_wrap(err, "fec protect");
+        }
+        iov->iov_len = (size_t)nn_red;
+    }
+
     // Cipher RTP to SRTP packet.
     if (true) {
         int nn_encrypt = (int)iov->iov_len;
@@ -2545,6 +2891,17 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
         iov->iov_len = (size_t)nn_encrypt;
     }
 
+    // Record the sent packet, for bandwidth estimation and pacer.
+    if (bwe_ || pacer_) {
+        srs_utime_t now = srs_get_tick();
+        if (bwe_) {
+            bwe_->on_sent(twcc_sn, (int)iov->iov_len, now);
+        }
+        if (pacer_) {
+            pacer_->on_sent((int)iov->iov_len, now);
+        }
+    }
+
     // For NACK simulator, drop packet.
     if (nn_simulate_player_nack_drop) {
         simulate_player_drop_packet(&pkt->header, (int)iov->iov_len);
@@ -2564,6 +2921,48 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
     return err;
 }
 
+SrsRtpPacketPool* SrsRtcConnection::packet_pool()
+{
+    return packet_pool_;
+}
+
+void SrsRtcConnection::dumps_bwe(SrsJsonObject* obj)
+{
+    obj->set("username", SrsJsonAny::str(username_.c_str()));
+    obj->set("url", SrsJsonAny::str(req ? req->get_stream_url().c_str() : ""));
+
+    if (bwe_) {
+        SrsJsonObject* bwe = SrsJsonAny::object();
+        obj->set("bwe", bwe);
+        bwe_->dumps(bwe);
+    }
+
+    if (pacer_) {
+        SrsJsonObject* pacer = SrsJsonAny::object();
+        obj->set("pacer", pacer);
+        pacer_->dumps(pacer);
+    }
+
+    SrsJsonArray* layers = SrsJsonAny::array();
+    obj->set("layers", layers);
+    for (map<string, SrsRtcPlayStream*>::iterator it = players_.begin(); it != players_.end(); ++it) {
+        it->second->dumps_layers(layers);
+    }
+
+    SrsJsonArray* keyframes = SrsJsonAny::array();
+    obj->set("keyframes", keyframes);
+    for (map<string, SrsRtcPublishStream*>::iterator it = publishers_.begin(); it != publishers_.end(); ++it) {
+        it->second->dumps_keyframe(keyframes);
+    }
+}
+
+void SrsRtcConnection::set_layer(std::string rid)
+{
+    for (map<string, SrsRtcPlayStream*>::iterator it = players_.begin(); it != players_.end(); ++it) {
+        it->second->set_layer(rid);
+    }
+}
+
 void SrsRtcConnection::set_all_tracks_status(std::string stream_uri, bool is_publish, bool status)
 {
     // For publishers.
@@ -2705,6 +3104,7 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
 
     bool nack_enabled = _srs_config->get_rtc_nack_enabled(req->vhost);
     bool twcc_enabled = _srs_config->get_rtc_twcc_enabled(req->vhost);
+    bool fec_enabled = _srs_config->get_rtc_fec_enabled(req->vhost);
     // TODO: FIME: Should check packetization-mode=1 also.
     bool has_42e01f = srs_sdp_has_h264_profile(remote_sdp, "42e01f");
 
@@ -2890,6 +3290,51 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
         track_desc->create_auxiliary_payload(remote_media_desc.find_media_with_encoding_name("rtx"));
         track_desc->create_auxiliary_payload(remote_media_desc.find_media_with_encoding_name("ulpfec"));
 
+        // The ULPFEC is in RED, only for video when FEC is enabled.
+        if (!fec_enabled || !remote_media_desc.is_video() || !track_desc->red_) {
+            srs_freep(track_desc->ulpfec_);
+        }
+
+        // For simulcast by RID, there is no SSRC for layers, which is bound by the RID extension of
+        // the first packet, so we create a track for each layer.
+        // @see https://tools.ietf.org/html/rfc8853
+        if (remote_media_desc.is_video() && remote_media_desc.simulcast_ == "send" && remote_media_desc.rids_.size() > 1) {
+            int remote_rid_id = 0, remote_repaired_rid_id = 0;
+            map<int, string> extmaps = remote_media_desc.get_extmaps();
+            for(map<int, string>::iterator it = extmaps.begin(); it != extmaps.end(); ++it) {
+                if (it->second == kRidExt) {
+                    remote_rid_id = it->first;
+                } else if (it->second == kRepairedRidExt) {
+                    remote_repaired_rid_id = it->first;
+                }
+            }
+
+            if (remote_rid_id) {
+                track_desc->add_rtp_extension_desc(remote_rid_id, kRidExt);
+                if (remote_repaired_rid_id) {
+                    track_desc->add_rtp_extension_desc(remote_repaired_rid_id, kRepairedRidExt);
+                }
+
+                string msid = remote_media_desc.msid_, track_id = remote_media_desc.msid_tracker_;
+                if (track_id.empty() && !remote_media_desc.ssrc_infos_.empty()) {
+                    msid = remote_media_desc.ssrc_infos_.at(0).msid_;
+                    track_id = remote_media_desc.ssrc_infos_.at(0).msid_tracker_;
+                }
+                if (track_id.empty()) {
+                    track_id = "video-" + remote_media_desc.mid_;
+                }
+
+                for (int j = 0; j < (int)remote_media_desc.rids_.size(); ++j) {
+                    SrsRtcTrackDescription* layer = track_desc->copy();
+                    layer->id_ = track_id;
+                    layer->msid_ = msid;
+                    layer->rid_ = remote_media_desc.rids_.at(j);
+                    stream_desc->video_track_descs_.push_back(layer);
+                }
+                continue;
+            }
+        }
+
         std::string track_id;
         for (int j = 0; j < (int)remote_media_desc.ssrc_infos_.size(); ++j) {
             const SrsSSRCInfo& ssrc_info = remote_media_desc.ssrc_infos_.at(j);
@@ -2910,6 +3355,39 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
             track_id = ssrc_info.msid_tracker_;
         }
 
+        // For simulcast by ssrc-group SIM, each SSRC is a layer of the track, which shares the same
+        // track id, and the RID of layer is the index in group.
+        for (int j = 0; remote_media_desc.is_video() && j < (int)remote_media_desc.ssrc_groups_.size(); ++j) {
+            const SrsSSRCGroup& ssrc_group = remote_media_desc.ssrc_groups_.at(j);
+            if (ssrc_group.semantic_ != "SIM" || ssrc_group.ssrcs_.size() < 2) {
+                continue;
+            }
+
+            SrsRtcTrackDescription* track = NULL;
+            for (int k = 0; !track && k < (int)stream_desc->video_track_descs_.size(); ++k) {
+                SrsRtcTrackDescription* desc = stream_desc->video_track_descs_.at(k);
+                if (std::find(ssrc_group.ssrcs_.begin(), ssrc_group.ssrcs_.end(), desc->ssrc_) != ssrc_group.ssrcs_.end()) {
+                    track = desc;
+                }
+            }
+            if (!track) {
+                continue;
+            }
+
+            uint32_t ssrc = track->ssrc_;
+            for (int k = 0; k < (int)ssrc_group.ssrcs_.size(); ++k) {
+                if (ssrc_group.ssrcs_.at(k) == ssrc) {
+                    track->rid_ = srs_int2str(k);
+                    continue;
+                }
+
+                SrsRtcTrackDescription* layer = track->copy();
+                layer->ssrc_ = ssrc_group.ssrcs_.at(k);
+                layer->rid_ = srs_int2str(k);
+                stream_desc->video_track_descs_.push_back(layer);
+            }
+        }
+
         // set track fec_ssrc and rtx_ssrc
         for (int j = 0; j < (int)remote_media_desc.ssrc_groups_.size(); ++j) {
             const SrsSSRCGroup& ssrc_group = remote_media_desc.ssrc_groups_.at(j);
@@ -2992,6 +3470,11 @@ srs_error_t SrsRtcConnection::generate_publish_local_sdp(SrsRequest* req, SrsSdp
     for (int i = 0;  i < (int)stream_desc->video_track_descs_.size(); ++i) {
         SrsRtcTrackDescription* video_track = stream_desc->video_track_descs_.at(i);
 
+        // For simulcast, the layers are in the same media.
+        if (!video_track->rid_.empty() && std::find(local_sdp.groups_.begin(), local_sdp.groups_.end(), video_track->mid_) != local_sdp.groups_.end()) {
+            continue;
+        }
+
         local_sdp.media_descs_.push_back(SrsMediaDesc("video"));
         SrsMediaDesc& local_media_desc = local_sdp.media_descs_.back();
 
@@ -3008,6 +3491,17 @@ srs_error_t SrsRtcConnection::generate_publish_local_sdp(SrsRequest* req, SrsSdp
         //local_media_desc.msid_tracker_ = video_track->id_;
         local_media_desc.extmaps_ = video_track->extmaps_;
 
+        // For simulcast by RID, we receive all layers of the track.
+        if (!video_track->rid_.empty() && video_track->get_rtp_extension_id(kRidExt)) {
+            local_media_desc.simulcast_ = "recv";
+            for (int j = i; j < (int)stream_desc->video_track_descs_.size(); ++j) {
+                SrsRtcTrackDescription* layer = stream_desc->video_track_descs_.at(j);
+                if (layer->mid_ == video_track->mid_) {
+                    local_media_desc.rids_.push_back(layer->rid_);
+                }
+            }
+        }
+
         if (video_track->direction_ == "recvonly") {
             local_media_desc.recvonly_ = true;
         } else if (video_track->direction_ == "sendonly") {
@@ -3026,6 +3520,10 @@ srs_error_t SrsRtcConnection::generate_publish_local_sdp(SrsRequest* req, SrsSdp
             local_media_desc.payload_types_.push_back(payload->generate_media_payload_type());
         }
 
+        if (video_track->ulpfec_) {
+            local_media_desc.payload_types_.push_back(video_track->ulpfec_->generate_media_payload_type());
+        }
+
         if(!unified_plan) {
             // For PlanB, only need media desc info, not ssrc info;
             break;
@@ -3044,6 +3542,7 @@ srs_error_t SrsRtcConnection::negotiate_play_capability(SrsRtcUserConfig* ruc, s
 
     bool nack_enabled = _srs_config->get_rtc_nack_enabled(req->vhost);
     bool twcc_enabled = _srs_config->get_rtc_twcc_enabled(req->vhost);
+    bool fec_enabled = _srs_config->get_rtc_fec_enabled(req->vhost);
     // TODO: FIME: Should check packetization-mode=1 also.
     bool has_42e01f = srs_sdp_has_h264_profile(remote_sdp, "42e01f");
 
@@ -3127,6 +3626,18 @@ srs_error_t SrsRtcConnection::negotiate_play_capability(SrsRtcUserConfig* ruc, s
                 track->red_->pt_ = red_pt.payload_type_;
             }
 
+            // Protect the video by ULPFEC in RED, if player supports it. Note that the FEC of publisher
+            // is removed when recovering, so we never forward it.
+            srs_freep(track->ulpfec_);
+            track->fec_ssrc_ = 0;
+            vector<SrsMediaPayloadType> ulpfec_pts = remote_media_desc.find_media_with_encoding_name("ulpfec");
+            if (fec_enabled && remote_media_desc.is_video() && !red_pts.empty() && !ulpfec_pts.empty()) {
+                if (!track->red_) {
+                    track->create_auxiliary_payload(red_pts);
+                }
+                track->create_auxiliary_payload(ulpfec_pts);
+            }
+
             track->mid_ = remote_media_desc.mid_;
             uint32_t publish_ssrc = track->ssrc_;
 
@@ -3213,6 +3724,10 @@ void video_track_generate_play_offer(SrsRtcTrackDescription* track, string mid,
         SrsRedPayload* red_payload = (SrsRedPayload*)track->red_;
         local_media_desc.payload_types_.push_back(red_payload->generate_media_payload_type());
     }
+
+    if (track->ulpfec_) {
+        local_media_desc.payload_types_.push_back(track->ulpfec_->generate_media_payload_type());
+    }
 }
 
 srs_error_t SrsRtcConnection::generate_play_local_sdp(SrsRequest* req, SrsSdp& local_sdp, SrsRtcSourceDescription* stream_desc, bool unified_plan)
@@ -3396,7 +3911,19 @@ srs_error_t SrsRtcConnection::create_player(SrsRequest* req, std::map<uint32_t,
             ++it;
         }
     }
-    srs_trace("RTC connection player gcc=%d", twcc_id);
+
+    // Stamp the transport-wide sequence number, then estimate the bandwidth by TWCC feedback.
+    if (twcc_id && !bwe_) {
+        twcc_id_ = twcc_id;
+        bwe_ = new SrsRtcBandwidthEstimator();
+    }
+
+    // TODO: FIXME: Support reload.
+    bool pacer = _srs_config->get_rtc_pacer_enabled(req->vhost);
+    if (pacer && !pacer_) {
+        pacer_ = new SrsRtcPacer();
+    }
+    srs_trace("RTC connection player gcc=%d, pacer=%d", twcc_id, pacer);
 
     // If DTLS done, start the player. Because maybe create some players after DTLS done.
     // For example, for single PC, we maybe start publisher when create it, because DTLS is done.
@@ -3426,6 +3953,7 @@ srs_error_t SrsRtcConnection::create_publisher(SrsRequest* req, SrsRtcSourceDesc
         return srs_error_wrap(err, "rtc publisher init");
     }
     publishers_[req->get_stream_url()] = publisher;
+    unknown_ssrcs_.clear();
 
     if(NULL != stream_desc->audio_track_desc_) {
         if(publishers_ssrc_map_.end() != publishers_ssrc_map_.find(stream_desc->audio_track_desc_->ssrc_)) {
@@ -3455,6 +3983,11 @@ srs_error_t SrsRtcConnection::create_publisher(SrsRequest* req, SrsRtcSourceDesc
 
     for(int i = 0; i < (int)stream_desc->video_track_descs_.size(); ++i) {
         SrsRtcTrackDescription* track_desc = stream_desc->video_track_descs_.at(i);
+        // Ignore the layer of simulcast by RID, which is bound to SSRC by the first packet.
+        if (!track_desc->ssrc_) {
+            continue;
+        }
+
         if(publishers_ssrc_map_.end() != publishers_ssrc_map_.find(track_desc->ssrc_)) {
             return srs_error_new(ERROR_RTC_DUPLICATED_SSRC, " duplicate ssrc %d, track id: %s",
                 track_desc->ssrc_, track_desc->id_.c_str());
@@ -32,6 +32,7 @@
 class SrsUdpMuxSocket;
 class SrsLiveConsumer;
 class SrsStunPacket;
+class SrsStunResponder;
 class SrsRtcServer;
 class SrsRtcConnection;
 class SrsSharedPtrMessage;
@@ -50,6 +51,12 @@ class SrsStatistic;
 class SrsRtcUserConfig;
 class SrsRtcSendTrack;
 class SrsRtcPublishStream;
+class SrsRtcBandwidthEstimator;
+class SrsRtcPacer;
+class SrsRtcFecEncoder;
+class SrsRtpPacketPool;
+class SrsJsonObject;
+class SrsJsonArray;
 
 const uint8_t kSR   = 200;
 const uint8_t kRR   = 201;
@@ -210,6 +217,8 @@ private:
     // key: publish_ssrc, value: send track to process rtp/rtcp
     std::map<uint32_t, SrsRtcAudioSendTrack*> audio_tracks_;
     std::map<uint32_t, SrsRtcVideoSendTrack*> video_tracks_;
+    // For simulcast, key: ssrc of layer, value: the video track of layers, not owned.
+    std::map<uint32_t, SrsRtcVideoSendTrack*> layer_tracks_;
     // The pithy print for special stage.
     SrsErrorPithyPrint* nack_epp;
 private:
@@ -250,9 +259,13 @@ public:
     virtual srs_error_t cycle();
 private:
     srs_error_t send_packet(SrsRtpPacket*& pkt);
+    SrsRtcVideoSendTrack* find_layer_track(uint32_t ssrc);
 public:
     // Directly set the status of track, generally for init to set the default value.
     void set_all_tracks_status(bool status);
+    // For simulcast, set the layer by API, empty for auto.
+    void set_layer(std::string rid);
+    void dumps_layers(SrsJsonArray* arr);
 public:
     srs_error_t on_rtcp(SrsRtcpCommon* rtcp);
 private:
@@ -313,6 +326,7 @@ private:
     bool nack_enabled_;
     bool nack_no_copy_;
     bool twcc_enabled_;
+    bool fec_enabled_;
 private:
     bool request_keyframe_;
     SrsErrorPithyPrint* pli_epp;
@@ -332,6 +346,10 @@ private:
     SrsRtpExtensionTypes extension_types_;
     bool is_started;
     srs_utime_t last_time_send_twcc_;
+private:
+    // For simulcast by RID, the extension id of RID and repaired RID, to bind SSRC of layers.
+    int rid_id_;
+    int repaired_rid_id_;
 public:
     SrsRtcPublishStream(SrsRtcConnection* session, const SrsContextId& cid);
     virtual ~SrsRtcPublishStream();
@@ -346,10 +364,15 @@ private:
     srs_error_t send_rtcp_xr_rrtr();
 public:
     srs_error_t on_rtp(char* buf, int nb_buf);
+    // For simulcast by RID, bind the unknown SSRC to layer by the RID extension.
+    bool bind_rid_ssrc(char* buf, int nb_buf, uint32_t ssrc);
 private:
     // @remark We copy the plaintext, user should free it.
     srs_error_t on_rtp_plaintext(char* plaintext, int nb_plaintext);
 private:
+    // For video protected by ULPFEC, unwrap the RED packet, and handle the recovered packets.
+    srs_error_t on_rtp_red(SrsRtcVideoRecvTrack* track, char* plaintext, int nb_plaintext);
+    srs_error_t on_rtp_media(char* plaintext, int nb_plaintext);
     srs_error_t do_on_rtp_plaintext(SrsRtpPacket*& pkt, SrsBuffer* buf);
 public:
     srs_error_t check_send_nacks();
@@ -365,6 +388,8 @@ private:
 public:
     void request_keyframe(uint32_t ssrc);
     virtual srs_error_t do_request_keyframe(uint32_t ssrc, SrsContextId cid);
+    // Dumps the PLIs of players to this publisher.
+    void dumps_keyframe(SrsJsonArray* arr);
 public:
     void simulate_nack_drop(int nn);
 private:
@@ -431,6 +456,8 @@ private:
     std::map<std::string, SrsRtcPublishStream*> publishers_;
     // key: publisher track's ssrc
     std::map<uint32_t, SrsRtcPublishStream*> publishers_ssrc_map_;
+    // key: unknown ssrc without publisher, value: the time to bind it by RID again.
+    std::map<uint32_t, srs_utime_t> unknown_ssrcs_;
 private:
     // The local:remote username, such as m5x0n128:jvOm where local name is m5x0n128.
     std::string username_;
@@ -438,6 +465,8 @@ private:
     SrsUdpMuxSocket* sendonly_skt;
     // The address list, client may use multiple addresses.
     std::map<std::string, SrsUdpMuxSocket*> peer_addresses_;
+    // The fast responder for STUN binding requests, setup when responded the first one.
+    SrsStunResponder* stun_responder_;
 private:
     // TODO: FIXME: Rename it.
     // The timeout of session, keep alive by STUN ping pong.
@@ -452,8 +481,15 @@ private:
     SrsSdp remote_sdp;
     SrsSdp local_sdp;
 private:
-    // twcc handler
+    // The TWCC ID of player, to stamp the transport-wide sequence number to packets.
     int twcc_id_;
+    uint16_t twcc_sn_;
+    // The bandwidth estimator by TWCC feedback of player, NULL if TWCC is disabled.
+    SrsRtcBandwidthEstimator* bwe_;
+    // The pacer for players, NULL if disabled.
+    SrsRtcPacer* pacer_;
+    // The pool of packets for publishers to decode RTP packets.
+    SrsRtpPacketPool* packet_pool_;
     // Simulators.
     int nn_simulate_player_nack_drop;
     // Pithy print for address change, use port as error code.
@@ -497,6 +533,9 @@ public:
     srs_error_t initialize(SrsRequest* r, bool dtls, bool srtp, std::string username);
     // The peer address may change, we can identify that by STUN messages.
     srs_error_t on_stun(SrsUdpMuxSocket* skt, SrsStunPacket* r);
+    // The fast path for binding requests of established session, without decoding the STUN packet.
+    // @param pconsumed Whether the packet is responded, or should be handled by on_stun.
+    srs_error_t on_stun_fast(SrsUdpMuxSocket* skt, bool* pconsumed);
     srs_error_t on_dtls(char* data, int nb_data);
     srs_error_t on_rtp(char* data, int nb_data);
 private:
@@ -507,7 +546,7 @@ public:
 private:
     srs_error_t dispatch_rtcp(SrsRtcpCommon* rtcp);
 public:
-    srs_error_t on_rtcp_feedback_twcc(char* buf, int nb_buf);
+    srs_error_t on_rtcp_feedback_twcc(SrsRtcpTWCC* rtcp);
     srs_error_t on_rtcp_feedback_remb(SrsRtcpPsfbCommon *rtcp);
 public:
     void set_hijacker(ISrsRtcConnectionHijacker* h);
@@ -531,8 +570,16 @@ public:
     void simulate_nack_drop(int nn);
     void simulate_player_drop_packet(SrsRtpHeader* h, int nn_bytes);
     srs_error_t do_send_packet(SrsRtpPacket* pkt);
+    // Send the media packet in RED, which is protected by FEC, see SrsRtcFecEncoder::protect.
+    srs_error_t do_send_packet(SrsRtpPacket* pkt, SrsRtcFecEncoder* fec);
     // Directly set the status of play track, generally for init to set the default value.
     void set_all_tracks_status(std::string stream_uri, bool is_publish, bool status);
+    // The pool of packets for publishers, to decode without allocation.
+    SrsRtpPacketPool* packet_pool();
+    // Dumps the estimated bandwidth, pacer and simulcast layers of players.
+    void dumps_bwe(SrsJsonObject* obj);
+    // For simulcast, set the layer of players by API, empty for auto.
+    void set_layer(std::string rid);
 private:
     srs_error_t on_binding_request(SrsStunPacket* r);
     // publish media capabilitiy negotiate
@@ -6,6 +6,7 @@
 
 #include <srs_app_rtc_dtls.hpp>
 
+#include <map>
 using namespace std;
 
 #include <string.h>
@@ -20,11 +21,14 @@ using namespace std;
 #include <srs_app_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_protocol_kbps.hpp>
 
 #include <srtp2/srtp.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+SrsPps* _srs_pps_dtls_handshakes = NULL;
+
 // Defined in HTTP/HTTPS client.
 extern int srs_verify_callback(int preverify_ok, X509_STORE_CTX *ctx);
 
@@ -110,6 +114,33 @@ void ssl_on_info(const SSL* dtls, int where, int ret)
     }
 }
 
+bool srs_srtp_gcm_supported()
+{
+    // The GCM cipher is only available when libsrtp is built with openssl, so we probe it by creating
+    // a context, which fails with cipher type not found if not supported.
+    static int supported = -1;
+    if (supported >= 0) {
+        return supported == 1;
+    }
+
+    srtp_policy_t policy;
+    bzero(&policy, sizeof(policy));
+    srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtp);
+    srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtcp);
+    policy.ssrc.type = ssrc_any_outbound;
+
+    uint8_t key[SRTP_AEAD_SALT_LEN + SRTP_AES_128_KEY_LEN] = {0};
+    policy.key = key;
+
+    srtp_t ctx = NULL;
+    supported = (srtp_create(&ctx, &policy) == srtp_err_status_ok)? 1 : 0;
+    if (ctx) {
+        srtp_dealloc(ctx);
+    }
+
+    return supported == 1;
+}
+
 SSL_CTX* srs_build_dtls_ctx(SrsDtlsVersion version, std::string role)
 {
     SSL_CTX* dtls_ctx;
@@ -175,14 +206,54 @@ SSL_CTX* srs_build_dtls_ctx(SrsDtlsVersion version, std::string role)
         // @see https://www.openssl.org/docs/man1.0.2/man3/SSL_CTX_set_read_ahead.html
         SSL_CTX_set_read_ahead(dtls_ctx, 1);
 
-        // TODO: Maybe we can use SRTP-GCM in future.
+        // The SRTP profiles in order of preference, the server selects the first one supported by client.
+        // We prefer SRTP-GCM, which is AEAD and accelerated by AES-NI of openssl, much cheaper than the
+        // AES-CM with HMAC-SHA1, but it requires libsrtp built with openssl.
         // @see https://bugs.chromium.org/p/chromium/issues/detail?id=713701
         // @see https://groups.google.com/forum/#!topic/discuss-webrtc/PvCbWSetVAQ
-        // @remark Only support SRTP_AES128_CM_SHA1_80, please read ssl/d1_srtp.c
-        srs_assert(SSL_CTX_set_tlsext_use_srtp(dtls_ctx, "SRTP_AES128_CM_SHA1_80") == 0);
+        string profiles = "SRTP_AES128_CM_SHA1_80";
+#ifdef SRTP_AEAD_AES_128_GCM
+        if (_srs_config->get_rtc_server_srtp_gcm() && srs_srtp_gcm_supported()) {
+            profiles = "SRTP_AEAD_AES_128_GCM:" + profiles;
+        }
+#endif
+        srs_assert(SSL_CTX_set_tlsext_use_srtp(dtls_ctx, profiles.c_str()) == 0);
+
+        // Browsers never resume DTLS sessions, so disable the session cache and tickets, which only
+        // costs memory and bytes in a shared context.
+        SSL_CTX_set_session_cache_mode(dtls_ctx, SSL_SESS_CACHE_OFF);
+        SSL_CTX_set_options(dtls_ctx, SSL_OP_NO_TICKET);
+    }
+
+    return dtls_ctx;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L // v1.1.x
+// The DTLS contexts shared by sessions, by version and role. All sessions use the same certificate,
+// so we build the context only once, to avoid setting up the certificate and key for each session.
+static std::map<std::string, SSL_CTX*> _srs_dtls_ctxs;
+#endif
+
+SSL_CTX* srs_fetch_dtls_ctx(SrsDtlsVersion version, std::string role)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L // v1.1.x
+    // There is no SSL_CTX_up_ref for openssl <1.1, so we build the context for each session.
+    return srs_build_dtls_ctx(version, role);
+#else
+    string id = srs_int2str(version) + "/" + role;
+
+    SSL_CTX* dtls_ctx = NULL;
+    std::map<std::string, SSL_CTX*>::iterator it = _srs_dtls_ctxs.find(id);
+    if (it != _srs_dtls_ctxs.end()) {
+        dtls_ctx = it->second;
+    } else {
+        dtls_ctx = _srs_dtls_ctxs[id] = srs_build_dtls_ctx(version, role);
     }
 
+    // The session frees the context by SSL_CTX_free, so we always hold a reference.
+    SSL_CTX_up_ref(dtls_ctx);
     return dtls_ctx;
+#endif
 }
 
 SrsDtlsCertificate::SrsDtlsCertificate()
@@ -427,7 +498,7 @@ srs_error_t SrsDtlsImpl::initialize(std::string version, std::string role)
         version_ = SrsDtlsVersionAuto;
     }
 
-    dtls_ctx = srs_build_dtls_ctx(version_, role);
+    dtls_ctx = srs_fetch_dtls_ctx(version_, role);
 
     if ((dtls = SSL_new(dtls_ctx)) == NULL) {
         return srs_error_new(ERROR_OpenSslCreateSSL, "SSL_new dtls");
@@ -579,6 +650,9 @@ srs_error_t SrsDtlsImpl::do_handshake()
 
     // OK, Handshake is done, note that it maybe done many times.
     if (r1 == SSL_ERROR_NONE) {
+        if (!handshake_done_for_us) {
+            ++_srs_pps_dtls_handshakes->sugar;
+        }
         handshake_done_for_us = true;
     }
 
@@ -634,13 +708,22 @@ void SrsDtlsImpl::state_trace(uint8_t* data, int length, bool incoming, int r0,
 
 const int SRTP_MASTER_KEY_KEY_LEN = 16;
 const int SRTP_MASTER_KEY_SALT_LEN = 14;
+const int SRTP_AEAD_MASTER_KEY_SALT_LEN = 12;
 srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_key)
 {
     srs_error_t err = srs_success;
 
-    unsigned char material[SRTP_MASTER_KEY_LEN * 2] = {0};  // client(SRTP_MASTER_KEY_KEY_LEN + SRTP_MASTER_KEY_SALT_LEN) + server
+    // The salt of AEAD_AES_128_GCM is shorter, and the layout of material is the same.
+    // @see https://tools.ietf.org/html/rfc7714#section-12
+    int salt_len = SRTP_MASTER_KEY_SALT_LEN;
+    if (get_srtp_profile() == SrsSrtpProfileAeadAes128Gcm) {
+        salt_len = SRTP_AEAD_MASTER_KEY_SALT_LEN;
+    }
+
+    unsigned char material[SRTP_MASTER_KEY_LEN * 2] = {0};  // client(SRTP_MASTER_KEY_KEY_LEN + salt_len) + server
+    int nb_material = (SRTP_MASTER_KEY_KEY_LEN + salt_len) * 2;
     static const string dtls_srtp_lable = "EXTRACTOR-dtls_srtp";
-    if (!SSL_export_keying_material(dtls, material, sizeof(material), dtls_srtp_lable.c_str(), dtls_srtp_lable.size(), NULL, 0, 0)) {
+    if (!SSL_export_keying_material(dtls, material, nb_material, dtls_srtp_lable.c_str(), dtls_srtp_lable.size(), NULL, 0, 0)) {
         return srs_error_new(ERROR_RTC_SRTP_INIT, "SSL export key r0=%lu", ERR_get_error());
     }
 
@@ -650,9 +733,9 @@ srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_k
     offset += SRTP_MASTER_KEY_KEY_LEN;
     std::string server_master_key(reinterpret_cast<char*>(material + offset), SRTP_MASTER_KEY_KEY_LEN);
     offset += SRTP_MASTER_KEY_KEY_LEN;
-    std::string client_master_salt(reinterpret_cast<char*>(material + offset), SRTP_MASTER_KEY_SALT_LEN);
-    offset += SRTP_MASTER_KEY_SALT_LEN;
-    std::string server_master_salt(reinterpret_cast<char*>(material + offset), SRTP_MASTER_KEY_SALT_LEN);
+    std::string client_master_salt(reinterpret_cast<char*>(material + offset), salt_len);
+    offset += salt_len;
+    std::string server_master_salt(reinterpret_cast<char*>(material + offset), salt_len);
 
     if (is_dtls_client()) {
         recv_key = server_master_key + server_master_salt;
@@ -665,6 +748,17 @@ srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_k
     return err;
 }
 
+SrsSrtpProfile SrsDtlsImpl::get_srtp_profile()
+{
+#ifdef SRTP_AEAD_AES_128_GCM
+    SRTP_PROTECTION_PROFILE* profile = dtls? SSL_get_selected_srtp_profile(dtls) : NULL;
+    if (profile && profile->id == SRTP_AEAD_AES_128_GCM) {
+        return SrsSrtpProfileAeadAes128Gcm;
+    }
+#endif
+    return SrsSrtpProfileAes128CmSha1_80;
+}
+
 void SrsDtlsImpl::callback_by_ssl(std::string type, std::string desc)
 {
     srs_error_t err = srs_success;
@@ -1036,6 +1130,11 @@ srs_error_t SrsDtls::get_srtp_key(std::string& recv_key, std::string& send_key)
     return impl->get_srtp_key(recv_key, send_key);
 }
 
+SrsSrtpProfile SrsDtls::get_srtp_profile()
+{
+    return impl->get_srtp_profile();
+}
+
 SrsSRTP::SrsSRTP()
 {
     recv_ctx_ = NULL;
@@ -1053,18 +1152,22 @@ SrsSRTP::~SrsSRTP()
     }
 }
 
-srs_error_t SrsSRTP::initialize(string recv_key, std::string send_key)
+srs_error_t SrsSRTP::initialize(string recv_key, std::string send_key, SrsSrtpProfile profile)
 {
     srs_error_t err = srs_success;
 
     srtp_policy_t policy;
     bzero(&policy, sizeof(policy));
 
-    // TODO: Maybe we can use SRTP-GCM in future.
     // @see https://bugs.chromium.org/p/chromium/issues/detail?id=713701
     // @see https://groups.google.com/forum/#!topic/discuss-webrtc/PvCbWSetVAQ
-    srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
-    srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);
+    if (profile == SrsSrtpProfileAeadAes128Gcm) {
+        srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtp);
+        srtp_crypto_policy_set_aes_gcm_128_16_auth(&policy.rtcp);
+    } else {
+        srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
+        srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);
+    }
 
     policy.ssrc.value = 0;
     // TODO: adjust window_size
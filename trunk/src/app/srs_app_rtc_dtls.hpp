@@ -64,6 +64,17 @@ enum SrsDtlsVersion {
     SrsDtlsVersion1_2
 };
 
+// The SRTP protection profile negotiated by DTLS.
+// @see https://tools.ietf.org/html/rfc5764#section-4.1.2
+// @see https://tools.ietf.org/html/rfc7714#section-14.2
+enum SrsSrtpProfile {
+    SrsSrtpProfileAes128CmSha1_80 = 0,
+    SrsSrtpProfileAeadAes128Gcm,
+};
+
+// Whether libsrtp supports the AEAD_AES_128_GCM profile, which requires libsrtp built with openssl.
+extern bool srs_srtp_gcm_supported();
+
 class ISrsDtlsCallback
 {
 public:
@@ -120,6 +131,7 @@ protected:
     void state_trace(uint8_t* data, int length, bool incoming, int r0, int r1, bool arq);
 public:
     srs_error_t get_srtp_key(std::string& recv_key, std::string& send_key);
+    SrsSrtpProfile get_srtp_profile();
     void callback_by_ssl(std::string type, std::string desc);
 protected:
     virtual srs_error_t on_final_out_data(uint8_t* data, int size) = 0;
@@ -210,6 +222,7 @@ public:
     srs_error_t on_dtls(char* data, int nb_data);
 public:
     srs_error_t get_srtp_key(std::string& recv_key, std::string& send_key);
+    SrsSrtpProfile get_srtp_profile();
 };
 
 class SrsSRTP
@@ -221,8 +234,8 @@ public:
     SrsSRTP();
     virtual ~SrsSRTP();
 public:
-    // Intialize srtp context with recv_key and send_key.
-    srs_error_t initialize(std::string recv_key, std::string send_key);
+    // Intialize srtp context with recv_key and send_key, for the profile negotiated by DTLS.
+    srs_error_t initialize(std::string recv_key, std::string send_key, SrsSrtpProfile profile);
 public:
     srs_error_t protect_rtp(void* packet, int* nb_cipher);
     srs_error_t protect_rtcp(void* packet, int* nb_cipher);
@@ -0,0 +1,543 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_rtc_fec.hpp>
+
+#include <math.h>
+#include <string.h>
+using namespace std;
+
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_rtc_rtp.hpp>
+
+// The max number of boundaries of shifter, each for a group of FEC packets.
+const int kFecMaxShifts = 64;
+// The protection ratio is 3x of the loss rate, no FEC if loss is less than 1%.
+const float kFecMinLoss = 0.01;
+const float kFecLossFactor = 3.0;
+const float kFecMaxRatio = 0.5;
+// The max number of FEC packets waiting for media packets to recover.
+const int kFecMaxPending = 32;
+
+// The size of FEC header and level 0 header without mask, see RFC5109.
+const int kFecHeaderSize = 12;
+
+static inline uint16_t srs_fec_read_2bytes(const char* p)
+{
+    return ((uint8_t)p[0] << 8) | (uint8_t)p[1];
+}
+
+static inline uint32_t srs_fec_read_4bytes(const char* p)
+{
+    return ((uint32_t)(uint8_t)p[0] << 24) | ((uint8_t)p[1] << 16) | ((uint8_t)p[2] << 8) | (uint8_t)p[3];
+}
+
+static inline void srs_fec_write_2bytes(char* p, uint16_t v)
+{
+    p[0] = (char)(v >> 8);
+    p[1] = (char)v;
+}
+
+static inline void srs_fec_write_4bytes(char* p, uint32_t v)
+{
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+// Get the size of RTP header, with CSRC and extensions. Return -1 if invalid.
+static int srs_fec_rtp_header_size(const char* data, int size)
+{
+    if (size < 12) {
+        return -1;
+    }
+
+    int nb_header = 12 + 4 * (data[0] & 0x0f);
+    if ((data[0] & 0x10) != 0) {
+        if (size < nb_header + 4) {
+            return -1;
+        }
+        nb_header += 4 + 4 * srs_fec_read_2bytes(data + nb_header + 2);
+    }
+
+    return size < nb_header ? -1 : nb_header;
+}
+
+SrsRtcFecPacket::SrsRtcFecPacket(char* data, int size)
+{
+    data_ = new char[size];
+    memcpy(data_, data, size);
+    size_ = size;
+    seq_ = srs_fec_read_2bytes(data + 2);
+}
+
+SrsRtcFecPacket::~SrsRtcFecPacket()
+{
+    srs_freepa(data_);
+}
+
+SrsRtcSeqShifter::SrsRtcSeqShifter()
+{
+    base_ = 0;
+}
+
+SrsRtcSeqShifter::~SrsRtcSeqShifter()
+{
+}
+
+void SrsRtcSeqShifter::shift(uint16_t seq, int delta)
+{
+    uint16_t offset = shifts_.empty() ? base_ : shifts_.back().second;
+    shifts_.push_back(make_pair(seq, (uint16_t)(offset + delta)));
+
+    // For the very old packets, use the offset of the oldest boundary.
+    if ((int)shifts_.size() > kFecMaxShifts) {
+        base_ = shifts_.front().second;
+        shifts_.pop_front();
+    }
+}
+
+uint16_t SrsRtcSeqShifter::get(uint16_t seq)
+{
+    // Generally, the packet is after the last boundary, so it's fast.
+    for (deque< pair<uint16_t, uint16_t> >::reverse_iterator it = shifts_.rbegin(); it != shifts_.rend(); ++it) {
+        if (srs_rtp_seq_distance(it->first, seq) > 0) {
+            return seq + it->second;
+        }
+    }
+
+    return seq + base_;
+}
+
+SrsRtcFecEncoder::SrsRtcFecEncoder(uint8_t red_pt, uint8_t fec_pt)
+{
+    red_pt_ = red_pt;
+    fec_pt_ = fec_pt;
+    loss_ = 0;
+    ratio_ = 0;
+    ready_ = false;
+    has_highest_ = false;
+    highest_ = 0;
+    highest_shifted_ = 0;
+    nn_fecs_ = 0;
+}
+
+SrsRtcFecEncoder::~SrsRtcFecEncoder()
+{
+    clear();
+}
+
+void SrsRtcFecEncoder::on_loss(float loss)
+{
+    loss_ = 0.5 * loss_ + 0.5 * loss;
+    ratio_ = (loss_ < kFecMinLoss) ? 0 : srs_min(kFecMaxRatio, loss_ * kFecLossFactor);
+
+    if (ratio_ == 0) {
+        clear();
+    }
+}
+
+float SrsRtcFecEncoder::ratio()
+{
+    return ratio_;
+}
+
+uint16_t SrsRtcFecEncoder::shift(uint16_t seq)
+{
+    uint16_t shifted = shifter_.get(seq);
+
+    if (!has_highest_ || srs_rtp_seq_distance(highest_, seq) > 0) {
+        has_highest_ = true;
+        highest_ = seq;
+        highest_shifted_ = shifted;
+    }
+
+    return shifted;
+}
+
+srs_error_t SrsRtcFecEncoder::protect(char* data, int* psize, int capacity)
+{
+    srs_error_t err = srs_success;
+
+    int size = *psize;
+    int nb_header = srs_fec_rtp_header_size(data, size);
+    if (nb_header < 0) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "invalid rtp %d bytes", size);
+    }
+
+    // Ignore the packet with padding, or no space for RED header.
+    if ((data[0] & 0x20) != 0 || size + 1 > capacity) {
+        return err;
+    }
+
+    // Only protect the packets in sequence order, the late packet is not protected.
+    if (ratio_ > 0) {
+        uint16_t seq = srs_fec_read_2bytes(data + 2);
+        int16_t distance = packets_.empty() ? 0 : srs_rtp_seq_distance(packets_.front()->seq_, seq);
+
+        if (distance >= SRS_RTC_FEC_MAX_PACKETS) {
+            ready_ = true;
+        } else if (packets_.empty() || srs_rtp_seq_distance(packets_.back()->seq_, seq) > 0) {
+            packets_.push_back(new SrsRtcFecPacket(data, size));
+
+            // Generate FEC packets at the end of frame, or the group is full.
+            bool marker = (data[1] & 0x80) != 0;
+            if (marker || distance == SRS_RTC_FEC_MAX_PACKETS - 1) {
+                ready_ = true;
+            }
+        }
+    }
+
+    // Wrap in RED, with the PT of media in the header of block.
+    memmove(data + nb_header + 1, data + nb_header, size - nb_header);
+    data[nb_header] = data[1] & 0x7f;
+    data[1] = (data[1] & 0x80) | red_pt_;
+    *psize = size + 1;
+
+    return err;
+}
+
+srs_error_t SrsRtcFecEncoder::encode(vector<SrsRtpPacket*>& pkts)
+{
+    srs_error_t err = srs_success;
+
+    if (!ready_ || packets_.empty()) {
+        return err;
+    }
+
+    // The media packets are interleaved to FEC packets, which covers the burst loss.
+    int nn_media = (int)packets_.size();
+    int nn_fec = srs_max(1, srs_min(nn_media, (int)ceil(nn_media * ratio_)));
+
+    uint16_t base = packets_.front()->seq_;
+    bool long_mask = srs_rtp_seq_distance(base, packets_.back()->seq_) >= 16;
+    int nb_mask = long_mask ? 6 : 2;
+
+    SrsRtcFecPacket* last = packets_.back();
+    uint32_t ts = srs_fec_read_4bytes(last->data_ + 4);
+    uint32_t ssrc = srs_fec_read_4bytes(last->data_ + 8);
+
+    for (int i = 0; i < nn_fec; i++) {
+        int protection = 0;
+        for (int j = i; j < nn_media; j += nn_fec) {
+            protection = srs_max(protection, packets_.at(j)->size_ - 12);
+        }
+
+        // The RED header, the FEC header, the level 0 header and payload.
+        int nb_fec = 1 + kFecHeaderSize + nb_mask + protection;
+
+        SrsRtpPacket* pkt = new SrsRtpPacket();
+        char* p = pkt->wrap(nb_fec);
+        memset(p, 0, nb_fec);
+
+        p[0] = fec_pt_;
+        char* header = p + 1;
+        char* payload = header + kFecHeaderSize + nb_mask;
+
+        uint16_t length = 0;
+        for (int j = i; j < nn_media; j += nn_fec) {
+            SrsRtcFecPacket* media = packets_.at(j);
+
+            header[0] ^= media->data_[0];
+            header[1] ^= media->data_[1];
+            for (int k = 4; k < 8; k++) {
+                header[k] ^= media->data_[k];
+            }
+            length ^= (uint16_t)(media->size_ - 12);
+
+            for (int k = 0; k < media->size_ - 12; k++) {
+                payload[k] ^= media->data_[12 + k];
+            }
+
+            int offset = srs_rtp_seq_distance(base, media->seq_);
+            header[kFecHeaderSize + offset / 8] |= (char)(0x80 >> (offset % 8));
+        }
+
+        // The E bit is 0, and the L bit for long mask.
+        header[0] = (header[0] & 0x3f) | (long_mask ? 0x40 : 0);
+        srs_fec_write_2bytes(header + 2, base);
+        srs_fec_write_2bytes(header + 8, length);
+        srs_fec_write_2bytes(header + 10, (uint16_t)protection);
+
+        pkt->header.set_payload_type(red_pt_);
+        pkt->header.set_ssrc(ssrc);
+        pkt->header.set_sequence(highest_shifted_ + 1 + i);
+        pkt->header.set_timestamp(ts);
+
+        SrsRtpRawPayload* raw = new SrsRtpRawPayload();
+        raw->payload = p;
+        raw->nn_payload = nb_fec;
+        pkt->set_payload(raw, SrsRtspPacketPayloadTypeRaw);
+
+        pkts.push_back(pkt);
+    }
+
+    // The FEC packets are after the highest media packet, so shift the next media packets.
+    shifter_.shift(highest_, nn_fec);
+    highest_shifted_ += nn_fec;
+    nn_fecs_ += nn_fec;
+
+    clear();
+
+    return err;
+}
+
+void SrsRtcFecEncoder::clear()
+{
+    for (int i = 0; i < (int)packets_.size(); i++) {
+        SrsRtcFecPacket* pkt = packets_.at(i);
+        srs_freep(pkt);
+    }
+    packets_.clear();
+    ready_ = false;
+}
+
+SrsRtcFecDecoder::SrsRtcFecDecoder(uint8_t fec_pt)
+{
+    fec_pt_ = fec_pt;
+    history_ = new SrsRtcFecPacket*[SRS_RTC_FEC_HISTORY_SIZE];
+    memset(history_, 0, sizeof(SrsRtcFecPacket*) * SRS_RTC_FEC_HISTORY_SIZE);
+    has_highest_ = false;
+    highest_ = 0;
+    nn_recovered_ = 0;
+}
+
+SrsRtcFecDecoder::~SrsRtcFecDecoder()
+{
+    for (int i = 0; i < SRS_RTC_FEC_HISTORY_SIZE; i++) {
+        SrsRtcFecPacket* pkt = history_[i];
+        srs_freep(pkt);
+    }
+    srs_freepa(history_);
+
+    for (int i = 0; i < (int)fecs_.size(); i++) {
+        SrsRtcFecPacket* pkt = fecs_.at(i);
+        srs_freep(pkt);
+    }
+}
+
+srs_error_t SrsRtcFecDecoder::decode(char* data, int* psize, vector<SrsRtcFecPacket*>& recovered)
+{
+    srs_error_t err = srs_success;
+
+    int size = *psize;
+    int nb_header = srs_fec_rtp_header_size(data, size);
+    if (nb_header < 0) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "invalid rtp %d bytes", size);
+    }
+
+    // Strip the padding of RED packet.
+    if ((data[0] & 0x20) != 0) {
+        uint8_t padding = (uint8_t)data[size - 1];
+        if (padding > size - nb_header) {
+            return srs_error_new(ERROR_RTC_RTP_MUXER, "invalid padding %d of %d bytes", padding, size);
+        }
+        size -= padding;
+        data[0] &= ~0x20;
+    }
+
+    // Skip the redundant blocks, the last block is the primary block.
+    // @see https://tools.ietf.org/html/rfc2198#section-3
+    int offset = nb_header;
+    int nb_redundant = 0;
+    while (true) {
+        if (offset >= size) {
+            return srs_error_new(ERROR_RTC_RTP_MUXER, "no primary block, %d bytes", size);
+        }
+        if (((uint8_t)data[offset] & 0x80) == 0) {
+            break;
+        }
+        if (offset + 4 > size) {
+            return srs_error_new(ERROR_RTC_RTP_MUXER, "invalid red header, %d bytes", size);
+        }
+        nb_redundant += (((uint8_t)data[offset + 2] & 0x03) << 8) | (uint8_t)data[offset + 3];
+        offset += 4;
+    }
+
+    uint8_t block_pt = data[offset] & 0x7f;
+    int primary = offset + 1 + nb_redundant;
+    if (primary > size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "invalid red blocks %d, %d bytes", primary, size);
+    }
+
+    // Unwrap the primary block as the RTP packet.
+    memmove(data + nb_header, data + primary, size - primary);
+    size = nb_header + size - primary;
+    data[1] = (data[1] & 0x80) | block_pt;
+
+    SrsRtcFecPacket* pkt = new SrsRtcFecPacket(data, size);
+    if (block_pt == fec_pt_) {
+        *psize = 0;
+        on_fec(pkt);
+    } else {
+        *psize = size;
+        on_media(pkt);
+    }
+
+    // Recover the lost packets, which may help to recover others.
+    for (bool changed = true; changed;) {
+        changed = false;
+
+        for (int i = 0; i < (int)fecs_.size(); i++) {
+            SrsRtcFecPacket* fec = fecs_.at(i);
+
+            bool done = false;
+            SrsRtcFecPacket* r = recover(fec, &done);
+            if (done) {
+                fecs_.erase(fecs_.begin() + i);
+                srs_freep(fec);
+            }
+
+            if (r) {
+                recovered.push_back(r);
+                on_media(new SrsRtcFecPacket(r->data_, r->size_));
+                nn_recovered_++;
+
+                changed = true;
+                break;
+            }
+
+            if (done) {
+                i--;
+            }
+        }
+    }
+
+    return err;
+}
+
+uint16_t SrsRtcFecDecoder::shift(uint16_t seq)
+{
+    return shifter_.get(seq);
+}
+
+uint64_t SrsRtcFecDecoder::nn_recovered()
+{
+    return nn_recovered_;
+}
+
+void SrsRtcFecDecoder::on_media(SrsRtcFecPacket* pkt)
+{
+    int index = pkt->seq_ % SRS_RTC_FEC_HISTORY_SIZE;
+    srs_freep(history_[index]);
+    history_[index] = pkt;
+
+    if (!has_highest_ || srs_rtp_seq_distance(highest_, pkt->seq_) > 0) {
+        has_highest_ = true;
+        highest_ = pkt->seq_;
+    }
+}
+
+void SrsRtcFecDecoder::on_fec(SrsRtcFecPacket* pkt)
+{
+    // Remove the FEC packet from sequence space, except the late one, because the packets after it
+    // have been sent.
+    if (!has_highest_ || srs_rtp_seq_distance(highest_, pkt->seq_) > 0) {
+        shifter_.shift(pkt->seq_, -1);
+        has_highest_ = true;
+        highest_ = pkt->seq_;
+    }
+
+    fecs_.push_back(pkt);
+
+    if ((int)fecs_.size() > kFecMaxPending) {
+        SrsRtcFecPacket* fec = fecs_.front();
+        fecs_.erase(fecs_.begin());
+        srs_freep(fec);
+    }
+}
+
+SrsRtcFecPacket* SrsRtcFecDecoder::recover(SrsRtcFecPacket* fec, bool* pdone)
+{
+    int nb_header = srs_fec_rtp_header_size(fec->data_, fec->size_);
+    if (nb_header < 0 || fec->size_ < nb_header + kFecHeaderSize + 2) {
+        *pdone = true;
+        return NULL;
+    }
+
+    char* header = fec->data_ + nb_header;
+    int nb_mask = ((uint8_t)header[0] & 0x40) ? 6 : 2;
+    uint16_t base = srs_fec_read_2bytes(header + 2);
+    uint16_t protection = srs_fec_read_2bytes(header + 10);
+    char* payload = header + kFecHeaderSize + nb_mask;
+    if (fec->size_ < nb_header + kFecHeaderSize + nb_mask + protection) {
+        *pdone = true;
+        return NULL;
+    }
+
+    // Find the lost packets protected by FEC.
+    int nn_lost = 0;
+    uint16_t lost = 0;
+    vector<SrsRtcFecPacket*> medias;
+    for (int i = 0; i < nb_mask * 8; i++) {
+        if ((header[kFecHeaderSize + i / 8] & (0x80 >> (i % 8))) == 0) {
+            continue;
+        }
+
+        uint16_t seq = base + i;
+        SrsRtcFecPacket* media = history_[seq % SRS_RTC_FEC_HISTORY_SIZE];
+        if (media && media->seq_ == seq) {
+            medias.push_back(media);
+        } else {
+            nn_lost++;
+            lost = seq;
+        }
+    }
+
+    // No packet lost, or too many packets lost to recover.
+    if (nn_lost == 0) {
+        *pdone = true;
+        return NULL;
+    }
+    if (nn_lost > 1) {
+        *pdone = has_highest_ && srs_rtp_seq_distance(base, highest_) >= SRS_RTC_FEC_HISTORY_SIZE / 2;
+        return NULL;
+    }
+
+    // The FEC is used, whether recovered or not.
+    *pdone = true;
+
+    uint8_t b0 = header[0];
+    uint8_t b1 = header[1];
+    uint32_t ts = srs_fec_read_4bytes(header + 4);
+    uint16_t length = srs_fec_read_2bytes(header + 8);
+
+    char* buf = new char[12 + protection];
+    SrsAutoFreeA(char, buf);
+    memcpy(buf + 12, payload, protection);
+
+    for (int i = 0; i < (int)medias.size(); i++) {
+        SrsRtcFecPacket* media = medias.at(i);
+        if (media->size_ - 12 > protection) {
+            return NULL;
+        }
+
+        b0 ^= (uint8_t)media->data_[0];
+        b1 ^= (uint8_t)media->data_[1];
+        ts ^= srs_fec_read_4bytes(media->data_ + 4);
+        length ^= (uint16_t)(media->size_ - 12);
+
+        for (int k = 0; k < media->size_ - 12; k++) {
+            buf[12 + k] ^= media->data_[12 + k];
+        }
+    }
+
+    if (length > protection) {
+        return NULL;
+    }
+
+    buf[0] = (char)(0x80 | (b0 & 0x3f));
+    buf[1] = (char)b1;
+    srs_fec_write_2bytes(buf + 2, lost);
+    srs_fec_write_4bytes(buf + 4, ts);
+    memcpy(buf + 8, fec->data_ + 8, 4);
+
+    return new SrsRtcFecPacket(buf, 12 + length);
+}
+
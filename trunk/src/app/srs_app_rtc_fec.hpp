@@ -0,0 +1,138 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_RTC_FEC_HPP
+#define SRS_APP_RTC_FEC_HPP
+
+#include <srs_core.hpp>
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+class SrsRtpPacket;
+
+// The max number of media packets protected by a FEC packet, by the 48 bits mask of ULPFEC.
+#define SRS_RTC_FEC_MAX_PACKETS 48
+// The number of media packets to keep for FEC recovery, should be larger than the max protected.
+#define SRS_RTC_FEC_HISTORY_SIZE 256
+
+// A copy of RTP packet for FEC, which is the media packet to protect or recovered, or the FEC packet.
+class SrsRtcFecPacket
+{
+public:
+    uint16_t seq_;
+    char* data_;
+    int size_;
+public:
+    SrsRtcFecPacket(char* data, int size);
+    virtual ~SrsRtcFecPacket();
+};
+
+// Shift the sequence number of media, when inserting or removing the FEC packets in the sequence space
+// of a SSRC. The late packet uses the offset when it should arrive, so it never conflicts with others.
+class SrsRtcSeqShifter
+{
+private:
+    // The offset for packets before all boundaries.
+    uint16_t base_;
+    // The boundary of sequence, and the offset for packets after it.
+    std::deque< std::pair<uint16_t, uint16_t> > shifts_;
+public:
+    SrsRtcSeqShifter();
+    virtual ~SrsRtcSeqShifter();
+public:
+    // Shift the packets after seq by delta.
+    void shift(uint16_t seq, int delta);
+    // Get the shifted sequence of packet.
+    uint16_t get(uint16_t seq);
+};
+
+// The ULPFEC encoder for a player, which protects the media packets of a frame by XOR, and sends both
+// media and FEC packets in RED. The protection ratio adapts to the loss reported by RTCP RR of player,
+// and no FEC packets are sent if no loss.
+// @see https://tools.ietf.org/html/rfc5109
+class SrsRtcFecEncoder
+{
+private:
+    uint8_t red_pt_;
+    uint8_t fec_pt_;
+    // The smoothed loss rate and the protection ratio, in [0, 1].
+    float loss_;
+    float ratio_;
+private:
+    // The media packets of group to protect, in sequence order.
+    std::vector<SrsRtcFecPacket*> packets_;
+    // Whether got the last packet of frame, or the group is full.
+    bool ready_;
+private:
+    // Insert FEC packets after the highest sequence of media we sent.
+    SrsRtcSeqShifter shifter_;
+    bool has_highest_;
+    uint16_t highest_;
+    uint16_t highest_shifted_;
+    uint64_t nn_fecs_;
+public:
+    SrsRtcFecEncoder(uint8_t red_pt, uint8_t fec_pt);
+    virtual ~SrsRtcFecEncoder();
+public:
+    // When got the fraction lost from RTCP RR of player, in [0, 1].
+    void on_loss(float loss);
+    float ratio();
+    // Shift the sequence of media packet, for the FEC packets we inserted.
+    uint16_t shift(uint16_t seq);
+    // Protect the media packet, and wrap it in RED, in place. The packet with padding is not
+    // protected, and sent as is.
+    // @param psize Input the size of media packet, output the size of RED packet.
+    // @param capacity The size of buffer, which should be larger than the RED packet.
+    srs_error_t protect(char* data, int* psize, int capacity);
+    // Generate the FEC packets in RED, when got a group of media packets. Note that the header
+    // extensions of FEC packets are empty, user should set them before sending.
+    // @remark User must free the packets.
+    srs_error_t encode(std::vector<SrsRtpPacket*>& pkts);
+private:
+    void clear();
+};
+
+// The ULPFEC decoder for a publisher, which unwraps the media packets in RED, and recovers the lost
+// media packets by the FEC packets. The FEC packets are removed from the sequence space, so that the
+// players never see a gap of sequence.
+// @see https://tools.ietf.org/html/rfc5109
+class SrsRtcFecDecoder
+{
+private:
+    uint8_t fec_pt_;
+    // The media packets we got, and the FEC packets which are not used.
+    SrsRtcFecPacket** history_;
+    std::vector<SrsRtcFecPacket*> fecs_;
+private:
+    // Remove FEC packets after the highest sequence we got.
+    SrsRtcSeqShifter shifter_;
+    bool has_highest_;
+    uint16_t highest_;
+    uint64_t nn_recovered_;
+public:
+    SrsRtcFecDecoder(uint8_t fec_pt);
+    virtual ~SrsRtcFecDecoder();
+public:
+    // Unwrap the RED packet in place, and recover the lost media packets if it's FEC.
+    // @param psize Input the size of RED packet, output the size of media packet, 0 for FEC packet.
+    // @param recovered Output the media packets recovered by FEC.
+    // @remark User must free the recovered packets.
+    srs_error_t decode(char* data, int* psize, std::vector<SrsRtcFecPacket*>& recovered);
+    // Shift the sequence of media packet, for the FEC packets we removed.
+    uint16_t shift(uint16_t seq);
+    uint64_t nn_recovered();
+private:
+    void on_media(SrsRtcFecPacket* pkt);
+    void on_fec(SrsRtcFecPacket* pkt);
+    // Recover the lost packet by FEC, return NULL if not possible.
+    // @param pdone Whether the FEC packet is done, which should be removed.
+    SrsRtcFecPacket* recover(SrsRtcFecPacket* fec, bool* pdone);
+};
+
+#endif
+
@@ -29,6 +29,7 @@ SrsRtpRingBuffer::SrsRtpRingBuffer(int capacity)
     begin = end = 0;
     capacity_ = (uint16_t)capacity;
     initialized_ = false;
+    pool_ = NULL;
 
     queue_ = new SrsRtpPacket*[capacity_];
     memset(queue_, 0, sizeof(SrsRtpPacket*) * capacity);
@@ -60,10 +61,19 @@ void SrsRtpRingBuffer::advance_to(uint16_t seq)
     begin = seq;
 }
 
+void SrsRtpRingBuffer::set_pool(SrsRtpPacketPool* v)
+{
+    pool_ = v;
+}
+
 void SrsRtpRingBuffer::set(uint16_t at, SrsRtpPacket* pkt)
 {
     SrsRtpPacket* p = queue_[at % capacity_];
-    srs_freep(p);
+    if (pool_) {
+        pool_->recycle(p);
+    } else {
+        srs_freep(p);
+    }
 
     queue_[at % capacity_] = pkt;
 }
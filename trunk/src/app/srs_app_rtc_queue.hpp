@@ -17,6 +17,7 @@
 #include <srs_kernel_rtc_rtcp.hpp>
 
 class SrsRtpPacket;
+class SrsRtpPacketPool;
 class SrsRtpQueue;
 class SrsRtpRingBuffer;
 
@@ -39,6 +40,8 @@ private:
     uint64_t nn_seq_flip_backs;
     // Whether initialized, because we use uint16 so we can't use -1.
     bool initialized_;
+    // The pool to recycle the packets, free them if NULL.
+    SrsRtpPacketPool* pool_;
 public:
     // The begin iterator for ring buffer.
     // For example, when got 1 elems, the begin is 0.
@@ -56,6 +59,8 @@ public:
     int size();
     // Move the low position of buffer to seq.
     void advance_to(uint16_t seq);
+    // Set the pool to recycle the packets we replaced.
+    void set_pool(SrsRtpPacketPool* v);
     // Free the packet at position.
     void set(uint16_t at, SrsRtpPacket* pkt);
     void remove(uint16_t at);
@@ -16,6 +16,7 @@ using namespace std;
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_protocol_utility.hpp>
 
 // TODO: FIXME: Maybe we should use json.encode to escape it?
 const std::string kCRLF = "\r\n";
@@ -410,6 +411,13 @@ srs_error_t SrsMediaDesc::encode(std::ostringstream& os)
         }
     }
 
+    if (!rids_.empty()) {
+        for (int i = 0; i < (int)rids_.size(); ++i) {
+            os << "a=rid:" << rids_.at(i) << " " << simulcast_ << kCRLF;
+        }
+        os << "a=simulcast:" << simulcast_ << " " << srs_join_vector_string(rids_, ";") << kCRLF;
+    }
+
     for (std::vector<SrsSSRCInfo>::iterator iter = ssrc_infos_.begin(); iter != ssrc_infos_.end(); ++iter) {
         SrsSSRCInfo& ssrc_info = *iter;
 
@@ -469,6 +477,10 @@ srs_error_t SrsMediaDesc::parse_attribute(const std::string& content)
         return parse_attr_ssrc(value);
     } else if (attribute == "ssrc-group") {
         return parse_attr_ssrc_group(value);
+    } else if (attribute == "rid") {
+        return parse_attr_rid(value);
+    } else if (attribute == "simulcast") {
+        return parse_attr_simulcast(value);
     } else if (attribute == "rtcp-mux") {
         rtcp_mux_ = true;
     } else if (attribute == "rtcp-rsize") {
@@ -689,6 +701,75 @@ srs_error_t SrsMediaDesc::parse_attr_ssrc_group(const std::string& value)
     return err;
 }
 
+srs_error_t SrsMediaDesc::parse_attr_rid(const std::string& value)
+{
+    srs_error_t err = srs_success;
+    // @see: https://tools.ietf.org/html/rfc8851#section-10
+    // a=rid:<rid-id> <direction> [pt=<fmt-list>;<restriction>=<value>...]
+
+    std::istringstream is(value);
+
+    std::string rid, direction;
+    FETCH(is, rid);
+    FETCH(is, direction);
+
+    if (direction != "send" && direction != "recv") {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid rid line=%s", value.c_str());
+    }
+
+    if (std::find(rids_.begin(), rids_.end(), rid) == rids_.end()) {
+        rids_.push_back(rid);
+    }
+    if (simulcast_.empty()) {
+        simulcast_ = direction;
+    }
+
+    return err;
+}
+
+srs_error_t SrsMediaDesc::parse_attr_simulcast(const std::string& value)
+{
+    srs_error_t err = srs_success;
+    // @see: https://tools.ietf.org/html/rfc8853#section-5.1
+    // a=simulcast:<direction> <alt-list>;<alt-list> [<direction> <alt-list>;<alt-list>]
+    // in which the alternatives of a layer are separated by comma, and the paused one starts with "~".
+
+    std::istringstream is(value);
+
+    std::string direction, layers;
+    FETCH(is, direction);
+    FETCH(is, layers);
+
+    if (direction != "send" && direction != "recv") {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid simulcast line=%s", value.c_str());
+    }
+
+    // We only use the first alternative of each layer, and follow the order of layers.
+    std::vector<std::string> rids;
+    std::vector<std::string> vec = split_str(layers, ";");
+    for (int i = 0; i < (int)vec.size(); ++i) {
+        std::string rid = split_str(vec.at(i), ",").at(0);
+        if (!rid.empty() && rid.at(0) == '~') {
+            rid = rid.substr(1);
+        }
+        if (!rid.empty()) {
+            rids.push_back(rid);
+        }
+    }
+
+    // The RIDs which are not in simulcast, are appended.
+    for (int i = 0; i < (int)rids_.size(); ++i) {
+        if (std::find(rids.begin(), rids.end(), rids_.at(i)) == rids.end()) {
+            rids.push_back(rids_.at(i));
+        }
+    }
+
+    rids_ = rids;
+    simulcast_ = direction;
+
+    return err;
+}
+
 SrsSSRCInfo& SrsMediaDesc::fetch_or_create_ssrc_info(uint32_t ssrc)
 {
     for (size_t i = 0; i < ssrc_infos_.size(); ++i) {
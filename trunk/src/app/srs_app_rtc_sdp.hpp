@@ -16,6 +16,9 @@
 #include <vector>
 #include <map>
 const std::string kTWCCExt = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+// The RID of simulcast layer, and the RID of RTX for the layer.
+const std::string kRidExt = "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id";
+const std::string kRepairedRidExt = "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id";
 
 // TDOO: FIXME: Rename it, and add utest.
 extern std::vector<std::string> split_str(const std::string& str, const std::string& delim);
@@ -141,6 +144,8 @@ private:
     srs_error_t parse_attr_ssrc(const std::string& value);
     srs_error_t parse_attr_ssrc_group(const std::string& value);
     srs_error_t parse_attr_extmap(const std::string& value);
+    srs_error_t parse_attr_rid(const std::string& value);
+    srs_error_t parse_attr_simulcast(const std::string& value);
 private:
     SrsSSRCInfo& fetch_or_create_ssrc_info(uint32_t ssrc);
 
@@ -167,6 +172,14 @@ public:
     std::vector<SrsSSRCGroup> ssrc_groups_;
     std::vector<SrsSSRCInfo>  ssrc_infos_;
     std::map<int, std::string> extmaps_;
+
+    // The RIDs of simulcast layers, in the order of a=simulcast if present, for example:
+    //      a=rid:h send
+    //      a=simulcast:send h;m;l
+    // @see https://tools.ietf.org/html/rfc8853
+    std::vector<std::string> rids_;
+    // The direction of simulcast, send or recv.
+    std::string simulcast_;
 };
 
 class SrsSdp
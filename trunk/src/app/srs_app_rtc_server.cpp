@@ -365,8 +365,21 @@ srs_error_t SrsRtcServer::on_udp_packet(SrsUdpMuxSocket* skt)
     // For STUN, the peer address may change.
     if (!is_rtp_or_rtcp && srs_is_stun((uint8_t*)data, size)) {
         ++_srs_pps_rstuns->sugar;
-        string peer_id = skt->peer_id();
 
+        // Fast path for the binding requests of established session, such as ICE consent freshness,
+        // which is responded without decoding the packet. Like RTP, we don't switch to the context.
+        if (session) {
+            bool consumed = false;
+            if ((err = session->on_stun_fast(skt, &consumed)) != srs_success) {
+                session->switch_to_context();
+                return srs_error_wrap(err, "stun fast");
+            }
+            if (consumed) {
+                return err;
+            }
+        }
+
+        string peer_id = skt->peer_id();
         SrsStunPacket ping;
         if ((err = ping.decode(data, size)) != srs_success) {
             return srs_error_wrap(err, "decode stun packet failed");
@@ -436,6 +449,10 @@ srs_error_t SrsRtcServer::listen_api()
         return srs_error_wrap(err, "handle publish");
     }
 
+    if ((err = http_api_mux->handle("/rtc/v1/bwe/", new SrsGoApiRtcBWE(this))) != srs_success) {
+        return srs_error_wrap(err, "handle bwe");
+    }
+
 #ifdef SRS_SIMULATOR
     if ((err = http_api_mux->handle("/rtc/v1/nack/", new SrsGoApiRtcNACK(this))) != srs_success) {
         return srs_error_wrap(err, "handle nack");
@@ -27,6 +27,8 @@
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_log.hpp>
 #include <srs_app_threads.hpp>
+#include <srs_app_rtc_bwe.hpp>
+#include <srs_app_rtc_fec.hpp>
 
 #ifdef SRS_FFMPEG_FIT
 #include <srs_app_rtc_codec.hpp>
@@ -230,6 +232,217 @@ void SrsRtcConsumer::on_stream_change(SrsRtcSourceDescription* desc)
     }
 }
 
+// The max packets in GOP cache, clear it when overflow, for example, 8192 packets is about
+// 10MB, and 8s for a stream of 8Mbps.
+#define SRS_RTC_GOP_CACHE_MAX_PACKETS 8192
+
+SrsRtcGopCache::SrsRtcGopCache()
+{
+    enable_gop_cache = false;
+    has_keyframe = false;
+    keyframe_ts = 0;
+    keyframe_ssrc = 0;
+}
+
+SrsRtcGopCache::~SrsRtcGopCache()
+{
+    clear();
+}
+
+void SrsRtcGopCache::set(bool v)
+{
+    enable_gop_cache = v;
+
+    if (!v) {
+        clear();
+    }
+}
+
+bool SrsRtcGopCache::enabled()
+{
+    return enable_gop_cache;
+}
+
+srs_error_t SrsRtcGopCache::cache(SrsRtpPacket* pkt)
+{
+    srs_error_t err = srs_success;
+
+    if (!enable_gop_cache) {
+        return err;
+    }
+
+    // Clear the cache when got a new keyframe, note that the SPS/PPS and IDR of a keyframe are
+    // in different packets with the same timestamp, and ignore the late packets of old keyframe.
+    // For simulcast, the GOP starts from the keyframe of the first layer, and we keep the other
+    // layers in the GOP, for player to switch layer by its keyframe.
+    if (pkt->is_keyframe()) {
+        uint32_t ts = pkt->header.get_timestamp();
+        uint32_t ssrc = pkt->header.get_ssrc();
+        if (!has_keyframe || (ssrc == keyframe_ssrc && (int32_t)(ts - keyframe_ts) > 0)) {
+            clear();
+            has_keyframe = true;
+            keyframe_ts = ts;
+            keyframe_ssrc = ssrc;
+        }
+    }
+
+    // Drop the packets before keyframe, which are useless for consumer to decode.
+    if (!has_keyframe) {
+        return err;
+    }
+
+    // Clear the cache when overflow, for example, the GOP is too large.
+    if ((int)gop_cache.size() >= SRS_RTC_GOP_CACHE_MAX_PACKETS) {
+        srs_warn("RTC: clear gop cache for overflow, packets=%d", (int)gop_cache.size());
+        clear();
+        return err;
+    }
+
+    gop_cache.push_back(pkt->copy());
+
+    return err;
+}
+
+void SrsRtcGopCache::clear()
+{
+    std::vector<SrsRtpPacket*>::iterator it;
+    for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
+        SrsRtpPacket* pkt = *it;
+        srs_freep(pkt);
+    }
+    gop_cache.clear();
+
+    has_keyframe = false;
+}
+
+srs_error_t SrsRtcGopCache::dump(SrsRtcConsumer* consumer)
+{
+    srs_error_t err = srs_success;
+
+    std::vector<SrsRtpPacket*>::iterator it;
+    for (it = gop_cache.begin(); it != gop_cache.end(); ++it) {
+        SrsRtpPacket* pkt = *it;
+        if ((err = consumer->enqueue(pkt->copy())) != srs_success) {
+            return srs_error_wrap(err, "enqueue packet");
+        }
+    }
+
+    return err;
+}
+
+int SrsRtcGopCache::size()
+{
+    return (int)gop_cache.size();
+}
+
+SrsRtcKeyframeArbiter::SrsRtcKeyframeArbiter()
+{
+    window_ = 0;
+    interval_ = 0;
+
+    nn_requests_ = 0;
+    nn_sent_ = 0;
+    nn_coalesced_ = 0;
+    nn_delayed_ = 0;
+    nn_cached_ = 0;
+}
+
+SrsRtcKeyframeArbiter::~SrsRtcKeyframeArbiter()
+{
+}
+
+void SrsRtcKeyframeArbiter::set_window(srs_utime_t window, srs_utime_t interval)
+{
+    window_ = window;
+    interval_ = interval;
+}
+
+bool SrsRtcKeyframeArbiter::on_request(uint32_t ssrc, srs_utime_t now)
+{
+    nn_requests_++;
+
+    SrsRtcKeyframeState& state = fetch(ssrc);
+
+    // Coalesce to the outstanding PLI, the keyframe is for all players.
+    bool outstanding = state.last_sent && state.last_sent > state.last_keyframe && now - state.last_sent < window_;
+    if (state.pending || outstanding) {
+        nn_coalesced_++;
+        return false;
+    }
+
+    // Delay the PLI, to keep the minimum interval between keyframes.
+    srs_utime_t last = srs_max(state.last_sent, state.last_keyframe);
+    if (last && now - last < interval_) {
+        state.pending = true;
+        nn_delayed_++;
+        return false;
+    }
+
+    state.last_sent = now;
+    nn_sent_++;
+
+    return true;
+}
+
+void SrsRtcKeyframeArbiter::on_keyframe(uint32_t ssrc, srs_utime_t now)
+{
+    // The delayed PLI is done, because the keyframe is after the request.
+    SrsRtcKeyframeState& state = fetch(ssrc);
+    state.last_keyframe = now;
+    state.pending = false;
+}
+
+void SrsRtcKeyframeArbiter::on_cached()
+{
+    nn_cached_++;
+}
+
+void SrsRtcKeyframeArbiter::pending(srs_utime_t now, vector<uint32_t>& ssrcs)
+{
+    for (map<uint32_t, SrsRtcKeyframeState>::iterator it = states_.begin(); it != states_.end(); ++it) {
+        SrsRtcKeyframeState& state = it->second;
+        if (!state.pending || now - srs_max(state.last_sent, state.last_keyframe) < interval_) {
+            continue;
+        }
+
+        state.pending = false;
+        state.last_sent = now;
+        nn_sent_++;
+
+        ssrcs.push_back(it->first);
+    }
+}
+
+void SrsRtcKeyframeArbiter::clear()
+{
+    states_.clear();
+}
+
+SrsRtcKeyframeArbiter::SrsRtcKeyframeState& SrsRtcKeyframeArbiter::fetch(uint32_t ssrc)
+{
+    map<uint32_t, SrsRtcKeyframeState>::iterator it = states_.find(ssrc);
+    if (it != states_.end()) {
+        return it->second;
+    }
+
+    SrsRtcKeyframeState state;
+    state.last_sent = 0;
+    state.last_keyframe = 0;
+    state.pending = false;
+    return states_.insert(make_pair(ssrc, state)).first->second;
+}
+
+void SrsRtcKeyframeArbiter::dumps(SrsJsonObject* obj)
+{
+    obj->set("window", SrsJsonAny::integer(srsu2msi(window_)));
+    obj->set("interval", SrsJsonAny::integer(srsu2msi(interval_)));
+    obj->set("requests", SrsJsonAny::integer(nn_requests_));
+    obj->set("sent", SrsJsonAny::integer(nn_sent_));
+    obj->set("coalesced", SrsJsonAny::integer(nn_coalesced_));
+    obj->set("delayed", SrsJsonAny::integer(nn_delayed_));
+    obj->set("cached", SrsJsonAny::integer(nn_cached_));
+}
+
 SrsRtcSourceManager::SrsRtcSourceManager()
 {
     lock = srs_mutex_new();
@@ -331,6 +544,9 @@ SrsRtcSource::SrsRtcSource()
     bridger_ = NULL;
 
     pli_for_rtmp_ = pli_elapsed_ = 0;
+
+    gop_cache_ = new SrsRtcGopCache();
+    keyframe_arbiter_ = new SrsRtcKeyframeArbiter();
 }
 
 SrsRtcSource::~SrsRtcSource()
@@ -339,6 +555,9 @@ SrsRtcSource::~SrsRtcSource()
     // for all consumers are auto free.
     consumers.clear();
 
+    srs_freep(gop_cache_);
+    srs_freep(keyframe_arbiter_);
+
     srs_freep(req);
     srs_freep(bridger_);
     srs_freep(stream_desc_);
@@ -474,8 +693,24 @@ srs_error_t SrsRtcSource::consumer_dumps(SrsRtcConsumer* consumer, bool ds, bool
 {
     srs_error_t err = srs_success;
 
+    // Dumps the GOP, so consumer is able to decode it immediately.
+    if (dg && gop_cache_->enabled()) {
+        if ((err = gop_cache_->dump(consumer)) != srs_success) {
+            return srs_error_wrap(err, "gop cache dump");
+        }
+    }
+
+    // The consumer starts from the keyframe in cache, so it never requests keyframe.
+    if (dg && gop_cache_->size() > 0) {
+        keyframe_arbiter_->on_cached();
+    }
+
     // print status.
-    srs_trace("create consumer, no gop cache");
+    if (dg && gop_cache_->enabled()) {
+        srs_trace("create consumer, gop cache packets=%d", gop_cache_->size());
+    } else {
+        srs_trace("create consumer, no gop cache");
+    }
 
     return err;
 }
@@ -522,6 +757,16 @@ srs_error_t SrsRtcSource::on_publish()
     is_created_ = true;
     is_delivering_packets_ = true;
 
+    // Update the config of GOP cache for each publishing.
+    gop_cache_->set(_srs_config->get_rtc_gop_cache(req->vhost));
+
+    // Update the config of PLI arbiter, the SSRCs of publisher might change.
+    keyframe_arbiter_->clear();
+    keyframe_arbiter_->set_window(_srs_config->get_rtc_pli_window(req->vhost), _srs_config->get_rtc_pli_interval(req->vhost));
+
+    // @see SrsRtcSource::on_timer()
+    _srs_hybrid->timer100ms()->subscribe(this);
+
     // Notify the consumers about stream change event.
     if ((err = on_source_changed()) != srs_success) {
         return srs_error_wrap(err, "source id change");
@@ -535,9 +780,6 @@ srs_error_t SrsRtcSource::on_publish()
 
         // The PLI interval for RTC2RTMP.
         pli_for_rtmp_ = _srs_config->get_rtc_pli_for_rtmp(req->vhost);
-
-        // @see SrsRtcSource::on_timer()
-        _srs_hybrid->timer100ms()->subscribe(this);
     }
 
     // TODO: FIXME: Handle by statistic.
@@ -557,6 +799,12 @@ void SrsRtcSource::on_unpublish()
     is_created_ = false;
     is_delivering_packets_ = false;
 
+    // The cached packets are of the stopped stream.
+    gop_cache_->clear();
+
+    // For SrsRtcSource::on_timer()
+    _srs_hybrid->timer100ms()->unsubscribe(this);
+
     if (!_source_id.empty()) {
         _pre_source_id = _source_id;
     }
@@ -569,9 +817,6 @@ void SrsRtcSource::on_unpublish()
 
     //free bridger resource
     if (bridger_) {
-        // For SrsRtcSource::on_timer()
-        _srs_hybrid->timer100ms()->unsubscribe(this);
-
         bridger_->on_unpublish();
         srs_freep(bridger_);
     }
@@ -605,6 +850,22 @@ void SrsRtcSource::set_publish_stream(ISrsRtcPublishStream* v)
     publish_stream_ = v;
 }
 
+void SrsRtcSource::request_keyframe(uint32_t ssrc)
+{
+    if (!publish_stream_) {
+        return;
+    }
+
+    if (keyframe_arbiter_->on_request(ssrc, srs_get_system_time())) {
+        publish_stream_->request_keyframe(ssrc);
+    }
+}
+
+void SrsRtcSource::dumps_keyframe(SrsJsonObject* obj)
+{
+    keyframe_arbiter_->dumps(obj);
+}
+
 srs_error_t SrsRtcSource::on_rtp(SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
@@ -615,6 +876,14 @@ srs_error_t SrsRtcSource::on_rtp(SrsRtpPacket* pkt)
         return err;
     }
 
+    if ((err = gop_cache_->cache(pkt)) != srs_success) {
+        return srs_error_wrap(err, "gop cache");
+    }
+
+    if (pkt->is_keyframe()) {
+        keyframe_arbiter_->on_keyframe(pkt->header.get_ssrc(), srs_get_system_time());
+    }
+
     for (int i = 0; i < (int)consumers.size(); i++) {
         SrsRtcConsumer* consumer = consumers.at(i);
         if ((err = consumer->enqueue(pkt->copy())) != srs_success) {
@@ -659,7 +928,14 @@ std::vector<SrsRtcTrackDescription*> SrsRtcSource::get_track_desc(std::string ty
     if (type == "video") {
         std::vector<SrsRtcTrackDescription*>::iterator it = stream_desc_->video_track_descs_.begin();
         while (it != stream_desc_->video_track_descs_.end() ){
-            track_descs.push_back(*it);
+            // For simulcast, only the first layer of track, because the player selects the layer.
+            bool is_layer = false;
+            for (int i = 0; !(*it)->rid_.empty() && i < (int)track_descs.size(); i++) {
+                is_layer = is_layer || track_descs.at(i)->id_ == (*it)->id_;
+            }
+            if (!is_layer) {
+                track_descs.push_back(*it);
+            }
             ++it;
         }
     }
@@ -667,6 +943,25 @@ std::vector<SrsRtcTrackDescription*> SrsRtcSource::get_track_desc(std::string ty
     return track_descs;
 }
 
+void SrsRtcSource::bind_rid_ssrc(std::string id, std::string rid, uint32_t ssrc, bool repaired)
+{
+    if (!stream_desc_) {
+        return;
+    }
+
+    for (int i = 0; i < (int)stream_desc_->video_track_descs_.size(); i++) {
+        SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
+        if (desc->id_ == id && desc->bind_rid_ssrc(rid, ssrc, repaired)) {
+            return;
+        }
+    }
+}
+
+SrsRtcTrackDescription* SrsRtcSource::find_layer_by_ssrc(uint32_t ssrc)
+{
+    return stream_desc_ ? stream_desc_->find_layer_by_ssrc(ssrc) : NULL;
+}
+
 srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
@@ -675,7 +970,18 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
         return err;
     }
 
-    // Request PLI and reset the timer.
+    // Send the PLIs delayed by arbiter.
+    vector<uint32_t> ssrcs;
+    keyframe_arbiter_->pending(srs_get_system_time(), ssrcs);
+    for (int i = 0; i < (int)ssrcs.size(); i++) {
+        publish_stream_->request_keyframe(ssrcs.at(i));
+    }
+
+    // Request PLI for RTC2RTMP and reset the timer.
+    if (!bridger_) {
+        return err;
+    }
+
     if (true) {
         pli_elapsed_ += interval;
         if (pli_elapsed_ < pli_for_rtmp_) {
@@ -686,7 +992,10 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
 
     for (int i = 0; i < (int)stream_desc_->video_track_descs_.size(); i++) {
         SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
-        publish_stream_->request_keyframe(desc->ssrc_);
+        // Ignore the layer of simulcast, which is not bound to SSRC.
+        if (desc->ssrc_) {
+            request_keyframe(desc->ssrc_);
+        }
     }
 
     return err;
@@ -2124,6 +2433,22 @@ int SrsRtcTrackDescription::get_rtp_extension_id(std::string uri)
     return 0;
 }
 
+bool SrsRtcTrackDescription::bind_rid_ssrc(std::string rid, uint32_t ssrc, bool repaired)
+{
+    if (rid_.empty() || rid_ != rid) {
+        return false;
+    }
+
+    // Never change the SSRC of layer, which is already bound.
+    uint32_t& v = repaired ? rtx_ssrc_ : ssrc_;
+    if (v && v != ssrc) {
+        return false;
+    }
+
+    v = ssrc;
+    return true;
+}
+
 SrsRtcTrackDescription* SrsRtcTrackDescription::copy()
 {
     SrsRtcTrackDescription* cp = new SrsRtcTrackDescription();
@@ -2137,6 +2462,7 @@ SrsRtcTrackDescription* SrsRtcTrackDescription::copy()
     cp->direction_ = direction_;
     cp->mid_ = mid_;
     cp->msid_ = msid_;
+    cp->rid_ = rid_;
     cp->is_active_ = is_active_;
     cp->media_ = media_ ? media_->copy():NULL;
     cp->red_ = red_ ? red_->copy():NULL;
@@ -2191,6 +2517,18 @@ SrsRtcTrackDescription* SrsRtcSourceDescription::find_track_description_by_ssrc(
     return NULL;
 }
 
+SrsRtcTrackDescription* SrsRtcSourceDescription::find_layer_by_ssrc(uint32_t ssrc)
+{
+    for (int i = 0; i < (int)video_track_descs_.size(); ++i) {
+        SrsRtcTrackDescription* desc = video_track_descs_.at(i);
+        if (!desc->rid_.empty() && desc->ssrc_ == ssrc) {
+            return desc;
+        }
+    }
+
+    return NULL;
+}
+
 SrsRtcRecvTrack::SrsRtcRecvTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc, bool is_audio)
 {
     session_ = session;
@@ -2205,6 +2543,11 @@ SrsRtcRecvTrack::SrsRtcRecvTrack(SrsRtcConnection* session, SrsRtcTrackDescripti
         nack_receiver_ = new SrsRtpNackForReceiver(rtp_queue_, 1000 * 2 / 3);
     }
 
+    // Recycle the packets to the pool of session, for decoder to reuse them.
+    if (session_) {
+        rtp_queue_->set_pool(session_->packet_pool());
+    }
+
     last_sender_report_sys_time = 0;
 }
 
@@ -2225,6 +2568,11 @@ uint32_t SrsRtcRecvTrack::get_ssrc()
     return track_desc_->ssrc_;
 }
 
+bool SrsRtcRecvTrack::bind_rid_ssrc(std::string rid, uint32_t ssrc, bool repaired)
+{
+    return track_desc_->bind_rid_ssrc(rid, ssrc, repaired);
+}
+
 void SrsRtcRecvTrack::update_rtt(int rtt)
 {
     nack_receiver_->update_rtt(rtt);
@@ -2284,11 +2632,34 @@ srs_error_t SrsRtcRecvTrack::on_nack(SrsRtpPacket** ppkt)
 
     SrsRtpPacket* pkt = *ppkt;
     uint16_t seq = pkt->header.get_sequence();
+    if (!update_nack(seq)) {
+        return err;
+    }
+
+    // insert into video_queue and audio_queue
+    // We directly use the pkt, never copy it, so we should set the pkt to NULL.
+    if (nack_no_copy_) {
+        rtp_queue_->set(seq, pkt);
+        *ppkt = NULL;
+    } else {
+        rtp_queue_->set(seq, pkt->copy());
+    }
+
+    return err;
+}
+
+void SrsRtcRecvTrack::on_nack_ignored(uint16_t seq)
+{
+    update_nack(seq);
+}
+
+bool SrsRtcRecvTrack::update_nack(uint16_t seq)
+{
     SrsRtpNackInfo* nack_info = nack_receiver_->find(seq);
     if (nack_info) {
         // seq had been received.
         nack_receiver_->remove(seq);
-        return err;
+        return false;
     }
 
     // insert check nack list
@@ -2302,16 +2673,7 @@ srs_error_t SrsRtcRecvTrack::on_nack(SrsRtpPacket** ppkt)
         nack_receiver_->check_queue_size();
     }
 
-    // insert into video_queue and audio_queue
-    // We directly use the pkt, never copy it, so we should set the pkt to NULL.
-    if (nack_no_copy_) {
-        rtp_queue_->set(seq, pkt);
-        *ppkt = NULL;
-    } else {
-        rtp_queue_->set(seq, pkt->copy());
-    }
-
-    return err;
+    return true;
 }
 
 srs_error_t SrsRtcRecvTrack::do_check_send_nacks(uint32_t& timeout_nacks)
@@ -2340,7 +2702,7 @@ void SrsRtcAudioRecvTrack::on_before_decode_payload(SrsRtpPacket* pkt, SrsBuffer
         return;
     }
 
-    *ppayload = new SrsRtpRawPayload();
+    *ppayload = pkt->reuse_raw();
     *ppt = SrsRtspPacketPayloadTypeRaw;
 }
 
@@ -2372,10 +2734,16 @@ srs_error_t SrsRtcAudioRecvTrack::check_send_nacks()
 SrsRtcVideoRecvTrack::SrsRtcVideoRecvTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc)
     : SrsRtcRecvTrack(session, track_desc, false)
 {
+    // The ULPFEC is negotiated only if FEC is enabled, see negotiate_publish_capability.
+    fec_ = NULL;
+    if (track_desc->red_ && track_desc->ulpfec_) {
+        fec_ = new SrsRtcFecDecoder(track_desc->ulpfec_->pt_);
+    }
 }
 
 SrsRtcVideoRecvTrack::~SrsRtcVideoRecvTrack()
 {
+    srs_freep(fec_);
 }
 
 void SrsRtcVideoRecvTrack::on_before_decode_payload(SrsRtpPacket* pkt, SrsBuffer* buf, ISrsRtpPayloader** ppayload, SrsRtspPacketPayloadType* ppt)
@@ -2392,10 +2760,10 @@ void SrsRtcVideoRecvTrack::on_before_decode_payload(SrsRtpPacket* pkt, SrsBuffer
         *ppayload = new SrsRtpSTAPPayload();
         *ppt = SrsRtspPacketPayloadTypeSTAP;
     } else if (v == kFuA) {
-        *ppayload = new SrsRtpFUAPayload2();
+        *ppayload = pkt->reuse_fua();
         *ppt = SrsRtspPacketPayloadTypeFUA2;
     } else {
-        *ppayload = new SrsRtpRawPayload();
+        *ppayload = pkt->reuse_raw();
         *ppt = SrsRtspPacketPayloadTypeRaw;
     }
 }
@@ -2406,7 +2774,19 @@ srs_error_t SrsRtcVideoRecvTrack::on_rtp(SrsRtcSource* source, SrsRtpPacket* pkt
 
     pkt->frame_type = SrsFrameTypeVideo;
 
-    if ((err = source->on_rtp(pkt)) != srs_success) {
+    // Remove the FEC packets from sequence space for players, but keep the sequence for NACK.
+    uint16_t seq = pkt->header.get_sequence();
+    if (fec_) {
+        pkt->header.set_sequence(fec_->shift(seq));
+    }
+
+    err = source->on_rtp(pkt);
+
+    if (fec_) {
+        pkt->header.set_sequence(seq);
+    }
+
+    if (err != srs_success) {
         return srs_error_wrap(err, "source on rtp");
     }
 
@@ -2435,6 +2815,27 @@ srs_error_t SrsRtcVideoRecvTrack::check_send_nacks()
     return err;
 }
 
+bool SrsRtcVideoRecvTrack::is_red(char* data, int size)
+{
+    return fec_ && srs_rtp_fast_parse_pt(data, size) == track_desc_->red_->pt_;
+}
+
+srs_error_t SrsRtcVideoRecvTrack::on_red(char* data, int* psize, std::vector<SrsRtcFecPacket*>& recovered)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = fec_->decode(data, psize, recovered)) != srs_success) {
+        return srs_error_wrap(err, "fec decode");
+    }
+
+    if (!recovered.empty()) {
+        srs_info("RTC: FEC recovered %d packets, total %" PRId64 ", track=%s", (int)recovered.size(),
+            fec_->nn_recovered(), track_desc_->id_.c_str());
+    }
+
+    return err;
+}
+
 SrsRtcSendTrack::SrsRtcSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc, bool is_audio)
 {
     session_ = session;
@@ -2599,10 +3000,26 @@ srs_error_t SrsRtcAudioSendTrack::on_rtcp(SrsRtpPacket* pkt)
 SrsRtcVideoSendTrack::SrsRtcVideoSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc)
     : SrsRtcSendTrack(session, track_desc, false)
 {
+    selector_ = track_desc->rid_.empty() ? NULL : new SrsRtcLayerSelector();
+    seq_offset_ = 0;
+    ts_offset_ = 0;
+    has_last_ = false;
+    last_seq_ = 0;
+    last_ts_ = 0;
+    last_sent_ = 0;
+    last_pli_ = 0;
+
+    // The ULPFEC is negotiated only if FEC is enabled, see negotiate_play_capability.
+    fec_ = NULL;
+    if (track_desc->red_ && track_desc->ulpfec_) {
+        fec_ = new SrsRtcFecEncoder(track_desc->red_->pt_, track_desc->ulpfec_->pt_);
+    }
 }
 
 SrsRtcVideoSendTrack::~SrsRtcVideoSendTrack()
 {
+    srs_freep(selector_);
+    srs_freep(fec_);
 }
 
 srs_error_t SrsRtcVideoSendTrack::on_rtp(SrsRtpPacket* pkt)
@@ -2626,10 +3043,33 @@ srs_error_t SrsRtcVideoSendTrack::on_rtp(SrsRtpPacket* pkt)
         // TODO: FIXME: Should update PT for RTX.
     }
 
-    if ((err = session_->do_send_packet(pkt)) != srs_success) {
+    // Insert the FEC packets to sequence space, so shift the sequence of media.
+    if (fec_) {
+        pkt->header.set_sequence(fec_->shift(pkt->header.get_sequence()));
+    }
+
+    if ((err = session_->do_send_packet(pkt, fec_)) != srs_success) {
         return srs_error_wrap(err, "raw send");
     }
 
+    // Send the FEC packets, when got a group of media packets.
+    if (fec_) {
+        vector<SrsRtpPacket*> fecs;
+        err = fec_->encode(fecs);
+
+        for (int i = 0; i < (int)fecs.size(); i++) {
+            SrsRtpPacket* fec = fecs.at(i);
+            if (err == srs_success) {
+                err = session_->do_send_packet(fec);
+            }
+            srs_freep(fec);
+        }
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "send fec");
+        }
+    }
+
     return err;
 }
 
@@ -2640,6 +3080,126 @@ srs_error_t SrsRtcVideoSendTrack::on_rtcp(SrsRtpPacket* pkt)
     return err;
 }
 
+bool SrsRtcVideoSendTrack::is_simulcast()
+{
+    return selector_;
+}
+
+void SrsRtcVideoSendTrack::add_layer(uint32_t ssrc, std::string rid)
+{
+    layers_[ssrc] = rid;
+}
+
+uint32_t SrsRtcVideoSendTrack::get_layer_ssrc()
+{
+    if (!selector_) {
+        return 0;
+    }
+
+    std::string current = selector_->current();
+    for (std::map<uint32_t, std::string>::iterator it = layers_.begin(); it != layers_.end(); ++it) {
+        if (it->first && it->second == current) {
+            return it->first;
+        }
+    }
+
+    return 0;
+}
+
+void SrsRtcVideoSendTrack::set_layer(std::string rid)
+{
+    if (selector_) {
+        selector_->set_manual(rid);
+    }
+}
+
+void SrsRtcVideoSendTrack::dumps_layers(SrsJsonObject* obj)
+{
+    obj->set("track", SrsJsonAny::str(track_desc_->id_.c_str()));
+    if (selector_) {
+        selector_->dumps(obj);
+    }
+}
+
+// Whether the packet is the start of keyframe, where we are able to switch the layer.
+static bool srs_rtp_is_keyframe_start(SrsRtpPacket* pkt)
+{
+    if (!pkt->is_keyframe()) {
+        return false;
+    }
+
+    if (pkt->nalu_type == kFuA) {
+        SrsRtpFUAPayload2* payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
+        return payload && payload->start;
+    }
+
+    return true;
+}
+
+bool SrsRtcVideoSendTrack::on_layer_rtp(SrsRtpPacket* pkt, int64_t estimate, uint32_t* pkeyframe_ssrc)
+{
+    if (!selector_) {
+        return true;
+    }
+
+    uint32_t ssrc = pkt->header.get_ssrc();
+    std::map<uint32_t, std::string>::iterator it = layers_.find(ssrc);
+    if (it == layers_.end()) {
+        return false;
+    }
+    std::string rid = it->second;
+
+    srs_utime_t now = srs_get_tick();
+    selector_->on_packet(rid, pkt->nb_bytes(), now);
+
+    std::string target = selector_->update(estimate, now);
+    std::string current = selector_->current();
+
+    // Switch to the target layer at keyframe, or any layer if no target.
+    if (rid != current && (target.empty() || rid == target) && srs_rtp_is_keyframe_start(pkt)) {
+        uint16_t seq = pkt->header.get_sequence();
+        uint32_t ts = pkt->header.get_timestamp();
+
+        // Continue the sequence and timestamp of previous layer, in 90kHz clock.
+        if (has_last_) {
+            uint32_t elapsed = (uint32_t)srs_max((srs_utime_t)1, (now - last_sent_) * 90 / SRS_UTIME_MILLISECONDS);
+            seq_offset_ = (uint16_t)(last_seq_ + 1 - seq);
+            ts_offset_ = last_ts_ + elapsed - ts;
+        }
+
+        srs_trace("RTC: Switch layer %s=>%s, ssrc=%u, seq=%u, ts=%u, estimate=%dkbps", current.c_str(), rid.c_str(),
+            ssrc, seq, ts, (int)(estimate / 1000));
+        selector_->on_switched(rid);
+        current = rid;
+    }
+
+    // Drop the packets of other layers, and request keyframe for the target layer.
+    if (rid != current) {
+        if (rid == target && now - last_pli_ >= 1 * SRS_UTIME_SECONDS) {
+            *pkeyframe_ssrc = ssrc;
+            last_pli_ = now;
+        }
+        return false;
+    }
+
+    last_seq_ = pkt->header.get_sequence() + seq_offset_;
+    last_ts_ = pkt->header.get_timestamp() + ts_offset_;
+    last_sent_ = now;
+    has_last_ = true;
+
+    pkt->header.set_sequence(last_seq_);
+    pkt->header.set_timestamp(last_ts_);
+
+    return true;
+}
+
+void SrsRtcVideoSendTrack::on_recv_rr(float lost_rate)
+{
+    if (fec_) {
+        fec_->on_loss(lost_rate);
+    }
+}
+
 SrsRtcSSRCGenerator* SrsRtcSSRCGenerator::_instance = NULL;
 
 SrsRtcSSRCGenerator::SrsRtcSSRCGenerator()
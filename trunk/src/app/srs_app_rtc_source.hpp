@@ -38,6 +38,10 @@ class SrsRtpRingBuffer;
 class SrsRtpNackForReceiver;
 class SrsJsonObject;
 class SrsErrorPithyPrint;
+class SrsRtcLayerSelector;
+class SrsRtcFecPacket;
+class SrsRtcFecEncoder;
+class SrsRtcFecDecoder;
 
 class SrsNtp
 {
@@ -100,6 +104,78 @@ public:
     void on_stream_change(SrsRtcSourceDescription* desc);
 };
 
+// The RTP packets of the last GOP, that is, since the last keyframe, for new consumer to play
+// immediately, without waiting for a PLI to the publisher and a fresh keyframe.
+// @remark The packets keep the sequence and timestamp, because the cache is contiguous to the
+//      packets of stream, and the send track of consumer rewrites the SSRC and PT.
+class SrsRtcGopCache
+{
+private:
+    bool enable_gop_cache;
+    // Whether got a keyframe, we only cache packets after keyframe.
+    bool has_keyframe;
+    // The timestamp of keyframe, which might be packed in multiple RTP packets.
+    uint32_t keyframe_ts;
+    // The SSRC of keyframe, because the layers of simulcast have different timestamp.
+    uint32_t keyframe_ssrc;
+    std::vector<SrsRtpPacket*> gop_cache;
+public:
+    SrsRtcGopCache();
+    virtual ~SrsRtcGopCache();
+public:
+    virtual void set(bool v);
+    virtual bool enabled();
+    // Cache the packet, clear the cache when got a new keyframe.
+    // @param pkt The shared packet, copy it if need to save it.
+    virtual srs_error_t cache(SrsRtpPacket* pkt);
+    virtual void clear();
+    // Dump the cached packets to consumer.
+    virtual srs_error_t dump(SrsRtcConsumer* consumer);
+    virtual int size();
+};
+
+// The arbiter of keyframe requests from all players of a source, to avoid keyframe storm of
+// publisher, when many players join or lose packets. The PLIs are coalesced to the outstanding
+// one in a window, and delayed to keep the minimum interval between keyframes.
+class SrsRtcKeyframeArbiter
+{
+private:
+    struct SrsRtcKeyframeState {
+        // The time of the last PLI sent to publisher, and the last keyframe from publisher.
+        srs_utime_t last_sent;
+        srs_utime_t last_keyframe;
+        // Whether a PLI is delayed for the minimum interval.
+        bool pending;
+    };
+    std::map<uint32_t, SrsRtcKeyframeState> states_;
+    srs_utime_t window_;
+    srs_utime_t interval_;
+private:
+    uint64_t nn_requests_;
+    uint64_t nn_sent_;
+    uint64_t nn_coalesced_;
+    uint64_t nn_delayed_;
+    uint64_t nn_cached_;
+public:
+    SrsRtcKeyframeArbiter();
+    virtual ~SrsRtcKeyframeArbiter();
+public:
+    // Set the window to coalesce PLIs, and the minimum interval between keyframes.
+    void set_window(srs_utime_t window, srs_utime_t interval);
+    // When player requests keyframe of SSRC, return whether to send PLI to publisher now.
+    bool on_request(uint32_t ssrc, srs_utime_t now);
+    // When got keyframe of SSRC from publisher.
+    void on_keyframe(uint32_t ssrc, srs_utime_t now);
+    // When a new player is served by the keyframe in GOP cache.
+    void on_cached();
+    // Get the SSRCs of delayed PLIs to send now.
+    void pending(srs_utime_t now, std::vector<uint32_t>& ssrcs);
+    void clear();
+    void dumps(SrsJsonObject* obj);
+private:
+    SrsRtcKeyframeState& fetch(uint32_t ssrc);
+};
+
 class SrsRtcSourceManager
 {
 private:
@@ -183,6 +259,10 @@ private:
     bool is_delivering_packets_;
     // Notify stream event to event handler
     std::vector<ISrsRtcSourceEventHandler*> event_handlers_;
+    // The GOP cache for consumer to fast startup.
+    SrsRtcGopCache* gop_cache_;
+    // The arbiter of PLIs from all consumers.
+    SrsRtcKeyframeArbiter* keyframe_arbiter_;
 private:
     // The PLI for RTC2RTMP.
     srs_utime_t pli_for_rtmp_;
@@ -233,12 +313,19 @@ public:
     // Get and set the publisher, passed to consumer to process requests such as PLI.
     ISrsRtcPublishStream* publish_stream();
     void set_publish_stream(ISrsRtcPublishStream* v);
+    // Request keyframe(PLI) from publisher for consumer, coalesced by the arbiter.
+    void request_keyframe(uint32_t ssrc);
+    void dumps_keyframe(SrsJsonObject* obj);
     // Consume the shared RTP packet, user must free it.
     srs_error_t on_rtp(SrsRtpPacket* pkt);
     // Set and get stream description for souce
     bool has_stream_desc();
     void set_stream_desc(SrsRtcSourceDescription* stream_desc);
     std::vector<SrsRtcTrackDescription*> get_track_desc(std::string type, std::string media_type);
+    // For simulcast by RID, bind the SSRC of layer to the stream description.
+    void bind_rid_ssrc(std::string id, std::string rid, uint32_t ssrc, bool repaired);
+    // For simulcast, find the video track of layer by SSRC, NULL if not found.
+    SrsRtcTrackDescription* find_layer_by_ssrc(uint32_t ssrc);
 // interface ISrsFastTimer
 private:
     srs_error_t on_timer(srs_utime_t interval);
@@ -461,6 +548,9 @@ public:
     std::string mid_;
     // msid_: track stream id
     std::string msid_;
+    // The RID of simulcast layer, empty if not simulcast. The layers of a track share the same id_,
+    // and for simulcast by ssrc-group SIM, it's the index of SSRC in group, such as 0, 1 or 2.
+    std::string rid_;
 
     // meida payload, such as opus, h264.
     SrsCodecPayload* media_;
@@ -486,6 +576,9 @@ public:
     void set_fec_ssrc(uint32_t ssrc);
     void set_mid(std::string mid);
     int get_rtp_extension_id(std::string uri);
+    // For simulcast by RID, bind the SSRC of layer, which is unknown until the first packet.
+    // @param repaired Whether the SSRC is the RTX of layer, identified by the repaired RID.
+    bool bind_rid_ssrc(std::string rid, uint32_t ssrc, bool repaired);
 public:
     SrsRtcTrackDescription* copy();
 };
@@ -505,6 +598,8 @@ public:
 public:
     SrsRtcSourceDescription* copy();
     SrsRtcTrackDescription* find_track_description_by_ssrc(uint32_t ssrc);
+    // For simulcast, find the video track of layer by SSRC.
+    SrsRtcTrackDescription* find_layer_by_ssrc(uint32_t ssrc);
 };
 
 class SrsRtcRecvTrack
@@ -530,6 +625,7 @@ public:
     void set_nack_no_copy(bool v) { nack_no_copy_ = v; }
     bool has_ssrc(uint32_t ssrc);
     uint32_t get_ssrc();
+    bool bind_rid_ssrc(std::string rid, uint32_t ssrc, bool repaired);
     void update_rtt(int rtt);
     void update_send_report_time(const SrsNtp& ntp);
     srs_error_t send_rtcp_rr();
@@ -541,6 +637,11 @@ public:
     // Note that we can set the pkt to NULL to avoid copy, for example, if the NACK cache the pkt and
     // set to NULL, nack nerver copy it but set the pkt to NULL.
     srs_error_t on_nack(SrsRtpPacket** ppkt);
+    // When got a packet which is not media, for example, the FEC packet, we should never NACK it.
+    void on_nack_ignored(uint16_t seq);
+private:
+    // Update the NACK list by the received sequence, return false if it's recovered by NACK.
+    bool update_nack(uint16_t seq);
 public:
     virtual srs_error_t on_rtp(SrsRtcSource* source, SrsRtpPacket* pkt) = 0;
     virtual srs_error_t check_send_nacks() = 0;
@@ -562,6 +663,9 @@ public:
 
 class SrsRtcVideoRecvTrack : public SrsRtcRecvTrack, public ISrsRtspPacketDecodeHandler
 {
+private:
+    // For publisher protects video by ULPFEC in RED.
+    SrsRtcFecDecoder* fec_;
 public:
     SrsRtcVideoRecvTrack(SrsRtcConnection* session, SrsRtcTrackDescription* stream_descs);
     virtual ~SrsRtcVideoRecvTrack();
@@ -570,6 +674,11 @@ public:
 public:
     virtual srs_error_t on_rtp(SrsRtcSource* source, SrsRtpPacket* pkt);
     virtual srs_error_t check_send_nacks();
+public:
+    // Whether the packet is RED with FEC, which should be decoded by on_red.
+    bool is_red(char* data, int size);
+    // Unwrap the RED packet, and recover the lost packets by FEC, see SrsRtcFecDecoder::decode.
+    srs_error_t on_red(char* data, int* psize, std::vector<SrsRtcFecPacket*>& recovered);
 };
 
 class SrsRtcSendTrack
@@ -620,12 +729,43 @@ public:
 
 class SrsRtcVideoSendTrack : public SrsRtcSendTrack
 {
+private:
+    // For simulcast, the RID of layers by SSRC, and the selector to switch layer.
+    std::map<uint32_t, std::string> layers_;
+    SrsRtcLayerSelector* selector_;
+    // The offset of sequence and timestamp of current layer, to make the stream continuous.
+    uint16_t seq_offset_;
+    uint32_t ts_offset_;
+    bool has_last_;
+    uint16_t last_seq_;
+    uint32_t last_ts_;
+    srs_utime_t last_sent_;
+    srs_utime_t last_pli_;
+private:
+    // For player supports ULPFEC in RED, to protect the video.
+    SrsRtcFecEncoder* fec_;
 public:
     SrsRtcVideoSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc);
     virtual ~SrsRtcVideoSendTrack();
 public:
     virtual srs_error_t on_rtp(SrsRtpPacket* pkt);
     virtual srs_error_t on_rtcp(SrsRtpPacket* pkt);
+public:
+    // Whether the track is simulcast, which sends one of the layers.
+    bool is_simulcast();
+    void add_layer(uint32_t ssrc, std::string rid);
+    // Get the SSRC of the layer we are sending, 0 if not simulcast.
+    uint32_t get_layer_ssrc();
+    // Set the layer by API, empty for auto.
+    void set_layer(std::string rid);
+    void dumps_layers(SrsJsonObject* obj);
+    // For simulcast, whether forward the packet of layer, and switch to the target layer at keyframe,
+    // then rewrite the sequence and timestamp to make the stream continuous.
+    // @param estimate The estimated bandwidth in bps, 0 if unknown.
+    // @param pkeyframe_ssrc Set to the SSRC of layer to request keyframe, 0 if no need.
+    bool on_layer_rtp(SrsRtpPacket* pkt, int64_t estimate, uint32_t* pkeyframe_ssrc);
+    // When got the fraction lost from RTCP RR of player, to adapt the protection of FEC.
+    void on_recv_rr(float lost_rate);
 };
 
 class SrsRtcSSRCGenerator
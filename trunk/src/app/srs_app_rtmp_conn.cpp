@@ -29,6 +29,7 @@ using namespace std;
 #include <srs_app_http_hooks.hpp>
 #include <srs_app_edge.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_kernel_balance.hpp>
 #include <srs_rtmp_msg_array.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_app_recv_thread.hpp>
@@ -39,6 +40,10 @@ using namespace std;
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_app_rtc_source.hpp>
+#include <srs_kernel_kbps.hpp>
+
+extern SrsHistogram* _srs_histogram_stage_send;
+extern SrsHistogram* _srs_histogram_stage_e2e;
 
 // the timeout in srs_utime_t to wait encoder to republish
 // if timeout, close the connection.
@@ -386,8 +391,10 @@ srs_error_t SrsRtmpConn::service_cycle()
         return srs_error_wrap(err, "rtmp: set chunk size %d", chunk_size);
     }
     
-    // response the client connect ok.
-    if ((err = rtmp->response_connect_app(req, local_ip.c_str())) != srs_success) {
+    // response the client connect ok, with the CPU load for edge to select the origin.
+    SrsProcSelfStat* self = srs_get_self_proc_stat();
+    int load = self->ok? (int)(self->percent * 100) : -1;
+    if ((err = rtmp->response_connect_app(req, local_ip.c_str(), load)) != srs_success) {
         return srs_error_wrap(err, "rtmp: response connect app");
     }
     
@@ -619,7 +626,9 @@ srs_error_t SrsRtmpConn::playing(SrsLiveSource* source)
     // When origin cluster enabled, try to redirect to the origin which is active.
     // A active origin is a server which is delivering stream.
     if (!info->edge && _srs_config->get_vhost_origin_cluster(req->vhost) && source->inactive()) {
-        vector<string> coworkers = _srs_config->get_vhost_coworkers(req->vhost);
+        // Skip the coworkers which are down recently.
+        SrsLbHealth* health = SrsLbHealth::instance();
+        vector<string> coworkers = health->filter(_srs_config->get_vhost_coworkers(req->vhost), srs_get_system_time());
         for (int i = 0; i < (int)coworkers.size(); i++) {
             // TODO: FIXME: User may config the server itself as coworker, we must identify and ignore it.
             string host; int port = 0; string coworker = coworkers.at(i);
@@ -627,14 +636,22 @@ srs_error_t SrsRtmpConn::playing(SrsLiveSource* source)
             string url = "http://" + coworker + "/api/v1/clusters?"
                 + "vhost=" + req->vhost + "&ip=" + req->host + "&app=" + req->app + "&stream=" + req->stream
                 + "&coworker=" + coworker;
+            srs_utime_t starttime = srs_get_system_time();
             if ((err = SrsHttpHooks::discover_co_workers(url, host, port)) != srs_success) {
+                // The coworker is down if no valid response, not only the stream is not there.
+                if (srs_error_code(err) != ERROR_OCLUSTER_DISCOVER) {
+                    health->on_failed(coworker, srs_get_system_time());
+                }
+
                 // If failed to discovery stream in this coworker, we should request the next one util the last.
                 // @see https://github.com/ossrs/srs/issues/1223
                 if (i < (int)coworkers.size() - 1) {
+                    srs_freep(err);
                     continue;
                 }
                 return srs_error_wrap(err, "discover coworkers, url=%s", url.c_str());
             }
+            health->on_connected(coworker, srs_get_system_time() - starttime, -1, srs_get_system_time());
 
             string rurl = srs_generate_rtmp_url(host, port, req->host, req->vhost, req->app, req->stream, req->param);
             srs_trace("rtmp: redirect in cluster, from=%s:%d, target=%s:%d, url=%s, rurl=%s",
@@ -794,8 +811,20 @@ srs_error_t SrsRtmpConn::do_playing(SrsLiveSource* source, SrsLiveConsumer* cons
         
         // sendout messages, all messages are freed by send_and_free_messages().
         // no need to assert msg, for the rtmp will assert it.
-        if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
-            return srs_error_wrap(err, "rtmp: send %d messages", count);
+        if (count > 0) {
+            // @remark Measure the e2e of the oldest message in batch, for all messages are freed when sent.
+            srs_utime_t recv_tick = msgs.msgs[0]->recv_tick;
+            srs_utime_t send_tick = srs_get_tick();
+
+            if ((err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
+                return srs_error_wrap(err, "rtmp: send %d messages", count);
+            }
+
+            srs_utime_t now = srs_get_tick();
+            _srs_histogram_stage_send->update(now - send_tick);
+            if (recv_tick > 0) {
+                _srs_histogram_stage_e2e->update(now - recv_tick);
+            }
         }
         
         // if duration specified, and exceed it, stop play live.
@@ -885,6 +914,10 @@ srs_error_t SrsRtmpConn::do_publishing(SrsLiveSource* source, SrsPublishRecvThre
             mr, srsu2msi(mr_sleep), srsu2msi(publish_1stpkt_timeout), srsu2msi(publish_normal_timeout), tcp_nodelay);
     }
     
+    // Pin the stat of stream, to update it without lookup.
+    SrsStatistic* stat = SrsStatistic::instance();
+    SrsStatisticStream* sstream = stat->fetch_stream(req);
+
     int64_t nb_msgs = 0;
     uint64_t nb_frames = 0;
     while (true) {
@@ -917,8 +950,7 @@ srs_error_t SrsRtmpConn::do_publishing(SrsLiveSource* source, SrsPublishRecvThre
         
         // Update the stat for video fps.
         // @remark https://github.com/ossrs/srs/issues/851
-        SrsStatistic* stat = SrsStatistic::instance();
-        if ((err = stat->on_video_frames(req, (int)(rtrd->nb_video_frames() - nb_frames))) != srs_success) {
+        if ((err = stat->on_video_frames(sstream, (int)(rtrd->nb_video_frames() - nb_frames))) != srs_success) {
             return srs_error_wrap(err, "rtmp: stat video frames");
         }
         nb_frames = rtrd->nb_video_frames();
@@ -25,7 +25,7 @@ using namespace std;
 #include <srs_raw_avc.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_app_pithy_print.hpp>
-#include <srs_app_rtmp_conn.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_format.hpp>
 
@@ -183,7 +183,7 @@ SrsRtspConn::SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o)
     audio_channel = 0;
     
     req = NULL;
-    sdk = NULL;
+    publisher = NULL;
     vjitter = new SrsRtspJitter();
     ajitter = new SrsRtspJitter();
     
@@ -206,7 +206,6 @@ SrsRtspConn::~SrsRtspConn()
     srs_freep(skt);
     srs_freep(rtsp);
     
-    srs_freep(sdk);
     srs_freep(req);
     
     srs_freep(vjitter);
@@ -637,13 +636,13 @@ srs_error_t SrsRtspConn::rtmp_write_packet(char type, uint32_t timestamp, char*
     
     SrsSharedPtrMessage* msg = NULL;
     
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, sdk->sid(), &msg)) != srs_success) {
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 0, &msg)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
     srs_assert(msg);
     
     // send out encoded msg.
-    if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+    if ((err = publisher->send_and_free_message(msg)) != srs_success) {
         close();
         return srs_error_wrap(err, "write message");
     }
@@ -656,7 +655,7 @@ srs_error_t SrsRtspConn::connect()
     srs_error_t err = srs_success;
     
     // Ignore when connected.
-    if (sdk) {
+    if (publisher) {
         return err;
     }
     
@@ -674,18 +673,11 @@ srs_error_t SrsRtspConn::connect()
         url = output;
     }
     
-    // connect host.
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(url, cto, sto);
+    // publish, in process when the url is served by this server.
+    std::string ip = srs_get_peer_ip(srs_netfd_fileno(stfd));
+    publisher = srs_create_live_publisher(url, ip);
     
-    if ((err = sdk->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    // publish.
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
+    if ((err = publisher->publish()) != srs_success) {
         close();
         return srs_error_wrap(err, "publish %s failed", url.c_str());
     }
@@ -695,7 +687,7 @@ srs_error_t SrsRtspConn::connect()
 
 void SrsRtspConn::close()
 {
-    srs_freep(sdk);
+    srs_freep(publisher);
 }
 
 SrsRtspCaster::SrsRtspCaster(SrsConfDirective* c)
@@ -33,7 +33,7 @@ class SrsSharedPtrMessage;
 class SrsAudioFrame;
 class SrsSimpleStream;
 class SrsPithyPrint;
-class SrsSimpleRtmpClient;
+class ISrsLivePublisher;
 class SrsResourceManager;
 
 // A rtp connection which transport a stream.
@@ -110,7 +110,7 @@ private:
     SrsCoroutine* trd;
 private:
     SrsRequest* req;
-    SrsSimpleRtmpClient* sdk;
+    ISrsLivePublisher* publisher;
     SrsRtspJitter* vjitter;
     SrsRtspJitter* ajitter;
 private:
@@ -151,9 +151,9 @@ private:
     virtual srs_error_t write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts);
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 private:
-    // Connect to RTMP server.
+    // Publish the stream to RTMP server.
     virtual srs_error_t connect();
-    // Close the connection to RTMP server.
+    // Unpublish the stream.
     virtual void close();
 };
 
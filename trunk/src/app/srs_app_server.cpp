@@ -37,6 +37,7 @@ using namespace std;
 #include <srs_app_coworkers.hpp>
 #include <srs_service_log.hpp>
 #include <srs_app_latest_version.hpp>
+#include <srs_app_workers.hpp>
 
 std::string srs_listener_type2string(SrsListenerType type)
 {
@@ -748,7 +749,17 @@ srs_error_t SrsServer::acquire_pid_file()
     if (_srs_config->is_dolphin()) {
         return srs_success;
     }
-    
+
+    // For workers, the pid file is acquired by master.
+    if (_srs_workers->is_worker()) {
+        return srs_success;
+    }
+
+    return srs_acquire_pid_file(&pid_fd);
+}
+
+srs_error_t srs_acquire_pid_file(int* pfd)
+{
     std::string pid_file = _srs_config->get_pid_file();
     
     // -rw-r--r--
@@ -800,7 +811,7 @@ srs_error_t SrsServer::acquire_pid_file()
     }
     
     srs_trace("write pid=%s to %s success!", pid.c_str(), pid_file.c_str());
-    pid_fd = fd;
+    *pfd = fd;
     
     return srs_success;
 }
@@ -900,6 +911,12 @@ srs_error_t SrsServer::http_handle()
     if ((err = http_api_mux->handle("/api/v1/raw", new SrsGoApiRaw(this))) != srs_success) {
         return srs_error_wrap(err, "handle raw");
     }
+    if ((err = http_api_mux->handle("/metrics", new SrsGoApiMetrics())) != srs_success) {
+        return srs_error_wrap(err, "handle metrics");
+    }
+    if ((err = http_api_mux->handle("/api/v1/latencies", new SrsGoApiLatencies())) != srs_success) {
+        return srs_error_wrap(err, "handle latencies");
+    }
     if ((err = http_api_mux->handle("/api/v1/clusters", new SrsGoApiClusters())) != srs_success) {
         return srs_error_wrap(err, "handle clusters");
     }
@@ -944,6 +961,11 @@ srs_error_t SrsServer::ingest()
 {
     srs_error_t err = srs_success;
     
+    // For workers, only the primary worker ingests, or the stream is published by each worker.
+    if (!_srs_workers->is_primary()) {
+        return err;
+    }
+
     if ((err = ingester->start()) != srs_success) {
         return srs_error_wrap(err, "ingest start");
     }
@@ -1181,7 +1203,7 @@ srs_error_t SrsServer::setup_ticks()
         }
     }
 
-    if (_srs_config->get_heartbeat_enabled()) {
+    if (_srs_config->get_heartbeat_enabled() && _srs_workers->is_primary()) {
         if ((err = timer_->tick(9, _srs_config->get_heartbeat_interval())) != srs_success) {
             return srs_error_wrap(err, "tick");
         }
@@ -1233,6 +1255,16 @@ srs_error_t SrsServer::listen_rtmp()
             srs_error_wrap(err, "rtmp listen %s:%d", ip.c_str(), port);
         }
     }
+
+    // For workers, listen at the private port to relay streams to other workers.
+    if (_srs_workers->is_worker()) {
+        SrsListener* listener = new SrsBufferListener(this, SrsListenerRtmpStream);
+        listeners.push_back(listener);
+
+        if ((err = listener->listen("127.0.0.1", _srs_workers->relay_port())) != srs_success) {
+            return srs_error_wrap(err, "rtmp relay listen 127.0.0.1:%d", _srs_workers->relay_port());
+        }
+    }
     
     return err;
 }
@@ -1334,6 +1366,11 @@ srs_error_t SrsServer::listen_stream_caster()
     srs_error_t err = srs_success;
     
     close_listeners(SrsListenerMpegTsOverUdp);
+
+    // For workers, only the primary worker listens the stream casters, which are not reuseport.
+    if (!_srs_workers->is_primary()) {
+        return err;
+    }
     
     std::vector<SrsConfDirective*>::iterator it;
     std::vector<SrsConfDirective*> stream_casters = _srs_config->get_stream_casters();
@@ -1393,19 +1430,9 @@ void SrsServer::resample_kbps()
 {
     SrsStatistic* stat = SrsStatistic::instance();
     
-    // collect delta from all clients.
-    for (int i = 0; i < (int)conn_manager->size(); i++) {
-        ISrsResource* c = conn_manager->at(i);
-        ISrsKbpsDelta* conn = dynamic_cast<ISrsKbpsDelta*>(conn_manager->at(i));
-        
-        // add delta of connection to server kbps.,
-        // for next sample() of server kbps can get the stat.
-        stat->kbps_add_delta(c->get_id().c_str(), conn);
-    }
-    
     // TODO: FXME: support all other connections.
     
-    // sample the kbps, get the stat.
+    // Collect delta from all clients and sample the kbps, get the stat.
     SrsKbps* kbps = stat->kbps_sample();
     
     srs_update_rtmp_server((int)conn_manager->size(), kbps);
@@ -1504,10 +1531,7 @@ srs_error_t SrsServer::fd_to_resource(SrsListenerType type, srs_netfd_t stfd, IS
 
 void SrsServer::remove(ISrsResource* c)
 {
-    ISrsStartableConneciton* conn = dynamic_cast<ISrsStartableConneciton*>(c);
-
     SrsStatistic* stat = SrsStatistic::instance();
-    stat->kbps_add_delta(c->get_id().c_str(), conn);
     stat->on_disconnect(c->get_id().c_str());
 
     // use manager to free it async.
@@ -1634,6 +1658,11 @@ srs_error_t SrsServer::on_publish(SrsLiveSource* s, SrsRequest* r)
 {
     srs_error_t err = srs_success;
     
+    // For workers, register the stream published by client, except the stream pulled by edge or relay.
+    if (!s->is_pulling() && (err = _srs_workers->on_publish(r)) != srs_success) {
+        return srs_error_wrap(err, "workers");
+    }
+    
     if ((err = http_server->http_mount(s, r)) != srs_success) {
         return srs_error_wrap(err, "http mount");
     }
@@ -1652,5 +1681,9 @@ void SrsServer::on_unpublish(SrsLiveSource* s, SrsRequest* r)
     
     SrsCoWorkers* coworkers = SrsCoWorkers::instance();
     coworkers->on_unpublish(s, r);
+
+    if (!s->is_pulling()) {
+        _srs_workers->on_unpublish(r);
+    }
 }
 
@@ -347,5 +347,8 @@ public:
     virtual void on_unpublish(SrsLiveSource* s, SrsRequest* r);
 };
 
+// Open and lock the pid file, write the pid of current process to it.
+extern srs_error_t srs_acquire_pid_file(int* pfd);
+
 #endif
 
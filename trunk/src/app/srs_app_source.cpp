@@ -16,6 +16,7 @@ using namespace std;
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_rtc_rtp.hpp>
 #include <srs_app_hls.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_app_forward.hpp>
 #include <srs_app_config.hpp>
 #include <srs_app_encoder.hpp>
@@ -34,11 +35,29 @@ using namespace std;
 #include <srs_app_dash.hpp>
 #include <srs_protocol_format.hpp>
 #include <srs_app_rtc_source.hpp>
+#include <srs_kernel_kbps.hpp>
 
 #define CONST_MAX_JITTER_MS         250
 #define CONST_MAX_JITTER_MS_NEG         -250
 #define DEFAULT_FRAME_TIME_MS         10
 
+// The histogram of the duration of messages in consumer queue, when sending to client.
+SrsHistogram* _srs_histogram_queue_delay = NULL;
+
+// The latency of each stage of media pipeline, from received to sent to player:
+//      recv: From the message received, to the source, for example, the recv thread and hooks.
+//      mux: The utilities of hub, such as HLS, DVR and forwarder.
+//      dispatch: Copy to all consumers.
+//      queue: Wait in the queue of consumer, until dumped by player.
+//      send: Mux and write to player, see SrsRtmpConn and SrsLiveStream.
+//      e2e: From the message received, to sent to player.
+SrsHistogram* _srs_histogram_stage_recv = NULL;
+SrsHistogram* _srs_histogram_stage_mux = NULL;
+SrsHistogram* _srs_histogram_stage_dispatch = NULL;
+SrsHistogram* _srs_histogram_stage_queue = NULL;
+SrsHistogram* _srs_histogram_stage_send = NULL;
+SrsHistogram* _srs_histogram_stage_e2e = NULL;
+
 // for 26ms per audio packet,
 // 115 packets is 3s.
 #define SRS_PURE_AUDIO_GUESS_COUNT 115
@@ -511,10 +530,26 @@ srs_error_t SrsLiveConsumer::dump_packets(SrsMessageArray* msgs, int& count)
         return err;
     }
     
+    // the delay of messages in queue.
+    if (queue->size() > 0) {
+        _srs_histogram_queue_delay->update(queue->duration());
+    }
+    
     // pump msgs from queue.
     if ((err = queue->dump_packets(max, msgs->msgs, count)) != srs_success) {
         return srs_error_wrap(err, "dump packets");
     }
+
+    // the wait of messages in queue, ignore the cached messages for new consumer.
+    if (count > 0) {
+        srs_utime_t now = srs_get_tick();
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs->msgs[i];
+            if (msg->queue_tick > 0) {
+                _srs_histogram_stage_queue->update(now - msg->queue_tick);
+            }
+        }
+    }
     
     return err;
 }
@@ -1104,6 +1139,12 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
 srs_error_t SrsOriginHub::on_publish()
 {
     srs_error_t err = srs_success;
+
+    // For relay of workers, the owner worker already does the hls, dvr and forward, so only deliver to players.
+    if (source->is_pulling() && !_srs_config->get_vhost_is_edge(req->vhost)) {
+        is_active = true;
+        return err;
+    }
     
     // create forwarders
     if ((err = create_forwarders()) != srs_success) {
@@ -1887,6 +1928,8 @@ srs_error_t SrsLiveSource::cycle()
         return srs_error_wrap(err, "hub cycle");
     }
     
+    play_edge->cycle();
+    
     return srs_success;
 }
 
@@ -2196,6 +2239,11 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
         }
     }
     
+    srs_utime_t starttime = srs_get_tick();
+    if (msg->recv_tick > 0) {
+        _srs_histogram_stage_recv->update(starttime - msg->recv_tick);
+    }
+    
     // Copy to hub to all utilities.
     if ((err = hub->on_audio(msg)) != srs_success) {
         return srs_error_wrap(err, "consume audio");
@@ -2208,12 +2256,19 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
 
     // copy to all consumer
     if (!drop_for_reduce) {
+        msg->queue_tick = srs_get_tick();
+        _srs_histogram_stage_mux->update(msg->queue_tick - starttime);
+
         for (int i = 0; i < (int)consumers.size(); i++) {
             SrsLiveConsumer* consumer = consumers.at(i);
             if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
                 return srs_error_wrap(err, "consume message");
             }
         }
+
+        // Reset it, so the cached messages for new consumer are not measured.
+        _srs_histogram_stage_dispatch->update(srs_get_tick() - msg->queue_tick);
+        msg->queue_tick = 0;
     }
     
     // cache the sequence header of aac, or first packet of mp3.
@@ -2326,6 +2381,11 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "meta update video");
     }
     
+    srs_utime_t starttime = srs_get_tick();
+    if (msg->recv_tick > 0) {
+        _srs_histogram_stage_recv->update(starttime - msg->recv_tick);
+    }
+    
     // Copy to hub to all utilities.
     if ((err = hub->on_video(msg, is_sequence_header)) != srs_success) {
         return srs_error_wrap(err, "hub consume video");
@@ -2338,12 +2398,19 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
 
     // copy to all consumer
     if (!drop_for_reduce) {
+        msg->queue_tick = srs_get_tick();
+        _srs_histogram_stage_mux->update(msg->queue_tick - starttime);
+
         for (int i = 0; i < (int)consumers.size(); i++) {
             SrsLiveConsumer* consumer = consumers.at(i);
             if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
                 return srs_error_wrap(err, "consume video");
             }
         }
+
+        // Reset it, so the cached messages for new consumer are not measured.
+        _srs_histogram_stage_dispatch->update(srs_get_tick() - msg->queue_tick);
+        msg->queue_tick = 0;
     }
     
     // when sequence header, donot push to gop cache and adjust the timestamp.
@@ -2369,6 +2436,52 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
     return err;
 }
 
+srs_error_t SrsLiveSource::on_frame(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // monotically increase detect.
+    if (!mix_correct && is_monotonically_increase) {
+        if (last_packet_time > 0 && msg->timestamp < last_packet_time) {
+            is_monotonically_increase = false;
+            srs_warn("%s: stream not monotonically increase, please open mix_correct.", msg->is_audio()? "AUDIO" : "VIDEO");
+        }
+    }
+    last_packet_time = msg->timestamp;
+    
+    // drop any unknown header video.
+    // @see https://github.com/ossrs/srs/issues/421
+    if (msg->is_video() && !SrsFlvVideo::acceptable(msg->payload, msg->size)) {
+        char b0 = msg->size > 0? msg->payload[0] : 0x00;
+        srs_warn("drop unknown header video, size=%d, bytes[0]=%#x", msg->size, b0);
+        return err;
+    }
+    
+    // directly process the message.
+    if (!mix_correct) {
+        return msg->is_audio()? on_audio_imp(msg) : on_video_imp(msg);
+    }
+    
+    // insert msg to the queue.
+    mix_queue->push(msg->copy());
+    
+    // fetch someone from mix queue.
+    SrsSharedPtrMessage* m = mix_queue->pop();
+    if (!m) {
+        return err;
+    }
+    
+    // consume the monotonically increase message.
+    if (m->is_audio()) {
+        err = on_audio_imp(m);
+    } else {
+        err = on_video_imp(m);
+    }
+    srs_freep(m);
+    
+    return err;
+}
+
 srs_error_t SrsLiveSource::on_aggregate(SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
@@ -2432,6 +2545,7 @@ srs_error_t SrsLiveSource::on_aggregate(SrsCommonMessage* msg)
         o.header.timestamp = timestamp;
         o.header.stream_id = stream_id;
         o.header.perfer_cid = msg->header.perfer_cid;
+        o.recv_tick = msg->recv_tick;
         
         if (data_size > 0) {
             o.size = data_size;
@@ -2559,8 +2673,9 @@ srs_error_t SrsLiveSource::create_consumer(SrsLiveConsumer*& consumer)
     consumer = new SrsLiveConsumer(this);
     consumers.push_back(consumer);
     
-    // for edge, when play edge stream, check the state
-    if (_srs_config->get_vhost_is_edge(req->vhost)) {
+    // for edge, when play edge stream, check the state,
+    // all consumers of the source share the same upstream.
+    if (should_pull()) {
         // notice edge to start for the first client.
         if ((err = play_edge->on_client_play()) != srs_success) {
             return srs_error_wrap(err, "play edge");
@@ -2570,6 +2685,16 @@ srs_error_t SrsLiveSource::create_consumer(SrsLiveConsumer*& consumer)
     return err;
 }
 
+bool SrsLiveSource::should_pull()
+{
+    if (_srs_config->get_vhost_is_edge(req->vhost)) {
+        return true;
+    }
+    
+    // For workers, relay the stream from the worker which owns it, by the play edge.
+    return !hub->active() && _srs_workers->owner_port(req) > 0;
+}
+
 srs_error_t SrsLiveSource::consumer_dumps(SrsLiveConsumer* consumer, bool ds, bool dm, bool dg)
 {
     srs_error_t err = srs_success;
@@ -2624,6 +2749,15 @@ void SrsLiveSource::on_consumer_destroy(SrsLiveConsumer* consumer)
     if (consumers.empty()) {
         play_edge->on_all_client_stop();
         die_at = srs_get_system_time();
+        
+        // The new consumers might come when stopping the pull, which is ignored by edge, so start it again.
+        if (!consumers.empty() && should_pull()) {
+            srs_error_t err = play_edge->on_client_play();
+            if (err != srs_success) {
+                srs_warn("ignore restart pull err %s", srs_error_desc(err).c_str());
+                srs_freep(err);
+            }
+        }
     }
 }
 
@@ -2658,3 +2792,8 @@ string SrsLiveSource::get_curr_origin()
     return play_edge->get_curr_origin();
 }
 
+bool SrsLiveSource::is_pulling()
+{
+    return play_edge->is_pulling();
+}
+
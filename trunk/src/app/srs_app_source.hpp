@@ -573,6 +573,10 @@ public:
     virtual srs_error_t on_video(SrsCommonMessage* video);
 private:
     virtual srs_error_t on_video_imp(SrsSharedPtrMessage* video);
+public:
+    // Consume the audio or video message from publisher in process, such as stream casters.
+    // @remark User should free the msg, the source copy it when need to cache it.
+    virtual srs_error_t on_frame(SrsSharedPtrMessage* msg);
 public:
     virtual srs_error_t on_aggregate(SrsCommonMessage* msg);
     // Publish stream event notify.
@@ -584,6 +588,10 @@ public:
     // Create consumer
     // @param consumer, output the create consumer.
     virtual srs_error_t create_consumer(SrsLiveConsumer*& consumer);
+private:
+    // Whether the consumer should pull stream from upstream, by the play edge.
+    virtual bool should_pull();
+public:
     // Dumps packets in cache to consumer.
     // @param ds, whether dumps the sequence header.
     // @param dm, whether dumps the metadata.
@@ -601,6 +609,8 @@ public:
     virtual void on_edge_proxy_unpublish();
 public:
     virtual std::string get_curr_origin();
+    // Whether the stream is pulled from upstream, by edge or relay of workers.
+    virtual bool is_pulling();
 };
 
 #endif
@@ -18,6 +18,7 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_app_metrics.hpp>
 
 string srs_generate_stat_vid()
 {
@@ -108,55 +109,51 @@ SrsStatisticStream::~SrsStatisticStream()
     srs_freep(clk);
 }
 
-srs_error_t SrsStatisticStream::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticStream::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("name", SrsJsonAny::str(stream.c_str()));
-    obj->set("vhost", SrsJsonAny::str(vhost->id.c_str()));
-    obj->set("app", SrsJsonAny::str(app.c_str()));
-    obj->set("live_ms", SrsJsonAny::integer(srsu2ms(srs_get_system_time())));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("frames", SrsJsonAny::integer(nb_frames));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-    
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
-    
-    SrsJsonObject* publish = SrsJsonAny::object();
-    obj->set("publish", publish);
-    
-    publish->set("active", SrsJsonAny::boolean(active));
-    publish->set("cid", SrsJsonAny::str(publisher_id.c_str()));
+    w->str("id", id);
+    w->str("name", stream);
+    w->str("vhost", vhost->id);
+    w->str("app", app);
+    w->integer("live_ms", srsu2ms(srs_get_system_time()));
+    w->integer("clients", nb_clients);
+    w->integer("frames", nb_frames);
+    w->integer("send_bytes", kbps->get_send_bytes());
+    w->integer("recv_bytes", kbps->get_recv_bytes());
+    
+    w->object_start("kbps");
+    w->integer("recv_30s", kbps->get_recv_kbps_30s());
+    w->integer("send_30s", kbps->get_send_kbps_30s());
+    w->object_end();
+    
+    w->object_start("publish");
+    w->boolean("active", active);
+    w->str("cid", publisher_id);
+    w->object_end();
     
     if (!has_video) {
-        obj->set("video", SrsJsonAny::null());
+        w->null("video");
     } else {
-        SrsJsonObject* video = SrsJsonAny::object();
-        obj->set("video", video);
-        
-        video->set("codec", SrsJsonAny::str(srs_video_codec_id2str(vcodec).c_str()));
-        video->set("profile", SrsJsonAny::str(srs_avc_profile2str(avc_profile).c_str()));
-        video->set("level", SrsJsonAny::str(srs_avc_level2str(avc_level).c_str()));
-        video->set("width", SrsJsonAny::integer(width));
-        video->set("height", SrsJsonAny::integer(height));
+        w->object_start("video");
+        w->str("codec", srs_video_codec_id2str(vcodec));
+        w->str("profile", srs_avc_profile2str(avc_profile));
+        w->str("level", srs_avc_level2str(avc_level));
+        w->integer("width", width);
+        w->integer("height", height);
+        w->object_end();
     }
     
     if (!has_audio) {
-        obj->set("audio", SrsJsonAny::null());
+        w->null("audio");
     } else {
-        SrsJsonObject* audio = SrsJsonAny::object();
-        obj->set("audio", audio);
-        
-        audio->set("codec", SrsJsonAny::str(srs_audio_codec_id2str(acodec).c_str()));
-        audio->set("sample_rate", SrsJsonAny::integer(srs_flv_srates[asample_rate]));
-        audio->set("channel", SrsJsonAny::integer(asound_type + 1));
-        audio->set("profile", SrsJsonAny::str(srs_aac_object2str(aac_object).c_str()));
+        w->object_start("audio");
+        w->str("codec", srs_audio_codec_id2str(acodec));
+        w->integer("sample_rate", srs_flv_srates[asample_rate]);
+        w->integer("channel", asound_type + 1);
+        w->str("profile", srs_aac_object2str(aac_object));
+        w->object_end();
     }
     
     return err;
@@ -183,6 +180,7 @@ SrsStatisticClient::SrsStatisticClient()
 {
     stream = NULL;
     conn = NULL;
+    delta = NULL;
     req = NULL;
     type = SrsRtmpConnUnknown;
     create = srs_get_system_time();
@@ -193,21 +191,21 @@ SrsStatisticClient::~SrsStatisticClient()
 	srs_freep(req);
 }
 
-srs_error_t SrsStatisticClient::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticClient::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("vhost", SrsJsonAny::str(stream->vhost->id.c_str()));
-    obj->set("stream", SrsJsonAny::str(stream->id.c_str()));
-    obj->set("ip", SrsJsonAny::str(req->ip.c_str()));
-    obj->set("pageUrl", SrsJsonAny::str(req->pageUrl.c_str()));
-    obj->set("swfUrl", SrsJsonAny::str(req->swfUrl.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(req->tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(req->get_stream_url().c_str()));
-    obj->set("type", SrsJsonAny::str(srs_client_type_string(type).c_str()));
-    obj->set("publish", SrsJsonAny::boolean(srs_client_type_is_publish(type)));
-    obj->set("alive", SrsJsonAny::number(srsu2ms(srs_get_system_time() - create) / 1000.0));
+    w->str("id", id);
+    w->str("vhost", stream->vhost->id);
+    w->str("stream", stream->id);
+    w->str("ip", req->ip);
+    w->str("pageUrl", req->pageUrl);
+    w->str("swfUrl", req->swfUrl);
+    w->str("tcUrl", req->tcUrl);
+    w->str("url", req->get_stream_url());
+    w->str("type", srs_client_type_string(type));
+    w->boolean("publish", srs_client_type_is_publish(type));
+    w->number("alive", srsu2ms(srs_get_system_time() - create) / 1000.0);
     
     return err;
 }
@@ -304,6 +302,12 @@ SrsStatisticClient* SrsStatistic::find_client(string client_id)
     return NULL;
 }
 
+SrsStatisticStream* SrsStatistic::fetch_stream(SrsRequest* req)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    return create_stream(vhost, req);
+}
+
 srs_error_t SrsStatistic::on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, SrsAvcProfile avc_profile, SrsAvcLevel avc_level, int width, int height)
 {
     srs_error_t err = srs_success;
@@ -338,13 +342,10 @@ srs_error_t SrsStatistic::on_audio_info(SrsRequest* req, SrsAudioCodecId acodec,
     return err;
 }
 
-srs_error_t SrsStatistic::on_video_frames(SrsRequest* req, int nb_frames)
+srs_error_t SrsStatistic::on_video_frames(SrsStatisticStream* stream, int nb_frames)
 {
     srs_error_t err = srs_success;
     
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
-    
     stream->nb_frames += nb_frames;
     
     return err;
@@ -401,6 +402,7 @@ srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire*
     
     // got client.
     client->conn = conn;
+    client->delta = dynamic_cast<ISrsKbpsDelta*>(conn);
     client->type = type;
     stream->nb_clients++;
     vhost->nb_clients++;
@@ -423,6 +425,9 @@ void SrsStatistic::on_disconnect(std::string id)
     SrsStatisticClient* client = it->second;
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
+
+    // Collect the bytes since last sample, for the conn is going to be freed.
+    kbps_add_delta(client);
     
     srs_freep(client);
     clients.erase(it);
@@ -431,17 +436,15 @@ void SrsStatistic::on_disconnect(std::string id)
     vhost->nb_clients--;
 }
 
-void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
+void SrsStatistic::kbps_add_delta(SrsStatisticClient* client)
 {
-    if (clients.find(id) == clients.end()) {
+    if (!client->delta) {
         return;
     }
     
-    SrsStatisticClient* client = clients[id];
-    
     // resample the kbps to collect the delta.
     int64_t in, out;
-    delta->remark(&in, &out);
+    client->delta->remark(&in, &out);
     
     // add delta of connection to kbps.
     // for next sample() of server kbps can get the stat.
@@ -452,6 +455,14 @@ void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
 
 SrsKbps* SrsStatistic::kbps_sample()
 {
+    // Collect delta from all clients, by the pinned conn and stream.
+    if (true) {
+        std::map<std::string, SrsStatisticClient*>::iterator it;
+        for (it = clients.begin(); it != clients.end(); it++) {
+            kbps_add_delta(it->second);
+        }
+    }
+
     kbps->sample();
     if (true) {
         std::map<std::string, SrsStatisticVhost*>::iterator it;
@@ -495,43 +506,124 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr)
+srs_error_t SrsStatistic::dumps_streams(SrsJsonWriter* w, int start, int count, string& cursor, int& nn)
 {
     srs_error_t err = srs_success;
     
     std::map<std::string, SrsStatisticStream*>::iterator it;
-    for (it = streams.begin(); it != streams.end(); it++) {
+    if (cursor.empty()) {
+        it = streams.begin();
+        for (int i = 0; i < start && it != streams.end(); i++) {
+            it++;
+        }
+    } else {
+        it = streams.upper_bound(cursor);
+    }
+    
+    for (nn = 0; nn < count && it != streams.end(); it++, nn++) {
         SrsStatisticStream* stream = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = stream->dumps(obj)) != srs_success) {
+        w->object_start();
+        if ((err = stream->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump stream");
         }
+        w->object_end();
+        cursor = it->first;
     }
     
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
+void SrsStatistic::dumps_metrics(SrsMetricsWriter* w)
+{
+    w->family("srs_send_bytes_total", "counter", "The bytes sent by server.");
+    w->sample("srs_send_bytes_total", NULL, kbps->get_send_bytes());
+    w->family("srs_recv_bytes_total", "counter", "The bytes received by server.");
+    w->sample("srs_recv_bytes_total", NULL, kbps->get_recv_bytes());
+    w->family("srs_clients", "gauge", "The number of clients.");
+    w->sample("srs_clients", NULL, (int64_t)clients.size());
+    w->family("srs_streams", "gauge", "The number of streams.");
+    w->sample("srs_streams", NULL, (int64_t)streams.size());
+
+    // Format the labels once, for each family to use it.
+    std::vector<std::string> vlabels;
+    std::map<std::string, SrsStatisticVhost*>::iterator vit;
+    for (vit = vhosts.begin(); vit != vhosts.end(); vit++) {
+        SrsStatisticVhost* vhost = vit->second;
+        vlabels.push_back("vhost=\"" + SrsMetricsWriter::escape(vhost->vhost) + "\"");
+    }
+
+    std::vector<std::string> slabels;
+    std::map<std::string, SrsStatisticStream*>::iterator sit;
+    for (sit = streams.begin(); sit != streams.end(); sit++) {
+        SrsStatisticStream* stream = sit->second;
+        slabels.push_back("vhost=\"" + SrsMetricsWriter::escape(stream->vhost->vhost) + "\",app=\""
+            + SrsMetricsWriter::escape(stream->app) + "\",stream=\"" + SrsMetricsWriter::escape(stream->stream) + "\"");
+    }
+
+    int i;
+    w->family("srs_vhost_streams", "gauge", "The number of streams of vhost.");
+    for (i = 0, vit = vhosts.begin(); vit != vhosts.end(); vit++, i++) {
+        w->sample("srs_vhost_streams", vlabels[i].c_str(), (int64_t)vit->second->nb_streams);
+    }
+    w->family("srs_vhost_clients", "gauge", "The number of clients of vhost.");
+    for (i = 0, vit = vhosts.begin(); vit != vhosts.end(); vit++, i++) {
+        w->sample("srs_vhost_clients", vlabels[i].c_str(), (int64_t)vit->second->nb_clients);
+    }
+    w->family("srs_vhost_send_bytes_total", "counter", "The bytes sent by vhost.");
+    for (i = 0, vit = vhosts.begin(); vit != vhosts.end(); vit++, i++) {
+        w->sample("srs_vhost_send_bytes_total", vlabels[i].c_str(), vit->second->kbps->get_send_bytes());
+    }
+    w->family("srs_vhost_recv_bytes_total", "counter", "The bytes received by vhost.");
+    for (i = 0, vit = vhosts.begin(); vit != vhosts.end(); vit++, i++) {
+        w->sample("srs_vhost_recv_bytes_total", vlabels[i].c_str(), vit->second->kbps->get_recv_bytes());
+    }
+
+    w->family("srs_stream_active", "gauge", "Whether the stream is publishing.");
+    for (i = 0, sit = streams.begin(); sit != streams.end(); sit++, i++) {
+        w->sample("srs_stream_active", slabels[i].c_str(), (int64_t)sit->second->active);
+    }
+    w->family("srs_stream_clients", "gauge", "The number of clients of stream.");
+    for (i = 0, sit = streams.begin(); sit != streams.end(); sit++, i++) {
+        w->sample("srs_stream_clients", slabels[i].c_str(), (int64_t)sit->second->nb_clients);
+    }
+    w->family("srs_stream_frames_total", "counter", "The number of video frames of stream.");
+    for (i = 0, sit = streams.begin(); sit != streams.end(); sit++, i++) {
+        w->sample("srs_stream_frames_total", slabels[i].c_str(), (int64_t)sit->second->nb_frames);
+    }
+    w->family("srs_stream_send_bytes_total", "counter", "The bytes sent by stream.");
+    for (i = 0, sit = streams.begin(); sit != streams.end(); sit++, i++) {
+        w->sample("srs_stream_send_bytes_total", slabels[i].c_str(), sit->second->kbps->get_send_bytes());
+    }
+    w->family("srs_stream_recv_bytes_total", "counter", "The bytes received by stream.");
+    for (i = 0, sit = streams.begin(); sit != streams.end(); sit++, i++) {
+        w->sample("srs_stream_recv_bytes_total", slabels[i].c_str(), sit->second->kbps->get_recv_bytes());
+    }
+}
+
+srs_error_t SrsStatistic::dumps_clients(SrsJsonWriter* w, int start, int count, string& cursor, int& nn)
 {
     srs_error_t err = srs_success;
     
-    std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin();
-    for (int i = 0; i < start + count && it != clients.end(); it++, i++) {
-        if (i < start) {
-            continue;
+    std::map<std::string, SrsStatisticClient*>::iterator it;
+    if (cursor.empty()) {
+        it = clients.begin();
+        for (int i = 0; i < start && it != clients.end(); i++) {
+            it++;
         }
-        
+    } else {
+        it = clients.upper_bound(cursor);
+    }
+    
+    for (nn = 0; nn < count && it != clients.end(); it++, nn++) {
         SrsStatisticClient* client = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = client->dumps(obj)) != srs_success) {
+        w->object_start();
+        if ((err = client->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump client");
         }
+        w->object_end();
+        cursor = it->first;
     }
     
     return err;
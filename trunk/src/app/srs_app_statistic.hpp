@@ -23,6 +23,8 @@ class ISrsExpire;
 class SrsJsonObject;
 class SrsJsonArray;
 class ISrsKbpsDelta;
+class SrsMetricsWriter;
+class SrsJsonWriter;
 
 struct SrsStatisticVhost
 {
@@ -83,7 +85,7 @@ public:
     SrsStatisticStream();
     virtual ~SrsStatisticStream();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 public:
     // Publish the stream, id is the publisher.
     virtual void publish(std::string id);
@@ -95,6 +97,8 @@ struct SrsStatisticClient
 {
 public:
     ISrsExpire* conn;
+    // The bytes of connection, pinned to sample the kbps without lookup by id.
+    ISrsKbpsDelta* delta;
     SrsStatisticStream* stream;
     SrsRequest* req;
     SrsRtmpConnType type;
@@ -104,7 +108,7 @@ public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 };
 
 class SrsStatistic
@@ -141,6 +145,9 @@ public:
     virtual SrsStatisticVhost* find_vhost_by_name(std::string name);
     virtual SrsStatisticStream* find_stream(std::string sid);
     virtual SrsStatisticClient* find_client(std::string client_id);
+    // Fetch or create the stream of req, for user to pin it to update without lookup.
+    // @remark The stream is never freed before stat, even it's closed.
+    virtual SrsStatisticStream* fetch_stream(SrsRequest* req);
 public:
     // When got video info for stream.
     virtual srs_error_t on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, SrsAvcProfile avc_profile,
@@ -148,9 +155,9 @@ public:
     // When got audio info for stream.
     virtual srs_error_t on_audio_info(SrsRequest* req, SrsAudioCodecId acodec, SrsAudioSampleRate asample_rate,
         SrsAudioChannels asound_type, SrsAacObjectType aac_object);
-    // When got videos, update the frames.
+    // When got videos, update the frames of the pinned stream.
     // We only stat the total number of video frames.
-    virtual srs_error_t on_video_frames(SrsRequest* req, int nb_frames);
+    virtual srs_error_t on_video_frames(SrsStatisticStream* stream, int nb_frames);
     // When publish stream.
     // @param req the request object of publish connection.
     // @param publisher_id The id of publish connection.
@@ -164,29 +171,34 @@ public:
     // @param conn, the physical absract connection object.
     // @param type, the type of connection.
     virtual srs_error_t on_client(std::string id, SrsRequest* req, ISrsExpire* conn, SrsRtmpConnType type);
-    // Client disconnect
+    // Client disconnect, collect the last delta bytes of client.
     // @remark the on_disconnect always call, while the on_client is call when
     //      only got the request object, so the client specified by id maybe not
     //      exists in stat.
     virtual void on_disconnect(std::string id);
-    // Sample the kbps, add delta bytes of conn.
-    // Use kbps_sample() to get all result of kbps stat.
-    virtual void kbps_add_delta(std::string id, ISrsKbpsDelta* delta);
-    // Calc the result for all kbps.
+    // Collect the delta bytes of all clients, then calc the result for all kbps.
     // @return the server kbps.
     virtual SrsKbps* kbps_sample();
+private:
+    // Add delta bytes of client to its stream, vhost and server.
+    virtual void kbps_add_delta(SrsStatisticClient* client);
 public:
     // Get the server id, used to identify the server.
     // For example, when restart, the server id must changed.
     virtual std::string server_id();
     // Dumps the vhosts to amf0 array.
     virtual srs_error_t dumps_vhosts(SrsJsonArray* arr);
-    // Dumps the streams to amf0 array.
-    virtual srs_error_t dumps_streams(SrsJsonArray* arr);
-    // Dumps the clients to amf0 array
-    // @param start the start index, from 0.
-    // @param count the max count of clients to dump.
-    virtual srs_error_t dumps_clients(SrsJsonArray* arr, int start, int count);
+    // Dumps the streams to json writer, in pages.
+    // @param start the start index, from 0, ignored if cursor is not empty.
+    // @param count the max count of streams to dump.
+    // @param cursor Input the id of last dumped stream to continue, or empty to dumps from start.
+    //      Output the id of last dumped stream, to continue when streams changed.
+    // @param nn Output the number of dumped streams.
+    virtual srs_error_t dumps_streams(SrsJsonWriter* w, int start, int count, std::string& cursor, int& nn);
+    // Dumps the clients to json writer, in pages, see dumps_streams.
+    virtual srs_error_t dumps_clients(SrsJsonWriter* w, int start, int count, std::string& cursor, int& nn);
+    // Dumps the server, vhosts and streams to metrics.
+    virtual void dumps_metrics(SrsMetricsWriter* w);
 private:
     virtual SrsStatisticVhost* create_vhost(SrsRequest* req);
     virtual SrsStatisticStream* create_stream(SrsStatisticVhost* vhost, SrsRequest* req);
@@ -8,6 +8,7 @@
 
 #include <srs_app_config.hpp>
 #include <srs_app_hybrid.hpp>
+#include <srs_app_workers.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtc_source.hpp>
@@ -21,9 +22,15 @@
 #include <srs_app_rtc_conn.hpp>
 #endif
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <string>
 using namespace std;
 
+#include <openssl/opensslconf.h>
+
+#include <srs_rtmp_handshake.hpp>
+
 extern ISrsLog* _srs_log;
 extern ISrsContext* _srs_context;
 extern SrsConfig* _srs_config;
@@ -53,6 +60,9 @@ extern SrsPps* _srs_pps_dispose;
 
 extern SrsPps* _srs_pps_timer;
 
+extern SrsPps* _srs_pps_alogs;
+extern SrsPps* _srs_pps_alogs_drop;
+
 extern SrsPps* _srs_pps_snack;
 extern SrsPps* _srs_pps_snack2;
 extern SrsPps* _srs_pps_snack3;
@@ -132,6 +142,12 @@ extern SrsPps* _srs_pps_rr;
 extern SrsPps* _srs_pps_pub;
 extern SrsPps* _srs_pps_conn;
 
+extern SrsPps* _srs_pps_tls_handshakes;
+extern SrsPps* _srs_pps_tls_resumed;
+#ifdef SRS_RTC
+extern SrsPps* _srs_pps_dtls_handshakes;
+#endif
+
 extern SrsPps* _srs_pps_rstuns;
 extern SrsPps* _srs_pps_rrtps;
 extern SrsPps* _srs_pps_rrtcps;
@@ -149,6 +165,23 @@ extern SrsPps* _srs_pps_objs_rfua;
 extern SrsPps* _srs_pps_objs_rbuf;
 extern SrsPps* _srs_pps_objs_rothers;
 
+extern SrsHistogram* _srs_histogram_queue_delay;
+extern SrsHistogram* _srs_histogram_hooks;
+
+SrsPps* _srs_pps_crypto = NULL;
+SrsHistogram* _srs_histogram_crypto = NULL;
+extern SrsHistogram* _srs_histogram_segment;
+
+extern SrsHistogram* _srs_histogram_stage_recv;
+extern SrsHistogram* _srs_histogram_stage_mux;
+extern SrsHistogram* _srs_histogram_stage_dispatch;
+extern SrsHistogram* _srs_histogram_stage_queue;
+extern SrsHistogram* _srs_histogram_stage_send;
+extern SrsHistogram* _srs_histogram_stage_e2e;
+#ifdef SRS_RTC
+extern SrsHistogram* _srs_histogram_rtc_e2e;
+#endif
+
 SrsCircuitBreaker::SrsCircuitBreaker()
 {
     enabled_ = false;
@@ -269,6 +302,355 @@ srs_error_t SrsCircuitBreaker::on_timer(srs_utime_t interval)
 
 SrsCircuitBreaker* _srs_circuit_breaker = NULL;
 
+ISrsCryptoTask::ISrsCryptoTask()
+{
+}
+
+ISrsCryptoTask::~ISrsCryptoTask()
+{
+}
+
+// The job of crypto task, to park the coroutine until the task is done.
+class SrsCryptoJob
+{
+public:
+    ISrsCryptoTask* task;
+    // Whether nobody waits for the job, so it's freed when done.
+    bool async;
+    // Only accessed by ST thread.
+    srs_cond_t cond;
+    bool done;
+public:
+    SrsCryptoJob(ISrsCryptoTask* t, bool a) {
+        task = t;
+        async = a;
+        cond = srs_cond_new();
+        done = false;
+    }
+    virtual ~SrsCryptoJob() {
+        srs_cond_destroy(cond);
+    }
+};
+
+SrsCryptoWorkers::SrsCryptoWorkers()
+{
+    started_ = false;
+    quit_ = false;
+
+    pipe_[0] = pipe_[1] = -1;
+    rfd_ = NULL;
+    trd_ = new SrsSTCoroutine("crypto", this);
+
+    pthread_mutex_init(&lock_, NULL);
+    pthread_cond_init(&cond_, NULL);
+}
+
+SrsCryptoWorkers::~SrsCryptoWorkers()
+{
+    stop();
+    srs_freep(trd_);
+
+    srs_close_stfd(rfd_);
+    if (pipe_[0] > 0) {
+        ::close(pipe_[0]);
+    }
+    if (pipe_[1] > 0) {
+        ::close(pipe_[1]);
+    }
+
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&lock_);
+}
+
+srs_error_t SrsCryptoWorkers::execute(ISrsCryptoTask* task)
+{
+    srs_error_t err = srs_success;
+
+    if (!_srs_config->get_crypto_workers_enabled()) {
+        task->run();
+        return err;
+    }
+
+    if ((err = start()) != srs_success) {
+        return srs_error_wrap(err, "start");
+    }
+
+    // Fallback to run in ST thread, if no thread is started.
+    if (threads_.empty()) {
+        task->run();
+        return err;
+    }
+
+    SrsCryptoJob job(task, false);
+    srs_utime_t starttime = srs_get_tick();
+
+    pthread_mutex_lock(&lock_);
+    jobs_.push_back(&job);
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&lock_);
+
+    // Never return before the job is done even if interrupted, because the job is used by thread.
+    while (!job.done) {
+        srs_cond_wait(job.cond);
+    }
+
+    ++_srs_pps_crypto->sugar;
+    _srs_histogram_crypto->update(srs_get_tick() - starttime);
+
+    return err;
+}
+
+srs_error_t SrsCryptoWorkers::post(ISrsCryptoTask* task)
+{
+    srs_error_t err = srs_success;
+
+    if (_srs_config->get_crypto_workers_enabled() && (err = start()) != srs_success) {
+        srs_freep(task);
+        return srs_error_wrap(err, "start");
+    }
+
+    // Fallback to run in ST thread, if disabled or no thread is started.
+    if (!_srs_config->get_crypto_workers_enabled() || threads_.empty()) {
+        task->run();
+        srs_freep(task);
+        return err;
+    }
+
+    pthread_mutex_lock(&lock_);
+    jobs_.push_back(new SrsCryptoJob(task, true));
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&lock_);
+
+    return err;
+}
+
+void SrsCryptoWorkers::stop()
+{
+    if (threads_.empty()) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock_);
+    quit_ = true;
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&lock_);
+
+    for (int i = 0; i < (int)threads_.size(); i++) {
+        pthread_join(threads_[i], NULL);
+    }
+    threads_.clear();
+
+    trd_->stop();
+}
+
+srs_error_t SrsCryptoWorkers::start()
+{
+    srs_error_t err = srs_success;
+
+    if (started_) {
+        return err;
+    }
+    started_ = true;
+
+    if (pipe(pipe_) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "create pipe");
+    }
+
+    // Never block the thread, the ST thread has been notified if pipe is full.
+    int flags = fcntl(pipe_[1], F_GETFL, 0);
+    fcntl(pipe_[1], F_SETFL, flags | O_NONBLOCK);
+
+    if ((rfd_ = srs_netfd_open(pipe_[0])) == NULL) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "open pipe");
+    }
+
+    if ((err = trd_->start()) != srs_success) {
+        return srs_error_wrap(err, "start coroutine");
+    }
+
+#ifndef OPENSSL_THREADS
+    // The openssl built without threads is not thread-safe, so run the task in ST thread.
+    srs_warn("Crypto: no thread for openssl without threads support");
+#else
+    int nn = _srs_config->get_crypto_workers_threads();
+    for (int i = 0; i < nn; i++) {
+        pthread_t trd;
+        int r0 = pthread_create(&trd, NULL, SrsCryptoWorkers::pfn, this);
+        if (r0 != 0) {
+            return srs_error_new(ERROR_THREAD_CREATE, "create crypto thread, r0=%d", r0);
+        }
+        threads_.push_back(trd);
+    }
+
+    srs_trace("Crypto: start %d threads", nn);
+#endif
+
+    return err;
+}
+
+bool SrsCryptoWorkers::threaded()
+{
+    return !threads_.empty();
+}
+
+void* SrsCryptoWorkers::pfn(void* arg)
+{
+    SrsCryptoWorkers* workers = (SrsCryptoWorkers*)arg;
+    workers->work();
+    return NULL;
+}
+
+void SrsCryptoWorkers::work()
+{
+    while (true) {
+        pthread_mutex_lock(&lock_);
+        while (!quit_ && jobs_.empty()) {
+            pthread_cond_wait(&cond_, &lock_);
+        }
+        // Quit util all jobs are done, because the coroutines are parked.
+        if (jobs_.empty()) {
+            pthread_mutex_unlock(&lock_);
+            break;
+        }
+        SrsCryptoJob* job = jobs_.front();
+        jobs_.pop_front();
+        pthread_mutex_unlock(&lock_);
+
+        job->task->run();
+
+        pthread_mutex_lock(&lock_);
+        done_.push_back(job);
+        pthread_mutex_unlock(&lock_);
+
+        // Notify the ST thread, ignore the error because it has been notified if pipe is full.
+        char c = 0;
+        ssize_t r0 = ::write(pipe_[1], &c, 1);
+        (void)r0;
+    }
+}
+
+srs_error_t SrsCryptoWorkers::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
+        }
+
+        char buf[64];
+        ssize_t nn = srs_read(rfd_, buf, sizeof(buf), SRS_UTIME_NO_TIMEOUT);
+        if (nn <= 0 && errno != EINTR) {
+            return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "read pipe, nn=%d", (int)nn);
+        }
+
+        std::vector<SrsCryptoJob*> jobs;
+        pthread_mutex_lock(&lock_);
+        jobs.swap(done_);
+        pthread_mutex_unlock(&lock_);
+
+        // Wakeup the parked coroutines, or free the async jobs.
+        for (int i = 0; i < (int)jobs.size(); i++) {
+            SrsCryptoJob* job = jobs[i];
+            if (job->async) {
+                srs_freep(job->task);
+                srs_freep(job);
+                continue;
+            }
+
+            job->done = true;
+            srs_cond_signal(job->cond);
+        }
+    }
+
+    return err;
+}
+
+SrsCryptoWorkers* _srs_crypto_workers = NULL;
+
+// The number of DH keys in pool.
+#define SRS_DH_POOL_SIZE 256
+
+// The task to refill the DH pool, by crypto workers.
+class SrsDHRefillTask : public ISrsCryptoTask
+{
+private:
+    SrsDHPoolRefiller* refiller_;
+public:
+    SrsDHRefillTask(SrsDHPoolRefiller* refiller) {
+        refiller_ = refiller;
+    }
+    // Freed in ST thread when done.
+    virtual ~SrsDHRefillTask() {
+        refiller_->on_refilled();
+    }
+public:
+    virtual void run() {
+        srs_internal::_srs_dh_pool->refill();
+    }
+};
+
+SrsDHPoolRefiller::SrsDHPoolRefiller()
+{
+    refilling_ = false;
+}
+
+SrsDHPoolRefiller::~SrsDHPoolRefiller()
+{
+}
+
+srs_error_t SrsDHPoolRefiller::initialize()
+{
+    srs_error_t err = srs_success;
+
+    // Generate the DH key for each handshake, if no crypto workers.
+    if (!_srs_config->get_crypto_workers_enabled()) {
+        return err;
+    }
+
+    // Never refill in ST thread, which generates all keys at once and stalls the event loop.
+    if ((err = _srs_crypto_workers->start()) != srs_success) {
+        return srs_error_wrap(err, "start crypto workers");
+    }
+    if (!_srs_crypto_workers->threaded()) {
+        srs_warn("DH: No crypto threads, generate DH key for each handshake");
+        return err;
+    }
+
+    if (!srs_internal::_srs_dh_pool) {
+        srs_internal::_srs_dh_pool = new srs_internal::SrsDHPool(SRS_DH_POOL_SIZE);
+    }
+
+    _srs_hybrid->timer100ms()->subscribe(this);
+    srs_trace("DH: Refill pool of %d keys by crypto workers", SRS_DH_POOL_SIZE);
+
+    return err;
+}
+
+void SrsDHPoolRefiller::on_refilled()
+{
+    refilling_ = false;
+}
+
+srs_error_t SrsDHPoolRefiller::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    srs_internal::SrsDHPool* pool = srs_internal::_srs_dh_pool;
+    if (refilling_ || pool->size() >= pool->capacity()) {
+        return err;
+    }
+
+    refilling_ = true;
+    if ((err = _srs_crypto_workers->post(new SrsDHRefillTask(this))) != srs_success) {
+        return srs_error_wrap(err, "refill dh");
+    }
+
+    return err;
+}
+
+SrsDHPoolRefiller* _srs_dh_refiller = NULL;
+
 srs_error_t srs_thread_initialize()
 {
     srs_error_t err = srs_success;
@@ -282,8 +664,8 @@ srs_error_t srs_thread_initialize()
     _srs_clock = new SrsWallClock();
 
     // The pps cids depends by st init.
-    _srs_pps_cids_get = new SrsPps();
-    _srs_pps_cids_set = new SrsPps();
+    _srs_pps_cids_get = new SrsPps("cids_get");
+    _srs_pps_cids_set = new SrsPps("cids_set");
 
     // Initialize ST, which depends on pps cids.
     if ((err = srs_st_init()) != srs_success) {
@@ -295,6 +677,9 @@ srs_error_t srs_thread_initialize()
     _srs_sources = new SrsLiveSourceManager();
     _srs_stages = new SrsStageManager();
     _srs_circuit_breaker = new SrsCircuitBreaker();
+    _srs_workers = new SrsWorkers();
+    _srs_crypto_workers = new SrsCryptoWorkers();
+    _srs_dh_refiller = new SrsDHPoolRefiller();
 
 #ifdef SRS_RTC
     _srs_rtc_sources = new SrsRtcSourceManager();
@@ -305,107 +690,134 @@ srs_error_t srs_thread_initialize()
 #endif
 
     // Initialize global pps, which depends on _srs_clock
-    _srs_pps_ids = new SrsPps();
-    _srs_pps_fids = new SrsPps();
-    _srs_pps_fids_level0 = new SrsPps();
-    _srs_pps_dispose = new SrsPps();
+    _srs_pps_ids = new SrsPps("ids");
+    _srs_pps_fids = new SrsPps("fids");
+    _srs_pps_fids_level0 = new SrsPps("fids_level0");
+    _srs_pps_dispose = new SrsPps("dispose");
+
+    _srs_pps_timer = new SrsPps("timer");
+    _srs_pps_conn = new SrsPps("conn");
+    _srs_pps_pub = new SrsPps("pub");
+
+    _srs_pps_tls_handshakes = new SrsPps("tls_handshakes");
+    _srs_pps_tls_resumed = new SrsPps("tls_resumed");
+    _srs_pps_crypto = new SrsPps("crypto_tasks");
+#ifdef SRS_RTC
+    _srs_pps_dtls_handshakes = new SrsPps("dtls_handshakes");
+#endif
 
-    _srs_pps_timer = new SrsPps();
-    _srs_pps_conn = new SrsPps();
-    _srs_pps_pub = new SrsPps();
+    _srs_pps_alogs = new SrsPps("alogs");
+    _srs_pps_alogs_drop = new SrsPps("alogs_drop");
 
 #ifdef SRS_RTC
-    _srs_pps_snack = new SrsPps();
-    _srs_pps_snack2 = new SrsPps();
-    _srs_pps_snack3 = new SrsPps();
-    _srs_pps_snack4 = new SrsPps();
-    _srs_pps_sanack = new SrsPps();
-    _srs_pps_svnack = new SrsPps();
-
-    _srs_pps_rnack = new SrsPps();
-    _srs_pps_rnack2 = new SrsPps();
-    _srs_pps_rhnack = new SrsPps();
-    _srs_pps_rmnack = new SrsPps();
+    _srs_pps_snack = new SrsPps("snack");
+    _srs_pps_snack2 = new SrsPps("snack2");
+    _srs_pps_snack3 = new SrsPps("snack3");
+    _srs_pps_snack4 = new SrsPps("snack4");
+    _srs_pps_sanack = new SrsPps("sanack");
+    _srs_pps_svnack = new SrsPps("svnack");
+
+    _srs_pps_rnack = new SrsPps("rnack");
+    _srs_pps_rnack2 = new SrsPps("rnack2");
+    _srs_pps_rhnack = new SrsPps("rhnack");
+    _srs_pps_rmnack = new SrsPps("rmnack");
 #endif
 
 #if defined(SRS_DEBUG) && defined(SRS_DEBUG_STATS)
-    _srs_pps_recvfrom = new SrsPps();
-    _srs_pps_recvfrom_eagain = new SrsPps();
-    _srs_pps_sendto = new SrsPps();
-    _srs_pps_sendto_eagain = new SrsPps();
-
-    _srs_pps_read = new SrsPps();
-    _srs_pps_read_eagain = new SrsPps();
-    _srs_pps_readv = new SrsPps();
-    _srs_pps_readv_eagain = new SrsPps();
-    _srs_pps_writev = new SrsPps();
-    _srs_pps_writev_eagain = new SrsPps();
-
-    _srs_pps_recvmsg = new SrsPps();
-    _srs_pps_recvmsg_eagain = new SrsPps();
-    _srs_pps_sendmsg = new SrsPps();
-    _srs_pps_sendmsg_eagain = new SrsPps();
-
-    _srs_pps_epoll = new SrsPps();
-    _srs_pps_epoll_zero = new SrsPps();
-    _srs_pps_epoll_shake = new SrsPps();
-    _srs_pps_epoll_spin = new SrsPps();
-
-    _srs_pps_sched_15ms = new SrsPps();
-    _srs_pps_sched_20ms = new SrsPps();
-    _srs_pps_sched_25ms = new SrsPps();
-    _srs_pps_sched_30ms = new SrsPps();
-    _srs_pps_sched_35ms = new SrsPps();
-    _srs_pps_sched_40ms = new SrsPps();
-    _srs_pps_sched_80ms = new SrsPps();
-    _srs_pps_sched_160ms = new SrsPps();
-    _srs_pps_sched_s = new SrsPps();
+    _srs_pps_recvfrom = new SrsPps("recvfrom");
+    _srs_pps_recvfrom_eagain = new SrsPps("recvfrom_eagain");
+    _srs_pps_sendto = new SrsPps("sendto");
+    _srs_pps_sendto_eagain = new SrsPps("sendto_eagain");
+
+    _srs_pps_read = new SrsPps("read");
+    _srs_pps_read_eagain = new SrsPps("read_eagain");
+    _srs_pps_readv = new SrsPps("readv");
+    _srs_pps_readv_eagain = new SrsPps("readv_eagain");
+    _srs_pps_writev = new SrsPps("writev");
+    _srs_pps_writev_eagain = new SrsPps("writev_eagain");
+
+    _srs_pps_recvmsg = new SrsPps("recvmsg");
+    _srs_pps_recvmsg_eagain = new SrsPps("recvmsg_eagain");
+    _srs_pps_sendmsg = new SrsPps("sendmsg");
+    _srs_pps_sendmsg_eagain = new SrsPps("sendmsg_eagain");
+
+    _srs_pps_epoll = new SrsPps("epoll");
+    _srs_pps_epoll_zero = new SrsPps("epoll_zero");
+    _srs_pps_epoll_shake = new SrsPps("epoll_shake");
+    _srs_pps_epoll_spin = new SrsPps("epoll_spin");
+
+    _srs_pps_sched_15ms = new SrsPps("sched_15ms");
+    _srs_pps_sched_20ms = new SrsPps("sched_20ms");
+    _srs_pps_sched_25ms = new SrsPps("sched_25ms");
+    _srs_pps_sched_30ms = new SrsPps("sched_30ms");
+    _srs_pps_sched_35ms = new SrsPps("sched_35ms");
+    _srs_pps_sched_40ms = new SrsPps("sched_40ms");
+    _srs_pps_sched_80ms = new SrsPps("sched_80ms");
+    _srs_pps_sched_160ms = new SrsPps("sched_160ms");
+    _srs_pps_sched_s = new SrsPps("sched_s");
 #endif
 
-    _srs_pps_clock_15ms = new SrsPps();
-    _srs_pps_clock_20ms = new SrsPps();
-    _srs_pps_clock_25ms = new SrsPps();
-    _srs_pps_clock_30ms = new SrsPps();
-    _srs_pps_clock_35ms = new SrsPps();
-    _srs_pps_clock_40ms = new SrsPps();
-    _srs_pps_clock_80ms = new SrsPps();
-    _srs_pps_clock_160ms = new SrsPps();
-    _srs_pps_timer_s = new SrsPps();
+    _srs_pps_clock_15ms = new SrsPps("clock_15ms");
+    _srs_pps_clock_20ms = new SrsPps("clock_20ms");
+    _srs_pps_clock_25ms = new SrsPps("clock_25ms");
+    _srs_pps_clock_30ms = new SrsPps("clock_30ms");
+    _srs_pps_clock_35ms = new SrsPps("clock_35ms");
+    _srs_pps_clock_40ms = new SrsPps("clock_40ms");
+    _srs_pps_clock_80ms = new SrsPps("clock_80ms");
+    _srs_pps_clock_160ms = new SrsPps("clock_160ms");
+    _srs_pps_timer_s = new SrsPps("timer_s");
 
 #if defined(SRS_DEBUG) && defined(SRS_DEBUG_STATS)
-    _srs_pps_thread_run = new SrsPps();
-    _srs_pps_thread_idle = new SrsPps();
-    _srs_pps_thread_yield = new SrsPps();
-    _srs_pps_thread_yield2 = new SrsPps();
+    _srs_pps_thread_run = new SrsPps("thread_run");
+    _srs_pps_thread_idle = new SrsPps("thread_idle");
+    _srs_pps_thread_yield = new SrsPps("thread_yield");
+    _srs_pps_thread_yield2 = new SrsPps("thread_yield2");
 #endif
 
-    _srs_pps_rpkts = new SrsPps();
-    _srs_pps_addrs = new SrsPps();
-    _srs_pps_fast_addrs = new SrsPps();
+    _srs_pps_rpkts = new SrsPps("rpkts");
+    _srs_pps_addrs = new SrsPps("addrs");
+    _srs_pps_fast_addrs = new SrsPps("fast_addrs");
 
-    _srs_pps_spkts = new SrsPps();
-    _srs_pps_objs_msgs = new SrsPps();
+    _srs_pps_spkts = new SrsPps("spkts");
+    _srs_pps_objs_msgs = new SrsPps("objs_msgs");
 
 #ifdef SRS_RTC
-    _srs_pps_sstuns = new SrsPps();
-    _srs_pps_srtcps = new SrsPps();
-    _srs_pps_srtps = new SrsPps();
+    _srs_pps_sstuns = new SrsPps("sstuns");
+    _srs_pps_srtcps = new SrsPps("srtcps");
+    _srs_pps_srtps = new SrsPps("srtps");
+
+    _srs_pps_rstuns = new SrsPps("rstuns");
+    _srs_pps_rrtps = new SrsPps("rrtps");
+    _srs_pps_rrtcps = new SrsPps("rrtcps");
 
-    _srs_pps_rstuns = new SrsPps();
-    _srs_pps_rrtps = new SrsPps();
-    _srs_pps_rrtcps = new SrsPps();
+    _srs_pps_aloss2 = new SrsPps("aloss2");
 
-    _srs_pps_aloss2 = new SrsPps();
+    _srs_pps_pli = new SrsPps("pli");
+    _srs_pps_twcc = new SrsPps("twcc");
+    _srs_pps_rr = new SrsPps("rr");
 
-    _srs_pps_pli = new SrsPps();
-    _srs_pps_twcc = new SrsPps();
-    _srs_pps_rr = new SrsPps();
+    _srs_pps_objs_rtps = new SrsPps("objs_rtps");
+    _srs_pps_objs_rraw = new SrsPps("objs_rraw");
+    _srs_pps_objs_rfua = new SrsPps("objs_rfua");
+    _srs_pps_objs_rbuf = new SrsPps("objs_rbuf");
+    _srs_pps_objs_rothers = new SrsPps("objs_rothers");
+#endif
 
-    _srs_pps_objs_rtps = new SrsPps();
-    _srs_pps_objs_rraw = new SrsPps();
-    _srs_pps_objs_rfua = new SrsPps();
-    _srs_pps_objs_rbuf = new SrsPps();
-    _srs_pps_objs_rothers = new SrsPps();
+    // The histograms for metrics.
+    _srs_histogram_queue_delay = new SrsHistogram("send_queue_delay");
+    _srs_histogram_hooks = new SrsHistogram("hook_latency");
+    _srs_histogram_crypto = new SrsHistogram("crypto_wait");
+    _srs_histogram_segment = new SrsHistogram("segment_write");
+
+    // The histograms for each stage of media pipeline.
+    _srs_histogram_stage_recv = new SrsHistogram("stage_recv");
+    _srs_histogram_stage_mux = new SrsHistogram("stage_mux");
+    _srs_histogram_stage_dispatch = new SrsHistogram("stage_dispatch");
+    _srs_histogram_stage_queue = new SrsHistogram("stage_queue");
+    _srs_histogram_stage_send = new SrsHistogram("stage_send");
+    _srs_histogram_stage_e2e = new SrsHistogram("stage_e2e");
+#ifdef SRS_RTC
+    _srs_histogram_rtc_e2e = new SrsHistogram("rtc_e2e");
 #endif
 
     return err;
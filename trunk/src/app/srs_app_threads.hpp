@@ -9,7 +9,12 @@
 
 #include <srs_core.hpp>
 
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
 #include <srs_app_hourglass.hpp>
+#include <srs_app_st.hpp>
 
 // Protect server in high load.
 class SrsCircuitBreaker : public ISrsFastTimer
@@ -46,6 +51,85 @@ private:
 
 extern SrsCircuitBreaker* _srs_circuit_breaker;
 
+class SrsCryptoJob;
+
+// The task run by crypto worker thread, which must never use ST or log, because they are not thread-safe.
+class ISrsCryptoTask
+{
+public:
+    ISrsCryptoTask();
+    virtual ~ISrsCryptoTask();
+public:
+    // Run the task in worker thread.
+    virtual void run() = 0;
+};
+
+// The thread pool for CPU-bound crypto, such as the asymmetric crypto of TLS handshake. The coroutine
+// is parked until its task is done by a thread, so the ST thread keeps serving other connections.
+// @remark The threads are started by the first task, because thread never survive fork.
+class SrsCryptoWorkers : public ISrsCoroutineHandler
+{
+private:
+    bool started_;
+    std::vector<pthread_t> threads_;
+    // Set to notify the threads to quit, protected by lock_.
+    bool quit_;
+private:
+    // The pending jobs for threads, protected by lock_ and signaled by cond_.
+    pthread_mutex_t lock_;
+    pthread_cond_t cond_;
+    std::deque<SrsCryptoJob*> jobs_;
+    // The done jobs for ST thread, protected by lock_ and notified by pipe.
+    std::vector<SrsCryptoJob*> done_;
+    int pipe_[2];
+    srs_netfd_t rfd_;
+    // The coroutine to wakeup the parked coroutines when jobs are done.
+    SrsCoroutine* trd_;
+public:
+    SrsCryptoWorkers();
+    virtual ~SrsCryptoWorkers();
+public:
+    // Run the task by a thread and park current coroutine until it's done. Run it directly if disabled.
+    srs_error_t execute(ISrsCryptoTask* task);
+    // Run the task by a thread without waiting, the task is freed in ST thread when done.
+    srs_error_t post(ISrsCryptoTask* task);
+    // Stop all threads, after the pending jobs are done.
+    void stop();
+    // Start the threads, ignore if started.
+    srs_error_t start();
+    // Whether any thread runs the tasks, false if openssl without threads, then tasks run in ST thread.
+    bool threaded();
+private:
+    static void* pfn(void* arg);
+    void work();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+extern SrsCryptoWorkers* _srs_crypto_workers;
+
+// Refill the DH pool of RTMP complex handshake by crypto workers, so the handshake uses the DH key
+// generated in advance, see srs_internal::SrsDHPool.
+class SrsDHPoolRefiller : public ISrsFastTimer
+{
+private:
+    // Whether there is a refill task in threads.
+    bool refilling_;
+public:
+    SrsDHPoolRefiller();
+    virtual ~SrsDHPoolRefiller();
+public:
+    srs_error_t initialize();
+    // When the refill task is done.
+    void on_refilled();
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
+};
+
+extern SrsDHPoolRefiller* _srs_dh_refiller;
+
 // Initialize global or thread-local variables.
 extern srs_error_t srs_thread_initialize();
 
@@ -0,0 +1,464 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_workers.hpp>
+
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#ifndef SRS_OSX
+#include <sys/prctl.h>
+#endif
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_consts.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_app_server.hpp>
+
+// The max number of streams in the shared table.
+#define SRS_WORKERS_MAX_STREAMS 4096
+// The max size of stream url, the longer url is not tracked by workers.
+#define SRS_WORKERS_URL_SIZE 256
+
+// The state of stream slot, the used slot is never freed to keep the probe chain of other streams.
+#define SRS_WORKERS_SLOT_FREE 0
+#define SRS_WORKERS_SLOT_USED 1
+
+// Wait for a while to respawn the worker which quit too fast.
+#define SRS_WORKERS_RESPAWN_INTERVAL (3 * SRS_UTIME_SECONDS)
+
+// The stream key in the memory shared by all workers, located by open addressing of url hash.
+struct SrsWorkerStream
+{
+    // The state of slot, protected by the lock of table.
+    int state;
+    // The worker which owns the stream, as index+1, 0 if not owned, changed by CAS only.
+    int owner;
+    // The hash of url, to compare fast.
+    uint32_t hash;
+    // The stream url, without the param.
+    char url[SRS_WORKERS_URL_SIZE];
+};
+
+// The streams table shared by all workers. The lock protects the keys, while the owner of a stream is
+// claimed by a single CAS, so it's never owned by two workers.
+struct SrsWorkerTable
+{
+    // The process shared lock, which is robust on linux, so it's recovered if a worker crash.
+    pthread_mutex_t lock;
+    SrsWorkerStream streams[SRS_WORKERS_MAX_STREAMS];
+};
+
+// The signals received by master, which are forwarded to workers.
+static volatile sig_atomic_t _srs_workers_signals[NSIG];
+
+static void srs_workers_on_signal(int signo)
+{
+    _srs_workers_signals[signo] = 1;
+}
+
+// The signals to forward to workers.
+static int _srs_workers_forwards[] = {
+    SRS_SIGNAL_RELOAD, SRS_SIGNAL_REOPEN_LOG, SRS_SIGNAL_UPGRADE, SRS_SIGNAL_FAST_QUIT,
+    SRS_SIGNAL_GRACEFULLY_QUIT, SIGINT
+};
+#define SRS_WORKERS_NN_FORWARDS (int)(sizeof(_srs_workers_forwards) / sizeof(int))
+
+SrsWorkers::SrsWorkers()
+{
+    enabled_ = false;
+    master_ = false;
+    index_ = -1;
+    relay_port_ = 0;
+    pid_fd_ = -1;
+    table_ = NULL;
+}
+
+SrsWorkers::~SrsWorkers()
+{
+    if (table_) {
+        munmap(table_, sizeof(SrsWorkerTable));
+        table_ = NULL;
+    }
+}
+
+srs_error_t SrsWorkers::run()
+{
+    srs_error_t err = srs_success;
+
+    enabled_ = _srs_config->get_workers_enabled();
+    if (!enabled_) {
+        return err;
+    }
+
+    int nn_workers = _srs_config->get_workers_count();
+    if (nn_workers <= 0) {
+        nn_workers = srs_max(1, srs_get_cpuinfo()->nb_processors_online);
+    }
+    relay_port_ = _srs_config->get_workers_relay_port();
+
+    // The table is created before fork, so it's shared by all workers.
+    size_t size = sizeof(SrsWorkerTable);
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return srs_error_new(ERROR_WORKERS_MMAP, "mmap %d bytes", (int)size);
+    }
+    memset(p, 0, size);
+    table_ = (SrsWorkerTable*)p;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifndef SRS_OSX
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    int r0 = pthread_mutex_init(&table_->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (r0) {
+        return srs_error_new(ERROR_WORKERS_MMAP, "init lock, r0=%d", r0);
+    }
+
+    // The master holds the pid file, so the signals from user are sent to master.
+    if (!_srs_config->is_dolphin() && (err = srs_acquire_pid_file(&pid_fd_)) != srs_success) {
+        return srs_error_wrap(err, "acquire pid file");
+    }
+
+    for (int i = 0; i < SRS_WORKERS_NN_FORWARDS; i++) {
+        signal(_srs_workers_forwards[i], srs_workers_on_signal);
+    }
+
+    master_ = true;
+    pids_.resize(nn_workers, 0);
+    starts_.resize(nn_workers, 0);
+    srs_trace("workers: master pid=%d, workers=%d, relay_port=%d", getpid(), nn_workers, relay_port_);
+
+    for (int i = 0; i < nn_workers; i++) {
+        if ((err = spawn(i)) != srs_success) {
+            return srs_error_wrap(err, "spawn worker %d", i);
+        }
+
+        // The worker returns to run the server.
+        if (!master_) {
+            return err;
+        }
+    }
+
+    if ((err = do_master()) != srs_success) {
+        return srs_error_wrap(err, "master");
+    }
+
+    return err;
+}
+
+bool SrsWorkers::is_master()
+{
+    return master_;
+}
+
+bool SrsWorkers::is_worker()
+{
+    return index_ >= 0;
+}
+
+bool SrsWorkers::is_primary()
+{
+    return index_ <= 0 && !master_;
+}
+
+int SrsWorkers::index()
+{
+    return index_;
+}
+
+int SrsWorkers::relay_port()
+{
+    return is_worker()? relay_port_ + index_ : 0;
+}
+
+srs_error_t SrsWorkers::on_publish(SrsRequest* r)
+{
+    srs_error_t err = srs_success;
+
+    if (!is_worker()) {
+        return err;
+    }
+
+    string url = r->get_stream_url();
+    if (url.length() >= SRS_WORKERS_URL_SIZE) {
+        srs_warn("workers: ignore url=%s, size=%d", url.c_str(), (int)url.length());
+        return err;
+    }
+    uint32_t hash = srs_crc32_ieee(url.data(), (int)url.length());
+
+    lock();
+    int slot = find(url, hash, true);
+    if (slot < 0) {
+        unlock();
+        return srs_error_new(ERROR_WORKERS_FULL, "workers table full, %d streams, url=%s", SRS_WORKERS_MAX_STREAMS, url.c_str());
+    }
+
+    // Claim the stream by a single CAS on its owner, so only one worker wins.
+    SrsWorkerStream* s = &table_->streams[slot];
+    int owner = 0;
+    bool claimed = __atomic_compare_exchange_n(&s->owner, &owner, index_ + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    unlock();
+
+    if (!claimed && owner != index_ + 1) {
+        return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "stream %s owned by worker %d", url.c_str(), owner - 1);
+    }
+
+    if (claimed) {
+        srs_trace("workers: worker %d owns stream %s, slot=%d", index_, url.c_str(), slot);
+    }
+    return err;
+}
+
+void SrsWorkers::on_unpublish(SrsRequest* r)
+{
+    if (!is_worker()) {
+        return;
+    }
+
+    string url = r->get_stream_url();
+    uint32_t hash = srs_crc32_ieee(url.data(), (int)url.length());
+
+    lock();
+    int slot = find(url, hash, false);
+    unlock();
+
+    // The key is kept for the stream might be published again, and reused by other streams when not owned.
+    int owner = index_ + 1;
+    if (slot >= 0 && __atomic_compare_exchange_n(&table_->streams[slot].owner, &owner, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        srs_trace("workers: worker %d release stream %s, slot=%d", index_, url.c_str(), slot);
+    }
+}
+
+int SrsWorkers::owner_port(SrsRequest* r)
+{
+    if (!is_worker()) {
+        return 0;
+    }
+
+    string url = r->get_stream_url();
+    uint32_t hash = srs_crc32_ieee(url.data(), (int)url.length());
+
+    lock();
+    int slot = find(url, hash, false);
+    int owner = (slot < 0)? 0 : __atomic_load_n(&table_->streams[slot].owner, __ATOMIC_ACQUIRE);
+    unlock();
+
+    int worker = owner - 1;
+    if (owner <= 0 || worker == index_) {
+        return 0;
+    }
+
+    return relay_port_ + worker;
+}
+
+srs_error_t SrsWorkers::do_master()
+{
+    srs_error_t err = srs_success;
+
+    bool quit = false;
+    while (true) {
+        // Forward the signals to all workers.
+        for (int i = 0; i < SRS_WORKERS_NN_FORWARDS; i++) {
+            int signo = _srs_workers_forwards[i];
+            if (!_srs_workers_signals[signo]) {
+                continue;
+            }
+            _srs_workers_signals[signo] = 0;
+
+            if (signo == SRS_SIGNAL_FAST_QUIT || signo == SRS_SIGNAL_GRACEFULLY_QUIT || signo == SIGINT) {
+                quit = true;
+            }
+
+            srs_trace("workers: master forward signal %d to workers, quit=%d", signo, quit);
+            for (int j = 0; j < (int)pids_.size(); j++) {
+                if (pids_[j] > 0) {
+                    kill(pids_[j], signo);
+                }
+            }
+        }
+
+        // Reap the quit workers.
+        int status = 0;
+        pid_t pid = 0;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            on_worker_quit(pid, status);
+        }
+
+        // All workers quit, master quit.
+        int nn_alive = 0;
+        for (int i = 0; i < (int)pids_.size(); i++) {
+            nn_alive += pids_[i] > 0? 1 : 0;
+        }
+        if (quit && !nn_alive) {
+            break;
+        }
+
+        // Respawn the dead workers, if not quit.
+        for (int i = 0; !quit && i < (int)pids_.size(); i++) {
+            if (pids_[i] > 0 || srs_update_system_time() - starts_[i] < SRS_WORKERS_RESPAWN_INTERVAL) {
+                continue;
+            }
+
+            if ((err = spawn(i)) != srs_success) {
+                srs_warn("workers: ignore spawn worker %d err %s", i, srs_error_desc(err).c_str());
+                srs_freep(err);
+                continue;
+            }
+
+            // The worker returns to run the server.
+            if (!master_) {
+                return err;
+            }
+        }
+
+        // Wait for signals or workers, interrupted by signal.
+        usleep(100 * 1000);
+    }
+
+    srs_trace("workers: master quit, all workers done");
+    return err;
+}
+
+srs_error_t SrsWorkers::spawn(int index)
+{
+    srs_error_t err = srs_success;
+
+    starts_[index] = srs_update_system_time();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return srs_error_new(ERROR_WORKERS_FORK, "fork worker %d", index);
+    }
+
+    // Master, remember the worker.
+    if (pid > 0) {
+        pids_[index] = pid;
+        srs_trace("workers: master fork worker %d, pid=%d", index, pid);
+        return err;
+    }
+
+    // Worker, restore signals, which are handled by signal manager of server.
+    for (int i = 0; i < SRS_WORKERS_NN_FORWARDS; i++) {
+        signal(_srs_workers_forwards[i], SIG_DFL);
+    }
+
+#ifndef SRS_OSX
+    // Quit when master is killed.
+    prctl(PR_SET_PDEATHSIG, SRS_SIGNAL_FAST_QUIT);
+#endif
+
+    master_ = false;
+    index_ = index;
+    pids_.clear();
+    starts_.clear();
+
+    // The pid file is held by master.
+    if (pid_fd_ > 0) {
+        ::close(pid_fd_);
+        pid_fd_ = -1;
+    }
+
+    srs_trace("workers: worker %d running, pid=%d, relay=127.0.0.1:%d", index_, getpid(), relay_port());
+    return err;
+}
+
+void SrsWorkers::on_worker_quit(pid_t pid, int status)
+{
+    for (int i = 0; i < (int)pids_.size(); i++) {
+        if (pids_[i] != pid) {
+            continue;
+        }
+
+        pids_[i] = 0;
+        remove(i);
+
+        if (WIFSIGNALED(status)) {
+            srs_warn("workers: worker %d pid=%d killed by signal %d", i, pid, WTERMSIG(status));
+        } else {
+            srs_trace("workers: worker %d pid=%d quit, code=%d", i, pid, WEXITSTATUS(status));
+        }
+        return;
+    }
+}
+
+int SrsWorkers::find(const string& url, uint32_t hash, bool create)
+{
+    // The first slot to insert the key, which is free or an unowned key of other stream.
+    int candidate = -1;
+
+    for (int i = 0; i < SRS_WORKERS_MAX_STREAMS; i++) {
+        int slot = (int)((hash + i) % SRS_WORKERS_MAX_STREAMS);
+        SrsWorkerStream* s = &table_->streams[slot];
+
+        if (s->state == SRS_WORKERS_SLOT_FREE) {
+            if (candidate < 0) {
+                candidate = slot;
+            }
+            break;
+        }
+
+        if (s->state == SRS_WORKERS_SLOT_USED && s->hash == hash && url == s->url) {
+            return slot;
+        }
+
+        // The owner is only set from 0 with the lock held, so an unowned key is safe to be reused.
+        if (candidate < 0 && !__atomic_load_n(&s->owner, __ATOMIC_ACQUIRE)) {
+            candidate = slot;
+        }
+    }
+
+    if (!create || candidate < 0) {
+        return -1;
+    }
+
+    SrsWorkerStream* s = &table_->streams[candidate];
+    s->state = SRS_WORKERS_SLOT_USED;
+    s->hash = hash;
+    memcpy(s->url, url.c_str(), url.length() + 1);
+    return candidate;
+}
+
+void SrsWorkers::lock()
+{
+#ifndef SRS_OSX
+    // The worker which held the lock crashed, recover the lock. A key torn by the crash is not owned,
+    // so it never matches and is reused by other streams.
+    if (pthread_mutex_lock(&table_->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&table_->lock);
+    }
+#else
+    pthread_mutex_lock(&table_->lock);
+#endif
+}
+
+void SrsWorkers::unlock()
+{
+    pthread_mutex_unlock(&table_->lock);
+}
+
+void SrsWorkers::remove(int worker)
+{
+    for (int i = 0; i < SRS_WORKERS_MAX_STREAMS; i++) {
+        int owner = worker + 1;
+        __atomic_compare_exchange_n(&table_->streams[i].owner, &owner, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    }
+}
+
+SrsWorkers* _srs_workers = NULL;
+
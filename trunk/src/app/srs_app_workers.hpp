@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_WORKERS_HPP
+#define SRS_APP_WORKERS_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+class SrsRequest;
+struct SrsWorkerTable;
+
+// The multiple processes mode, the master forks some workers, each worker is a shared-nothing SRS server,
+// which listens at the same RTMP/HTTP ports by SO_REUSEPORT, so kernel dispatch the connections to workers.
+// For stream affinity, the publishing streams are registered in the memory shared by all workers, and a
+// player on other worker is relayed from the private RTMP port of the worker which owns the stream.
+class SrsWorkers
+{
+private:
+    // Whether run in workers mode.
+    bool enabled_;
+    // Whether current process is the master.
+    bool master_;
+    // The index of current worker, -1 for master or single process.
+    int index_;
+    // The base port of the private RTMP listener of workers.
+    int relay_port_;
+private:
+    // The pid of workers, 0 if not running.
+    std::vector<pid_t> pids_;
+    // The time to fork each worker, to avoid respawn too fast.
+    std::vector<srs_utime_t> starts_;
+    // The pid file fd of master.
+    int pid_fd_;
+private:
+    // The streams table in shared memory, which is created by master before fork.
+    SrsWorkerTable* table_;
+public:
+    SrsWorkers();
+    virtual ~SrsWorkers();
+public:
+    // Fork the workers and wait for them if enabled. The master returns when all workers quit, and
+    // the worker returns immediately to run the server.
+    virtual srs_error_t run();
+    // Whether current process is the master, which should quit after run.
+    virtual bool is_master();
+    // Whether current process is a worker.
+    virtual bool is_worker();
+    // Whether current process is the primary process, which runs the singleton services like ingest,
+    // for example, the single process or the worker 0.
+    virtual bool is_primary();
+    // Get the index of current worker, -1 for master or single process.
+    virtual int index();
+    // Get the private RTMP port of current worker, 0 if not worker.
+    virtual int relay_port();
+public:
+    // When stream published on current worker, register it, fail if owned by other worker.
+    virtual srs_error_t on_publish(SrsRequest* r);
+    // When stream unpublished on current worker, unregister it.
+    virtual void on_unpublish(SrsRequest* r);
+    // Get the private RTMP port of the worker which owns the stream, 0 if not found or owned by current worker.
+    virtual int owner_port(SrsRequest* r);
+private:
+    virtual srs_error_t do_master();
+    virtual srs_error_t spawn(int index);
+    virtual void on_worker_quit(pid_t pid, int status);
+    // Find the slot of stream url, or insert it if create, -1 if not found or table is full.
+    // @remark Must hold the lock of table.
+    virtual int find(const std::string& url, uint32_t hash, bool create);
+    virtual void lock();
+    virtual void unlock();
+    virtual void remove(int worker);
+};
+
+extern SrsWorkers* _srs_workers;
+
+#endif
+
@@ -6,12 +6,162 @@
 
 #include <srs_kernel_balance.hpp>
 
+#include <srs_kernel_utility.hpp>
+
 using namespace std;
 
-SrsLbRoundRobin::SrsLbRoundRobin()
+// The EWMA weight of the new connect time, in percent.
+#define SRS_LB_EWMA_ALPHA 30
+// The server not connected for a while should be measured again.
+#define SRS_LB_STALE_TIMEOUT (60 * SRS_UTIME_SECONDS)
+// The failed server is skipped for fails*backoff, at most max times.
+#define SRS_LB_FAIL_BACKOFF (5 * SRS_UTIME_SECONDS)
+#define SRS_LB_FAIL_BACKOFF_MAX 6
+
+SrsLbServer::SrsLbServer()
+{
+    conns = 0;
+    rtt = 0;
+    load = -1;
+    fails = 0;
+    fail_at = 0;
+    update_at = 0;
+    probe_at = 0;
+}
+
+SrsLbServer::~SrsLbServer()
+{
+}
+
+SrsLbHealth* SrsLbHealth::_instance = NULL;
+
+SrsLbHealth::SrsLbHealth()
+{
+}
+
+SrsLbHealth::~SrsLbHealth()
+{
+    std::map<std::string, SrsLbServer*>::iterator it;
+    for (it = servers_.begin(); it != servers_.end(); ++it) {
+        SrsLbServer* server = it->second;
+        srs_freep(server);
+    }
+    servers_.clear();
+}
+
+SrsLbHealth* SrsLbHealth::instance()
+{
+    if (_instance == NULL) {
+        _instance = new SrsLbHealth();
+    }
+    return _instance;
+}
+
+SrsLbServer* SrsLbHealth::fetch(const string& server)
+{
+    std::map<std::string, SrsLbServer*>::iterator it = servers_.find(server);
+    if (it != servers_.end()) {
+        return it->second;
+    }
+
+    SrsLbServer* s = new SrsLbServer();
+    servers_[server] = s;
+    return s;
+}
+
+void SrsLbHealth::on_connected(const string& server, srs_utime_t rtt, int load, srs_utime_t now)
+{
+    SrsLbServer* s = fetch(server);
+
+    // Restart the EWMA when stale, because the network might change.
+    if (s->rtt <= 0 || now - s->update_at > SRS_LB_STALE_TIMEOUT) {
+        s->rtt = rtt;
+    } else {
+        s->rtt = (s->rtt * (100 - SRS_LB_EWMA_ALPHA) + rtt * SRS_LB_EWMA_ALPHA) / 100;
+    }
+
+    s->load = load;
+    s->fails = 0;
+    s->update_at = now;
+}
+
+void SrsLbHealth::on_failed(const string& server, srs_utime_t now)
+{
+    SrsLbServer* s = fetch(server);
+    s->fails++;
+    s->fail_at = now;
+}
+
+void SrsLbHealth::acquire(const string& server)
+{
+    fetch(server)->conns++;
+}
+
+void SrsLbHealth::release(const string& server)
+{
+    SrsLbServer* s = fetch(server);
+    if (s->conns > 0) {
+        s->conns--;
+    }
+}
+
+bool SrsLbHealth::available(const string& server, srs_utime_t now)
+{
+    std::map<std::string, SrsLbServer*>::iterator it = servers_.find(server);
+    if (it == servers_.end()) {
+        return true;
+    }
+
+    SrsLbServer* s = it->second;
+    if (s->fails <= 0) {
+        return true;
+    }
+
+    srs_utime_t backoff = srs_min(s->fails, SRS_LB_FAIL_BACKOFF_MAX) * SRS_LB_FAIL_BACKOFF;
+    return now - s->fail_at >= backoff;
+}
+
+vector<string> SrsLbHealth::filter(const vector<string>& servers, srs_utime_t now)
+{
+    vector<string> alive;
+    for (int i = 0; i < (int)servers.size(); i++) {
+        const string& server = servers.at(i);
+        if (available(server, now)) {
+            alive.push_back(server);
+        }
+    }
+
+    // All servers are failed, try all of them.
+    if (alive.empty()) {
+        return servers;
+    }
+    return alive;
+}
+
+// Get the index of server in the configured servers, -1 if not found.
+static int srs_lb_index_of(const vector<string>& servers, const string& server)
+{
+    for (int i = 0; i < (int)servers.size(); i++) {
+        if (servers.at(i) == server) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ISrsLoadBalancer::ISrsLoadBalancer()
+{
+}
+
+ISrsLoadBalancer::~ISrsLoadBalancer()
+{
+}
+
+SrsLbRoundRobin::SrsLbRoundRobin(SrsLbHealth* h)
 {
     index = -1;
     count = 0;
+    health = h;
 }
 
 SrsLbRoundRobin::~SrsLbRoundRobin()
@@ -31,10 +181,211 @@ string SrsLbRoundRobin::selected()
 string SrsLbRoundRobin::select(const vector<string>& servers)
 {
     srs_assert(!servers.empty());
-    
+
     index = (int)(count++ % servers.size());
+
+    // Skip the failed servers, keep the index in the configured servers so the rotation is stable
+    // when the failed servers recover. Select the next one if all failed.
+    if (health) {
+        srs_utime_t now = srs_get_system_time();
+        for (int i = 0; i < (int)servers.size(); i++) {
+            int next = (index + i) % (int)servers.size();
+            if (health->available(servers.at(next), now)) {
+                count += i;
+                index = next;
+                break;
+            }
+        }
+    }
+
     elem = servers.at(index);
-    
+
     return elem;
 }
 
+SrsLbLeastConn::SrsLbLeastConn(SrsLbHealth* h)
+{
+    index = -1;
+    health = h;
+    rr = new SrsLbRoundRobin();
+}
+
+SrsLbLeastConn::~SrsLbLeastConn()
+{
+    srs_freep(rr);
+}
+
+uint32_t SrsLbLeastConn::current()
+{
+    return index;
+}
+
+string SrsLbLeastConn::selected()
+{
+    return rr->selected();
+}
+
+string SrsLbLeastConn::select(const vector<string>& servers)
+{
+    srs_assert(!servers.empty());
+
+    vector<string> alive = health->filter(servers, srs_get_system_time());
+
+    // Round-robin in the servers with the least connections.
+    vector<string> least;
+    int min_conns = 0;
+    for (int i = 0; i < (int)alive.size(); i++) {
+        int conns = health->fetch(alive.at(i))->conns;
+        if (least.empty() || conns < min_conns) {
+            least.clear();
+            min_conns = conns;
+        }
+        if (conns == min_conns) {
+            least.push_back(alive.at(i));
+        }
+    }
+
+    string elem = rr->select(least);
+    index = srs_lb_index_of(servers, elem);
+
+    return elem;
+}
+
+SrsLbEwma::SrsLbEwma(SrsLbHealth* h)
+{
+    index = -1;
+    health = h;
+    rr = new SrsLbRoundRobin();
+}
+
+SrsLbEwma::~SrsLbEwma()
+{
+    srs_freep(rr);
+}
+
+uint32_t SrsLbEwma::current()
+{
+    return index;
+}
+
+string SrsLbEwma::selected()
+{
+    return rr->selected();
+}
+
+string SrsLbEwma::select(const vector<string>& servers)
+{
+    srs_assert(!servers.empty());
+
+    srs_utime_t now = srs_get_system_time();
+    vector<string> alive = health->filter(servers, now);
+
+    // Measure the servers never connected first.
+    vector<string> candidates;
+    for (int i = 0; i < (int)alive.size(); i++) {
+        if (health->fetch(alive.at(i))->update_at <= 0) {
+            candidates.push_back(alive.at(i));
+        }
+    }
+
+    // Measure the stale server again, once in a stale timeout.
+    for (int i = 0; candidates.empty() && i < (int)alive.size(); i++) {
+        SrsLbServer* s = health->fetch(alive.at(i));
+        if (now - s->update_at > SRS_LB_STALE_TIMEOUT && now - s->probe_at > SRS_LB_STALE_TIMEOUT) {
+            s->probe_at = now;
+            candidates.push_back(alive.at(i));
+        }
+    }
+
+    // Select the least cost, which is the connect time weighted by load.
+    if (candidates.empty()) {
+        string best;
+        int64_t best_cost = 0;
+        for (int i = 0; i < (int)alive.size(); i++) {
+            SrsLbServer* s = health->fetch(alive.at(i));
+            int64_t cost = srs_max(s->rtt, 1) * (100 + srs_max(s->load, 0));
+            if (best.empty() || cost < best_cost) {
+                best = alive.at(i);
+                best_cost = cost;
+            }
+        }
+        candidates.push_back(best);
+    }
+
+    // Round-robin in candidates, which also updates the selected server of rr.
+    string elem = rr->select(candidates);
+    index = srs_lb_index_of(servers, elem);
+
+    return elem;
+}
+
+SrsLbConsistentHash::SrsLbConsistentHash(string k, SrsLbHealth* h)
+{
+    index = -1;
+    key = k;
+    health = h;
+}
+
+SrsLbConsistentHash::~SrsLbConsistentHash()
+{
+}
+
+uint32_t SrsLbConsistentHash::current()
+{
+    return index;
+}
+
+string SrsLbConsistentHash::selected()
+{
+    return elem;
+}
+
+string SrsLbConsistentHash::select(const vector<string>& servers)
+{
+    srs_assert(!servers.empty());
+
+    srs_utime_t now = srs_get_system_time();
+    uint32_t seed = srs_crc32_ieee(key.data(), (int)key.length());
+
+    // The available server with the highest hash wins, or the highest one if all failed.
+    int best = -1;
+    bool best_available = false;
+    uint32_t best_hash = 0;
+    for (int i = 0; i < (int)servers.size(); i++) {
+        const string& server = servers.at(i);
+        uint32_t hash = srs_crc32_ieee(server.data(), (int)server.length(), seed);
+        bool available = health->available(server, now);
+
+        if (best < 0 || (available && !best_available) || (available == best_available && hash > best_hash)) {
+            best = i;
+            best_available = available;
+            best_hash = hash;
+        }
+    }
+
+    index = best;
+    elem = servers.at(index);
+
+    return elem;
+}
+
+bool srs_lb_is_valid(string strategy)
+{
+    return strategy == "round_robin" || strategy == "least_conn" || strategy == "ewma" || strategy == "rtt_load"
+        || strategy == "hash";
+}
+
+ISrsLoadBalancer* srs_lb_create(string strategy, string key, SrsLbHealth* health)
+{
+    if (strategy == "least_conn") {
+        return new SrsLbLeastConn(health);
+    }
+    // The rtt_load is the EWMA of RTT weighted by load, so it's an alias of ewma.
+    if (strategy == "ewma" || strategy == "rtt_load") {
+        return new SrsLbEwma(health);
+    }
+    if (strategy == "hash") {
+        return new SrsLbConsistentHash(key, health);
+    }
+    return new SrsLbRoundRobin(health);
+}
@@ -11,22 +11,97 @@
 
 #include <vector>
 #include <string>
+#include <map>
+
+/**
+ * The passive health and load of an upstream server, for example, the origin of edge,
+ * which is updated by the connections to it.
+ */
+class SrsLbServer
+{
+public:
+    // The number of active connections to server.
+    int conns;
+    // The EWMA of time to connect to server, 0 if unknown.
+    srs_utime_t rtt;
+    // The CPU load in percent reported by server, -1 if unknown.
+    int load;
+    // The consecutive failures.
+    int fails;
+    // The time of last failure, 0 if never.
+    srs_utime_t fail_at;
+    // The time of last success, 0 if never.
+    srs_utime_t update_at;
+    // The time to measure the stale server again, 0 if never.
+    srs_utime_t probe_at;
+public:
+    SrsLbServer();
+    virtual ~SrsLbServer();
+};
+
+/**
+ * The health of upstream servers, shared by all balancers in process.
+ */
+class SrsLbHealth
+{
+private:
+    static SrsLbHealth* _instance;
+    // The servers, key is the ip[:port] in config.
+    std::map<std::string, SrsLbServer*> servers_;
+public:
+    SrsLbHealth();
+    virtual ~SrsLbHealth();
+public:
+    static SrsLbHealth* instance();
+public:
+    // Fetch or create the server.
+    virtual SrsLbServer* fetch(const std::string& server);
+    // When connected to server, update the connect time and load.
+    virtual void on_connected(const std::string& server, srs_utime_t rtt, int load, srs_utime_t now);
+    // When failed to connect to server.
+    virtual void on_failed(const std::string& server, srs_utime_t now);
+    // When a connection to server is established or closed, for least connections.
+    virtual void acquire(const std::string& server);
+    virtual void release(const std::string& server);
+public:
+    // Whether server is available, which is not failed recently.
+    virtual bool available(const std::string& server, srs_utime_t now);
+    // Filter the available servers, return all servers if none is available.
+    virtual std::vector<std::string> filter(const std::vector<std::string>& servers, srs_utime_t now);
+};
+
+/**
+ * The load balance algorithm, to select the upstream server,
+ * used for edge pull and other multiple server feature.
+ */
+class ISrsLoadBalancer
+{
+public:
+    ISrsLoadBalancer();
+    virtual ~ISrsLoadBalancer();
+public:
+    virtual uint32_t current() = 0;
+    virtual std::string selected() = 0;
+    virtual std::string select(const std::vector<std::string>& servers) = 0;
+};
 
 /**
  * the round-robin load balance algorithm,
  * used for edge pull and other multiple server feature.
  */
-class SrsLbRoundRobin
+class SrsLbRoundRobin : public ISrsLoadBalancer
 {
 private:
-    // current selected index.
+    // current selected index, in the configured servers.
     int index;
     // total scheduled count.
     uint32_t count;
     // current selected server.
     std::string elem;
+    // The health to skip the failed servers, NULL to ignore.
+    SrsLbHealth* health;
 public:
-    SrsLbRoundRobin();
+    SrsLbRoundRobin(SrsLbHealth* h = NULL);
     virtual ~SrsLbRoundRobin();
 public:
     virtual uint32_t current();
@@ -34,5 +109,76 @@ public:
     virtual std::string select(const std::vector<std::string>& servers);
 };
 
-#endif
+/**
+ * Select the server with the least active connections, round-robin if equal.
+ */
+class SrsLbLeastConn : public ISrsLoadBalancer
+{
+private:
+    // The selected index, in the configured servers.
+    int index;
+    // The round-robin in the candidates, which are part of the configured servers.
+    SrsLbRoundRobin* rr;
+    SrsLbHealth* health;
+public:
+    SrsLbLeastConn(SrsLbHealth* h);
+    virtual ~SrsLbLeastConn();
+public:
+    virtual uint32_t current();
+    virtual std::string selected();
+    virtual std::string select(const std::vector<std::string>& servers);
+};
+
+/**
+ * Select the server with the least EWMA connect time weighted by the load it reported.
+ * The servers never connected are measured first, by round-robin. The server not recently
+ * connected is measured again once per stale timeout, and uses its last cost otherwise, so
+ * it does not degrade to round-robin when all servers are stale.
+ */
+class SrsLbEwma : public ISrsLoadBalancer
+{
+private:
+    // The selected index, in the configured servers.
+    int index;
+    // The round-robin in the candidates, which are part of the configured servers.
+    SrsLbRoundRobin* rr;
+    SrsLbHealth* health;
+public:
+    SrsLbEwma(SrsLbHealth* h);
+    virtual ~SrsLbEwma();
+public:
+    virtual uint32_t current();
+    virtual std::string selected();
+    virtual std::string select(const std::vector<std::string>& servers);
+};
 
+/**
+ * Select the server by consistent hash of key, generally the stream url, so the same
+ * stream always goes to the same server, and only the streams of failed server move.
+ * @remark We use the rendezvous(HRW) hash, the server with the highest hash of key and server wins.
+ */
+class SrsLbConsistentHash : public ISrsLoadBalancer
+{
+private:
+    int index;
+    std::string elem;
+    std::string key;
+    SrsLbHealth* health;
+public:
+    SrsLbConsistentHash(std::string k, SrsLbHealth* h);
+    virtual ~SrsLbConsistentHash();
+public:
+    virtual uint32_t current();
+    virtual std::string selected();
+    virtual std::string select(const std::vector<std::string>& servers);
+};
+
+// Whether the strategy of balancer is valid, see srs_lb_create.
+extern bool srs_lb_is_valid(std::string strategy);
+
+// Create the balancer by strategy, which is round_robin, least_conn, ewma(or rtt_load) or hash.
+// @param key The key for consistent hash, generally the stream url.
+// @remark The strategy should be checked by srs_lb_is_valid, or it's round_robin.
+extern ISrsLoadBalancer* srs_lb_create(std::string strategy, std::string key, SrsLbHealth* health);
+
+#endif
@@ -101,6 +101,11 @@
 #define ERROR_SOCKET_SETREUSEADDR           1079
 #define ERROR_SOCKET_SETCLOSEEXEC           1080
 #define ERROR_SOCKET_ACCEPT                 1081
+#define ERROR_THREAD_CREATE                 1082
+#define ERROR_WORKERS_FORK                  1083
+#define ERROR_WORKERS_MMAP                  1084
+#define ERROR_WORKERS_NO_OWNER              1085
+#define ERROR_WORKERS_FULL                  1086
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
@@ -272,6 +277,7 @@
 #define ERROR_INOTIFY_OPENFD                3094
 #define ERROR_INOTIFY_WATCH                 3095
 #define ERROR_HTTP_URL_UNESCAPE             3096
+#define ERROR_ENCODER_PIPE                  3097
 
 ///////////////////////////////////////////////////////
 // HTTP/StreamCaster protocol error.
@@ -314,6 +320,7 @@
 #define ERROR_HTTPS_READ                    4043
 #define ERROR_HTTPS_WRITE                   4044
 #define ERROR_HTTPS_KEY_CRT                 4045
+#define ERROR_HTTP_SENDFILE                 4046
 
 ///////////////////////////////////////////////////////
 // RTC protocol error.
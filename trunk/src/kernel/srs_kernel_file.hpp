@@ -97,6 +97,8 @@ public:
     virtual void skip(int64_t size);
     virtual int64_t seek2(int64_t offset);
     virtual int64_t filesize();
+    // Get the fd of file, -1 if not opened or not a system file, for example, to sendfile.
+    virtual int get_fd();
 // Interface ISrsReadSeeker
 public:
     virtual srs_error_t read(void* buf, size_t count, ssize_t* pnread);
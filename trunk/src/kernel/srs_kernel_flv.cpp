@@ -144,6 +144,7 @@ SrsCommonMessage::SrsCommonMessage()
 {
     payload = NULL;
     size = 0;
+    recv_tick = 0;
 }
 
 SrsCommonMessage::~SrsCommonMessage()
@@ -197,6 +198,7 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), size(0), payload(NULL)
 {
     ptr = NULL;
+    recv_tick = queue_tick = 0;
 
     ++ _srs_pps_objs_msgs->sugar;
 }
@@ -219,6 +221,7 @@ srs_error_t SrsSharedPtrMessage::create(SrsCommonMessage* msg)
     if ((err = create(&msg->header, msg->payload, msg->size)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
+    recv_tick = msg->recv_tick;
     
     // to prevent double free of payload:
     // initialize already attach the payload of msg,
@@ -333,6 +336,8 @@ SrsSharedPtrMessage* SrsSharedPtrMessage::copy()
     
     copy->timestamp = timestamp;
     copy->stream_id = stream_id;
+    copy->recv_tick = recv_tick;
+    copy->queue_tick = queue_tick;
 
     return copy;
 }
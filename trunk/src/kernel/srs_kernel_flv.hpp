@@ -202,6 +202,9 @@ public:
     // @remark, not all message payload can be decoded to packet. for example,
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
+public:
+    // The tick when the entire message is received, 0 if unknown, for latency measurement.
+    srs_utime_t recv_tick;
 public:
     SrsCommonMessage();
     virtual ~SrsCommonMessage();
@@ -272,6 +275,12 @@ public:
     // @remark, not all message payload can be decoded to packet. for example,
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
+// The ticks for latency measurement, 0 if unknown, see srs_get_tick.
+public:
+    // The tick when the message is received from the publisher or origin.
+    srs_utime_t recv_tick;
+    // The tick when the message is queued to consumer.
+    srs_utime_t queue_tick;
 
 private:
     class SrsSharedPtrPayload
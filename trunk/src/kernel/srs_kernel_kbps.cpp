@@ -8,6 +8,8 @@
 
 #include <srs_kernel_utility.hpp>
 
+#include <string.h>
+
 SrsRateSample::SrsRateSample()
 {
     total = time = -1;
@@ -42,14 +44,28 @@ void srs_pps_update(SrsRateSample& sample, int64_t nn, srs_utime_t now)
     sample.update(nn, now, pps);
 }
 
-SrsPps::SrsPps()
+SrsPps::SrsPps(const char* name)
 {
     clk_ = _srs_clock;
     sugar = 0;
+    name_ = name;
+
+    if (name_) {
+        srs_pps_registry().push_back(this);
+    }
 }
 
 SrsPps::~SrsPps()
 {
+    if (name_) {
+        std::vector<SrsPps*>& registry = srs_pps_registry();
+        for (std::vector<SrsPps*>::iterator it = registry.begin(); it != registry.end(); ++it) {
+            if (*it == this) {
+                registry.erase(it);
+                break;
+            }
+        }
+    }
 }
 
 void SrsPps::update()
@@ -62,6 +78,7 @@ void SrsPps::update(int64_t nn)
     srs_assert(clk_);
 
     srs_utime_t now = clk_->now();
+    sugar = nn;
 
     srs_pps_init(sample_10s_, nn, now);
     srs_pps_init(sample_30s_, nn, now);
@@ -91,6 +108,118 @@ int SrsPps::r10s()
     return sample_10s_.rate;
 }
 
+const char* SrsPps::name()
+{
+    return name_;
+}
+
+std::vector<SrsPps*>& srs_pps_registry()
+{
+    static std::vector<SrsPps*> registry;
+    return registry;
+}
+
+SrsHistogram::SrsHistogram(const char* name)
+{
+    name_ = name;
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+    memset(buckets_, 0, sizeof(buckets_));
+
+    srs_histogram_registry().push_back(this);
+}
+
+SrsHistogram::~SrsHistogram()
+{
+    std::vector<SrsHistogram*>& registry = srs_histogram_registry();
+    for (std::vector<SrsHistogram*>::iterator it = registry.begin(); it != registry.end(); ++it) {
+        if (*it == this) {
+            registry.erase(it);
+            break;
+        }
+    }
+}
+
+void SrsHistogram::update(srs_utime_t v)
+{
+    count_++;
+    sum_ += v;
+    max_ = srs_max(max_, v);
+
+    // The first bucket whose bound 2^i is not less than v.
+    int i = 0;
+    while (i < SRS_HISTOGRAM_BUCKETS && ((srs_utime_t)1 << i) < v) {
+        i++;
+    }
+    buckets_[i]++;
+}
+
+void SrsHistogram::reset()
+{
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+    memset(buckets_, 0, sizeof(buckets_));
+}
+
+const char* SrsHistogram::name()
+{
+    return name_;
+}
+
+int64_t SrsHistogram::count()
+{
+    return count_;
+}
+
+srs_utime_t SrsHistogram::sum()
+{
+    return sum_;
+}
+
+srs_utime_t SrsHistogram::max()
+{
+    return max_;
+}
+
+srs_utime_t SrsHistogram::percentile(double p)
+{
+    if (count_ <= 0) {
+        return 0;
+    }
+
+    int64_t target = (int64_t)(p * count_ + 0.5);
+    target = srs_max(1, srs_min(target, count_));
+
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_HISTOGRAM_BUCKETS; i++) {
+        nn += buckets_[i];
+        if (nn >= target) {
+            return srs_min(bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+srs_utime_t SrsHistogram::bound(int index)
+{
+    srs_assert(index >= 0 && index < SRS_HISTOGRAM_BUCKETS);
+    return (srs_utime_t)1 << index;
+}
+
+int64_t SrsHistogram::bucket(int index)
+{
+    srs_assert(index >= 0 && index <= SRS_HISTOGRAM_BUCKETS);
+    return buckets_[index];
+}
+
+std::vector<SrsHistogram*>& srs_histogram_registry()
+{
+    static std::vector<SrsHistogram*> registry;
+    return registry;
+}
+
 SrsWallClock::SrsWallClock()
 {
 }
@@ -9,7 +9,7 @@
 
 #include <srs_core.hpp>
 
-#include <srs_kernel_kbps.hpp>
+#include <vector>
 
 class SrsWallClock;
 
@@ -33,6 +33,8 @@ class SrsPps
 {
 private:
     SrsWallClock* clk_;
+    // The name for metrics, NULL if not registered.
+    const char* name_;
 private:
     // samples
     SrsRateSample sample_10s_;
@@ -41,20 +43,65 @@ private:
     SrsRateSample sample_5m_;
     SrsRateSample sample_60m_;
 public:
-    // Sugar for target to stat.
+    // Sugar for target to stat, which is also the total count, for metrics.
     int64_t sugar;
 public:
-    SrsPps();
+    // @param name The name for metrics, which is registered if not NULL.
+    SrsPps(const char* name = NULL);
     virtual ~SrsPps();
 public:
     // Update with the nn which is target.
     void update();
-    // Update with the nn.
+    // Update with the nn, which is also set to sugar.
     void update(int64_t nn);
     // Get the 10s average stat.
     int r10s();
+    // Get the name for metrics.
+    const char* name();
 };
 
+// Get all the named pps, for metrics.
+extern std::vector<SrsPps*>& srs_pps_registry();
+
+// The number of buckets of histogram, exclude the +Inf.
+#define SRS_HISTOGRAM_BUCKETS 25
+
+// A histogram of latency with 25 fixed buckets, whose upper bound is power of two in us, from 1us to
+// 16.7s, plus the +Inf one, so the relative error is at most 2x over the range, registered for metrics.
+class SrsHistogram
+{
+private:
+    // The name for metrics.
+    const char* name_;
+    // The count of each bucket, not cumulative, the last one is +Inf.
+    int64_t buckets_[SRS_HISTOGRAM_BUCKETS + 1];
+    int64_t count_;
+    srs_utime_t sum_;
+    srs_utime_t max_;
+public:
+    SrsHistogram(const char* name);
+    virtual ~SrsHistogram();
+public:
+    // Update with a sample of latency.
+    void update(srs_utime_t v);
+    // Clear all samples, for example, to measure a new period.
+    void reset();
+public:
+    const char* name();
+    int64_t count();
+    srs_utime_t sum();
+    srs_utime_t max();
+    // Get the estimated latency at percentile p in (0, 1], which is the upper bound of the bucket.
+    srs_utime_t percentile(double p);
+    // Get the upper bound of bucket, in srs_utime_t.
+    static srs_utime_t bound(int index);
+    // Get the count of bucket, index in [0, SRS_HISTOGRAM_BUCKETS], not cumulative.
+    int64_t bucket(int index);
+};
+
+// Get all the histograms, for metrics.
+extern std::vector<SrsHistogram*>& srs_histogram_registry();
+
 /**
  * A time source to provide wall clock.
  */
@@ -8,6 +8,7 @@
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 
 #include <arpa/inet.h>
 using namespace std;
@@ -493,7 +494,7 @@ uint32_t SrsRtcpRR::get_rb_ssrc() const
 
 float SrsRtcpRR::get_lost_rate() const
 {
-    return rb_.fraction_lost / 256;
+    return rb_.fraction_lost / 256.0;
 }
 
 uint32_t SrsRtcpRR::get_lost_packets() const
@@ -692,6 +693,7 @@ SrsRtcpTWCC::SrsRtcpTWCCChunk::SrsRtcpTWCCChunk()
 
 SrsRtcpTWCC::SrsRtcpTWCC(uint32_t sender_ssrc) : pkt_len(0)
 {
+    pkt_status_count_ = 0;
     header_.padding = 0;
     header_.type = SrsRtcpType_rtpfb;
     header_.rc = 15;
@@ -735,6 +737,16 @@ uint8_t SrsRtcpTWCC::get_feedback_count() const
 {
     return fb_pkt_count_;
 }
+
+uint16_t SrsRtcpTWCC::get_packet_status_count() const
+{
+    return pkt_status_count_;
+}
+
+const map<uint16_t, srs_utime_t>& SrsRtcpTWCC::get_recv_packets() const
+{
+    return recv_packets_;
+}
     
 vector<uint16_t> SrsRtcpTWCC::get_packet_chucks() const
 {
@@ -834,6 +846,97 @@ srs_error_t SrsRtcpTWCC::decode(SrsBuffer *buffer)
     payload_len_ = (header_.length + 1) * 4 - sizeof(SrsRtcpHeader) - 4;
     buffer->read_bytes((char *)payload_, payload_len_);
 
+    // Parse the payload, for sender to estimate the bandwidth. The corrupt feedback is ignored without
+    // any packet, rather than failing the whole compound, for the NACK or PLI after it.
+    SrsBuffer b((char*)payload_, payload_len_);
+    if ((err = decode_feedback(&b)) != srs_success) {
+        srs_warn("twcc: ignore feedback, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+
+        clear();
+        pkt_status_count_ = 0;
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcpTWCC::decode_feedback(SrsBuffer* buffer)
+{
+    srs_error_t err = srs_success;
+
+    clear();
+
+    if (!buffer->require(12)) {
+        return srs_error_new(ERROR_RTC_RTCP, "twcc: requires 12 bytes, left %d", buffer->left());
+    }
+
+    media_ssrc_ = buffer->read_4bytes();
+    base_sn_ = buffer->read_2bytes();
+    pkt_status_count_ = buffer->read_2bytes();
+    reference_time_ = buffer->read_3bytes();
+    fb_pkt_count_ = buffer->read_1bytes();
+
+    // Parse the status symbol of each packet, from the packet chunks.
+    std::vector<uint8_t> symbols;
+    symbols.reserve(pkt_status_count_);
+    while ((int)symbols.size() < pkt_status_count_) {
+        if (!buffer->require(kTwccFbChunkBytes)) {
+            return srs_error_new(ERROR_RTC_RTCP, "twcc: chunk requires %d bytes, status %d/%d",
+                kTwccFbChunkBytes, (int)symbols.size(), pkt_status_count_);
+        }
+
+        uint16_t chunk = buffer->read_2bytes();
+        encoded_chucks_.push_back(chunk);
+
+        int left = pkt_status_count_ - (int)symbols.size();
+        if ((chunk & 0x8000) == 0) {
+            // Run length chunk, |T=0|S(2bits)|Run Length(13bits)|
+            uint8_t symbol = (chunk >> 13) & 0x03;
+            int run_length = srs_min(left, chunk & kTwccFbMaxRunLength);
+            symbols.insert(symbols.end(), run_length, symbol);
+        } else if ((chunk & 0x4000) == 0) {
+            // Status vector chunk with one bit symbols, |T=1|S=0|symbol list(14bits)|
+            for (int i = 0; i < kTwccFbOneBitElements && i < left; i++) {
+                symbols.push_back((chunk >> (kTwccFbOneBitElements - 1 - i)) & 0x01);
+            }
+        } else {
+            // Status vector chunk with two bits symbols, |T=1|S=1|symbol list(14bits)|
+            for (int i = 0; i < kTwccFbTwoBitElements && i < left; i++) {
+                symbols.push_back((chunk >> (2 * (kTwccFbTwoBitElements - 1 - i))) & 0x03);
+            }
+        }
+    }
+
+    // Parse the recv delta of received packets, the small delta is 1 byte unsigned, while the
+    // large or negative delta is 2 bytes signed, in multiple of 250us.
+    srs_utime_t ts = (srs_utime_t)reference_time_ * kTwccFbTimeMultiplier;
+    for (int i = 0; i < (int)symbols.size(); i++) {
+        uint8_t symbol = symbols.at(i);
+        if (symbol == SrsRtcpTWCCStatusNotReceived || symbol == SrsRtcpTWCCStatusReserved) {
+            continue;
+        }
+
+        int16_t delta = 0;
+        if (symbol == SrsRtcpTWCCStatusSmallDelta) {
+            if (!buffer->require(1)) {
+                return srs_error_new(ERROR_RTC_RTCP, "twcc: small delta requires 1 byte, packet %d", i);
+            }
+            delta = (uint8_t)buffer->read_1bytes();
+        } else {
+            if (!buffer->require(kTwccFbLargeRecvDeltaBytes)) {
+                return srs_error_new(ERROR_RTC_RTCP, "twcc: large delta requires 2 bytes, packet %d", i);
+            }
+            delta = (int16_t)buffer->read_2bytes();
+        }
+
+        pkt_deltas_.push_back((uint16_t)delta);
+        ts += delta * kTwccFbDeltaUnit;
+
+        uint16_t sn = base_sn_ + i;
+        recv_packets_[sn] = ts;
+        recv_sns_.insert(sn);
+    }
+
     return err;
 }
 
@@ -247,6 +247,15 @@ public:
 #define kTwccFbLargeRecvDeltaBytes	2
 #define kTwccFbMaxBitElements 		kTwccFbOneBitElements
 
+// The status symbol of packet in TWCC feedback.
+enum SrsRtcpTWCCStatus
+{
+    SrsRtcpTWCCStatusNotReceived = 0,
+    SrsRtcpTWCCStatusSmallDelta = 1,
+    SrsRtcpTWCCStatusLargeDelta = 2,
+    SrsRtcpTWCCStatusReserved = 3,
+};
+
 class SrsRtcpTWCC : public SrsRtcpCommon
 {
 private:
@@ -254,6 +263,8 @@ private:
     uint16_t base_sn_;
     int32_t reference_time_;
     uint8_t fb_pkt_count_;
+    // The number of packets in feedback, including the lost ones.
+    uint16_t pkt_status_count_;
     std::vector<uint16_t> encoded_chucks_;
     std::vector<uint16_t> pkt_deltas_;
 
@@ -292,6 +303,10 @@ public:
     uint8_t get_feedback_count() const;
     std::vector<uint16_t> get_packet_chucks() const;
     std::vector<uint16_t> get_recv_deltas() const;
+    uint16_t get_packet_status_count() const;
+    // Get the received packets of the decoded feedback, key is the transport-wide sequence
+    // number and value is the arrival time in us, the lost packets are not included.
+    const std::map<uint16_t, srs_utime_t>& get_recv_packets() const;
 
     void set_media_ssrc(uint32_t ssrc);
     void set_base_sn(uint16_t sn);
@@ -309,6 +324,7 @@ public:
     virtual uint64_t nb_bytes();
     virtual srs_error_t encode(SrsBuffer *buffer);   
 private:
+    srs_error_t decode_feedback(SrsBuffer* buffer);
     srs_error_t do_encode(SrsBuffer *buffer);
 };
 
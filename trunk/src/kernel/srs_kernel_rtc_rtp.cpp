@@ -124,6 +124,66 @@ srs_error_t srs_rtp_fast_parse_twcc(char* buf, int size, uint8_t twcc_id, uint16
     return err;
 }
 
+srs_error_t srs_rtp_fast_parse_rid(char* buf, int size, uint8_t rid_id, std::string& rid)
+{
+    srs_error_t err = srs_success;
+
+    int need_size = 12 /*rtp head fix len*/ + 4 /* extension header len*/;
+    if (size < need_size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "required %d bytes, actual %d", need_size, size);
+    }
+
+    uint8_t first = buf[0];
+    bool extension = (first & 0x10);
+    uint8_t cc = (first & 0x0F);
+
+    if (!extension) {
+        return srs_error_new(ERROR_RTC_RTP, "no extension in rtp");
+    }
+
+    need_size += cc * 4; // csrc size
+    if (size < need_size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "required %d bytes, actual %d", need_size, size);
+    }
+    char* p = buf + 12 + 4 * cc;
+
+    uint16_t profile = ntohs(*((uint16_t*)p));
+    if (0xBEDE != profile) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "no support this type(0x%02x) extension", profile);
+    }
+
+    int extension_length = 4 * ntohs(*((uint16_t*)(p + 2)));
+    p += 4;
+    need_size += extension_length; // entension size
+    if (size < need_size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "required %d bytes, actual %d", need_size, size);
+    }
+
+    char* end = p + extension_length;
+    while (p < end) {
+        uint8_t v = *p++;
+        // Padding byte.
+        if (0 == v) {
+            continue;
+        }
+
+        uint8_t id = (v & 0xF0) >> 4;
+        int len = (v & 0x0F) + 1;
+        // The id 15 is reserved, we should stop parsing.
+        if (id == 15 || p + len > end) {
+            break;
+        }
+
+        if (id == rid_id) {
+            rid = std::string(p, len);
+            return err;
+        }
+        p += len;
+    }
+
+    return srs_error_new(ERROR_RTC_RTP, "no rid extension id=%d", rid_id);
+}
+
 // If value is newer than pre_value，return true; otherwise false
 bool srs_seq_is_newer(uint16_t value, uint16_t pre_value)
 {
@@ -760,8 +820,11 @@ SrsRtpPacket::SrsRtpPacket()
 
     nalu_type = SrsAvcNaluTypeReserved;
     frame_type = SrsFrameTypeReserved;
+    recv_tick = 0;
     cached_payload_size = 0;
     decode_handler = NULL;
+    spare_payload_ = NULL;
+    spare_type_ = SrsRtspPacketPayloadTypeUnknown;
 
     ++_srs_pps_objs_rtps->sugar;
 }
@@ -769,6 +832,7 @@ SrsRtpPacket::SrsRtpPacket()
 SrsRtpPacket::~SrsRtpPacket()
 {
     srs_freep(payload_);
+    srs_freep(spare_payload_);
     srs_freep(shared_buffer_);
 }
 
@@ -812,6 +876,7 @@ char* SrsRtpPacket::wrap(SrsSharedPtrMessage* msg)
 
     // Copy from the new message.
     shared_buffer_ = msg->copy();
+    recv_tick = msg->recv_tick;
     // If we wrap a message, the size of packet equals to the message size.
     actual_buffer_size_ = shared_buffer_->size;
 
@@ -830,6 +895,7 @@ SrsRtpPacket* SrsRtpPacket::copy()
     cp->shared_buffer_ = shared_buffer_? shared_buffer_->copy2() : NULL;
     cp->actual_buffer_size_ = actual_buffer_size_;
     cp->frame_type = frame_type;
+    cp->recv_tick = recv_tick;
 
     cp->cached_payload_size = cached_payload_size;
     // For performance issue, do not copy the unused field.
@@ -838,6 +904,77 @@ SrsRtpPacket* SrsRtpPacket::copy()
     return cp;
 }
 
+bool SrsRtpPacket::recycle()
+{
+    // The buffer is shared by copies, for example, in the queue of consumers.
+    if (shared_buffer_ && shared_buffer_->count() > 0) {
+        return false;
+    }
+
+    // Only keep the payload which is reused by decoder.
+    if (payload_type_ == SrsRtspPacketPayloadTypeRaw || payload_type_ == SrsRtspPacketPayloadTypeFUA2) {
+        srs_freep(spare_payload_);
+        spare_payload_ = payload_;
+        spare_type_ = payload_type_;
+    } else {
+        srs_freep(payload_);
+    }
+    payload_ = NULL;
+    payload_type_ = SrsRtspPacketPayloadTypeUnknown;
+
+    header = SrsRtpHeader();
+    actual_buffer_size_ = 0;
+    nalu_type = SrsAvcNaluTypeReserved;
+    frame_type = SrsFrameTypeReserved;
+    recv_tick = 0;
+    cached_payload_size = 0;
+    decode_handler = NULL;
+
+    return true;
+}
+
+SrsRtpRawPayload* SrsRtpPacket::reuse_raw()
+{
+    SrsRtpRawPayload* p = NULL;
+    if (spare_payload_ && spare_type_ == SrsRtspPacketPayloadTypeRaw) {
+        p = (SrsRtpRawPayload*)spare_payload_;
+        spare_payload_ = NULL;
+
+        p->payload = NULL;
+        p->nn_payload = 0;
+    } else {
+        p = new SrsRtpRawPayload();
+    }
+
+    srs_freep(payload_);
+    payload_ = p;
+    payload_type_ = SrsRtspPacketPayloadTypeRaw;
+
+    return p;
+}
+
+SrsRtpFUAPayload2* SrsRtpPacket::reuse_fua()
+{
+    SrsRtpFUAPayload2* p = NULL;
+    if (spare_payload_ && spare_type_ == SrsRtspPacketPayloadTypeFUA2) {
+        p = (SrsRtpFUAPayload2*)spare_payload_;
+        spare_payload_ = NULL;
+
+        p->start = p->end = false;
+        p->nri = p->nalu_type = (SrsAvcNaluType)0;
+        p->payload = NULL;
+        p->size = 0;
+    } else {
+        p = new SrsRtpFUAPayload2();
+    }
+
+    srs_freep(payload_);
+    payload_ = p;
+    payload_type_ = SrsRtspPacketPayloadTypeFUA2;
+
+    return p;
+}
+
 void SrsRtpPacket::set_padding(int size)
 {
     header.set_padding(size);
@@ -925,8 +1062,7 @@ srs_error_t SrsRtpPacket::decode(SrsBuffer* buf)
 
     // By default, we always use the RAW payload.
     if (!payload_) {
-        payload_ = new SrsRtpRawPayload();
-        payload_type_ = SrsRtspPacketPayloadTypeRaw;
+        reuse_raw();
     }
 
     if ((err = payload_->decode(buf)) != srs_success) {
@@ -963,6 +1099,50 @@ bool SrsRtpPacket::is_keyframe()
     return false;
 }
 
+SrsRtpPacketPool::SrsRtpPacketPool(int capacity)
+{
+    capacity_ = capacity;
+}
+
+SrsRtpPacketPool::~SrsRtpPacketPool()
+{
+    for (int i = 0; i < (int)packets_.size(); i++) {
+        SrsRtpPacket* pkt = packets_.at(i);
+        srs_freep(pkt);
+    }
+    packets_.clear();
+}
+
+SrsRtpPacket* SrsRtpPacketPool::allocate()
+{
+    if (packets_.empty()) {
+        return new SrsRtpPacket();
+    }
+
+    SrsRtpPacket* pkt = packets_.back();
+    packets_.pop_back();
+    return pkt;
+}
+
+void SrsRtpPacketPool::recycle(SrsRtpPacket* pkt)
+{
+    if (!pkt) {
+        return;
+    }
+
+    if ((int)packets_.size() >= capacity_ || !pkt->recycle()) {
+        srs_freep(pkt);
+        return;
+    }
+
+    packets_.push_back(pkt);
+}
+
+int SrsRtpPacketPool::size()
+{
+    return (int)packets_.size();
+}
+
 SrsRtpRawPayload::SrsRtpRawPayload()
 {
     payload = NULL;
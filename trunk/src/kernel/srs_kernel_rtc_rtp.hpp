@@ -48,6 +48,8 @@ class SrsRtpExtensionTypes;
 uint32_t srs_rtp_fast_parse_ssrc(char* buf, int size);
 uint8_t srs_rtp_fast_parse_pt(char* buf, int size);
 srs_error_t srs_rtp_fast_parse_twcc(char* buf, int size, uint8_t twcc_id, uint16_t& twcc_sn);
+// Fast parse the RID of simulcast from the one-byte header extension, which is not encrypted by SRTP.
+srs_error_t srs_rtp_fast_parse_rid(char* buf, int size, uint8_t rid_id, std::string& rid);
 
 // The "distance" between two uint16 number, for example:
 //      distance(prev_value=3, value=5) === (int16_t)(uint16_t)((uint16_t)3-(uint16_t)5) === -2
@@ -288,12 +290,17 @@ public:
     SrsAvcNaluType nalu_type;
     // The frame type, for RTMP bridger or SFU source.
     SrsFrameType frame_type;
+    // The tick when the packet is received, 0 if unknown, for latency measurement.
+    srs_utime_t recv_tick;
 // Fast cache for performance.
 private:
     // The cached payload size for packet.
     int cached_payload_size;
     // The helper handler for decoder, use RAW payload if NULL.
     ISrsRtspPacketDecodeHandler* decode_handler;
+    // The payload of recycled packet, to reuse by decoder.
+    ISrsRtpPayloader* spare_payload_;
+    SrsRtspPacketPayloadType spare_type_;
 public:
     SrsRtpPacket();
     virtual ~SrsRtpPacket();
@@ -305,6 +312,12 @@ public:
     char* wrap(SrsSharedPtrMessage* msg);
     // Copy the RTP packet.
     virtual SrsRtpPacket* copy();
+    // Reset the packet to decode another one, keep the buffer and payload object to reuse.
+    // @return false if the buffer is still referenced by copies, which should never be reused.
+    bool recycle();
+    // Set the payload by the spare payload if possible, to avoid allocation for decoder.
+    SrsRtpRawPayload* reuse_raw();
+    SrsRtpFUAPayload2* reuse_fua();
 public:
     // Parse the TWCC extension, ignore by default.
     void enable_twcc_decode() { header.enable_twcc_decode(); } // SrsRtpPacket::enable_twcc_decode
@@ -331,6 +344,26 @@ public:
     bool is_keyframe();
 };
 
+// The pool of RTP packets for a connection, to reuse the packets with their buffers and payloads,
+// so that we never allocate memory to decode the packets, when the packets are not referenced.
+// @remark The packet whose buffer is still shared is not reused, for example, copied by the consumers
+//      or GOP cache when nack_no_copy is off, so it mostly helps the publisher without players.
+class SrsRtpPacketPool
+{
+private:
+    int capacity_;
+    std::vector<SrsRtpPacket*> packets_;
+public:
+    SrsRtpPacketPool(int capacity);
+    virtual ~SrsRtpPacketPool();
+public:
+    // Get a packet from pool, or create a new one if empty.
+    SrsRtpPacket* allocate();
+    // Put the packet to pool, or free it if pool is full or it's still referenced.
+    void recycle(SrsRtpPacket* pkt);
+    int size();
+};
+
 // Single payload data.
 class SrsRtpRawPayload : public ISrsRtpPayloader
 {
@@ -12,6 +12,7 @@
 #include <netdb.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 #include <string.h>
@@ -150,6 +151,24 @@ srs_utime_t srs_update_system_time()
     return _srs_system_time_us_cache;
 }
 
+srs_utime_t srs_get_tick()
+{
+#ifndef SRS_OSX
+    // It's served by vDSO without syscall, which is cheap enough for the media hot path.
+    timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+        return 0;
+    }
+    return ((int64_t)now.tv_sec) * SRS_UTIME_SECONDS + (int64_t)now.tv_nsec / 1000;
+#else
+    timeval now;
+    if (gettimeofday(&now, NULL) < 0) {
+        return 0;
+    }
+    return ((int64_t)now.tv_sec) * SRS_UTIME_SECONDS + (int64_t)now.tv_usec;
+#endif
+}
+
 // TODO: FIXME: Replace by ST dns resolve.
 string srs_dns_resolve(string host, int& family)
 {
@@ -30,6 +30,10 @@ extern srs_utime_t srs_get_system_startup_time();
 // A daemon st-thread updates it.
 extern srs_utime_t srs_update_system_time();
 
+// Get the monotonic tick in srs_utime_t, which is precise but not cached, for latency measurement.
+// @remark It's not the wall clock, only the diff of ticks is meaningful.
+extern srs_utime_t srs_get_tick();
+
 // The "ANY" address to listen, it's "0.0.0.0" for ipv4, and "::" for ipv6.
 // @remark We prefer ipv4, only use ipv6 if ipv4 is disabled.
 extern std::string srs_any_address_for_listener();
@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_core.hpp>
+
+#include <srs_kernel_error.hpp>
+#include <srs_service_log.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_stream.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_kbps.hpp>
+#include <srs_protocol_kbps.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+using namespace std;
+
+// @global log and context.
+ISrsLog* _srs_log = new SrsConsoleLog(SrsLogLevelTrace, false);
+ISrsContext* _srs_context = new SrsThreadContext();
+
+// The pps for context, which is required by error.
+extern SrsPps* _srs_pps_cids_get;
+extern SrsPps* _srs_pps_cids_set;
+
+// The size to read from file each time.
+#define SRS_LOG_DECODER_CHUNK 65536
+
+srs_error_t decode(std::string log_file)
+{
+    srs_error_t err = srs_success;
+
+    SrsFileReader fr;
+    if ((err = fr.open(log_file)) != srs_success) {
+        return srs_error_wrap(err, "open log file %s", log_file.c_str());
+    }
+
+    SrsSimpleStream* stream = new SrsSimpleStream();
+    SrsAutoFree(SrsSimpleStream, stream);
+
+    char* chunk = new char[SRS_LOG_DECODER_CHUNK];
+    SrsAutoFreeA(char, chunk);
+
+    SrsBinaryLogDecoder decoder;
+    while (true) {
+        ssize_t nread = 0;
+        if ((err = fr.read(chunk, SRS_LOG_DECODER_CHUNK, &nread)) != srs_success) {
+            return srs_error_wrap(err, "read log");
+        }
+        stream->append(chunk, (int)nread);
+
+        // Decode all complete records in stream.
+        int pos = 0;
+        while (pos < stream->length()) {
+            int nn = 0;
+            string text;
+            if ((err = decoder.decode(stream->bytes() + pos, stream->length() - pos, &nn, text)) != srs_success) {
+                return srs_error_wrap(err, "decode at %d", (int)fr.tellg() - stream->length() + pos);
+            }
+
+            if (!nn) {
+                break;
+            }
+            pos += nn;
+
+            if (!text.empty()) {
+                fprintf(stdout, "%s\n", text.c_str());
+            }
+        }
+        stream->erase(pos);
+    }
+
+    return err;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printf("SRS log decoder/%d.%d.%d, render the binary log to text.\n"
+               "Usage: %s <log_file>\n"
+               "        log_file The binary log file, see srs_log_format in full.conf.\n"
+               "For example:\n"
+               "        %s objs/srs.log\n"
+               "        %s objs/srs.log |grep Error\n",
+               VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION,
+               argv[0], argv[0], argv[0]);
+
+        exit(-1);
+    }
+    string log_file = argv[1];
+
+    _srs_clock = new SrsWallClock();
+    _srs_pps_cids_get = new SrsPps();
+    _srs_pps_cids_set = new SrsPps();
+
+    srs_error_t err = decode(log_file);
+    int code = srs_error_code(err);
+
+    if (code != ERROR_SYSTEM_FILE_EOF) {
+        srs_error("Decode error %s", srs_error_desc(err).c_str());
+    }
+
+    srs_freep(err);
+    return code == ERROR_SYSTEM_FILE_EOF? 0 : code;
+}
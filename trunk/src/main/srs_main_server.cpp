@@ -38,6 +38,8 @@ using namespace std;
 #include <srs_kernel_file.hpp>
 #include <srs_app_hybrid.hpp>
 #include <srs_app_threads.hpp>
+#include <srs_app_workers.hpp>
+#include <srs_app_conn.hpp>
 #ifdef SRS_RTC
 #include <srs_app_rtc_conn.hpp>
 #include <srs_app_rtc_server.hpp>
@@ -442,11 +444,27 @@ srs_error_t run_hybrid_server()
 {
     srs_error_t err = srs_success;
 
+    // Generate the TLS ticket keys before fork, so workers share them.
+    if ((err = srs_ssl_ticket_keys_initialize()) != srs_success) {
+        return srs_error_wrap(err, "ticket keys");
+    }
+
+    // For workers, the master forks and waits for the workers, which run the hybrid server.
+    if ((err = _srs_workers->run()) != srs_success) {
+        return srs_error_wrap(err, "workers");
+    }
+    if (_srs_workers->is_master()) {
+        return err;
+    }
+
     // Create servers and register them.
     _srs_hybrid->register_server(new SrsServerAdapter());
 
 #ifdef SRS_SRT
-    _srs_hybrid->register_server(new SrtServerAdapter());
+    // For workers, only the primary worker runs the SRT server.
+    if (_srs_workers->is_primary()) {
+        _srs_hybrid->register_server(new SrtServerAdapter());
+    }
 #endif
 
 #ifdef SRS_RTC
@@ -463,6 +481,11 @@ srs_error_t run_hybrid_server()
         return srs_error_wrap(err, "init circuit breaker");
     }
 
+    // Refill the DH keys for RTMP handshake, which depends on hybrid.
+    if ((err = _srs_dh_refiller->initialize()) != srs_success) {
+        return srs_error_wrap(err, "init dh refiller");
+    }
+
     // Should run util hybrid servers all done.
     if ((err = _srs_hybrid->run()) != srs_success) {
         return srs_error_wrap(err, "hybrid run");
@@ -7,6 +7,8 @@
 #include <srs_http_stack.hpp>
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <sys/stat.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -22,7 +24,7 @@ using namespace std;
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
 // @see ISrsHttpMessage._http_ts_send_buffer
-#define SRS_HTTP_TS_SEND_BUFFER_SIZE 4096
+#define SRS_HTTP_TS_SEND_BUFFER_SIZE 65536
 
 // get the status text of code.
 string srs_generate_http_status_text(int status)
@@ -231,6 +233,16 @@ ISrsHttpResponseWriter::~ISrsHttpResponseWriter()
 {
 }
 
+bool ISrsHttpResponseWriter::sendfile_supported()
+{
+    return false;
+}
+
+srs_error_t ISrsHttpResponseWriter::sendfile(int fd, int64_t offset, int64_t size)
+{
+    return srs_error_new(ERROR_HTTP_SENDFILE, "sendfile not supported");
+}
+
 ISrsHttpResponseReader::ISrsHttpResponseReader()
 {
 }
@@ -331,11 +343,246 @@ string srs_http_fs_fullpath(string dir, string pattern, string upath)
     return fullpath;
 }
 
+bool srs_http_parse_range(string range, int64_t size, int64_t& start, int64_t& end)
+{
+    if (range.find("bytes=") != 0) {
+        return false;
+    }
+    range = range.substr(6);
+
+    // Ignore the multiple ranges, which is optional.
+    size_t pos = range.find("-");
+    if (pos == string::npos || range.find(",") != string::npos) {
+        return false;
+    }
+
+    string first = range.substr(0, pos);
+    string last = range.substr(pos + 1);
+    if (first.empty() && last.empty()) {
+        return false;
+    }
+
+    // The suffix range, for example, bytes=-500 for the last 500 bytes.
+    if (first.empty()) {
+        int64_t suffix = ::atoll(last.c_str());
+        start = (suffix > 0)? srs_max(size - suffix, 0) : size;
+        end = size - 1;
+        return true;
+    }
+
+    start = ::atoll(first.c_str());
+    end = last.empty()? size - 1 : ::atoll(last.c_str());
+    if (start < 0 || (!last.empty() && end < start)) {
+        return false;
+    }
+
+    end = srs_min(end, size - 1);
+    return true;
+}
+
+// The etag of file, by the mtime in ns, size and inode.
+static bool srs_http_stat_etag(struct stat& st, string& etag)
+{
+    if (!S_ISREG(st.st_mode)) {
+        return false;
+    }
+
+    // Use the mtime in ns, because the playlist might be updated in a second.
+#ifdef SRS_OSX
+    int64_t mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    int64_t mtime = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+
+    // The inode is changed when file is replaced by rename, for example, the HLS playlist.
+    char buf[128];
+    snprintf(buf, sizeof(buf), "\"%" PRIx64 "-%" PRIx64 "-%" PRIx64 "\"",
+        (uint64_t)mtime, (uint64_t)st.st_size, (uint64_t)st.st_ino);
+    etag = buf;
+
+    return true;
+}
+
+bool srs_http_file_etag(string path, string& etag)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+
+    return srs_http_stat_etag(st, etag);
+}
+
+bool srs_http_file_etag(int fd, string& etag)
+{
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    return srs_http_stat_etag(st, etag);
+}
+
+bool srs_http_etag_matched(string if_none_match, string etag)
+{
+    if (if_none_match.empty() || etag.empty()) {
+        return false;
+    }
+
+    if (srs_string_trim_start(srs_string_trim_end(if_none_match, " "), " ") == "*") {
+        return true;
+    }
+
+    // We never generate weak etag, but client might response it, which is also matched for GET.
+    vector<string> tags = srs_string_split(if_none_match, ",");
+    for (int i = 0; i < (int)tags.size(); i++) {
+        string tag = srs_string_trim_start(srs_string_trim_end(tags.at(i), " "), " ");
+        if (srs_string_starts_with(tag, "W/")) {
+            tag = tag.substr(2);
+        }
+        if (tag == etag) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+SrsHttpFileCacheEntry::SrsHttpFileCacheEntry()
+{
+    data = NULL;
+    size = 0;
+    refs = 0;
+    cached = false;
+}
+
+SrsHttpFileCacheEntry::~SrsHttpFileCacheEntry()
+{
+    srs_freepa(data);
+}
+
+SrsHttpFileCache::SrsHttpFileCache(int64_t max_size, int64_t max_file)
+{
+    max_size_ = max_size;
+    max_file_ = srs_min(max_file, max_size);
+    size_ = 0;
+    nn_hits_ = 0;
+    nn_misses_ = 0;
+}
+
+SrsHttpFileCache::~SrsHttpFileCache()
+{
+    while (!lru_.empty()) {
+        evict(lru_.back());
+    }
+}
+
+srs_error_t SrsHttpFileCache::fetch(string path, string etag, SrsFileReader* fr, SrsHttpFileCacheEntry** pentry)
+{
+    srs_error_t err = srs_success;
+
+    *pentry = NULL;
+
+    std::map<std::string, SrsHttpFileCacheEntry*>::iterator it = entries_.find(path);
+    if (it != entries_.end()) {
+        SrsHttpFileCacheEntry* entry = it->second;
+
+        // Hit, move to the front of LRU.
+        if (entry->etag == etag) {
+            lru_.splice(lru_.begin(), lru_, entry->lru);
+            entry->refs++;
+            nn_hits_++;
+            *pentry = entry;
+            return err;
+        }
+
+        // The file is modified, load it again.
+        evict(entry);
+    }
+
+    nn_misses_++;
+
+    int64_t filesize = fr->filesize();
+    if (filesize > max_file_) {
+        return err;
+    }
+
+    SrsHttpFileCacheEntry* entry = new SrsHttpFileCacheEntry();
+    entry->path = path;
+    entry->etag = etag;
+    entry->size = (int)filesize;
+    entry->data = new char[srs_max(entry->size, 1)];
+
+    // Read the whole file, without any coroutine switch.
+    for (int pos = 0; pos < entry->size;) {
+        ssize_t nread = 0;
+        if ((err = fr->read(entry->data + pos, entry->size - pos, &nread)) != srs_success) {
+            srs_freep(entry);
+            return srs_error_wrap(err, "read %s, pos=%d, size=%d", path.c_str(), pos, (int)filesize);
+        }
+        pos += (int)nread;
+    }
+
+    entry->cached = true;
+    entries_[path] = entry;
+    lru_.push_front(entry);
+    entry->lru = lru_.begin();
+    size_ += entry->size;
+
+    // Evict the least recently used files, except the new one.
+    while (size_ > max_size_ && lru_.size() > 1) {
+        evict(lru_.back());
+    }
+
+    entry->refs++;
+    *pentry = entry;
+
+    return err;
+}
+
+void SrsHttpFileCache::release(SrsHttpFileCacheEntry* entry)
+{
+    entry->refs--;
+
+    if (!entry->cached && entry->refs <= 0) {
+        srs_freep(entry);
+    }
+}
+
+int64_t SrsHttpFileCache::size()
+{
+    return size_;
+}
+
+int64_t SrsHttpFileCache::hits()
+{
+    return nn_hits_;
+}
+
+int64_t SrsHttpFileCache::misses()
+{
+    return nn_misses_;
+}
+
+void SrsHttpFileCache::evict(SrsHttpFileCacheEntry* entry)
+{
+    entries_.erase(entry->path);
+    lru_.erase(entry->lru);
+    size_ -= entry->size;
+    entry->cached = false;
+
+    // The entry in sending is freed when released.
+    if (entry->refs <= 0) {
+        srs_freep(entry);
+    }
+}
+
 SrsHttpFileServer::SrsHttpFileServer(string root_dir)
 {
     dir = root_dir;
     fs_factory = new ISrsFileReaderFactory();
     _srs_path_exists = srs_path_exists;
+    cache = NULL;
 }
 
 SrsHttpFileServer::~SrsHttpFileServer()
@@ -343,6 +590,11 @@ SrsHttpFileServer::~SrsHttpFileServer()
     srs_freep(fs_factory);
 }
 
+void SrsHttpFileServer::set_cache(SrsHttpFileCache* v)
+{
+    cache = v;
+}
+
 void SrsHttpFileServer::set_fs_factory(ISrsFileReaderFactory* f)
 {
     srs_freep(fs_factory);
@@ -397,10 +649,66 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
         return srs_error_wrap(err, "open file %s", fullpath.c_str());
     }
 
-    // The length of bytes we could response to.
-    int64_t length = fs->filesize() - fs->tellg();
-    
-    // unset the content length to encode in chunked encoding.
+    // Response 304 if not modified, for example, the repeat polls of HLS playlist.
+    // @remark The etag is of the opened file, so it always matches the bytes we send, even if the file
+    //      is replaced after opened.
+    string etag;
+    if (srs_http_file_etag(fs->get_fd(), etag)) {
+        w->header()->set("ETag", etag);
+
+        SrsHttpHeader* h = r->header();
+        if (h && srs_http_etag_matched(h->get("If-None-Match"), etag)) {
+            w->write_header(SRS_CONSTS_HTTP_NotModified);
+            return w->final_request();
+        }
+    }
+
+    // Serve the hot file from memory, or from disk if not cacheable.
+    SrsHttpFileCacheEntry* entry = NULL;
+    if (cache && !etag.empty() && (err = cache->fetch(fullpath, etag, fs, &entry)) != srs_success) {
+        return srs_error_wrap(err, "cache file %s", fullpath.c_str());
+    }
+
+    err = do_serve_file(w, r, fullpath, fs, entry);
+
+    if (entry) {
+        cache->release(entry);
+    }
+
+    return err;
+}
+
+srs_error_t SrsHttpFileServer::do_serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, SrsFileReader* fs, SrsHttpFileCacheEntry* entry)
+{
+    srs_error_t err = srs_success;
+
+    // The range of bytes we could response to, in [start, end].
+    int64_t size = entry? entry->size : fs->filesize();
+    int64_t start = 0;
+    int64_t end = size - 1;
+
+    // Response the part of file for range request, or whole file if no or multiple ranges.
+    // https://developer.mozilla.org/zh-CN/docs/Web/HTTP/Range_requests
+    SrsHttpHeader* h = r->header();
+    bool partial = h && srs_http_parse_range(h->get("Range"), size, start, end);
+
+    if (partial && start >= size) {
+        std::stringstream content_range;
+        content_range << "bytes */" << size;
+        w->header()->set("Content-Range", content_range.str());
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_RequestedRangeNotSatisfiable);
+    }
+
+    if (partial) {
+        std::stringstream content_range;
+        content_range << "bytes " << start << "-" << end << "/" << size;
+        w->header()->set("Content-Range", content_range.str());
+        if (!entry) {
+            fs->seek2(start);
+        }
+    }
+
+    int64_t length = end - start + 1;
     w->header()->set_content_length(length);
     
     static std::map<std::string, std::string> _mime;
@@ -449,12 +757,15 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
         }
     }
 
-    // Enter chunked mode, because we didn't set the content-length.
-    w->write_header(SRS_CONSTS_HTTP_OK);
+    w->write_header(partial? SRS_CONSTS_HTTP_PartialContent : SRS_CONSTS_HTTP_OK);
     
     // write body.
     int64_t left = length;
-    if ((err = copy(w, fs, r, (int)left)) != srs_success) {
+    if (entry) {
+        if ((err = w->write(entry->data + start, (int)left)) != srs_success) {
+            return srs_error_wrap(err, "write cached file=%s size=%d", fullpath.c_str(), (int)left);
+        }
+    } else if ((err = copy(w, fs, r, (int)left)) != srs_success) {
         return srs_error_wrap(err, "copy file=%s size=%d", fullpath.c_str(), (int)left);
     }
     
@@ -542,6 +853,16 @@ srs_error_t SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs
 {
     srs_error_t err = srs_success;
     
+    // Send file in kernel for plaintext TCP, without copy to user space.
+    int fd = fs->get_fd();
+    if (fd >= 0 && w->sendfile_supported()) {
+        if ((err = w->sendfile(fd, fs->tellg(), size)) != srs_success) {
+            return srs_error_wrap(err, "sendfile size=%d", size);
+        }
+        fs->skip(size);
+        return err;
+    }
+    
     int left = size;
     char* buf = new char[SRS_HTTP_TS_SEND_BUFFER_SIZE];
     SrsAutoFreeA(char, buf);
@@ -574,6 +895,122 @@ SrsHttpMuxEntry::~SrsHttpMuxEntry()
     srs_freep(handler);
 }
 
+// The node of radix tree, the edge from parent is the label, so the pattern of node
+// is the labels from root to it.
+class SrsHttpMuxNode
+{
+public:
+    std::string label;
+    // The entry of pattern which ends at this node, NULL if none.
+    SrsHttpMuxEntry* entry;
+    // The children, key is the first char of label.
+    std::map<char, SrsHttpMuxNode*> children;
+public:
+    SrsHttpMuxNode(std::string l, SrsHttpMuxEntry* e);
+    virtual ~SrsHttpMuxNode();
+public:
+    // Get the child whose label starts with ch, NULL if not found.
+    SrsHttpMuxNode* child(char ch);
+};
+
+SrsHttpMuxNode::SrsHttpMuxNode(string l, SrsHttpMuxEntry* e)
+{
+    label = l;
+    entry = e;
+}
+
+SrsHttpMuxNode::~SrsHttpMuxNode()
+{
+    std::map<char, SrsHttpMuxNode*>::iterator it;
+    for (it = children.begin(); it != children.end(); ++it) {
+        SrsHttpMuxNode* node = it->second;
+        srs_freep(node);
+    }
+    children.clear();
+}
+
+SrsHttpMuxNode* SrsHttpMuxNode::child(char ch)
+{
+    std::map<char, SrsHttpMuxNode*>::iterator it = children.find(ch);
+    if (it == children.end()) {
+        return NULL;
+    }
+    return it->second;
+}
+
+SrsHttpMuxTree::SrsHttpMuxTree()
+{
+    root = new SrsHttpMuxNode("", NULL);
+}
+
+SrsHttpMuxTree::~SrsHttpMuxTree()
+{
+    srs_freep(root);
+}
+
+void SrsHttpMuxTree::insert(string pattern, SrsHttpMuxEntry* entry)
+{
+    SrsHttpMuxNode* node = root;
+    size_t pos = 0;
+
+    while (pos < pattern.length()) {
+        SrsHttpMuxNode* next = node->child(pattern.at(pos));
+        if (!next) {
+            node->children[pattern.at(pos)] = new SrsHttpMuxNode(pattern.substr(pos), entry);
+            return;
+        }
+
+        // The common prefix of label and the left pattern.
+        size_t n = 0;
+        while (n < next->label.length() && pos + n < pattern.length() && next->label.at(n) == pattern.at(pos + n)) {
+            n++;
+        }
+
+        // Split the label at the common prefix, for example, insert /api/v1 to /api/v2, then
+        // the /api/v2 is splitted to /api/v and 2.
+        if (n < next->label.length()) {
+            SrsHttpMuxNode* mid = new SrsHttpMuxNode(next->label.substr(0, n), NULL);
+            next->label = next->label.substr(n);
+            mid->children[next->label.at(0)] = next;
+            node->children[mid->label.at(0)] = mid;
+            next = mid;
+        }
+
+        node = next;
+        pos += n;
+    }
+
+    node->entry = entry;
+}
+
+SrsHttpMuxEntry* SrsHttpMuxTree::match(const string& path)
+{
+    SrsHttpMuxEntry* matched = NULL;
+
+    SrsHttpMuxNode* node = root;
+    size_t pos = 0;
+
+    while (true) {
+        // The pattern is path[0, pos), which ends with '/' to match any, or exactly match the path.
+        SrsHttpMuxEntry* entry = node->entry;
+        if (entry && entry->enabled && (pos == path.length() || (pos > 0 && path.at(pos - 1) == '/'))) {
+            matched = entry;
+        }
+
+        if (pos >= path.length()) {
+            break;
+        }
+
+        node = node->child(path.at(pos));
+        if (!node || path.compare(pos, node->label.length(), node->label) != 0) {
+            break;
+        }
+        pos += node->label.length();
+    }
+
+    return matched;
+}
+
 ISrsHttpMatchHijacker::ISrsHttpMatchHijacker()
 {
 }
@@ -592,6 +1029,7 @@ ISrsHttpServeMux::~ISrsHttpServeMux()
 
 SrsHttpServeMux::SrsHttpServeMux()
 {
+    tree = new SrsHttpMuxTree();
 }
 
 SrsHttpServeMux::~SrsHttpServeMux()
@@ -602,6 +1040,7 @@ SrsHttpServeMux::~SrsHttpServeMux()
         srs_freep(entry);
     }
     entries.clear();
+    srs_freep(tree);
     
     vhosts.clear();
     hijackers.clear();
@@ -669,6 +1108,7 @@ srs_error_t SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handle
             srs_freep(exists);
         }
         entries[pattern] = entry;
+        tree->insert(pattern, entry);
     }
     
     // Helpful behavior:
@@ -694,6 +1134,7 @@ srs_error_t SrsHttpServeMux::handle(std::string pattern, ISrsHttpHandler* handle
             entry->handler->entry = entry;
             
             entries[rpattern] = entry;
+            tree->insert(rpattern, entry);
         }
     }
     
@@ -759,57 +1200,12 @@ srs_error_t SrsHttpServeMux::match(ISrsHttpMessage* r, ISrsHttpHandler** ph)
         path = r->host() + path;
     }
     
-    int nb_matched = 0;
-    ISrsHttpHandler* h = NULL;
-    
-    std::map<std::string, SrsHttpMuxEntry*>::iterator it;
-    for (it = entries.begin(); it != entries.end(); ++it) {
-        std::string pattern = it->first;
-        SrsHttpMuxEntry* entry = it->second;
-        
-        if (!entry->enabled) {
-            continue;
-        }
-        
-        if (!path_match(pattern, path)) {
-            continue;
-        }
-        
-        if (!h || (int)pattern.length() > nb_matched) {
-            nb_matched = (int)pattern.length();
-            h = entry->handler;
-        }
-    }
-    
-    *ph = h;
+    SrsHttpMuxEntry* entry = tree->match(path);
+    *ph = entry? entry->handler : NULL;
     
     return srs_success;
 }
 
-bool SrsHttpServeMux::path_match(string pattern, string path)
-{
-    if (pattern.empty()) {
-        return false;
-    }
-    
-    int n = (int)pattern.length();
-    
-    // not endswith '/', exactly match.
-    if (pattern.at(n - 1) != '/') {
-        return pattern == path;
-    }
-    
-    // endswith '/', match any,
-    // for example, '/api/' match '/api/[N]'
-    if ((int)path.length() >= n) {
-        if (memcmp(pattern.data(), path.data(), n) == 0) {
-            return true;
-        }
-    }
-    
-    return false;
-}
-
 SrsHttpCorsMux::SrsHttpCorsMux()
 {
     next = NULL;
@@ -12,6 +12,7 @@
 #include <srs_kernel_io.hpp>
 
 #include <map>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,7 @@ class SrsFileReader;
 class SrsHttpHeader;
 class ISrsHttpMessage;
 class SrsHttpMuxEntry;
+class SrsHttpMuxNode;
 class ISrsHttpResponseWriter;
 class SrsJsonObject;
 class ISrsFileReaderFactory;
@@ -192,6 +194,12 @@ public:
     // send error codes.
     // @remark, user must set header then write or write_header.
     virtual void write_header(int code) = 0;
+public:
+    // Whether could send file in kernel without copy, see sendfile.
+    virtual bool sendfile_supported();
+    // Send size bytes of file fd from offset as body in kernel, only for response with content-length.
+    // @remark The file position is not changed.
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size);
 };
 
 // The reader interface for http response.
@@ -255,6 +263,78 @@ typedef bool (*_pfn_srs_path_exists)(std::string path);
 // Build the file path from request r.
 extern std::string srs_http_fs_fullpath(std::string dir, std::string pattern, std::string upath);
 
+// Parse the single range of header, such as bytes=0-499, bytes=500- or bytes=-500, of file in size bytes.
+// @param start, end The range in [start, end], start >= size if not satisfiable.
+// @return false if no or multiple ranges, so serve the whole file.
+extern bool srs_http_parse_range(std::string range, int64_t size, int64_t& start, int64_t& end);
+
+// The validator of file, by the identity of the file.
+// @return false if file not exists or not a regular file.
+extern bool srs_http_file_etag(std::string path, std::string& etag);
+// The validator of the opened file, which is not changed even if the file is replaced after opened.
+extern bool srs_http_file_etag(int fd, std::string& etag);
+
+// Whether the If-None-Match header matches the etag, such as "x", "x", "y" or *.
+extern bool srs_http_etag_matched(std::string if_none_match, std::string etag);
+
+// The file cached in memory, shared by the requests which are sending it.
+class SrsHttpFileCacheEntry
+{
+public:
+    std::string path;
+    char* data;
+    int size;
+    // The validator of file, the modified or replaced file is loaded again.
+    std::string etag;
+public:
+    // The number of requests which are sending it.
+    int refs;
+    // Whether in cache, the evicted entry is freed when released by the last request.
+    bool cached;
+    // The position in the LRU list.
+    std::list<SrsHttpFileCacheEntry*>::iterator lru;
+public:
+    SrsHttpFileCacheEntry();
+    virtual ~SrsHttpFileCacheEntry();
+};
+
+// The LRU cache of hot files, for example, the HLS/DASH segments and playlists requested by lots
+// of players at the same time, to serve them from memory without reading the disk.
+// @remark The file is loaded without any coroutine switch, so the concurrent requests of a new file
+//      are coalesced, that is, the first one loads it and others hit the cache.
+class SrsHttpFileCache
+{
+private:
+    // The max bytes of all files, and the max bytes of a file to cache.
+    int64_t max_size_;
+    int64_t max_file_;
+    // The bytes of all files in cache.
+    int64_t size_;
+    // The cached files, key is the full path.
+    std::map<std::string, SrsHttpFileCacheEntry*> entries_;
+    // The LRU list, the most recently used at front.
+    std::list<SrsHttpFileCacheEntry*> lru_;
+private:
+    int64_t nn_hits_;
+    int64_t nn_misses_;
+public:
+    SrsHttpFileCache(int64_t max_size, int64_t max_file);
+    virtual ~SrsHttpFileCache();
+public:
+    // Fetch the file with etag from cache, load it from the opened file fr if not cached or modified.
+    // @param fr The opened file of etag, read from its current position if loaded.
+    // @param pentry Output the entry, NULL if not cacheable, for example, the file is too large.
+    // @remark User must release the entry after sending it.
+    virtual srs_error_t fetch(std::string path, std::string etag, SrsFileReader* fr, SrsHttpFileCacheEntry** pentry);
+    virtual void release(SrsHttpFileCacheEntry* entry);
+public:
+    virtual int64_t size();
+    virtual int64_t hits();
+    virtual int64_t misses();
+private:
+    virtual void evict(SrsHttpFileCacheEntry* entry);
+};
+
 // FileServer returns a handler that serves HTTP requests
 // with the contents of the file system rooted at root.
 //
@@ -270,9 +350,13 @@ protected:
 protected:
     ISrsFileReaderFactory* fs_factory;
     _pfn_srs_path_exists _srs_path_exists;
+    // The cache of hot files, NULL to disable it. Not owned by server.
+    SrsHttpFileCache* cache;
 public:
     SrsHttpFileServer(std::string root_dir);
     virtual ~SrsHttpFileServer();
+public:
+    virtual void set_cache(SrsHttpFileCache* v);
 private:
     // For utest to mock the fs.
     virtual void set_fs_factory(ISrsFileReaderFactory* v);
@@ -283,6 +367,8 @@ public:
 private:
     // Serve the file by specified path
     virtual srs_error_t serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
+    // Serve the file from cache entry, or from the opened file fs if entry is NULL.
+    virtual srs_error_t do_serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, SrsFileReader* fs, SrsHttpFileCacheEntry* entry);
     virtual srs_error_t serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
     virtual srs_error_t serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
 protected:
@@ -312,6 +398,24 @@ public:
     virtual ~SrsHttpMuxEntry();
 };
 
+// The radix tree of mux patterns, to match the path in O(length of path), no matter how many
+// patterns, for example, each live stream mounts some patterns for FLV, TS and HLS.
+// @remark The tree never frees the entries, which are owned by the mux.
+class SrsHttpMuxTree
+{
+private:
+    SrsHttpMuxNode* root;
+public:
+    SrsHttpMuxTree();
+    virtual ~SrsHttpMuxTree();
+public:
+    // Insert or replace the entry of pattern.
+    virtual void insert(std::string pattern, SrsHttpMuxEntry* entry);
+    // Match the enabled entry of the longest pattern, NULL if not found.
+    // The pattern ends with '/' matches the path starts with it, others matches the path exactly.
+    virtual SrsHttpMuxEntry* match(const std::string& path);
+};
+
 // The hijacker for http pattern match.
 class ISrsHttpMatchHijacker
 {
@@ -367,6 +471,8 @@ class SrsHttpServeMux : public ISrsHttpServeMux
 private:
     // The pattern handler, to handle the http request.
     std::map<std::string, SrsHttpMuxEntry*> entries;
+    // The radix tree of entries, to match the path fast.
+    SrsHttpMuxTree* tree;
     // The vhost handler.
     // When find the handler to process the request,
     // append the matched vhost when pattern not starts with /,
@@ -397,7 +503,6 @@ public:
     virtual srs_error_t find_handler(ISrsHttpMessage* r, ISrsHttpHandler** ph);
 private:
     virtual srs_error_t match(ISrsHttpMessage* r, ISrsHttpHandler** ph);
-    virtual bool path_match(std::string pattern, std::string path);
 };
 
 // The filter http mux, directly serve the http CORS requests,
@@ -38,3 +38,11 @@ ISrsProtocolReadWriter::~ISrsProtocolReadWriter()
 {
 }
 
+ISrsProtocolFileWriter::ISrsProtocolFileWriter()
+{
+}
+
+ISrsProtocolFileWriter::~ISrsProtocolFileWriter()
+{
+}
+
@@ -104,5 +104,20 @@ public:
     virtual ~ISrsProtocolReadWriter();
 };
 
+/**
+ * The writer to send file to peer in kernel, without copy to user space, for example, the
+ * plaintext TCP by sendfile.
+ */
+class ISrsProtocolFileWriter
+{
+public:
+    ISrsProtocolFileWriter();
+    virtual ~ISrsProtocolFileWriter();
+public:
+    // Send size bytes of file fd from offset to peer, the file position is not changed.
+    // @param nwrite, the actual write bytes, ignore if NULL.
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, ssize_t* nwrite) = 0;
+};
+
 #endif
 
@@ -1308,7 +1308,10 @@ void json_value_free (json_value * value)
 
 #include <srs_protocol_json.hpp>
 
+#include <stdio.h>
+#include <string.h>
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -1998,6 +2001,202 @@ SrsAmf0Any* SrsJsonArray::to_amf0()
     return arr;
 }
 
+SrsJsonWriter::SrsJsonWriter(int size)
+{
+    size_ = srs_max(size, 64);
+    buf_ = new char[size_];
+    pos_ = 0;
+    fields_depth_ = 0;
+    skip_ = 0;
+}
+
+SrsJsonWriter::~SrsJsonWriter()
+{
+    srs_freepa(buf_);
+}
+
+void SrsJsonWriter::select(const vector<string>& fields, int depth)
+{
+    fields_ = fields;
+    fields_depth_ = depth;
+}
+
+void SrsJsonWriter::object_start(const char* name)
+{
+    if (!prefix(name)) {
+        skip_++;
+        return;
+    }
+
+    append("{", 1);
+    levels_.push_back(0);
+}
+
+void SrsJsonWriter::object_end()
+{
+    if (skip_ > 0) {
+        skip_--;
+        return;
+    }
+
+    append("}", 1);
+    levels_.pop_back();
+}
+
+void SrsJsonWriter::array_start(const char* name)
+{
+    if (!prefix(name)) {
+        skip_++;
+        return;
+    }
+
+    append("[", 1);
+    levels_.push_back(0);
+}
+
+void SrsJsonWriter::array_end()
+{
+    if (skip_ > 0) {
+        skip_--;
+        return;
+    }
+
+    append("]", 1);
+    levels_.pop_back();
+}
+
+void SrsJsonWriter::str(const char* name, const string& v)
+{
+    if (!prefix(name)) {
+        return;
+    }
+
+    append("\"", 1);
+    escape(v.data(), (int)v.length());
+    append("\"", 1);
+}
+
+void SrsJsonWriter::integer(const char* name, int64_t v)
+{
+    if (!prefix(name)) {
+        return;
+    }
+
+    char tmp[24];
+    int nn = snprintf(tmp, sizeof(tmp), "%" PRId64, v);
+    append(tmp, nn);
+}
+
+void SrsJsonWriter::number(const char* name, double v)
+{
+    if (!prefix(name)) {
+        return;
+    }
+
+    // Keep the same precision as SrsJsonAny.
+    char tmp[32];
+    int nn = snprintf(tmp, sizeof(tmp), "%.2f", v);
+    append(tmp, srs_min(nn, (int)sizeof(tmp) - 1));
+}
+
+void SrsJsonWriter::boolean(const char* name, bool v)
+{
+    if (!prefix(name)) {
+        return;
+    }
+
+    if (v) {
+        append("true", 4);
+    } else {
+        append("false", 5);
+    }
+}
+
+void SrsJsonWriter::null(const char* name)
+{
+    if (!prefix(name)) {
+        return;
+    }
+
+    append("null", 4);
+}
+
+char* SrsJsonWriter::bytes()
+{
+    return buf_;
+}
+
+int SrsJsonWriter::length()
+{
+    return pos_;
+}
+
+void SrsJsonWriter::reset()
+{
+    pos_ = 0;
+}
+
+bool SrsJsonWriter::prefix(const char* name)
+{
+    if (skip_ > 0) {
+        return false;
+    }
+
+    if (levels_.empty()) {
+        return true;
+    }
+
+    // Ignore the field not selected.
+    if (name && !fields_.empty() && (int)levels_.size() == fields_depth_) {
+        if (std::find(fields_.begin(), fields_.end(), string(name)) == fields_.end()) {
+            return false;
+        }
+    }
+
+    if (levels_.back()++ > 0) {
+        append(",", 1);
+    }
+
+    if (name) {
+        append("\"", 1);
+        escape(name, (int)strlen(name));
+        append("\":", 2);
+    }
+
+    return true;
+}
+
+void SrsJsonWriter::append(const char* data, int size)
+{
+    if (pos_ + size > size_) {
+        int nsize = srs_max(size_ * 2, pos_ + size);
+        char* buf = new char[nsize];
+        memcpy(buf, buf_, pos_);
+        srs_freepa(buf_);
+        buf_ = buf;
+        size_ = nsize;
+    }
+
+    memcpy(buf_ + pos_, data, size);
+    pos_ += size;
+}
+
+void SrsJsonWriter::escape(const char* v, int size)
+{
+    for (int i = 0; i < size; i++) {
+        char ch = v[i];
+        if (ch == '"' || ch == '\\') {
+            append("\\", 1);
+        } else if ((unsigned char)ch < 0x20) {
+            char tmp[8];
+            int nn = snprintf(tmp, sizeof(tmp), "\\u%04x", (int)(unsigned char)ch);
+            append(tmp, nn);
+            continue;
+        }
+        append(&ch, 1);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -147,6 +147,64 @@ public:
     virtual SrsAmf0Any* to_amf0();
 };
 
+// The streaming JSON writer, to serialize to a growable buffer directly, without the tree of
+// SrsJsonAny and its allocations, for example, to dumps lots of clients for HTTP API.
+// For example:
+//      SrsJsonWriter w;
+//      w.object_start();
+//      w.integer("code", 0);
+//      w.array_start("clients");
+//      w.object_start();
+//      w.str("id", "xxx");
+//      w.object_end();
+//      w.array_end();
+//      w.object_end();
+//      // Now, bytes() is {"code":0,"clients":[{"id":"xxx"}]}
+class SrsJsonWriter
+{
+private:
+    char* buf_;
+    int size_;
+    int pos_;
+private:
+    // The number of values written in each level of object or array, to write the comma.
+    std::vector<int> levels_;
+    // The fields to select of objects at depth, all fields if empty.
+    std::vector<std::string> fields_;
+    int fields_depth_;
+    // The level of the object or array in skipping, 0 if not skipping.
+    int skip_;
+public:
+    SrsJsonWriter(int size = 4096);
+    virtual ~SrsJsonWriter();
+public:
+    // Select the fields of objects at depth, the depth of root object is 1, for example, to
+    // select the fields of clients in {"clients":[{...}]}, the depth is 3.
+    virtual void select(const std::vector<std::string>& fields, int depth);
+public:
+    // Start and end the object or array, the name is required when it's in object.
+    virtual void object_start(const char* name = NULL);
+    virtual void object_end();
+    virtual void array_start(const char* name = NULL);
+    virtual void array_end();
+    // Write the value, the name is required when it's in object, or NULL in array.
+    virtual void str(const char* name, const std::string& v);
+    virtual void integer(const char* name, int64_t v);
+    virtual void number(const char* name, double v);
+    virtual void boolean(const char* name, bool v);
+    virtual void null(const char* name);
+public:
+    virtual char* bytes();
+    virtual int length();
+    // Drop the written bytes, for example, which is sent, the state is kept to write more values.
+    virtual void reset();
+private:
+    // Write the comma and name of value, return false if the value is skipped.
+    virtual bool prefix(const char* name);
+    virtual void append(const char* data, int size);
+    virtual void escape(const char* v, int size);
+};
+
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
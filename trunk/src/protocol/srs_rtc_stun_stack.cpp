@@ -364,3 +364,193 @@ string SrsStunPacket::encode_fingerprint(uint32_t crc32)
 
     return string(stream->data(), stream->pos());
 }
+
+SrsStunResponder::SrsStunResponder()
+{
+    hmac_ = NULL;
+    response_ = NULL;
+    nb_response_ = 0;
+    mapped_offset_ = 0;
+    integrity_offset_ = 0;
+    fingerprint_offset_ = 0;
+}
+
+SrsStunResponder::~SrsStunResponder()
+{
+    if (hmac_) {
+        HMAC_CTX_free(hmac_);
+    }
+    srs_freepa(response_);
+}
+
+srs_error_t SrsStunResponder::initialize(const string& pwd, const string& username)
+{
+    srs_error_t err = srs_success;
+
+    size_t p = username.find(":");
+    if (p == string::npos) {
+        return srs_error_new(ERROR_RTC_STUN, "invalid username=%s", username.c_str());
+    }
+    username_ = username;
+
+    if ((hmac_ = HMAC_CTX_new()) == NULL) {
+        return srs_error_new(ERROR_RTC_STUN, "hmac new");
+    }
+    if (HMAC_Init_ex(hmac_, pwd.data(), pwd.size(), EVP_sha1(), NULL) != 1) {
+        return srs_error_new(ERROR_RTC_STUN, "hmac init");
+    }
+
+    // Build the template by an empty response, the ufrags are swapped, so the username is the same.
+    SrsStunPacket tmpl;
+    tmpl.set_message_type(BindingResponse);
+    tmpl.set_local_ufrag(username.substr(p + 1));
+    tmpl.set_remote_ufrag(username.substr(0, p));
+    tmpl.set_transcation_id(string(12, 0));
+
+    char buf[1460];
+    SrsBuffer stream(buf, sizeof(buf));
+    if ((err = tmpl.encode(pwd, &stream)) != srs_success) {
+        return srs_error_wrap(err, "encode");
+    }
+
+    // The attributes are USERNAME, XOR-MAPPED-ADDRESS, MESSAGE-INTEGRITY and FINGERPRINT.
+    mapped_offset_ = 20 + 4 + (int)(username.size() + 3) / 4 * 4;
+    integrity_offset_ = mapped_offset_ + 12;
+    fingerprint_offset_ = integrity_offset_ + 24;
+    if (fingerprint_offset_ + 8 != stream.pos()) {
+        return srs_error_new(ERROR_RTC_STUN, "invalid template size=%d, fingerprint=%d", stream.pos(), fingerprint_offset_);
+    }
+
+    nb_response_ = stream.pos();
+    response_ = new char[nb_response_];
+    memcpy(response_, buf, nb_response_);
+
+    return err;
+}
+
+bool SrsStunResponder::match(const char* data, int size)
+{
+    bool username = false, controlled = false;
+    int offset = parse(data, size, &username, &controlled);
+    if (offset < 0 || !username || controlled) {
+        return false;
+    }
+
+    return check_integrity(data, offset);
+}
+
+bool SrsStunResponder::verify(const char* data, int size)
+{
+    bool username = false, controlled = false;
+    int offset = parse(data, size, &username, &controlled);
+    if (offset < 0) {
+        return false;
+    }
+
+    return check_integrity(data, offset);
+}
+
+srs_error_t SrsStunResponder::respond(const char* request, uint32_t address, uint16_t port, char* buf, int* psize)
+{
+    srs_error_t err = srs_success;
+
+    if (!response_) {
+        return srs_error_new(ERROR_RTC_STUN, "not initialized");
+    }
+    if (*psize < nb_response_) {
+        return srs_error_new(ERROR_RTC_STUN, "no space %d<%d", *psize, nb_response_);
+    }
+
+    memcpy(buf, response_, nb_response_);
+    memcpy(buf + 8, request + 8, 12);
+
+    SrsBuffer stream(buf, nb_response_);
+
+    stream.skip(mapped_offset_ + 6);
+    stream.write_2bytes(port ^ (kStunMagicCookie >> 16));
+    stream.write_4bytes(address ^ kStunMagicCookie);
+
+    if ((err = sign(buf, integrity_offset_, (uint8_t*)buf + integrity_offset_ + 4)) != srs_success) {
+        return srs_error_wrap(err, "sign");
+    }
+
+    uint32_t crc32 = srs_crc32_ieee(buf, fingerprint_offset_, 0) ^ 0x5354554E;
+    stream.skip(fingerprint_offset_ + 4 - stream.pos());
+    stream.write_4bytes(crc32);
+
+    *psize = nb_response_;
+
+    return err;
+}
+
+int SrsStunResponder::parse(const char* data, int size, bool* pusername, bool* pcontrolled)
+{
+    if (size < 20 || data[0] != 0 || data[1] != (char)BindingRequest) {
+        return -1;
+    }
+
+    SrsBuffer stream(const_cast<char*>(data), size);
+    stream.skip(2);
+    if (20 + stream.read_2bytes() != size || stream.read_4bytes() != kStunMagicCookie) {
+        return -1;
+    }
+    stream.skip(12);
+
+    while (stream.left() >= 4) {
+        int offset = stream.pos();
+        uint16_t type = stream.read_2bytes();
+        uint16_t len = stream.read_2bytes();
+
+        if (stream.left() < len) {
+            return -1;
+        }
+
+        if (type == Username) {
+            *pusername = (len == username_.size() && memcmp(stream.head(), username_.data(), len) == 0);
+        } else if (type == IceControlled) {
+            *pcontrolled = true;
+        } else if (type == MessageIntegrity) {
+            // Only the FINGERPRINT is allowed after MESSAGE-INTEGRITY, so we stop here.
+            return (len == 20)? offset : -1;
+        }
+
+        stream.skip(srs_min(stream.left(), (len + 3) / 4 * 4));
+    }
+
+    return -1;
+}
+
+bool SrsStunResponder::check_integrity(const char* data, int offset)
+{
+    if (!hmac_) {
+        return false;
+    }
+
+    uint8_t digest[20];
+    srs_error_t err = sign(data, offset, digest);
+    if (err != srs_success) {
+        srs_freep(err);
+        return false;
+    }
+
+    return CRYPTO_memcmp(digest, data + offset + 4, sizeof(digest)) == 0;
+}
+
+srs_error_t SrsStunResponder::sign(const char* data, int offset, uint8_t* digest)
+{
+    // The length in header should point to the end of MESSAGE-INTEGRITY, excluding the FINGERPRINT.
+    // @see https://tools.ietf.org/html/rfc5389#section-15.4
+    uint16_t length = offset + 24 - 20;
+    uint8_t header[4] = {(uint8_t)data[0], (uint8_t)data[1], uint8_t(length >> 8), uint8_t(length)};
+
+    // Reuse the key of context, which is much faster than setting up the key again.
+    unsigned int nb_digest = 0;
+    if (HMAC_Init_ex(hmac_, NULL, 0, NULL, NULL) != 1
+        || HMAC_Update(hmac_, header, sizeof(header)) != 1
+        || HMAC_Update(hmac_, (const uint8_t*)data + 4, offset - 4) != 1
+        || HMAC_Final(hmac_, digest, &nb_digest) != 1) {
+        return srs_error_new(ERROR_RTC_STUN, "hmac sha1");
+    }
+
+    return srs_success;
+}
@@ -13,6 +13,8 @@
 
 #include <srs_kernel_error.hpp>
 
+#include <openssl/hmac.h>
+
 class SrsBuffer;
 
 // @see: https://tools.ietf.org/html/rfc5389
@@ -104,4 +106,45 @@ private:
     std::string encode_fingerprint(uint32_t crc32);
 };
 
+// The fast responder for the binding requests of an established session, for example, the ICE consent
+// freshness, which checks the request without decoding it to strings, and builds the response from a
+// template by patching the transaction id and mapped address.
+// @see https://tools.ietf.org/html/rfc7675
+class SrsStunResponder
+{
+private:
+    // The HMAC-SHA1 context with key of local ICE password, which is reset for each message to avoid
+    // setting up the key again.
+    HMAC_CTX* hmac_;
+    // The username of binding request, which is also the username of response.
+    std::string username_;
+private:
+    // The template of binding response, and the offset of attributes to patch.
+    char* response_;
+    int nb_response_;
+    int mapped_offset_;
+    int integrity_offset_;
+    int fingerprint_offset_;
+public:
+    SrsStunResponder();
+    virtual ~SrsStunResponder();
+public:
+    // Initialize by the local ICE password, and the username of binding request.
+    srs_error_t initialize(const std::string& pwd, const std::string& username);
+    // Whether the packet is a binding request of the username with valid MESSAGE-INTEGRITY, and
+    // without ICE-CONTROLLED, which could be responded by template.
+    bool match(const char* data, int size);
+    // Whether the MESSAGE-INTEGRITY of binding request is valid.
+    bool verify(const char* data, int size);
+    // Build the response for the binding request, which should be matched.
+    // @param psize Input the size of buf, output the size of response.
+    srs_error_t respond(const char* request, uint32_t address, uint16_t port, char* buf, int* psize);
+private:
+    // Parse the attributes of binding request.
+    // @return The offset of MESSAGE-INTEGRITY, -1 if invalid packet or no integrity.
+    int parse(const char* data, int size, bool* pusername, bool* pcontrolled);
+    bool check_integrity(const char* data, int offset);
+    srs_error_t sign(const char* data, int offset, uint8_t* digest);
+};
+
 #endif
@@ -7,6 +7,7 @@
 #include <srs_rtmp_handshake.hpp>
 
 #include <time.h>
+#include <pthread.h>
 
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_error.hpp>
@@ -137,6 +138,32 @@ namespace srs_internal
         return err;
     }
 
+    // The HMAC context of each thread, reused by all digests, because the digest is done without yield.
+    // It's freed when the thread, for example, the crypto worker, quits.
+    static pthread_key_t _srs_hmac_key;
+    static pthread_once_t _srs_hmac_once = PTHREAD_ONCE_INIT;
+
+    static void srs_hmac_ctx_free(void* ctx)
+    {
+        HMAC_CTX_free((HMAC_CTX*)ctx);
+    }
+
+    static void srs_hmac_key_create()
+    {
+        pthread_key_create(&_srs_hmac_key, srs_hmac_ctx_free);
+    }
+
+    static HMAC_CTX* srs_hmac_ctx()
+    {
+        pthread_once(&_srs_hmac_once, srs_hmac_key_create);
+
+        HMAC_CTX* ctx = (HMAC_CTX*)pthread_getspecific(_srs_hmac_key);
+        if (ctx == NULL && (ctx = HMAC_CTX_new()) != NULL) {
+            pthread_setspecific(_srs_hmac_key, ctx);
+        }
+        return ctx;
+    }
+
     /**
      * sha256 digest algorithm.
      * @param key the sha256 key, NULL to use EVP_Digest, for instance,
@@ -159,20 +186,18 @@ namespace srs_internal
                 return srs_error_new(ERROR_OpenSslSha256EvpDigest, "evp digest");
             }
         } else {
-            // use key-data to digest.
-            HMAC_CTX *ctx = HMAC_CTX_new();
+            // use key-data to digest, reuse the context of current thread.
+            HMAC_CTX *ctx = srs_hmac_ctx();
             if (ctx == NULL) {
                 return srs_error_new(ERROR_OpenSslCreateHMAC, "hmac new");
             }
             // @remark, if no key, use EVP_Digest to digest,
             // for instance, in python, hashlib.sha256(data).digest().
             if (HMAC_Init_ex(ctx, temp_key, key_size, EVP_sha256(), NULL) < 0) {
-                HMAC_CTX_free(ctx);
                 return srs_error_new(ERROR_OpenSslSha256Init, "hmac init");
             }
             
             err = do_openssl_HMACsha256(ctx, data, data_size, temp_digest, &digest_size);
-            HMAC_CTX_free(ctx);
             
             if (err != srs_success) {
                 return srs_error_wrap(err, "hmac sha256");
@@ -294,6 +319,33 @@ namespace srs_internal
         return err;
     }
     
+    bool SrsDH::generate()
+    {
+        close();
+
+        if ((pdh = DH_new()) == NULL) {
+            return false;
+        }
+
+        BIGNUM* p = NULL;
+        BIGNUM* g = NULL;
+        if (!BN_hex2bn(&p, RFC2409_PRIME_1024) || (g = BN_new()) == NULL || !BN_set_word(g, 2)) {
+            BN_free(p);
+            BN_free(g);
+            return false;
+        }
+        DH_set0_pqg(pdh, p, NULL, g);
+        DH_set_length(pdh, 1024);
+
+        if (!DH_generate_key(pdh)) {
+            return false;
+        }
+
+        const BIGNUM *pub_key = NULL;
+        DH_get0_key(pdh, &pub_key, NULL);
+        return BN_num_bytes(pub_key) == 128;
+    }
+    
     srs_error_t SrsDH::do_initialize()
     {
         srs_error_t err = srs_success;
@@ -339,6 +391,74 @@ namespace srs_internal
         return err;
     }
     
+    SrsDHPool::SrsDHPool(int capacity)
+    {
+        capacity_ = capacity;
+        pthread_mutex_init(&lock_, NULL);
+    }
+
+    SrsDHPool::~SrsDHPool()
+    {
+        for (int i = 0; i < (int)keys_.size(); i++) {
+            SrsDH* dh = keys_.at(i);
+            srs_freep(dh);
+        }
+        keys_.clear();
+
+        pthread_mutex_destroy(&lock_);
+    }
+
+    SrsDH* SrsDHPool::fetch()
+    {
+        SrsDH* dh = NULL;
+
+        pthread_mutex_lock(&lock_);
+        if (!keys_.empty()) {
+            dh = keys_.back();
+            keys_.pop_back();
+        }
+        pthread_mutex_unlock(&lock_);
+
+        return dh;
+    }
+
+    void SrsDHPool::refill()
+    {
+        // Generate the keys without lock, which maybe overflow a little, it's ok.
+        for (int nn = capacity_ - size(), retry = 0; nn > 0 && retry < 3;) {
+            SrsDH* dh = new SrsDH();
+
+            // Retry if the public key is 127bytes, which is rare.
+            if (!dh->generate()) {
+                srs_freep(dh);
+                retry++;
+                continue;
+            }
+
+            pthread_mutex_lock(&lock_);
+            keys_.push_back(dh);
+            pthread_mutex_unlock(&lock_);
+
+            nn--;
+            retry = 0;
+        }
+    }
+
+    int SrsDHPool::size()
+    {
+        pthread_mutex_lock(&lock_);
+        int v = (int)keys_.size();
+        pthread_mutex_unlock(&lock_);
+        return v;
+    }
+
+    int SrsDHPool::capacity()
+    {
+        return capacity_;
+    }
+
+    SrsDHPool* _srs_dh_pool = NULL;
+    
     key_block::key_block()
     {
         offset = (int32_t)srs_random();
@@ -563,24 +683,29 @@ namespace srs_internal
     {
         srs_error_t err = srs_success;
         
-        SrsDH dh;
-        
-        // ensure generate 128bytes public key.
-        if ((err = dh.initialize(true)) != srs_success) {
-            return srs_error_wrap(err, "dh init");
+        // Use the key generated in advance, or generate one now.
+        SrsDH* dh = _srs_dh_pool? _srs_dh_pool->fetch() : NULL;
+        if (!dh) {
+            dh = new SrsDH();
+            
+            // ensure generate 128bytes public key.
+            if ((err = dh->initialize(true)) != srs_success) {
+                srs_freep(dh);
+                return srs_error_wrap(err, "dh init");
+            }
         }
+        SrsAutoFree(SrsDH, dh);
         
         // directly generate the public key.
         // @see: https://github.com/ossrs/srs/issues/148
+        // @remark We use the public key rather than the shared key, which is the key of server in s1, and
+        //       the shared key is never used because there is no RTMPE, so we don't compute it, which
+        //       costs as much as generating the key.
         int pkey_size = 128;
-        if ((err = dh.copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
-            return srs_error_wrap(err, "copy shared key");
+        if ((err = dh->copy_public_key(key.key, pkey_size)) != srs_success) {
+            return srs_error_wrap(err, "copy public key");
         }
-        
-        // although the public key is always 128bytes, but the share key maybe not.
-        // we just ignore the actual key size, but if need to use the key, must use the actual size.
-        // TODO: FIXME: use the actual key size.
-        //srs_assert(pkey_size == 128);
+        srs_assert(pkey_size == 128);
         
         char* s1_digest = NULL;
         if ((err = calc_s1_digest(owner, s1_digest))  != srs_success) {
@@ -624,8 +749,7 @@ namespace srs_internal
          *     c1s1-part2: (1536-n-32)bytes (digest-part2)
          * @return a new allocated bytes, user must free it.
          */
-        char* c1s1_joined_bytes = new char[1536 -32];
-        SrsAutoFreeA(char, c1s1_joined_bytes);
+        char c1s1_joined_bytes[1536 - 32];
         if ((err = copy_to(owner, c1s1_joined_bytes, 1536 - 32, false)) != srs_success) {
             return srs_error_wrap(err, "copy bytes");
         }
@@ -650,8 +774,7 @@ namespace srs_internal
          *     c1s1-part2: (1536-n-32)bytes (digest-part2)
          * @return a new allocated bytes, user must free it.
          */
-        char* c1s1_joined_bytes = new char[1536 -32];
-        SrsAutoFreeA(char, c1s1_joined_bytes);
+        char c1s1_joined_bytes[1536 - 32];
         if ((err = copy_to(owner, c1s1_joined_bytes, 1536 - 32, false)) != srs_success) {
             return srs_error_wrap(err, "copy bytes");
         }
@@ -1194,25 +1317,16 @@ srs_error_t SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_byt
     }
     
     // encode s1
+    // @remark We never verify s1 and s2, which are digested by ourself, to save the HMAC.
     c1s1 s1;
     if ((err = s1.s1_create(&c1)) != srs_success) {
         return srs_error_wrap(err, "create s1 from c1");
     }
-    // verify s1
-    if ((err = s1.s1_validate_digest(is_valid)) != srs_success || !is_valid) {
-        srs_freep(err);
-        return srs_error_new(ERROR_RTMP_TRY_SIMPLE_HS, "verify s1 failed, try simple handshake");
-    }
     
     c2s2 s2;
     if ((err = s2.s2_create(&c1)) != srs_success) {
         return srs_error_wrap(err, "create s2 from c1");
     }
-    // verify s2
-    if ((err = s2.s2_validate(&c1, is_valid)) != srs_success || !is_valid) {
-        srs_freep(err);
-        return srs_error_new(ERROR_RTMP_TRY_SIMPLE_HS, "verify s2 failed, try simple handshake");
-    }
     
     // sendout s0s1s2
     if ((err = hs_bytes->create_s0s1s2()) != srs_success) {
@@ -9,6 +9,9 @@
 
 #include <srs_core.hpp>
 
+#include <pthread.h>
+#include <vector>
+
 class ISrsProtocolReadWriter;
 class SrsComplexHandshake;
 class SrsHandshakeBytes;
@@ -62,9 +65,39 @@ namespace srs_internal
         // @param skey_size the max shared key size, output the actual shared key size.
         //       user should never ignore this size.
         virtual srs_error_t copy_shared_key(const char* ppkey, int32_t ppkey_size, char* skey, int32_t& skey_size);
+        // Generate the 128bytes public key, without log or error, so it's safe for threads.
+        // @return false if failed or the public key is not 128bytes.
+        virtual bool generate();
     private:
         virtual srs_error_t do_initialize();
     };
+
+    // The pool of DH keys generated in advance, because generating the DH key is the most expensive
+    // step of complex handshake. It's thread-safe, so it could be refilled by threads.
+    class SrsDHPool
+    {
+    private:
+        pthread_mutex_t lock_;
+        std::vector<SrsDH*> keys_;
+        int capacity_;
+    public:
+        SrsDHPool(int capacity);
+        virtual ~SrsDHPool();
+    public:
+        // Fetch a DH key, which is removed from pool, user must free it.
+        // @return NULL if pool is empty.
+        virtual SrsDH* fetch();
+        // Generate keys util the pool is full, or failed. It's called by threads, so never log or
+        // return error, the caller should check the size.
+        virtual void refill();
+        // The number of keys in pool.
+        virtual int size();
+        virtual int capacity();
+    };
+
+    // The pool of DH keys, NULL to generate key for each handshake.
+    extern SrsDHPool* _srs_dh_pool;
+
     // The schema type.
     enum srs_schema_type
     {
@@ -1282,6 +1282,7 @@ srs_error_t SrsProtocol::read_message_payload(SrsChunkStream* chunk, SrsCommonMe
     
     // got entire RTMP message?
     if (chunk->header.payload_length == chunk->msg->size) {
+        chunk->msg->recv_tick = srs_get_tick();
         *pmsg = chunk->msg;
         chunk->msg = NULL;
         return err;
@@ -1805,6 +1806,7 @@ SrsServerInfo::SrsServerInfo()
 {
     pid = cid = 0;
     major = minor = revision = build = 0;
+    load = -1;
 }
 
 SrsRtmpClient::SrsRtmpClient(ISrsProtocolReadWriter* skt)
@@ -1999,6 +2001,9 @@ srs_error_t SrsRtmpClient::connect_app(string app, string tcUrl, SrsRequest* r,
         if ((prop = arr->ensure_property_number("srs_pid")) != NULL) {
             si->pid = (int)prop->to_number();
         }
+        if ((prop = arr->ensure_property_number("srs_load")) != NULL) {
+            si->load = (int)prop->to_number();
+        }
         if ((prop = arr->ensure_property_string("srs_version")) != NULL) {
             vector<string> versions = srs_string_split(prop->to_str(), ".");
             if (versions.size() > 0) {
@@ -2017,8 +2022,8 @@ srs_error_t SrsRtmpClient::connect_app(string app, string tcUrl, SrsRequest* r,
     }
     
     if (si) {
-        srs_trace("connected, version=%d.%d.%d.%d, ip=%s, pid=%d, id=%d, dsu=%d",
-                  si->major, si->minor, si->revision, si->build, si->ip.c_str(), si->pid, si->cid, dsu);
+        srs_trace("connected, version=%d.%d.%d.%d, ip=%s, pid=%d, id=%d, load=%d, dsu=%d",
+                  si->major, si->minor, si->revision, si->build, si->ip.c_str(), si->pid, si->cid, si->load, dsu);
     } else {
         srs_trace("connected, dsu=%d", dsu);
     }
@@ -2363,7 +2368,7 @@ srs_error_t SrsRtmpServer::set_peer_bandwidth(int bandwidth, int type)
     return err;
 }
 
-srs_error_t SrsRtmpServer::response_connect_app(SrsRequest *req, const char* server_ip)
+srs_error_t SrsRtmpServer::response_connect_app(SrsRequest *req, const char* server_ip, int load)
 {
     srs_error_t err = srs_success;
     
@@ -2395,6 +2400,10 @@ srs_error_t SrsRtmpServer::response_connect_app(SrsRequest *req, const char* ser
     // for edge to directly get the id of client.
     data->set("srs_pid", SrsAmf0Any::number(getpid()));
     data->set("srs_id", SrsAmf0Any::str(_srs_context->get_id().c_str()));
+    // for edge to select the origin by load.
+    if (load >= 0) {
+        data->set("srs_load", SrsAmf0Any::number(load));
+    }
     
     if ((err = protocol->send_and_free_packet(pkt, 0)) != srs_success) {
         return srs_error_wrap(err, "send connect app response");
@@ -518,6 +518,8 @@ struct SrsServerInfo
     int minor;
     int revision;
     int build;
+    // The load of server, the CPU percent, -1 if unknown.
+    int load;
     
     SrsServerInfo();
 };
@@ -688,7 +690,8 @@ public:
     // using the Limit type field.
     virtual srs_error_t set_peer_bandwidth(int bandwidth, int type);
     // @param server_ip the ip of server.
-    virtual srs_error_t response_connect_app(SrsRequest* req, const char* server_ip = NULL);
+    // @param load the load of server, the CPU percent, -1 to ignore.
+    virtual srs_error_t response_connect_app(SrsRequest* req, const char* server_ip = NULL, int load = -1);
     // Redirect the connection to another rtmp server.
     // @param a RTMP url to redirect to.
     // @param whether the client accept the redirect.
@@ -684,6 +684,7 @@ ISrsHttpHeaderFilter::~ISrsHttpHeaderFilter()
 SrsHttpResponseWriter::SrsHttpResponseWriter(ISrsProtocolReadWriter* io)
 {
     skt = io;
+    fw = dynamic_cast<ISrsProtocolFileWriter*>(io);
     hdr = new SrsHttpHeader();
     header_wrote = false;
     status = SRS_CONSTS_HTTP_OK;
@@ -716,7 +717,7 @@ srs_error_t SrsHttpResponseWriter::final_request()
     }
     
     // complete the chunked encoding.
-    if (content_length == -1) {
+    if (content_length == -1 && srs_go_http_body_allowd(status)) {
         std::stringstream ss;
         ss << 0 << SRS_HTTP_CRLF << SRS_HTTP_CRLF;
         std::string ch = ss.str();
@@ -910,8 +911,8 @@ srs_error_t SrsHttpResponseWriter::send_header(char* data, int size)
         hdr->set("Server", RTMP_SIG_SRS_SERVER);
     }
     
-    // chunked encoding
-    if (content_length == -1) {
+    // chunked encoding, except the response without body, such as 304.
+    if (content_length == -1 && srs_go_http_body_allowd(status)) {
         hdr->set("Transfer-Encoding", "chunked");
     }
     
@@ -935,6 +936,46 @@ srs_error_t SrsHttpResponseWriter::send_header(char* data, int size)
     return skt->write((void*)buf.c_str(), buf.length(), NULL);
 }
 
+bool SrsHttpResponseWriter::sendfile_supported()
+{
+    return fw != NULL;
+}
+
+srs_error_t SrsHttpResponseWriter::sendfile(int fd, int64_t offset, int64_t size)
+{
+    srs_error_t err = srs_success;
+
+    if (!fw) {
+        return srs_error_new(ERROR_HTTP_SENDFILE, "sendfile not supported");
+    }
+
+    // write the header data in memory.
+    if (!header_wrote) {
+        write_header(SRS_CONSTS_HTTP_OK);
+    }
+
+    // The chunked encoding requires to frame the data, so it's not supported.
+    if (content_length == -1) {
+        return srs_error_new(ERROR_HTTP_SENDFILE, "sendfile without content-length");
+    }
+
+    // Send the header, because the file is sent directly.
+    if ((err = send_header(NULL, 0)) != srs_success) {
+        return srs_error_wrap(err, "send header");
+    }
+
+    written += size;
+    if (written > content_length) {
+        return srs_error_new(ERROR_HTTP_CONTENT_LENGTH, "overflow writen=%d, max=%d", (int)written, (int)content_length);
+    }
+
+    if ((err = fw->sendfile(fd, offset, size, NULL)) != srs_success) {
+        return srs_error_wrap(err, "sendfile offset=%" PRId64 ", size=%" PRId64, offset, size);
+    }
+
+    return err;
+}
+
 SrsHttpResponseReader::SrsHttpResponseReader(SrsHttpMessage* msg, ISrsReader* reader, SrsFastStream* body)
 {
     skt = reader;
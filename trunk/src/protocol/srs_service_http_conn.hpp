@@ -19,6 +19,7 @@ class SrsRequest;
 class ISrsReader;
 class SrsHttpResponseReader;
 class ISrsProtocolReadWriter;
+class ISrsProtocolFileWriter;
 
 // A wrapper for http-parser,
 // provides HTTP message originted service.
@@ -203,6 +204,8 @@ class SrsHttpResponseWriter : public ISrsHttpResponseWriter
 {
 private:
     ISrsProtocolReadWriter* skt;
+    // The writer to sendfile, NULL if not supported, for example, the HTTPS.
+    ISrsProtocolFileWriter* fw;
     SrsHttpHeader* hdr;
     // Before writing header, there is a chance to filter it,
     // such as remove some headers or inject new.
@@ -237,6 +240,9 @@ public:
     virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
     virtual void write_header(int code);
     virtual srs_error_t send_header(char* data, int size);
+public:
+    virtual bool sendfile_supported();
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size);
 };
 
 // Response reader use st socket.
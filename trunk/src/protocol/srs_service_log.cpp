@@ -9,10 +9,15 @@
 #include <stdarg.h>
 #include <sys/time.h>
 #include <unistd.h>
+#ifndef SRS_OSX
+#include <link.h>
+#endif
 #include <sstream>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_core_autofree.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_utility.hpp>
 
@@ -215,6 +220,13 @@ bool srs_log_header(char* buffer, int size, bool utc, bool dangerous, const char
     if (gettimeofday(&tv, NULL) == -1) {
         return false;
     }
+
+    return srs_log_header_of(buffer, size, utc, dangerous, tag, cid.c_str(), level, &tv, getpid(), errno, psize);
+}
+
+bool srs_log_header_of(char* buffer, int size, bool utc, bool dangerous, const char* tag, const char* cid, const char* level, timeval* ptv, int pid, int err, int* psize)
+{
+    timeval& tv = *ptv;
     
     // to calendar time
     struct tm* tm;
@@ -234,24 +246,24 @@ bool srs_log_header(char* buffer, int size, bool utc, bool dangerous, const char
             written = snprintf(buffer, size,
                 "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s][%d][%s] ",
                 1900 + tm->tm_year, 1 + tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(tv.tv_usec / 1000),
-                level, getpid(), cid.c_str(), errno, tag);
+                level, pid, cid, err, tag);
         } else {
             written = snprintf(buffer, size,
                 "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s][%d] ",
                 1900 + tm->tm_year, 1 + tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(tv.tv_usec / 1000),
-                level, getpid(), cid.c_str(), errno);
+                level, pid, cid, err);
         }
     } else {
         if (tag) {
             written = snprintf(buffer, size,
                 "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s][%s] ",
                 1900 + tm->tm_year, 1 + tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(tv.tv_usec / 1000),
-                level, getpid(), cid.c_str(), tag);
+                level, pid, cid, tag);
         } else {
             written = snprintf(buffer, size,
                 "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s] ",
                 1900 + tm->tm_year, 1 + tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, (int)(tv.tv_usec / 1000),
-                level, getpid(), cid.c_str());
+                level, pid, cid);
         }
     }
 
@@ -271,3 +283,722 @@ bool srs_log_header(char* buffer, int size, bool utc, bool dangerous, const char
     return true;
 }
 
+const char* srs_log_level_name(int level)
+{
+    switch (level) {
+        case SrsLogLevelVerbose: return "Verb";
+        case SrsLogLevelInfo: return "Debug";
+        case SrsLogLevelTrace: return "Trace";
+        case SrsLogLevelWarn: return "Warn";
+        case SrsLogLevelError: return "Error";
+        default: return "Unknown";
+    }
+}
+
+// The binary log version.
+#define SRS_BINARY_LOG_VERSION 1
+// The size of record header, u8 type and u16 size.
+#define SRS_BINARY_LOG_RECORD_HEADER 3
+// The max length of string argument, and the length of NULL string.
+#define SRS_BINARY_LOG_MAX_STRING 0xfffe
+#define SRS_BINARY_LOG_NULL_STRING 0xffff
+
+// The format for dynamic format, which is rendered to string.
+static const char* SRS_BINARY_LOG_DYNAMIC = "%s";
+
+#ifndef SRS_OSX
+// The read-only segments of executable, where the string literals are, excluding the writable data.
+static std::vector< std::pair<uintptr_t, uintptr_t> > _srs_binary_log_segments;
+static pthread_once_t _srs_binary_log_segments_once = PTHREAD_ONCE_INIT;
+
+static int srs_binary_log_on_phdr(struct dl_phdr_info* info, size_t size, void* data)
+{
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr)* phdr = info->dlpi_phdr + i;
+        if (phdr->p_type == PT_LOAD && (phdr->p_flags & PF_W) == 0) {
+            uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+            _srs_binary_log_segments.push_back(std::make_pair(start, start + phdr->p_memsz));
+        }
+    }
+
+    // The first object is the executable, ignore the shared libraries.
+    return 1;
+}
+
+static void srs_binary_log_init_segments()
+{
+    dl_iterate_phdr(srs_binary_log_on_phdr, NULL);
+}
+#endif
+
+// Whether the format is a string literal, which never changes and is safe to intern by address.
+static bool srs_binary_log_is_static(const char* fmt)
+{
+#ifndef SRS_OSX
+    pthread_once(&_srs_binary_log_segments_once, srs_binary_log_init_segments);
+
+    uintptr_t addr = (uintptr_t)fmt;
+    for (int i = 0; i < (int)_srs_binary_log_segments.size(); i++) {
+        std::pair<uintptr_t, uintptr_t>& segment = _srs_binary_log_segments[i];
+        if (addr >= segment.first && addr < segment.second) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+// Parse a conversion specification, the p is the next char of %,
+// return the conversion char, or the end of format.
+static const char* srs_binary_log_parse_spec(const char* p, std::vector<char>& args)
+{
+    // Flags.
+    while (*p && strchr("-+ #0'", *p)) {
+        p++;
+    }
+
+    // Width.
+    if (*p == '*') {
+        args.push_back(SrsBinaryLogArgStar);
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+
+    // Precision, which limits the length of string.
+    bool star_precision = false;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            args.push_back(SrsBinaryLogArgStar);
+            star_precision = true;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    // Length modifier, the long double is not supported.
+    int nn_l = 0;
+    bool is_long = false, is_long_long = false;
+    while (*p && strchr("hlqjzt", *p)) {
+        nn_l += (*p == 'l')? 1 : 0;
+        is_long = is_long || *p == 'l' || *p == 'z' || *p == 't';
+        is_long_long = is_long_long || nn_l > 1 || *p == 'q' || *p == 'j';
+        p++;
+    }
+
+    if (!*p) {
+        return p;
+    }
+
+    char c = *p;
+    if (c == 'c') {
+        args.push_back(SrsBinaryLogArgInt);
+    } else if (strchr("diouxX", c)) {
+        if (is_long_long) {
+            args.push_back(SrsBinaryLogArgLongLong);
+        } else {
+            args.push_back(is_long? SrsBinaryLogArgLong : SrsBinaryLogArgInt);
+        }
+    } else if (strchr("fFeEgGaA", c)) {
+        args.push_back(SrsBinaryLogArgDouble);
+    } else if (c == 's') {
+        // Mark the precision star as part of string, to limit the length of string.
+        if (star_precision) {
+            args.back() = '.';
+        }
+        args.push_back(SrsBinaryLogArgString);
+    } else if (c == 'p') {
+        args.push_back(SrsBinaryLogArgPointer);
+    } else if (c == 'n') {
+        // Never write to the address of argument, see SrsBinaryLogArgIgnored.
+        args.push_back(SrsBinaryLogArgIgnored);
+    }
+
+    return p;
+}
+
+void srs_binary_log_parse(const char* fmt, std::vector<char>& args)
+{
+    for (const char* p = fmt; p && *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+
+        if (*++p == '%') {
+            continue;
+        }
+
+        p = srs_binary_log_parse_spec(p, args);
+        if (!*p) {
+            break;
+        }
+    }
+}
+
+// Write the size of record, which starts at p.
+static void srs_binary_log_end_record(char* p, SrsBuffer* buf)
+{
+    int size = (int)(buf->head() - p) - SRS_BINARY_LOG_RECORD_HEADER;
+    p[1] = (char)(size & 0xff);
+    p[2] = (char)((size >> 8) & 0xff);
+}
+
+// Write a string with u8 or u16 length.
+static void srs_binary_log_write_string(SrsBuffer* buf, const char* str, int size, bool u8)
+{
+    if (u8) {
+        buf->write_1bytes((int8_t)size);
+    } else {
+        buf->write_le2bytes((int16_t)size);
+    }
+    buf->write_bytes((char*)str, size);
+}
+
+// Write the define record of format.
+static bool srs_binary_log_write_define(SrsBuffer* buf, SrsBinaryLogFormat* format)
+{
+    int len = srs_min(SRS_BINARY_LOG_MAX_STRING, (int)strlen(format->fmt));
+    if (!buf->require(SRS_BINARY_LOG_RECORD_HEADER + 6 + len)) {
+        return false;
+    }
+
+    char* p = buf->head();
+    buf->write_1bytes(SrsBinaryLogTypeDefine);
+    buf->write_le2bytes(0);
+    buf->write_le4bytes(format->id);
+    srs_binary_log_write_string(buf, format->fmt, len, false);
+    srs_binary_log_end_record(p, buf);
+
+    return true;
+}
+
+struct SrsBinaryLogThreadState
+{
+    // The formats defined in the log of this thread.
+    std::map<const char*, SrsBinaryLogFormat*> defined;
+    // The formats defined by the last encoded log, which is not written yet.
+    std::vector<SrsBinaryLogFormat*> pending;
+    // The buffer to render the dynamic format.
+    char* dynamic;
+
+    SrsBinaryLogThreadState() {
+        dynamic = new char[SRS_BASIC_LOG_SIZE];
+    }
+    ~SrsBinaryLogThreadState() {
+        srs_freepa(dynamic);
+    }
+};
+
+// Free the state when thread exits.
+static void srs_binary_log_free_state(void* p)
+{
+    SrsBinaryLogThreadState* state = (SrsBinaryLogThreadState*)p;
+    srs_freep(state);
+}
+
+SrsBinaryLogEncoder::SrsBinaryLogEncoder(bool utc)
+{
+    utc_ = utc;
+    pthread_mutex_init(&lock_, NULL);
+    pthread_key_create(&key_, srs_binary_log_free_state);
+}
+
+SrsBinaryLogEncoder::~SrsBinaryLogEncoder()
+{
+    // The destructor is not called by pthread_key_delete, so free the state of current thread.
+    SrsBinaryLogThreadState* state = (SrsBinaryLogThreadState*)pthread_getspecific(key_);
+    srs_freep(state);
+    pthread_key_delete(key_);
+
+    for (int i = 0; i < (int)formats_.size(); i++) {
+        SrsBinaryLogFormat* format = formats_[i];
+        srs_freep(format);
+    }
+
+    pthread_mutex_destroy(&lock_);
+}
+
+string SrsBinaryLogEncoder::preamble()
+{
+    int size = SRS_BINARY_LOG_RECORD_HEADER + 6 + SRS_BINARY_LOG_MAX_STRING;
+    char* data = new char[size];
+    SrsAutoFreeA(char, data);
+
+    string v;
+
+    if (true) {
+        SrsBuffer buf(data, size);
+
+        char* p = buf.head();
+        buf.write_1bytes(SrsBinaryLogTypeHeader);
+        buf.write_le2bytes(0);
+        buf.write_bytes((char*)"SRSB", 4);
+        buf.write_1bytes(SRS_BINARY_LOG_VERSION);
+        buf.write_le4bytes(getpid());
+        buf.write_1bytes(utc_);
+        srs_binary_log_end_record(p, &buf);
+
+        v.append(data, buf.pos());
+    }
+
+    // Define all formats, because the decoder drops the formats when got a header.
+    pthread_mutex_lock(&lock_);
+    for (int i = 0; i < (int)formats_.size(); i++) {
+        SrsBuffer buf(data, size);
+        srs_binary_log_write_define(&buf, formats_[i]);
+        v.append(data, buf.pos());
+    }
+    pthread_mutex_unlock(&lock_);
+
+    return v;
+}
+
+int SrsBinaryLogEncoder::encode(char* data, int size, int level, const char* tag, const SrsContextId& cid, int err, const char* fmt, va_list ap)
+{
+    SrsBinaryLogThreadState* st = state();
+    st->pending.clear();
+
+    va_list args;
+    // The va_copy is not available for C++98, so we use the builtin of GCC and Clang.
+    __va_copy(args, ap);
+
+    int nn = do_encode(st, data, size, level, tag, cid, err, fmt, ap);
+
+    // The log is too long, render it and truncate like text log.
+    if (!nn && fmt != SRS_BINARY_LOG_DYNAMIC) {
+        st->pending.clear();
+        vsnprintf(st->dynamic, SRS_BASIC_LOG_SIZE, fmt, args);
+        nn = encode_dynamic(st, data, size, level, tag, cid, err, SRS_BINARY_LOG_DYNAMIC, st->dynamic);
+    }
+
+    va_end(args);
+
+    return nn;
+}
+
+void SrsBinaryLogEncoder::on_written(bool written)
+{
+    SrsBinaryLogThreadState* st = state();
+
+    // Only mark the formats as defined when written, or define them again for next log.
+    for (int i = 0; written && i < (int)st->pending.size(); i++) {
+        SrsBinaryLogFormat* format = st->pending[i];
+        st->defined[format->fmt] = format;
+    }
+    st->pending.clear();
+}
+
+SrsBinaryLogThreadState* SrsBinaryLogEncoder::state()
+{
+    SrsBinaryLogThreadState* st = (SrsBinaryLogThreadState*)pthread_getspecific(key_);
+    if (!st) {
+        st = new SrsBinaryLogThreadState();
+        pthread_setspecific(key_, st);
+    }
+    return st;
+}
+
+SrsBinaryLogFormat* SrsBinaryLogEncoder::fetch(const char* fmt)
+{
+    SrsBinaryLogFormat* format = NULL;
+
+    pthread_mutex_lock(&lock_);
+
+    std::map<const char*, SrsBinaryLogFormat*>::iterator it = ids_.find(fmt);
+    if (it != ids_.end()) {
+        format = it->second;
+    } else {
+        format = new SrsBinaryLogFormat();
+        format->id = (uint32_t)formats_.size();
+        format->fmt = fmt;
+        srs_binary_log_parse(fmt, format->args);
+
+        ids_[fmt] = format;
+        formats_.push_back(format);
+    }
+
+    pthread_mutex_unlock(&lock_);
+
+    return format;
+}
+
+int SrsBinaryLogEncoder::do_encode(SrsBinaryLogThreadState* st, char* data, int size, int level, const char* tag, const SrsContextId& cid, int err, const char* fmt, va_list ap)
+{
+    // The address of dynamic format maybe reused by another string, so we render it as a string argument.
+    if (fmt != SRS_BINARY_LOG_DYNAMIC && !srs_binary_log_is_static(fmt)) {
+        vsnprintf(st->dynamic, SRS_BASIC_LOG_SIZE, fmt, ap);
+        return encode_dynamic(st, data, size, level, tag, cid, err, SRS_BINARY_LOG_DYNAMIC, st->dynamic);
+    }
+
+    SrsBuffer buf(data, size);
+
+    // Intern the format by its address, and define it before the first event of this thread, because
+    // the events of threads are in different rings of async log.
+    SrsBinaryLogFormat* format = NULL;
+    std::map<const char*, SrsBinaryLogFormat*>::iterator it = st->defined.find(fmt);
+    if (it != st->defined.end()) {
+        format = it->second;
+    } else {
+        format = fetch(fmt);
+        if (!srs_binary_log_write_define(&buf, format)) {
+            return 0;
+        }
+        st->pending.push_back(format);
+    }
+
+    // The event, without arguments.
+    const char* scid = cid.c_str();
+    int cid_len = srs_min(0xff, (int)strlen(scid));
+    int tag_len = tag? srs_min(0xff, (int)strlen(tag)) : 0;
+    if (!buf.require(SRS_BINARY_LOG_RECORD_HEADER + 19 + cid_len + tag_len)) {
+        return 0;
+    }
+
+    timeval tv;
+    if (gettimeofday(&tv, NULL) == -1) {
+        return 0;
+    }
+
+    char* p = buf.head();
+    buf.write_1bytes(SrsBinaryLogTypeEvent);
+    buf.write_le2bytes(0);
+    buf.write_le4bytes(format->id);
+    buf.write_1bytes((int8_t)level);
+    buf.write_le8bytes((int64_t)tv.tv_sec * 1000000 + tv.tv_usec);
+    srs_binary_log_write_string(&buf, scid, cid_len, true);
+    srs_binary_log_write_string(&buf, tag, tag_len, true);
+    buf.write_le4bytes(err);
+
+    // The arguments, by the kinds parsed from format.
+    int precision = -1;
+    std::vector<char>& args = format->args;
+    for (int i = 0; i < (int)args.size(); i++) {
+        char kind = args[i];
+        if (kind == SrsBinaryLogArgInt || kind == SrsBinaryLogArgStar || kind == '.') {
+            int v = va_arg(ap, int);
+            if (!buf.require(4)) {
+                return 0;
+            }
+            buf.write_le4bytes(v);
+            precision = (kind == '.')? v : -1;
+        } else if (kind == SrsBinaryLogArgLong || kind == SrsBinaryLogArgLongLong) {
+            int64_t v = (kind == SrsBinaryLogArgLong)? (int64_t)va_arg(ap, long) : (int64_t)va_arg(ap, long long);
+            if (!buf.require(8)) {
+                return 0;
+            }
+            buf.write_le8bytes(v);
+        } else if (kind == SrsBinaryLogArgIgnored) {
+            (void)va_arg(ap, void*);
+        } else if (kind == SrsBinaryLogArgPointer) {
+            int64_t v = (int64_t)(intptr_t)va_arg(ap, void*);
+            if (!buf.require(8)) {
+                return 0;
+            }
+            buf.write_le8bytes(v);
+        } else if (kind == SrsBinaryLogArgDouble) {
+            double v = va_arg(ap, double);
+            if (!buf.require(8)) {
+                return 0;
+            }
+            int64_t iv = 0;
+            memcpy(&iv, &v, 8);
+            buf.write_le8bytes(iv);
+        } else if (kind == SrsBinaryLogArgString) {
+            const char* v = va_arg(ap, const char*);
+            if (!v) {
+                if (!buf.require(2)) {
+                    return 0;
+                }
+                buf.write_le2bytes((int16_t)SRS_BINARY_LOG_NULL_STRING);
+                continue;
+            }
+
+            // The string maybe not terminated, for example, "%.*s".
+            int len = 0;
+            int max_len = precision >= 0? srs_min(precision, SRS_BINARY_LOG_MAX_STRING) : SRS_BINARY_LOG_MAX_STRING;
+            precision = -1;
+            while (len < max_len && v[len]) {
+                len++;
+            }
+
+            // Truncate the string to the space left, like text log.
+            if (!buf.require(2 + len)) {
+                len = buf.left() - 2;
+                if (len < 0) {
+                    return 0;
+                }
+            }
+            srs_binary_log_write_string(&buf, v, len, false);
+        }
+    }
+    srs_binary_log_end_record(p, &buf);
+
+    return buf.pos();
+}
+
+int SrsBinaryLogEncoder::encode_dynamic(SrsBinaryLogThreadState* st, char* data, int size, int level, const char* tag, const SrsContextId& cid, int err, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int nn = do_encode(st, data, size, level, tag, cid, err, fmt, ap);
+    va_end(ap);
+
+    return nn;
+}
+
+SrsBinaryLogDecoder::SrsBinaryLogDecoder()
+{
+    pid_ = 0;
+    utc_ = false;
+}
+
+SrsBinaryLogDecoder::~SrsBinaryLogDecoder()
+{
+}
+
+srs_error_t SrsBinaryLogDecoder::decode(const char* data, int size, int* pnn, string& text)
+{
+    srs_error_t err = srs_success;
+
+    *pnn = 0;
+    text = "";
+
+    if (size < SRS_BINARY_LOG_RECORD_HEADER) {
+        return err;
+    }
+
+    uint8_t type = (uint8_t)data[0];
+    int nn = (uint8_t)data[1] | ((uint8_t)data[2] << 8);
+    if (size < SRS_BINARY_LOG_RECORD_HEADER + nn) {
+        return err;
+    }
+    *pnn = SRS_BINARY_LOG_RECORD_HEADER + nn;
+
+    SrsBuffer buf((char*)data + SRS_BINARY_LOG_RECORD_HEADER, nn);
+    if (type == SrsBinaryLogTypeHeader) {
+        return on_header(&buf);
+    } else if (type == SrsBinaryLogTypeDefine) {
+        return on_define(&buf);
+    } else if (type == SrsBinaryLogTypeEvent) {
+        return on_event(&buf, text);
+    }
+
+    // Ignore the unknown record.
+    return err;
+}
+
+srs_error_t SrsBinaryLogDecoder::on_header(SrsBuffer* buf)
+{
+    if (!buf->require(10)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "header requires 10 only %d bytes", buf->left());
+    }
+
+    string magic = buf->read_string(4);
+    if (magic != "SRSB") {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "invalid magic %s", magic.c_str());
+    }
+
+    int version = buf->read_1bytes();
+    if (version != SRS_BINARY_LOG_VERSION) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "invalid version %d", version);
+    }
+
+    pid_ = buf->read_le4bytes();
+    utc_ = buf->read_1bytes();
+
+    // All formats are defined again for new log file.
+    formats_.clear();
+
+    return srs_success;
+}
+
+srs_error_t SrsBinaryLogDecoder::on_define(SrsBuffer* buf)
+{
+    if (!buf->require(6)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "define requires 6 only %d bytes", buf->left());
+    }
+
+    uint32_t id = (uint32_t)buf->read_le4bytes();
+    int len = (uint16_t)buf->read_le2bytes();
+    if (!buf->require(len)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "format requires %d only %d bytes", len, buf->left());
+    }
+
+    formats_[id] = buf->read_string(len);
+
+    return srs_success;
+}
+
+srs_error_t SrsBinaryLogDecoder::on_event(SrsBuffer* buf, string& text)
+{
+    srs_error_t err = srs_success;
+
+    if (!buf->require(14)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "event requires 14 only %d bytes", buf->left());
+    }
+
+    uint32_t id = (uint32_t)buf->read_le4bytes();
+    int level = (uint8_t)buf->read_1bytes();
+    int64_t us = buf->read_le8bytes();
+
+    int len = (uint8_t)buf->read_1bytes();
+    if (!buf->require(len + 1)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "cid requires %d only %d bytes", len + 1, buf->left());
+    }
+    string cid = buf->read_string(len);
+
+    len = (uint8_t)buf->read_1bytes();
+    if (!buf->require(len + 4)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "tag requires %d only %d bytes", len + 4, buf->left());
+    }
+    string tag = buf->read_string(len);
+    int errnum = buf->read_le4bytes();
+
+    // Render the header, same to the text log.
+    timeval tv;
+    tv.tv_sec = (time_t)(us / 1000000);
+    tv.tv_usec = (suseconds_t)(us % 1000000);
+
+    char header[SRS_BASIC_LOG_SIZE];
+    int size = 0;
+    bool dangerous = level == SrsLogLevelWarn || level == SrsLogLevelError;
+    if (!srs_log_header_of(header, sizeof(header), utc_, dangerous, tag.empty()? NULL : tag.c_str(), cid.c_str(),
+        srs_log_level_name(level), &tv, pid_, errnum, &size)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_READ, "render header");
+    }
+    text.append(header, size);
+
+    std::map<uint32_t, string>::iterator it = formats_.find(id);
+    if (it == formats_.end()) {
+        text.append("(unknown format)");
+        return err;
+    }
+
+    // Render the message by format, spec by spec.
+    const char* fmt = it->second.c_str();
+    for (const char* p = fmt; *p; p++) {
+        if (*p != '%') {
+            text.push_back(*p);
+            continue;
+        }
+
+        if (p[1] == '%') {
+            text.push_back('%');
+            p++;
+            continue;
+        }
+
+        const char* start = p++;
+        std::vector<char> args;
+        p = srs_binary_log_parse_spec(p, args);
+        if (!*p) {
+            text.append(start);
+            break;
+        }
+
+        if ((err = render(buf, string(start, p - start + 1), args, text)) != srs_success) {
+            return srs_error_wrap(err, "render %s", fmt);
+        }
+    }
+
+    // Append the strerror for error, same to the text log.
+    if (level == SrsLogLevelError && errnum != 0) {
+        text.append("(");
+        text.append(strerror(errnum));
+        text.append(")");
+    }
+
+    return err;
+}
+
+// Render the spec with star arguments and the value.
+#define SRS_BINARY_LOG_RENDER(v) \
+    if (nn_stars == 0) { \
+        n = snprintf(NULL, 0, spec.c_str(), v); \
+    } else if (nn_stars == 1) { \
+        n = snprintf(NULL, 0, spec.c_str(), stars[0], v); \
+    } else { \
+        n = snprintf(NULL, 0, spec.c_str(), stars[0], stars[1], v); \
+    } \
+    if (n > 0) { \
+        std::vector<char> tmp(n + 1); \
+        if (nn_stars == 0) { \
+            snprintf(&tmp[0], n + 1, spec.c_str(), v); \
+        } else if (nn_stars == 1) { \
+            snprintf(&tmp[0], n + 1, spec.c_str(), stars[0], v); \
+        } else { \
+            snprintf(&tmp[0], n + 1, spec.c_str(), stars[0], stars[1], v); \
+        } \
+        text.append(&tmp[0], n); \
+    }
+
+srs_error_t SrsBinaryLogDecoder::render(SrsBuffer* buf, string spec, std::vector<char>& args, string& text)
+{
+    int stars[2];
+    int nn_stars = 0;
+
+    for (int i = 0; i < (int)args.size(); i++) {
+        char kind = args[i];
+        int n = 0;
+
+        if (kind == SrsBinaryLogArgStar || kind == '.') {
+            if (!buf->require(4) || nn_stars >= 2) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "invalid star");
+            }
+            stars[nn_stars++] = buf->read_le4bytes();
+        } else if (kind == SrsBinaryLogArgInt) {
+            if (!buf->require(4)) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "int requires 4 only %d bytes", buf->left());
+            }
+            int v = buf->read_le4bytes();
+            SRS_BINARY_LOG_RENDER(v);
+        } else if (kind == SrsBinaryLogArgLong || kind == SrsBinaryLogArgLongLong) {
+            if (!buf->require(8)) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "long requires 8 only %d bytes", buf->left());
+            }
+            // Render the value as long long, so the length modifier should be ll.
+            size_t pos = spec.find_last_not_of("hlqjzt", spec.length() - 2);
+            spec = spec.substr(0, pos + 1) + "ll" + spec.substr(spec.length() - 1);
+            long long v = (long long)buf->read_le8bytes();
+            SRS_BINARY_LOG_RENDER(v);
+        } else if (kind == SrsBinaryLogArgIgnored) {
+            text.append(spec);
+        } else if (kind == SrsBinaryLogArgPointer) {
+            if (!buf->require(8)) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "pointer requires 8 only %d bytes", buf->left());
+            }
+            void* v = (void*)(intptr_t)buf->read_le8bytes();
+            SRS_BINARY_LOG_RENDER(v);
+        } else if (kind == SrsBinaryLogArgDouble) {
+            if (!buf->require(8)) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "double requires 8 only %d bytes", buf->left());
+            }
+            int64_t iv = buf->read_le8bytes();
+            double v = 0;
+            memcpy(&v, &iv, 8);
+            SRS_BINARY_LOG_RENDER(v);
+        } else if (kind == SrsBinaryLogArgString) {
+            if (!buf->require(2)) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "string requires 2 only %d bytes", buf->left());
+            }
+            int len = (uint16_t)buf->read_le2bytes();
+            if (len == SRS_BINARY_LOG_NULL_STRING) {
+                const char* v = NULL;
+                SRS_BINARY_LOG_RENDER(v);
+                continue;
+            }
+            if (!buf->require(len)) {
+                return srs_error_new(ERROR_SYSTEM_FILE_READ, "string requires %d only %d bytes", len, buf->left());
+            }
+            string sv = buf->read_string(len);
+            const char* v = sv.c_str();
+            SRS_BINARY_LOG_RENDER(v);
+        }
+    }
+
+    return srs_success;
+}
@@ -11,6 +11,10 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #include <srs_service_st.hpp>
 #include <srs_kernel_log.hpp>
@@ -67,6 +71,123 @@ public:
     virtual void error(const char* tag, SrsContextId context_id, const char* fmt, ...);
 };
 
+class SrsBuffer;
+
+// The binary log format, the format string is interned once and only the arguments are written,
+// so it's much faster than rendering the text log, and the log is rendered by the decoder offline.
+// @remark The format which is not a string literal, is rendered and written as a "%s" argument.
+// The binary log is a sequence of records, each record is:
+//      u8 type, u16 size, u8[size] payload
+// The payload of records, all numbers are little-endian:
+//      Header: u8[4] "SRSB", u8 version, u32 pid, u8 utc
+//      Define: u32 id, u16 len, u8[len] fmt
+//      Event: u32 id, u8 level, u64 time(us), u8 len, u8[len] cid, u8 len, u8[len] tag, i32 errno, args
+// The args are encoded by the conversion specifications of fmt:
+//      int: 4 bytes, long and pointer: 8 bytes, double: 8 bytes, string: u16 len + bytes.
+// @remark A header is written when log file is reopened, then all formats are defined again.
+enum SrsBinaryLogType
+{
+    SrsBinaryLogTypeHeader = 0x01,
+    SrsBinaryLogTypeDefine = 0x02,
+    SrsBinaryLogTypeEvent = 0x03,
+};
+
+// The kind of argument, parsed from the conversion specification of fmt.
+enum SrsBinaryLogArg
+{
+    SrsBinaryLogArgInt = 'i',
+    // The long, size_t or ptrdiff_t, which is the same size as long.
+    SrsBinaryLogArgLong = 'l',
+    // The long long or intmax_t.
+    SrsBinaryLogArgLongLong = 'L',
+    SrsBinaryLogArgDouble = 'd',
+    SrsBinaryLogArgString = 's',
+    SrsBinaryLogArgPointer = 'p',
+    // The width or precision specified by *, which is an int argument.
+    SrsBinaryLogArgStar = '*',
+    // The %n is never written, its argument is ignored, and it's rendered as text.
+    SrsBinaryLogArgIgnored = 'n',
+};
+
+// Parse the printf format to kinds of arguments, @see SrsBinaryLogArg
+extern void srs_binary_log_parse(const char* fmt, std::vector<char>& args);
+
+// The format interned by its address, shared by all threads.
+struct SrsBinaryLogFormat
+{
+    uint32_t id;
+    const char* fmt;
+    // The kinds of arguments, @see SrsBinaryLogArg
+    std::vector<char> args;
+};
+
+// The state of encoder for each thread.
+struct SrsBinaryLogThreadState;
+
+// The encoder for binary log, interns the format string by its address.
+// @remark Each thread writes to its own ring of async log, so the format is defined in the ring of each
+//      thread before its events, and the header with all formats is written when log file is opened.
+class SrsBinaryLogEncoder
+{
+private:
+    bool utc_;
+    // Protect the interned formats, which are shared by all threads.
+    pthread_mutex_t lock_;
+    // The interned formats, the key is address of format string.
+    std::map<const char*, SrsBinaryLogFormat*> ids_;
+    std::vector<SrsBinaryLogFormat*> formats_;
+    // The key of thread state, @see SrsBinaryLogThreadState
+    pthread_key_t key_;
+public:
+    SrsBinaryLogEncoder(bool utc);
+    virtual ~SrsBinaryLogEncoder();
+public:
+    // Get the header and all interned formats, which should be written first to a new log file.
+    std::string preamble();
+    // Encode the log to buffer, return the size of bytes, or 0 if no enough space. The log is truncated
+    // like text log if it's too long.
+    // @remark User must call on_written when done, to mark the formats as defined.
+    int encode(char* data, int size, int level, const char* tag, const SrsContextId& cid, int err, const char* fmt, va_list ap);
+    // Whether the encoded log is written, for example, it maybe dropped by async log.
+    void on_written(bool written);
+private:
+    SrsBinaryLogThreadState* state();
+    SrsBinaryLogFormat* fetch(const char* fmt);
+    int do_encode(SrsBinaryLogThreadState* state, char* data, int size, int level, const char* tag, const SrsContextId& cid, int err, const char* fmt, va_list ap);
+    int encode_dynamic(SrsBinaryLogThreadState* state, char* data, int size, int level, const char* tag, const SrsContextId& cid, int err, const char* fmt, ...);
+};
+
+// The decoder for binary log, to render the log to text.
+class SrsBinaryLogDecoder
+{
+private:
+    int pid_;
+    bool utc_;
+    // The formats of current file, the key is id.
+    std::map<uint32_t, std::string> formats_;
+public:
+    SrsBinaryLogDecoder();
+    virtual ~SrsBinaryLogDecoder();
+public:
+    // Decode a record, and render the text line if it's an event.
+    // @param pnn Output the bytes of record, 0 if no enough bytes for a record.
+    // @param text Output the text line without tail, empty if not an event.
+    srs_error_t decode(const char* data, int size, int* pnn, std::string& text);
+private:
+    srs_error_t on_header(SrsBuffer* buf);
+    srs_error_t on_define(SrsBuffer* buf);
+    srs_error_t on_event(SrsBuffer* buf, std::string& text);
+    // Render a conversion specification with the argument in buf.
+    srs_error_t render(SrsBuffer* buf, std::string spec, std::vector<char>& args, std::string& text);
+};
+
+// Generate the log header for specified time, pid and errno.
+// @remark It's a internal API, @see srs_log_header
+bool srs_log_header_of(char* buffer, int size, bool utc, bool dangerous, const char* tag, const char* cid, const char* level, timeval* ptv, int pid, int err, int* psize);
+
+// Get the level name in log header, for example, "Trace".
+extern const char* srs_log_level_name(int level);
+
 // Generate the log header.
 // @param dangerous Whether log is warning or error, log the errno if true.
 // @param utc Whether use UTC time format in the log header.
@@ -33,6 +33,7 @@ SrsBasicRtmpClient::SrsBasicRtmpClient(string r, srs_utime_t ctm, srs_utime_t st
     client = NULL;
     
     stream_id = 0;
+    si = new SrsServerInfo();
 }
 
 SrsBasicRtmpClient::~SrsBasicRtmpClient()
@@ -41,6 +42,7 @@ SrsBasicRtmpClient::~SrsBasicRtmpClient()
     srs_freep(kbps);
     srs_freep(clk);
     srs_freep(req);
+    srs_freep(si);
 }
 
 srs_error_t SrsBasicRtmpClient::connect()
@@ -123,8 +125,7 @@ srs_error_t SrsBasicRtmpClient::do_connect_app(string local_ip, bool debug)
     // upnode server identity will show in the connect_app of client.
     // @see https://github.com/ossrs/srs/issues/160
     // the debug_srs_upnode is config in vhost and default to true.
-    SrsServerInfo si;
-    if ((err = client->connect_app(req->app, tc_url, req, debug, &si)) != srs_success) {
+    if ((err = client->connect_app(req->app, tc_url, req, debug, si)) != srs_success) {
         return srs_error_wrap(err, "connect app tcUrl=%s, debug=%d", tc_url.c_str(), debug);
     }
     
@@ -203,6 +204,11 @@ int SrsBasicRtmpClient::sid()
     return stream_id;
 }
 
+SrsServerInfo* SrsBasicRtmpClient::server_info()
+{
+    return si;
+}
+
 srs_error_t SrsBasicRtmpClient::recv_message(SrsCommonMessage** pmsg)
 {
     return client->recv_message(pmsg);
@@ -19,6 +19,7 @@ class SrsSharedPtrMessage;
 class SrsPacket;
 class SrsKbps;
 class SrsWallClock;
+struct SrsServerInfo;
 
 // The simple RTMP client, provides friendly APIs.
 // @remark Should never use client when closed.
@@ -41,6 +42,8 @@ private:
     SrsKbps* kbps;
     SrsWallClock* clk;
     int stream_id;
+    // The upnode server info, from the response of connect app.
+    SrsServerInfo* si;
 public:
     // Constructor.
     // @param r The RTMP url, for example, rtmp://ip:port/app/stream?domain=vhost
@@ -62,6 +65,8 @@ public:
     virtual void kbps_sample(const char* label, int64_t age);
     virtual void kbps_sample(const char* label, int64_t age, int msgs);
     virtual int sid();
+    // Get the upnode server info, which is valid after connected.
+    virtual SrsServerInfo* server_info();
 public:
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
@@ -10,6 +10,12 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
+#ifndef SRS_OSX
+#include <sys/sendfile.h>
+#else
+#include <sys/uio.h>
+#endif
 using namespace std;
 
 #include <srs_core_autofree.hpp>
@@ -21,6 +27,9 @@ using namespace std;
 // nginx also set to 512
 #define SERVER_LISTEN_BACKLOG 512
 
+// The window in bytes to sendfile and read ahead.
+#define SRS_SENDFILE_WINDOW (1024 * 1024)
+
 #ifdef __linux__
 #include <sys/epoll.h>
 
@@ -610,6 +619,69 @@ srs_error_t SrsStSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
     return err;
 }
 
+srs_error_t SrsStSocket::sendfile(int fd, int64_t offset, int64_t size, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+
+    int osfd = srs_netfd_fileno(stfd);
+    st_utime_t timeout = (stm == SRS_UTIME_NO_TIMEOUT)? ST_UTIME_NO_TIMEOUT : stm;
+
+    int64_t pos = offset;
+    int64_t left = size;
+
+#ifndef SRS_OSX
+    // Start to read the first window from disk.
+    posix_fadvise(fd, pos, srs_min(left, SRS_SENDFILE_WINDOW), POSIX_FADV_WILLNEED);
+#endif
+
+    while (left > 0) {
+        int64_t window = srs_min(left, SRS_SENDFILE_WINDOW);
+
+#ifndef SRS_OSX
+        // Read the next window ahead, so the disk IO is done in background when sending this one,
+        // and the sendfile seldom blocks the event loop for cold file.
+        if (left > window) {
+            posix_fadvise(fd, pos + window, srs_min(left - window, SRS_SENDFILE_WINDOW), POSIX_FADV_WILLNEED);
+        }
+
+        off_t off = (off_t)pos;
+        ssize_t nb_write = ::sendfile(osfd, fd, &off, (size_t)window);
+#else
+        off_t nb_sent = (off_t)window;
+        ssize_t nb_write = ::sendfile(fd, osfd, (off_t)pos, &nb_sent, NULL, 0);
+        if (nb_write == 0 || (nb_write < 0 && errno == EAGAIN && nb_sent > 0)) {
+            nb_write = nb_sent;
+        }
+#endif
+
+        // The socket buffer is full, wait for it to be writable.
+        if (nb_write < 0 && errno == EAGAIN) {
+            if (st_netfd_poll((st_netfd_t)stfd, POLLOUT, timeout) == -1) {
+                if (errno == ETIME) {
+                    return srs_error_new(ERROR_SOCKET_TIMEOUT, "sendfile timeout %d ms", srsu2msi(stm));
+                }
+                return srs_error_new(ERROR_SOCKET_WRITE, "sendfile poll");
+            }
+            continue;
+        }
+
+        // The file is truncated when nothing sent.
+        if (nb_write <= 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendfile offset=%" PRId64 ", left=%" PRId64, pos, left);
+        }
+
+        pos += nb_write;
+        left -= nb_write;
+        sbytes += nb_write;
+    }
+
+    if (nwrite) {
+        *nwrite = (ssize_t)size;
+    }
+
+    return err;
+}
+
 SrsTcpClient::SrsTcpClient(string h, int p, srs_utime_t tm)
 {
     stfd = NULL;
@@ -106,7 +106,7 @@ public:
 
 // the socket provides TCP socket over st,
 // that is, the sync socket mechanism.
-class SrsStSocket : public ISrsProtocolReadWriter
+class SrsStSocket : public ISrsProtocolReadWriter, public ISrsProtocolFileWriter
 {
 private:
     // The recv/send timeout in srs_utime_t.
@@ -138,6 +138,9 @@ public:
     // @param nwrite, the actual write bytes, ignore if NULL.
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsProtocolFileWriter
+public:
+    virtual srs_error_t sendfile(int fd, int64_t offset, int64_t size, ssize_t* nwrite);
 };
 
 // The client to connect to server over TCP.
@@ -58,6 +58,13 @@ extern srs_utime_t _srs_tmp_timeout;
     if ((err = x) != srs_success) delete err; \
     ASSERT_TRUE(srs_success != err)
 
+// Skip the rest of test, like GTEST_SKIP which is not available in gtest-1.6, so we record
+// it in the XML report and show it in the console.
+#define HELPER_SKIP(reason) \
+    ::testing::Test::RecordProperty("skipped", reason); \
+    printf("[  SKIPPED ] %s\n", reason); \
+    return
+
 // For init array data.
 #define HELPER_ARRAY_INIT(buf, sz, val) \
     for (int _iii = 0; _iii < (int)sz; _iii++) (buf)[_iii] = val
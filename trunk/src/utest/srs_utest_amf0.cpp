@@ -2775,3 +2775,64 @@ VOID TEST(ProtocolJSONTest, ParseSpecial)
     }
 }
 
+VOID TEST(ProtocolJSONTest, Writer)
+{
+    if (true) {
+        SrsJsonWriter w(16);
+        w.object_start();
+        w.integer("code", 0);
+        w.str("server", "vid-\"x\"");
+        w.array_start("clients");
+        for (int i = 0; i < 2; i++) {
+            w.object_start();
+            w.integer("id", i);
+            w.boolean("publish", i == 0);
+            w.number("alive", 1.5);
+            w.null("video");
+            w.object_end();
+        }
+        w.array_end();
+        w.object_end();
+
+        string json(w.bytes(), w.length());
+        EXPECT_STREQ("{\"code\":0,\"server\":\"vid-\\\"x\\\"\",\"clients\":[{\"id\":0,\"publish\":true,\"alive\":1.50,\"video\":null},"
+            "{\"id\":1,\"publish\":false,\"alive\":1.50,\"video\":null}]}", json.c_str());
+
+        SrsJsonAny* p = SrsJsonAny::loads(json);
+        ASSERT_TRUE(p && p->is_object());
+        srs_freep(p);
+    }
+
+    // Select the fields of items, and reset the bytes which is sent.
+    if (true) {
+        vector<string> fields;
+        fields.push_back("id");
+        fields.push_back("kbps");
+
+        SrsJsonWriter w;
+        w.select(fields, 3);
+        w.object_start();
+        w.integer("code", 0);
+        w.array_start("streams");
+        w.object_start();
+        w.integer("id", 1);
+        w.str("name", "livestream");
+        w.object_start("publish");
+        w.boolean("active", true);
+        w.object_end();
+        w.object_start("kbps");
+        w.integer("recv_30s", 10);
+        w.object_end();
+        w.object_end();
+        EXPECT_STREQ("{\"code\":0,\"streams\":[{\"id\":1,\"kbps\":{\"recv_30s\":10}}", string(w.bytes(), w.length()).c_str());
+
+        w.reset();
+        w.object_start();
+        w.integer("id", 2);
+        w.object_end();
+        w.array_end();
+        w.object_end();
+        EXPECT_STREQ(",{\"id\":2}]}", string(w.bytes(), w.length()).c_str());
+    }
+}
+
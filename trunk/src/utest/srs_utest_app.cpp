@@ -7,6 +7,9 @@
 
 using namespace std;
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <srs_kernel_error.hpp>
 #include <srs_app_fragment.hpp>
 #include <srs_app_security.hpp>
@@ -15,6 +18,13 @@ using namespace std;
 #include <srs_app_st.hpp>
 #include <srs_service_conn.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_log.hpp>
+#include <srs_app_metrics.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_utest_config.hpp>
+
+#include <openssl/opensslconf.h>
 
 class MockIDResource : public ISrsResource
 {
@@ -655,3 +665,197 @@ VOID TEST(AppSecurity, CheckSecurity)
     //       4. deny if matches deny strategy.
 }
 
+
+VOID TEST(AppAsyncLogTest, RingBuffer)
+{
+    if (true) {
+        SrsLogRingBuffer ring(16); iovec iovs[2];
+        EXPECT_EQ(0, ring.peek(iovs));
+
+        EXPECT_TRUE(ring.push("Hello", 5));
+        EXPECT_TRUE(ring.push("World", 5));
+        EXPECT_EQ(2, (int)ring.nn_lines());
+
+        EXPECT_EQ(1, ring.peek(iovs));
+        EXPECT_EQ(10, (int)iovs[0].iov_len);
+        EXPECT_EQ(0, memcmp(iovs[0].iov_base, "HelloWorld", 10));
+        ring.consume(10);
+        EXPECT_EQ(0, ring.peek(iovs));
+    }
+
+    // Wrap to the start of ring.
+    if (true) {
+        SrsLogRingBuffer ring(16); iovec iovs[2];
+        EXPECT_TRUE(ring.push("0123456789", 10));
+        EXPECT_EQ(1, ring.peek(iovs));
+        ring.consume(10);
+
+        EXPECT_TRUE(ring.push("abcdefghij", 10));
+        EXPECT_EQ(2, ring.peek(iovs));
+        EXPECT_EQ(6, (int)iovs[0].iov_len);
+        EXPECT_EQ(0, memcmp(iovs[0].iov_base, "abcdef", 6));
+        EXPECT_EQ(4, (int)iovs[1].iov_len);
+        EXPECT_EQ(0, memcmp(iovs[1].iov_base, "ghij", 4));
+    }
+
+    // Full, drop the line.
+    if (true) {
+        SrsLogRingBuffer ring(16);
+        EXPECT_TRUE(ring.push("0123456789", 10));
+        EXPECT_FALSE(ring.push("abcdefghij", 10));
+        ring.on_dropped();
+        EXPECT_EQ(1, (int)ring.nn_lines());
+        EXPECT_EQ(1, (int)ring.nn_dropped());
+    }
+}
+
+VOID TEST(AppAsyncLogTest, WriterDrain)
+{
+    srs_error_t err = srs_success;
+
+    // Write all lines to file.
+    if (true) {
+        SrsAsyncLogWriter writer;
+        HELPER_EXPECT_SUCCESS(writer.initialize("", 0, false, NULL, false));
+
+        int fds[2];
+        ASSERT_EQ(0, pipe(fds));
+        writer.fd_ = fds[1];
+
+        EXPECT_TRUE(writer.write("Hello\n", 6));
+        EXPECT_TRUE(writer.write("World\n", 6));
+        EXPECT_EQ(12, writer.drain());
+
+        char buf[32];
+        EXPECT_EQ(12, (int)::read(fds[0], buf, sizeof(buf)));
+        EXPECT_EQ(0, memcmp(buf, "Hello\nWorld\n", 12));
+        EXPECT_EQ(0, (int)writer.nn_dropped());
+        ::close(fds[0]);
+    }
+
+    // The lines failed to write are counted as dropped.
+    if (true) {
+        SrsAsyncLogWriter writer;
+        HELPER_EXPECT_SUCCESS(writer.initialize("", 0, false, NULL, false));
+        writer.fd_ = ::open("/dev/null", O_RDONLY);
+        ASSERT_GT(writer.fd_, 0);
+
+        EXPECT_TRUE(writer.write("Hello\n", 6));
+        EXPECT_TRUE(writer.write("World\n", 6));
+        EXPECT_EQ(12, writer.drain());
+        EXPECT_EQ(2, (int)writer.nn_dropped());
+    }
+
+    // Never block the ST thread, drop the line even for block policy.
+    if (true) {
+        SrsAsyncLogWriter writer;
+        HELPER_EXPECT_SUCCESS(writer.initialize("", 0, true, NULL, false));
+        writer.started_ = true;
+
+        string line(1024, 'x');
+        int nn = 0;
+        while (writer.write(line.data(), (int)line.size())) {
+            nn++;
+        }
+        EXPECT_EQ((int)writer.capacity_ / 1024, nn);
+        EXPECT_EQ(1, (int)writer.nn_dropped());
+        writer.started_ = false;
+    }
+}
+
+class MockCryptoTask : public ISrsCryptoTask
+{
+public:
+    pthread_t self;
+    int v;
+public:
+    MockCryptoTask() {
+        self = pthread_self();
+        v = 0;
+    }
+    virtual ~MockCryptoTask() {
+    }
+    virtual void run() {
+        self = pthread_self();
+        v++;
+    }
+};
+
+VOID TEST(AppCryptoWorkersTest, Execute)
+{
+    srs_error_t err;
+
+    SrsCryptoWorkers workers;
+
+    // Run by thread, and the coroutine is parked until done.
+    for (int i = 0; i < 3; i++) {
+        MockCryptoTask task;
+        HELPER_EXPECT_SUCCESS(workers.execute(&task));
+        EXPECT_EQ(1, task.v);
+#ifdef OPENSSL_THREADS
+        EXPECT_FALSE(pthread_equal(task.self, pthread_self()));
+#endif
+    }
+
+    workers.stop();
+}
+
+VOID TEST(AppMetricsWriterTest, Render)
+{
+    // Grow the buffer when not enough.
+    if (true) {
+        SrsMetricsWriter w(1024);
+        w.family("srs_clients", "gauge", "The number of clients.");
+        for (int i = 0; i < 100; i++) {
+            w.sample("srs_clients", "vhost=\"test.com\"", (int64_t)i);
+        }
+        EXPECT_GT(w.length(), 1024);
+        EXPECT_EQ(0, memcmp(w.bytes(), "# HELP srs_clients The number of clients.\n# TYPE srs_clients gauge\n", 67));
+
+        w.reset();
+        w.sample("srs_clients", NULL, (int64_t)10);
+        EXPECT_EQ(15, w.length());
+        EXPECT_EQ(0, memcmp(w.bytes(), "srs_clients 10\n", 15));
+    }
+
+    // Escape the label value.
+    if (true) {
+        EXPECT_STREQ("livestream", SrsMetricsWriter::escape("livestream").c_str());
+        EXPECT_STREQ("a\\\\b\\\"c\\n", SrsMetricsWriter::escape("a\\b\"c\n").c_str());
+    }
+}
+
+VOID TEST(AppLivePublisherTest, CreatePublisher)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse("listen 1935 19350;"));
+
+    SrsConfig* config = _srs_config;
+    _srs_config = &conf;
+
+    // Publish in process, when url is served by this server.
+    if (true) {
+        ISrsLivePublisher* p = srs_create_live_publisher("rtmp://127.0.0.1/live/livestream", "");
+        EXPECT_TRUE(dynamic_cast<SrsLiveSourcePublisher*>(p) != NULL);
+        srs_freep(p);
+
+        p = srs_create_live_publisher("rtmp://localhost:19350/live/livestream?vhost=test.com", "");
+        EXPECT_TRUE(dynamic_cast<SrsLiveSourcePublisher*>(p) != NULL);
+        srs_freep(p);
+    }
+
+    // Relay by RTMP, when url is served by other server.
+    if (true) {
+        ISrsLivePublisher* p = srs_create_live_publisher("rtmp://127.0.0.1:1936/live/livestream", "");
+        EXPECT_TRUE(dynamic_cast<SrsRtmpRelayPublisher*>(p) != NULL);
+        srs_freep(p);
+
+        p = srs_create_live_publisher("rtmp://ossrs.net/live/livestream", "");
+        EXPECT_TRUE(dynamic_cast<SrsRtmpRelayPublisher*>(p) != NULL);
+        srs_freep(p);
+    }
+
+    _srs_config = config;
+}
@@ -3138,6 +3138,17 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_EQ(1, (int)conf.get_vhost_coworkers("ossrs.net").size());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_balance ewma;}}"));
+        EXPECT_STREQ("ewma", conf.get_vhost_edge_origin_balance("ossrs.net").c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_balance xxx;}}"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{origin_cluster on;}}"));
@@ -3269,6 +3280,7 @@ VOID TEST(ConfigMainTest, CheckVhostConfig4)
         EXPECT_TRUE(conf.get_transcode("ossrs.net", "") == NULL);
         EXPECT_FALSE(conf.get_transcode_enabled(conf.get_transcode("ossrs.net", "")));
         EXPECT_TRUE(conf.get_transcode_ffmpeg(conf.get_transcode("ossrs.net", "")).empty());
+        EXPECT_FALSE(conf.get_transcode_pipe(conf.get_transcode("ossrs.net", "")));
         EXPECT_EQ(0, (int)conf.get_transcode_engines(conf.get_transcode("ossrs.net", "")).size());
     }
 
@@ -3459,6 +3471,12 @@ VOID TEST(ConfigMainTest, CheckVhostConfig4)
         EXPECT_TRUE(conf.get_transcode_enabled(conf.get_transcode("ossrs.net", "xxx")));
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{transcode xxx{pipe on;}}"));
+        EXPECT_TRUE(conf.get_transcode_pipe(conf.get_transcode("ossrs.net", "xxx")));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{transcode xxx;}"));
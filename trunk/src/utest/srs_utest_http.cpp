@@ -6,6 +6,7 @@
 #include <srs_utest_http.hpp>
 
 #include <sstream>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_http_stack.hpp>
@@ -635,6 +636,46 @@ VOID TEST(ProtocolHTTPTest, HTTPServerMuxerVhost)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, HTTPServerMuxerTree)
+{
+    SrsHttpMuxEntry root, api, v1, v2, flv, flv2;
+
+    SrsHttpMuxTree t;
+    t.insert("/", &root);
+    t.insert("/api/v1/", &v1);
+    t.insert("/api/v2", &v2);
+    t.insert("/api/", &api);
+    t.insert("/live/livestream.flv", &flv);
+    t.insert("/live/livestream2.flv", &flv2);
+
+    // The longest pattern wins, or exactly match.
+    EXPECT_TRUE(&root == t.match("/"));
+    EXPECT_TRUE(&root == t.match("/index.html"));
+    EXPECT_TRUE(&api == t.match("/api/"));
+    EXPECT_TRUE(&api == t.match("/api/v3"));
+    EXPECT_TRUE(&api == t.match("/api/v2/streams"));
+    EXPECT_TRUE(&v1 == t.match("/api/v1/"));
+    EXPECT_TRUE(&v1 == t.match("/api/v1/streams"));
+    EXPECT_TRUE(&v2 == t.match("/api/v2"));
+    EXPECT_TRUE(&flv == t.match("/live/livestream.flv"));
+    EXPECT_TRUE(&flv2 == t.match("/live/livestream2.flv"));
+    EXPECT_TRUE(&root == t.match("/live/livestream"));
+    EXPECT_TRUE(&root == t.match("/live/livestream.flv2"));
+    EXPECT_TRUE(NULL == t.match("live"));
+
+    // The disabled entry is ignored, for stream is unpublished.
+    v1.enabled = false;
+    flv.enabled = false;
+    EXPECT_TRUE(&api == t.match("/api/v1/streams"));
+    EXPECT_TRUE(&root == t.match("/live/livestream.flv"));
+    EXPECT_TRUE(&flv2 == t.match("/live/livestream2.flv"));
+
+    // Replace the entry.
+    SrsHttpMuxEntry flv3;
+    t.insert("/live/livestream.flv", &flv3);
+    EXPECT_TRUE(&flv3 == t.match("/live/livestream.flv"));
+}
+
 VOID TEST(ProtocolHTTPTest, HTTPServerMuxerImplicitHandler)
 {
     srs_error_t err;
@@ -1359,6 +1400,276 @@ VOID TEST(ProtocolHTTPTest, BasicHandlers)
     }
 }
 
+VOID TEST(ProtocolHTTPTest, HTTPFileServerRange)
+{
+    srs_error_t err;
+
+    if (true) {
+        int64_t start = 0, end = 0;
+        EXPECT_FALSE(srs_http_parse_range("", 100, start, end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=", 100, start, end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=-", 100, start, end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=0-1,3-4", 100, start, end));
+        EXPECT_FALSE(srs_http_parse_range("bytes=5-4", 100, start, end));
+
+        EXPECT_TRUE(srs_http_parse_range("bytes=0-9", 100, start, end));
+        EXPECT_EQ(0, start); EXPECT_EQ(9, end);
+
+        EXPECT_TRUE(srs_http_parse_range("bytes=90-", 100, start, end));
+        EXPECT_EQ(90, start); EXPECT_EQ(99, end);
+
+        EXPECT_TRUE(srs_http_parse_range("bytes=90-200", 100, start, end));
+        EXPECT_EQ(90, start); EXPECT_EQ(99, end);
+
+        EXPECT_TRUE(srs_http_parse_range("bytes=-10", 100, start, end));
+        EXPECT_EQ(90, start); EXPECT_EQ(99, end);
+
+        EXPECT_TRUE(srs_http_parse_range("bytes=-200", 100, start, end));
+        EXPECT_EQ(0, start); EXPECT_EQ(99, end);
+
+        // Not satisfiable.
+        EXPECT_TRUE(srs_http_parse_range("bytes=100-", 100, start, end));
+        EXPECT_TRUE(start >= 100);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.ts", false));
+
+        SrsHttpHeader hdr;
+        hdr.set("Range", "bytes=7-11");
+        r.set_header(&hdr, false);
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(206, "world", w);
+    }
+
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.ts", false));
+
+        SrsHttpHeader hdr;
+        hdr.set("Range", "bytes=13-");
+        r.set_header(&hdr, false);
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        EXPECT_EQ(416, w.w->status);
+    }
+}
+
+
+void mock_http_write_file(string path, string content)
+{
+    SrsFileWriter fw;
+    if (fw.open(path) == srs_success) {
+        fw.write((void*)content.data(), content.length(), NULL);
+    }
+}
+
+srs_error_t mock_http_cache_fetch(SrsHttpFileCache* c, string path, string etag, SrsHttpFileCacheEntry** pentry)
+{
+    srs_error_t err = srs_success;
+
+    SrsFileReader fr;
+    if ((err = fr.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+
+    return c->fetch(path, etag, &fr, pentry);
+}
+
+VOID TEST(ProtocolHTTPTest, HTTPFileServerCache)
+{
+    srs_error_t err;
+
+    if (true) {
+        EXPECT_FALSE(srs_http_etag_matched("", "\"a\""));
+        EXPECT_FALSE(srs_http_etag_matched("\"b\"", "\"a\""));
+        EXPECT_TRUE(srs_http_etag_matched("\"a\"", "\"a\""));
+        EXPECT_TRUE(srs_http_etag_matched("\"b\", \"a\"", "\"a\""));
+        EXPECT_TRUE(srs_http_etag_matched("W/\"a\"", "\"a\""));
+        EXPECT_TRUE(srs_http_etag_matched(" * ", "\"a\""));
+    }
+
+    string filepath = _srs_tmp_file_prefix + "http-file-cache.m3u8";
+    mock_http_write_file(filepath, "Hello");
+
+    // The modified file should be loaded again, while the old one is still valid for its user.
+    if (true) {
+        SrsHttpFileCache c(16, 8);
+
+        string etag;
+        EXPECT_TRUE(srs_http_file_etag(filepath, etag));
+        EXPECT_FALSE(srs_http_file_etag(_srs_tmp_file_prefix + "http-file-cache-none", etag));
+        EXPECT_FALSE(srs_http_file_etag(-1, etag));
+
+        // The etag of the opened file is not changed, even if the file is replaced.
+        if (true) {
+            SrsFileReader fr;
+            HELPER_ASSERT_SUCCESS(fr.open(filepath));
+
+            string fetag;
+            EXPECT_TRUE(srs_http_file_etag(fr.get_fd(), fetag));
+            EXPECT_STREQ(etag.c_str(), fetag.c_str());
+
+            string tmp = filepath + ".tmp";
+            mock_http_write_file(tmp, "World");
+            ASSERT_EQ(0, ::rename(tmp.c_str(), filepath.c_str()));
+
+            EXPECT_TRUE(srs_http_file_etag(fr.get_fd(), fetag));
+            EXPECT_STREQ(etag.c_str(), fetag.c_str());
+
+            EXPECT_TRUE(srs_http_file_etag(filepath, etag));
+            EXPECT_STRNE(etag.c_str(), fetag.c_str());
+
+            mock_http_write_file(filepath, "Hello");
+            EXPECT_TRUE(srs_http_file_etag(filepath, etag));
+        }
+
+        SrsHttpFileCacheEntry* e0 = NULL;
+        HELPER_ASSERT_SUCCESS(mock_http_cache_fetch(&c, filepath, etag, &e0));
+        ASSERT_TRUE(e0 != NULL);
+        EXPECT_EQ(0, memcmp("Hello", e0->data, 5));
+        EXPECT_EQ(0, c.hits()); EXPECT_EQ(1, c.misses()); EXPECT_EQ(5, c.size());
+
+        SrsHttpFileCacheEntry* e1 = NULL;
+        HELPER_ASSERT_SUCCESS(mock_http_cache_fetch(&c, filepath, etag, &e1));
+        EXPECT_TRUE(e0 == e1);
+        EXPECT_EQ(1, c.hits()); EXPECT_EQ(1, c.misses());
+        c.release(e1);
+
+        mock_http_write_file(filepath, "Hello!");
+        EXPECT_TRUE(srs_http_file_etag(filepath, etag));
+
+        HELPER_ASSERT_SUCCESS(mock_http_cache_fetch(&c, filepath, etag, &e1));
+        EXPECT_TRUE(e0 != e1);
+        EXPECT_EQ(0, memcmp("Hello!", e1->data, 6));
+        EXPECT_EQ(0, memcmp("Hello", e0->data, 5));
+        EXPECT_EQ(2, c.misses()); EXPECT_EQ(6, c.size());
+        c.release(e0);
+        c.release(e1);
+
+        // Too large to cache.
+        mock_http_write_file(filepath, "Hello, world!");
+        EXPECT_TRUE(srs_http_file_etag(filepath, etag));
+        HELPER_ASSERT_SUCCESS(mock_http_cache_fetch(&c, filepath, etag, &e1));
+        EXPECT_TRUE(e1 == NULL);
+        EXPECT_EQ(0, c.size());
+    }
+
+    // Evict the least recently used files.
+    if (true) {
+        SrsHttpFileCache c(16, 8);
+
+        string files[3];
+        SrsHttpFileCacheEntry* entries[3];
+        for (int i = 0; i < 3; i++) {
+            files[i] = _srs_tmp_file_prefix + "http-file-cache-" + srs_int2str(i) + ".ts";
+            mock_http_write_file(files[i], "Hello, ");
+
+            string etag;
+            EXPECT_TRUE(srs_http_file_etag(files[i], etag));
+            HELPER_ASSERT_SUCCESS(mock_http_cache_fetch(&c, files[i], etag, &entries[i]));
+            c.release(entries[i]);
+        }
+        EXPECT_EQ(14, c.size());
+        EXPECT_EQ(3, c.misses());
+
+        // The first file is evicted, so it's a miss.
+        string etag;
+        EXPECT_TRUE(srs_http_file_etag(files[0], etag));
+        HELPER_ASSERT_SUCCESS(mock_http_cache_fetch(&c, files[0], etag, &entries[0]));
+        c.release(entries[0]);
+        EXPECT_EQ(4, c.misses());
+
+        for (int i = 0; i < 3; i++) {
+            ::unlink(files[i].c_str());
+        }
+    }
+
+    // Response 200 with ETag, then 304 for If-None-Match.
+    if (true) {
+        mock_http_write_file(filepath, "Hello");
+
+        SrsHttpFileCache c(16, 8);
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_cache(&c);
+        h.entry = &e;
+
+        string upath = filepath.substr(4);
+        string etag;
+        EXPECT_TRUE(srs_http_file_etag(filepath, etag));
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url(upath, false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            EXPECT_EQ(200, w.w->status);
+            EXPECT_TRUE(srs_string_ends_with(HELPER_BUFFER2STR(&w.io.out_buffer), "\r\n\r\nHello"));
+            EXPECT_STREQ(etag.c_str(), w.w->header()->get("ETag").c_str());
+        }
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url(upath, false));
+
+            SrsHttpHeader hdr;
+            hdr.set("Range", "bytes=1-3");
+            r.set_header(&hdr, false);
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            EXPECT_EQ(206, w.w->status);
+            EXPECT_TRUE(srs_string_ends_with(HELPER_BUFFER2STR(&w.io.out_buffer), "\r\n\r\nell"));
+            EXPECT_EQ(1, c.hits());
+        }
+
+        if (true) {
+            MockResponseWriter w;
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url(upath, false));
+
+            SrsHttpHeader hdr;
+            hdr.set("If-None-Match", etag);
+            r.set_header(&hdr, false);
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            EXPECT_EQ(304, w.w->status);
+            EXPECT_STREQ(etag.c_str(), w.w->header()->get("ETag").c_str());
+
+            // No body, so neither Content-Length nor chunked encoding.
+            string res = HELPER_BUFFER2STR(&w.io.out_buffer);
+            EXPECT_TRUE(srs_string_ends_with(res, "\r\n\r\n"));
+            EXPECT_EQ(string::npos, res.find("Content-Length"));
+            EXPECT_EQ(string::npos, res.find("Transfer-Encoding"));
+        }
+    }
+
+    ::unlink(filepath.c_str());
+}
 VOID TEST(ProtocolHTTPTest, MSegmentsReader)
 {
     srs_error_t err;
@@ -20,6 +20,7 @@ using namespace std;
 #include <srs_kernel_mp3.hpp>
 #include <srs_kernel_ts.hpp>
 #include <srs_kernel_mp4.hpp>
+#include <srs_kernel_kbps.hpp>
 #include <srs_core_autofree.hpp>
 
 #define MAX_MOCK_DATA_SIZE 1024 * 1024
@@ -3201,6 +3202,250 @@ VOID TEST(KernelLBRRTest, CoverAll)
     }
 }
 
+VOID TEST(KernelLBTest, HealthBackoff)
+{
+    SrsLbHealth health;
+    EXPECT_TRUE(health.available("s0", 0));
+
+    // Skip for fails*5s, at most 30s.
+    health.on_failed("s0", 10 * SRS_UTIME_SECONDS);
+    EXPECT_FALSE(health.available("s0", 14 * SRS_UTIME_SECONDS));
+    EXPECT_TRUE(health.available("s0", 15 * SRS_UTIME_SECONDS));
+
+    for (int i = 0; i < 10; i++) {
+        health.on_failed("s0", 10 * SRS_UTIME_SECONDS);
+    }
+    EXPECT_FALSE(health.available("s0", 39 * SRS_UTIME_SECONDS));
+    EXPECT_TRUE(health.available("s0", 40 * SRS_UTIME_SECONDS));
+
+    // Recover when connected.
+    health.on_connected("s0", 10 * SRS_UTIME_MILLISECONDS, 20, 11 * SRS_UTIME_SECONDS);
+    EXPECT_TRUE(health.available("s0", 11 * SRS_UTIME_SECONDS));
+    EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, health.fetch("s0")->rtt);
+    EXPECT_EQ(20, health.fetch("s0")->load);
+
+    // EWMA of connect time.
+    health.on_connected("s0", 20 * SRS_UTIME_MILLISECONDS, 20, 12 * SRS_UTIME_SECONDS);
+    EXPECT_EQ(13 * SRS_UTIME_MILLISECONDS, health.fetch("s0")->rtt);
+
+    // Filter all servers if none is available.
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    health.on_failed("s1", 12 * SRS_UTIME_SECONDS);
+    EXPECT_EQ(1, (int)health.filter(servers, 12 * SRS_UTIME_SECONDS).size());
+    health.on_failed("s0", 12 * SRS_UTIME_SECONDS);
+    EXPECT_EQ(2, (int)health.filter(servers, 12 * SRS_UTIME_SECONDS).size());
+}
+
+VOID TEST(KernelLBTest, SelectByStrategy)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    servers.push_back("s2");
+
+    // Round-robin skips the failed server.
+    if (true) {
+        SrsLbHealth health; SrsLbRoundRobin lb(&health);
+        health.on_failed("s0", srs_get_system_time());
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        EXPECT_EQ(1, (int)lb.current());
+        EXPECT_STREQ("s2", lb.select(servers).c_str());
+        EXPECT_EQ(2, (int)lb.current());
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        EXPECT_EQ(1, (int)lb.current());
+
+        // The index is in the configured servers, so the rotation goes on when recovered.
+        health.on_connected("s0", 10 * SRS_UTIME_MILLISECONDS, -1, srs_get_system_time());
+        EXPECT_STREQ("s2", lb.select(servers).c_str());
+        EXPECT_STREQ("s0", lb.select(servers).c_str());
+        EXPECT_EQ(0, (int)lb.current());
+    }
+
+    // Round-robin rotates all servers if all failed.
+    if (true) {
+        SrsLbHealth health; SrsLbRoundRobin lb(&health);
+        health.on_failed("s0", srs_get_system_time());
+        health.on_failed("s1", srs_get_system_time());
+        health.on_failed("s2", srs_get_system_time());
+        EXPECT_STREQ("s0", lb.select(servers).c_str());
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+    }
+
+    // Least connections.
+    if (true) {
+        SrsLbHealth health; SrsLbLeastConn lb(&health);
+        health.acquire("s0"); health.acquire("s0"); health.acquire("s1");
+        EXPECT_STREQ("s2", lb.select(servers).c_str());
+        EXPECT_EQ(2, (int)lb.current());
+        health.acquire("s2"); health.acquire("s2");
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        EXPECT_STREQ("s1", lb.selected().c_str());
+        EXPECT_EQ(1, (int)lb.current());
+        health.release("s0"); health.release("s0");
+        EXPECT_STREQ("s0", lb.select(servers).c_str());
+    }
+
+    // EWMA measures the unknown servers first, then select the least cost.
+    if (true) {
+        SrsLbHealth health; SrsLbEwma lb(&health);
+        srs_utime_t now = srs_get_system_time();
+        EXPECT_STREQ("s0", lb.select(servers).c_str());
+        health.on_connected("s0", 10 * SRS_UTIME_MILLISECONDS, 90, now);
+        EXPECT_STREQ("s2", lb.select(servers).c_str());
+        health.on_connected("s2", 30 * SRS_UTIME_MILLISECONDS, 0, now);
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        health.on_connected("s1", 15 * SRS_UTIME_MILLISECONDS, 10, now);
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        EXPECT_STREQ("s1", lb.selected().c_str());
+        EXPECT_EQ(1, (int)lb.current());
+
+        health.on_failed("s1", now);
+        EXPECT_STREQ("s0", lb.select(servers).c_str());
+        EXPECT_EQ(0, (int)lb.current());
+    }
+
+    // Consistent hash always selects the same server, and fails over to another.
+    if (true) {
+        SrsLbHealth health;
+        SrsLbConsistentHash lb("/live/livestream", &health);
+        string server = lb.select(servers);
+        EXPECT_STREQ(server.c_str(), lb.select(servers).c_str());
+
+        health.on_failed(server, srs_get_system_time());
+        string other = lb.select(servers);
+        EXPECT_STRNE(server.c_str(), other.c_str());
+
+        health.on_connected(server, 10 * SRS_UTIME_MILLISECONDS, -1, srs_get_system_time());
+        EXPECT_STREQ(server.c_str(), lb.select(servers).c_str());
+    }
+
+    // Create by strategy.
+    if (true) {
+        SrsLbHealth health;
+        ISrsLoadBalancer* lb = srs_lb_create("least_conn", "", &health);
+        EXPECT_TRUE(dynamic_cast<SrsLbLeastConn*>(lb) != NULL);
+        srs_freep(lb);
+
+        lb = srs_lb_create("ewma", "", &health);
+        EXPECT_TRUE(dynamic_cast<SrsLbEwma*>(lb) != NULL);
+        srs_freep(lb);
+
+        lb = srs_lb_create("hash", "", &health);
+        EXPECT_TRUE(dynamic_cast<SrsLbConsistentHash*>(lb) != NULL);
+        srs_freep(lb);
+
+        lb = srs_lb_create("round_robin", "", &health);
+        EXPECT_TRUE(dynamic_cast<SrsLbRoundRobin*>(lb) != NULL);
+        srs_freep(lb);
+    }
+
+    // The unknown strategy is rejected by config.
+    if (true) {
+        EXPECT_TRUE(srs_lb_is_valid("round_robin"));
+        EXPECT_TRUE(srs_lb_is_valid("hash"));
+        EXPECT_FALSE(srs_lb_is_valid("xxx"));
+        EXPECT_FALSE(srs_lb_is_valid(""));
+    }
+}
+
+VOID TEST(KernelLBTest, SelectByRttLoad)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    servers.push_back("s2");
+
+    // The rtt_load is the ewma, the least RTT weighted by load.
+    if (true) {
+        SrsLbHealth health;
+        ISrsLoadBalancer* lb = srs_lb_create("rtt_load", "", &health);
+        SrsAutoFree(ISrsLoadBalancer, lb);
+        EXPECT_TRUE(dynamic_cast<SrsLbEwma*>(lb) != NULL);
+        EXPECT_TRUE(srs_lb_is_valid("rtt_load"));
+
+        srs_utime_t now = srs_get_system_time();
+        health.on_connected("s0", 10 * SRS_UTIME_MILLISECONDS, 90, now);
+        health.on_connected("s1", 15 * SRS_UTIME_MILLISECONDS, 10, now);
+        health.on_connected("s2", 30 * SRS_UTIME_MILLISECONDS, 0, now);
+        EXPECT_STREQ("s1", lb->select(servers).c_str());
+    }
+
+    // The stale servers are measured once, then selected by the last cost, not round-robin.
+    if (true) {
+        SrsLbHealth health; SrsLbEwma lb(&health);
+        srs_utime_t stale = srs_get_system_time() - 61 * SRS_UTIME_SECONDS;
+        health.on_connected("s0", 10 * SRS_UTIME_MILLISECONDS, 90, stale);
+        health.on_connected("s1", 15 * SRS_UTIME_MILLISECONDS, 10, stale);
+        health.on_connected("s2", 30 * SRS_UTIME_MILLISECONDS, 0, stale);
+
+        EXPECT_STREQ("s0", lb.select(servers).c_str());
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        EXPECT_STREQ("s2", lb.select(servers).c_str());
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+        EXPECT_STREQ("s1", lb.select(servers).c_str());
+
+        // The measured server uses the new cost.
+        health.on_connected("s2", 5 * SRS_UTIME_MILLISECONDS, 0, srs_get_system_time());
+        EXPECT_STREQ("s2", lb.select(servers).c_str());
+    }
+}
+
+VOID TEST(KernelHistogramTest, Buckets)
+{
+    SrsHistogram h("test");
+    EXPECT_TRUE(srs_histogram_registry().back() == &h);
+
+    h.update(1);
+    h.update(3);
+    h.update(4);
+    h.update(1 * SRS_UTIME_MILLISECONDS);
+    h.update(20 * SRS_UTIME_SECONDS);
+
+    EXPECT_EQ(5, h.count());
+    EXPECT_EQ(1, h.bucket(0));
+    EXPECT_EQ(0, h.bucket(1));
+    EXPECT_EQ(2, h.bucket(2));
+    EXPECT_EQ(1, h.bucket(10));
+    EXPECT_EQ(1, h.bucket(SRS_HISTOGRAM_BUCKETS));
+    EXPECT_EQ(8 + 1 * SRS_UTIME_MILLISECONDS + 20 * SRS_UTIME_SECONDS, h.sum());
+    EXPECT_EQ(20 * SRS_UTIME_SECONDS, h.max());
+    EXPECT_EQ(1, SrsHistogram::bound(0));
+    EXPECT_EQ(16777216, SrsHistogram::bound(SRS_HISTOGRAM_BUCKETS - 1));
+
+    // The percentile is the upper bound of bucket, or the max for +Inf.
+    EXPECT_EQ(1, h.percentile(0.2));
+    EXPECT_EQ(4, h.percentile(0.5));
+    EXPECT_EQ(1024, h.percentile(0.8));
+    EXPECT_EQ(20 * SRS_UTIME_SECONDS, h.percentile(0.99));
+
+    h.reset();
+    EXPECT_EQ(0, h.count());
+    EXPECT_EQ(0, h.bucket(2));
+    EXPECT_EQ(0, h.percentile(0.5));
+}
+
+VOID TEST(KernelHistogramTest, Tick)
+{
+    srs_utime_t t0 = srs_get_tick();
+    usleep(10 * 1000);
+    srs_utime_t t1 = srs_get_tick();
+    EXPECT_GT(t0, 0);
+    EXPECT_GE(t1 - t0, 10 * SRS_UTIME_MILLISECONDS);
+
+    // The tick is carried by the copies of message.
+    SrsSharedPtrMessage msg;
+    msg.wrap(new char[1], 1);
+    msg.recv_tick = t0;
+    msg.queue_tick = t1;
+
+    SrsSharedPtrMessage* copy = msg.copy();
+    EXPECT_EQ(t0, copy->recv_tick);
+    EXPECT_EQ(t1, copy->queue_tick);
+    srs_freep(copy);
+}
+
 VOID TEST(KernelCodecTest, CoverAll)
 {
     if (true) {
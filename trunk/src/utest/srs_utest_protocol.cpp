@@ -492,6 +492,119 @@ VOID TEST(ProtocolHandshakeTest, ComplexHandshake)
     }
 }
 
+VOID TEST(ProtocolHandshakeTest, DHPool)
+{
+    srs_error_t err;
+
+    srs_internal::SrsDHPool pool(3);
+    EXPECT_EQ(0, pool.size());
+    EXPECT_TRUE(pool.fetch() == NULL);
+
+    pool.refill();
+    EXPECT_EQ(3, pool.size());
+
+    srs_internal::SrsDH* dh = pool.fetch();
+    ASSERT_TRUE(dh != NULL);
+    SrsAutoFree(srs_internal::SrsDH, dh);
+    EXPECT_EQ(2, pool.size());
+
+    char pkey[128];
+    int32_t pkey_size = 128;
+    HELPER_EXPECT_SUCCESS(dh->copy_public_key(pkey, pkey_size));
+    EXPECT_EQ(128, pkey_size);
+}
+
+// The server side of complex handshake uses the DH keys in pool, and generates one if drained.
+VOID TEST(ProtocolHandshakeTest, ComplexHandshakeWithDHPool)
+{
+    srs_error_t err;
+
+    // The c0c1 signed by client, and the c2 is never verified.
+    uint8_t c0c1[1537];
+    uint8_t c2[1536];
+    if (true) {
+        c1s1 c1;
+        HELPER_ASSERT_SUCCESS(c1.c1_create(srs_schema1));
+        HELPER_ASSERT_SUCCESS(c1.dump((char*)c0c1 + 1, 1536));
+        c0c1[0] = 0x03;
+        memset(c2, 0, sizeof(c2));
+    }
+
+    srs_internal::SrsDHPool pool(2);
+    pool.refill();
+    EXPECT_EQ(2, pool.size());
+    srs_internal::_srs_dh_pool = &pool;
+
+    // Take the keys from pool, then generate one when drained.
+    for (int i = 0; i < 3; i++) {
+        MockBufferIO io;
+        io.append(c0c1, sizeof(c0c1));
+        io.append(c2, sizeof(c2));
+
+        SrsHandshakeBytes bytes;
+        SrsComplexHandshake hs;
+        HELPER_ASSERT_SUCCESS(hs.handshake_with_client(&bytes, &io));
+        EXPECT_EQ(srs_max(0, 1 - i), pool.size());
+
+        // The s1 signed by the key is valid for client.
+        c1s1 s1;
+        HELPER_EXPECT_SUCCESS(s1.parse(bytes.s0s1s2 + 1, 1536, srs_schema1));
+
+        bool is_valid = false;
+        HELPER_EXPECT_SUCCESS(s1.s1_validate_digest(is_valid));
+        EXPECT_TRUE(is_valid);
+    }
+
+    // Refill the drained pool.
+    pool.refill();
+    EXPECT_EQ(2, pool.size());
+
+    srs_internal::_srs_dh_pool = NULL;
+}
+
+// Benchmark the server side of complex handshake, to show the handshakes per second. It's disabled
+// by default, run it by --gtest_also_run_disabled_tests --gtest_filter=*ComplexHandshakeBenchmark.
+VOID TEST(ProtocolHandshakeTest, DISABLED_ComplexHandshakeBenchmark)
+{
+    srs_error_t err;
+
+    // The c0c1 signed by client, and the c2 is never verified.
+    uint8_t c0c1[1537];
+    uint8_t c2[1536];
+    if (true) {
+        c1s1 c1;
+        HELPER_ASSERT_SUCCESS(c1.c1_create(srs_schema1));
+        HELPER_ASSERT_SUCCESS(c1.dump((char*)c0c1 + 1, 1536));
+        c0c1[0] = 0x03;
+        memset(c2, 0, sizeof(c2));
+    }
+
+    const int nn = 50;
+    for (int i = 0; i < 2; i++) {
+        // The second round use the DH keys generated in advance.
+        srs_internal::SrsDHPool pool(nn);
+        if (i == 1) {
+            pool.refill();
+            srs_internal::_srs_dh_pool = &pool;
+        }
+
+        srs_utime_t starttime = srs_update_system_time();
+        for (int j = 0; j < nn; j++) {
+            MockBufferIO io;
+            io.append(c0c1, sizeof(c0c1));
+            io.append(c2, sizeof(c2));
+
+            SrsHandshakeBytes bytes;
+            SrsComplexHandshake hs;
+            HELPER_EXPECT_SUCCESS(hs.handshake_with_client(&bytes, &io));
+        }
+        srs_utime_t duration = srs_max(1, srs_update_system_time() - starttime);
+
+        srs_internal::_srs_dh_pool = NULL;
+        printf("complex handshake, pool=%d, %d handshakes/s\n", i, (int)(nn * SRS_UTIME_SECONDS / duration));
+    }
+}
+
 VOID TEST(ProtocolHandshakeTest, SimpleHandshake)
 {
     srs_error_t err;
@@ -14,12 +14,21 @@
 #include <srs_app_rtc_conn.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_rtc_bwe.hpp>
+#include <srs_app_rtc_fec.hpp>
+#include <srs_kernel_rtc_rtcp.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_rtc_stun_stack.hpp>
 
 #include <srs_utest_service.hpp>
 
 #include <vector>
 using namespace std;
 
+extern SrsPps* _srs_pps_objs_rtps;
+extern SrsPps* _srs_pps_objs_rfua;
+extern SrsPps* _srs_pps_objs_rbuf;
+
 VOID TEST(KernelRTCTest, RtpSTAPPayloadException)
 {
     srs_error_t err = srs_success;
@@ -897,3 +906,893 @@ VOID TEST(KernelRTCTest, DefaultTrackStatus)
     }
 }
 
+
+VOID TEST(KernelRTCTest, GopCacheDump)
+{
+    srs_error_t err;
+
+    // Disabled by default.
+    if (true) {
+        SrsRtcGopCache gop;
+        EXPECT_FALSE(gop.enabled());
+
+        SrsRtpPacket pkt; pkt.frame_type = SrsFrameTypeVideo; pkt.nalu_type = SrsAvcNaluTypeIDR;
+        HELPER_EXPECT_SUCCESS(gop.cache(&pkt));
+        EXPECT_EQ(0, gop.size());
+    }
+
+    // Only cache packets after keyframe, and clear when got a new keyframe.
+    if (true) {
+        SrsRtcGopCache gop;
+        gop.set(true);
+
+        SrsRtpPacket audio; audio.frame_type = SrsFrameTypeAudio;
+        HELPER_EXPECT_SUCCESS(gop.cache(&audio));
+        EXPECT_EQ(0, gop.size());
+
+        // The SPS/PPS and IDR of keyframe, with the same timestamp.
+        SrsRtpPacket sps; sps.frame_type = SrsFrameTypeVideo; sps.nalu_type = SrsAvcNaluTypeSPS; sps.header.set_timestamp(90);
+        SrsRtpPacket idr; idr.frame_type = SrsFrameTypeVideo; idr.nalu_type = SrsAvcNaluTypeIDR; idr.header.set_timestamp(90);
+        SrsRtpPacket p; p.frame_type = SrsFrameTypeVideo; p.nalu_type = SrsAvcNaluTypeNonIDR; p.header.set_timestamp(180);
+        HELPER_EXPECT_SUCCESS(gop.cache(&sps));
+        HELPER_EXPECT_SUCCESS(gop.cache(&idr));
+        HELPER_EXPECT_SUCCESS(gop.cache(&audio));
+        HELPER_EXPECT_SUCCESS(gop.cache(&p));
+        EXPECT_EQ(4, gop.size());
+
+        // Ignore the late packet of old keyframe.
+        SrsRtpPacket old; old.frame_type = SrsFrameTypeVideo; old.nalu_type = SrsAvcNaluTypeIDR; old.header.set_timestamp(0);
+        HELPER_EXPECT_SUCCESS(gop.cache(&old));
+        EXPECT_EQ(5, gop.size());
+
+        // Dump to consumer.
+        SrsRtcSource source;
+        SrsRtcConsumer consumer(&source);
+        HELPER_EXPECT_SUCCESS(gop.dump(&consumer));
+
+        SrsRtpPacket* pkt = NULL;
+        HELPER_EXPECT_SUCCESS(consumer.dump_packet(&pkt));
+        ASSERT_TRUE(pkt != NULL);
+        EXPECT_EQ(SrsAvcNaluTypeSPS, pkt->nalu_type);
+        srs_freep(pkt);
+
+        // A new keyframe.
+        SrsRtpPacket idr2; idr2.frame_type = SrsFrameTypeVideo; idr2.nalu_type = SrsAvcNaluTypeIDR; idr2.header.set_timestamp(270);
+        HELPER_EXPECT_SUCCESS(gop.cache(&idr2));
+        EXPECT_EQ(1, gop.size());
+
+        gop.set(false);
+        EXPECT_EQ(0, gop.size());
+    }
+}
+
+VOID TEST(KernelRTCTest, TWCCFeedbackDecode)
+{
+    srs_error_t err;
+
+    // The base sn is 100, 10 packets and the 3th is lost, reference time is 64ms.
+    uint8_t data[] = {
+        0x8f, 0xcd, 0x00, 0x08, 0x00, 0x00, 0x00, 0x01, // Header, length=8 words, sender SSRC.
+        0x00, 0x00, 0x00, 0x02, 0x00, 0x64, 0x00, 0x0a, // Media SSRC, base sn=100, status count=10.
+        0x00, 0x00, 0x01, 0x00, // Reference time=1, fb pkt count=0.
+        0xd4, 0x95, // Status vector chunk with two bits symbols, [1,1,0,2,1,1,1]
+        0x20, 0x03, // Run length chunk, 3 packets with small delta.
+        0x04, 0x04, 0xff, 0xf8, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, // Recv deltas, the 4th is -2ms.
+        0x00, 0x00 // Padding.
+    };
+
+    SrsRtcpTWCC twcc;
+    SrsBuffer b((char*)data, sizeof(data));
+    HELPER_EXPECT_SUCCESS(twcc.decode(&b));
+
+    EXPECT_EQ(2, (int)twcc.get_media_ssrc());
+    EXPECT_EQ(100, twcc.get_base_sn());
+    EXPECT_EQ(10, twcc.get_packet_status_count());
+    EXPECT_EQ(2, (int)twcc.get_packet_chucks().size());
+    EXPECT_EQ(9, (int)twcc.get_recv_deltas().size());
+
+    const map<uint16_t, srs_utime_t>& packets = twcc.get_recv_packets();
+    EXPECT_EQ(9, (int)packets.size());
+    EXPECT_TRUE(packets.find(102) == packets.end());
+    EXPECT_EQ(65 * SRS_UTIME_MILLISECONDS, packets.find(100)->second);
+    EXPECT_EQ(66 * SRS_UTIME_MILLISECONDS, packets.find(101)->second);
+    EXPECT_EQ(64 * SRS_UTIME_MILLISECONDS, packets.find(103)->second);
+    EXPECT_EQ(70 * SRS_UTIME_MILLISECONDS, packets.find(109)->second);
+
+    // Truncated recv deltas, ignored without any packet.
+    if (true) {
+        data[3] = 0x06; // Length=6 words.
+        SrsRtcpTWCC twcc;
+        SrsBuffer b((char*)data, 28);
+        HELPER_EXPECT_SUCCESS(twcc.decode(&b));
+        EXPECT_TRUE(b.empty());
+        EXPECT_EQ(0, twcc.get_packet_status_count());
+        EXPECT_EQ(0, (int)twcc.get_recv_packets().size());
+    }
+
+    // The NACK after the truncated feedback in the same compound is still decoded.
+    if (true) {
+        uint8_t compound[28 + 16];
+        memcpy(compound, data, 28);
+
+        uint8_t nack[] = {
+            0x81, 0xcd, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, // Header, length=3 words, sender SSRC.
+            0x00, 0x00, 0x00, 0x02, 0x00, 0x64, 0x00, 0x01, // Media SSRC, PID=100, BLP=0x0001.
+        };
+        memcpy(compound + 28, nack, sizeof(nack));
+
+        SrsRtcpCompound rtcps;
+        SrsBuffer b((char*)compound, sizeof(compound));
+        HELPER_ASSERT_SUCCESS(rtcps.decode(&b));
+
+        SrsRtcpCommon* rtcp = rtcps.get_next_rtcp();
+        SrsAutoFree(SrsRtcpCommon, rtcp);
+        SrsRtcpNack* pnack = dynamic_cast<SrsRtcpNack*>(rtcp);
+        ASSERT_TRUE(pnack != NULL);
+        EXPECT_EQ(2, (int)pnack->get_media_ssrc());
+
+        vector<uint16_t> sns = pnack->get_lost_sns();
+        ASSERT_EQ(2, (int)sns.size());
+        EXPECT_EQ(100, sns.at(0));
+        EXPECT_EQ(101, sns.at(1));
+
+        SrsRtcpCommon* rtcp2 = rtcps.get_next_rtcp();
+        SrsAutoFree(SrsRtcpCommon, rtcp2);
+        SrsRtcpTWCC* ptwcc = dynamic_cast<SrsRtcpTWCC*>(rtcp2);
+        ASSERT_TRUE(ptwcc != NULL);
+        EXPECT_EQ(0, ptwcc->get_packet_status_count());
+    }
+}
+
+// Mock the TWCC feedback of player, by the encoder of TWCC.
+srs_error_t mock_twcc_feedback(SrsRtcpTWCC* feedback, uint16_t base_sn, int nn, int lost_every, srs_utime_t arrival, srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    SrsRtcpTWCC twcc;
+    for (int i = 0; i < nn; i++) {
+        if (lost_every && i % lost_every == lost_every - 1) {
+            continue;
+        }
+        if ((err = twcc.recv_packet(base_sn + i, arrival + i * interval)) != srs_success) {
+            return srs_error_wrap(err, "recv packet");
+        }
+    }
+
+    char buf[kRtcpPacketSize];
+    SrsBuffer b(buf, sizeof(buf));
+    if ((err = twcc.encode(&b)) != srs_success) {
+        return srs_error_wrap(err, "encode");
+    }
+
+    SrsBuffer d(buf, b.pos());
+    if ((err = feedback->decode(&d)) != srs_success) {
+        return srs_error_wrap(err, "decode");
+    }
+
+    return err;
+}
+
+VOID TEST(KernelRTCTest, BandwidthEstimator)
+{
+    srs_error_t err;
+
+    // The estimate follows the acked bitrate, about 9.6Mbps, then decrease for loss.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        EXPECT_EQ(300 * 1000, bwe.estimate());
+
+        uint16_t sn = 0;
+        srs_utime_t now = 10 * SRS_UTIME_SECONDS;
+        for (int i = 0; i < 30; i++, now += 100 * SRS_UTIME_MILLISECONDS) {
+            uint16_t base_sn = sn + 1;
+            for (int j = 0; j < 100; j++) {
+                bwe.on_sent(++sn, 1200, now + j * SRS_UTIME_MILLISECONDS);
+            }
+
+            SrsRtcpTWCC feedback;
+            HELPER_ASSERT_SUCCESS(mock_twcc_feedback(&feedback, base_sn, 100, 0, now, SRS_UTIME_MILLISECONDS));
+            bwe.on_feedback(&feedback, now + 100 * SRS_UTIME_MILLISECONDS);
+        }
+        int64_t estimate = bwe.estimate();
+        EXPECT_GT(estimate, 9000 * 1000);
+
+        // Lost 25% packets.
+        for (int i = 0; i < 30; i++, now += 100 * SRS_UTIME_MILLISECONDS) {
+            uint16_t base_sn = sn + 1;
+            for (int j = 0; j < 100; j++) {
+                bwe.on_sent(++sn, 1200, now + j * SRS_UTIME_MILLISECONDS);
+            }
+
+            SrsRtcpTWCC feedback;
+            HELPER_ASSERT_SUCCESS(mock_twcc_feedback(&feedback, base_sn, 100, 4, now, SRS_UTIME_MILLISECONDS));
+            bwe.on_feedback(&feedback, now + 100 * SRS_UTIME_MILLISECONDS);
+        }
+        EXPECT_LT(bwe.estimate(), estimate * 0.85);
+    }
+
+    // The estimate decreases for the delay increasing, the queue of bottleneck is building up.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+
+        uint16_t sn = 0;
+        srs_utime_t now = 10 * SRS_UTIME_SECONDS, arrival = now;
+        for (int i = 0; i < 30; i++, now += 100 * SRS_UTIME_MILLISECONDS, arrival += 100 * SRS_UTIME_MILLISECONDS) {
+            uint16_t base_sn = sn + 1;
+            for (int j = 0; j < 100; j++) {
+                bwe.on_sent(++sn, 1200, now + j * SRS_UTIME_MILLISECONDS);
+            }
+
+            SrsRtcpTWCC feedback;
+            HELPER_ASSERT_SUCCESS(mock_twcc_feedback(&feedback, base_sn, 100, 0, arrival, SRS_UTIME_MILLISECONDS));
+            bwe.on_feedback(&feedback, now + 100 * SRS_UTIME_MILLISECONDS);
+        }
+        int64_t estimate = bwe.estimate();
+
+        // The packets arrive at 2ms interval, while sent at 1ms.
+        for (int i = 0; i < 10; i++, now += 100 * SRS_UTIME_MILLISECONDS, arrival += 200 * SRS_UTIME_MILLISECONDS) {
+            uint16_t base_sn = sn + 1;
+            for (int j = 0; j < 100; j++) {
+                bwe.on_sent(++sn, 1200, now + j * SRS_UTIME_MILLISECONDS);
+            }
+
+            SrsRtcpTWCC feedback;
+            HELPER_ASSERT_SUCCESS(mock_twcc_feedback(&feedback, base_sn, 100, 0, arrival, 2 * SRS_UTIME_MILLISECONDS));
+            bwe.on_feedback(&feedback, now + 100 * SRS_UTIME_MILLISECONDS);
+        }
+        EXPECT_LT(bwe.estimate(), estimate * 0.85);
+    }
+}
+
+VOID TEST(KernelRTCTest, PacerBudget)
+{
+    SrsRtcPacer pacer;
+    srs_utime_t now = 10 * SRS_UTIME_SECONDS;
+
+    // Never pace before we know the rate of media.
+    EXPECT_EQ(0, pacer.delay(now));
+    EXPECT_EQ(0, pacer.pacing_bps());
+
+    // Send about 1Mbps for 500ms, the pacing rate is 2.5x of it.
+    for (int i = 0; i <= 500; i++) {
+        pacer.on_sent(125, now + i * SRS_UTIME_MILLISECONDS);
+    }
+    now += 500 * SRS_UTIME_MILLISECONDS;
+    EXPECT_NEAR(2500, pacer.pacing_bps() / 1000, 10);
+    EXPECT_EQ(0, pacer.delay(now));
+
+    // The burst of keyframe should be paced, about 50000*8/2.5Mbps=160ms.
+    pacer.on_sent(50000, now);
+    srs_utime_t delay = pacer.delay(now);
+    EXPECT_NEAR(160, srsu2msi(delay), 5);
+    EXPECT_EQ(0, pacer.delay(now + delay));
+
+    // Use the estimated bandwidth if larger than the rate of media.
+    pacer.set_estimate(4 * 1000 * 1000);
+    EXPECT_EQ(10 * 1000 * 1000, pacer.pacing_bps());
+}
+
+VOID TEST(KernelRTCTest, SimulcastSdpRid)
+{
+    srs_error_t err;
+
+    SrsMediaDesc media("video");
+    HELPER_EXPECT_SUCCESS(media.parse_line("a=rid:h send"));
+    HELPER_EXPECT_SUCCESS(media.parse_line("a=rid:l send"));
+    HELPER_EXPECT_SUCCESS(media.parse_line("a=rid:m send"));
+    HELPER_EXPECT_SUCCESS(media.parse_line("a=simulcast:send l;~m;h,x"));
+    HELPER_EXPECT_FAILED(media.parse_line("a=rid:x play"));
+
+    // The layers are in the order of simulcast, and only the first alternative.
+    ASSERT_EQ(3, (int)media.rids_.size());
+    EXPECT_STREQ("l", media.rids_.at(0).c_str());
+    EXPECT_STREQ("m", media.rids_.at(1).c_str());
+    EXPECT_STREQ("h", media.rids_.at(2).c_str());
+    EXPECT_STREQ("send", media.simulcast_.c_str());
+
+    std::ostringstream os;
+    HELPER_EXPECT_SUCCESS(media.encode(os));
+    EXPECT_TRUE(os.str().find("a=rid:m send") != string::npos);
+    EXPECT_TRUE(os.str().find("a=simulcast:send l;m;h") != string::npos);
+}
+
+VOID TEST(KernelRTCTest, RidFastParse)
+{
+    srs_error_t err;
+
+    // The RTP header with extension of id=3 mid "0", id=10 rid "hi", and a padding.
+    uint8_t data[] = {
+        0x90, 0x60, 0x00, 0x01, 0x00, 0x00, 0x00, 0x5a, 0x00, 0x00, 0x01, 0x2c,
+        0xbe, 0xde, 0x00, 0x02, 0x30, '0', 0xa1, 'h', 'i', 0x00, 0x00, 0x00,
+    };
+
+    string rid;
+    HELPER_EXPECT_SUCCESS(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 10, rid));
+    EXPECT_STREQ("hi", rid.c_str());
+
+    HELPER_EXPECT_SUCCESS(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 3, rid));
+    EXPECT_STREQ("0", rid.c_str());
+
+    HELPER_EXPECT_FAILED(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 11, rid));
+    HELPER_EXPECT_FAILED(srs_rtp_fast_parse_rid((char*)data, 20, 10, rid));
+
+    // No extension.
+    data[0] = 0x80;
+    HELPER_EXPECT_FAILED(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 10, rid));
+}
+
+// Feed the layers of 150kbps, 500kbps and 1.5Mbps, for about 1s.
+static void mock_simulcast_layers(SrsRtcLayerSelector* selector, srs_utime_t& now)
+{
+    for (int i = 0; i < 10; i++, now += 100 * SRS_UTIME_MILLISECONDS) {
+        selector->on_packet("0", 1875, now);
+        selector->on_packet("1", 6250, now);
+        selector->on_packet("2", 18750, now);
+    }
+}
+
+VOID TEST(KernelRTCTest, SimulcastLayerSelector)
+{
+    // Any layer before the bitrate is known, or the best layer without estimate.
+    if (true) {
+        SrsRtcLayerSelector selector;
+        srs_utime_t now = 100 * SRS_UTIME_SECONDS;
+        EXPECT_STREQ("", selector.update(0, now).c_str());
+
+        mock_simulcast_layers(&selector, now);
+        selector.on_packet("0", 0, now);
+        EXPECT_STREQ("2", selector.update(0, now).c_str());
+
+        // Specified by API.
+        selector.set_manual("0");
+        EXPECT_STREQ("0", selector.update(0, now).c_str());
+    }
+
+    // The best layer for estimate, down when overuse, and probe up.
+    if (true) {
+        SrsRtcLayerSelector selector;
+        srs_utime_t now = 100 * SRS_UTIME_SECONDS;
+        mock_simulcast_layers(&selector, now);
+        selector.on_packet("0", 0, now);
+
+        EXPECT_STREQ("1", selector.update(700 * 1000, now).c_str());
+        selector.on_switched("1");
+
+        // Keep the layer in interval.
+        EXPECT_STREQ("1", selector.update(100 * 1000, now + 100 * SRS_UTIME_MILLISECONDS).c_str());
+
+        now += 1 * SRS_UTIME_SECONDS;
+        EXPECT_STREQ("0", selector.update(300 * 1000, now).c_str());
+        selector.on_switched("0");
+
+        // Never probe before the interval.
+        now += 1 * SRS_UTIME_SECONDS;
+        EXPECT_STREQ("0", selector.update(200 * 1000, now).c_str());
+
+        now += 5 * SRS_UTIME_SECONDS;
+        EXPECT_STREQ("1", selector.update(200 * 1000, now).c_str());
+    }
+}
+
+VOID TEST(KernelRTCTest, SimulcastLayerSwitch)
+{
+    SrsRtcConnection s(NULL, SrsContextId());
+
+    SrsRtcTrackDescription ds;
+    ds.rid_ = "0";
+    SrsRtcVideoSendTrack track(&s, &ds);
+    track.add_layer(200, "0");
+    track.add_layer(300, "1");
+    EXPECT_TRUE(track.is_simulcast());
+    EXPECT_EQ(0, (int)track.get_layer_ssrc());
+
+    uint32_t keyframe_ssrc = 0;
+
+    // Unknown layer.
+    SrsRtpPacket p0; p0.frame_type = SrsFrameTypeVideo; p0.nalu_type = SrsAvcNaluTypeIDR; p0.header.set_ssrc(100);
+    EXPECT_FALSE(track.on_layer_rtp(&p0, 0, &keyframe_ssrc));
+
+    // Start from any layer at keyframe.
+    SrsRtpPacket p1; p1.frame_type = SrsFrameTypeVideo; p1.nalu_type = SrsAvcNaluTypeIDR; p1.header.set_ssrc(300);
+    p1.header.set_sequence(1000); p1.header.set_timestamp(9000);
+    EXPECT_TRUE(track.on_layer_rtp(&p1, 0, &keyframe_ssrc));
+    EXPECT_EQ(300, (int)track.get_layer_ssrc());
+    EXPECT_EQ(1000, p1.header.get_sequence());
+
+    // Drop other layers.
+    SrsRtpPacket p2; p2.frame_type = SrsFrameTypeVideo; p2.nalu_type = SrsAvcNaluTypeNonIDR; p2.header.set_ssrc(200);
+    EXPECT_FALSE(track.on_layer_rtp(&p2, 0, &keyframe_ssrc));
+    EXPECT_EQ(0, (int)keyframe_ssrc);
+
+    // Request keyframe of the target layer.
+    track.set_layer("0");
+    EXPECT_FALSE(track.on_layer_rtp(&p2, 0, &keyframe_ssrc));
+    EXPECT_EQ(200, (int)keyframe_ssrc);
+
+    // Switch at keyframe, continue the sequence and timestamp.
+    SrsRtpPacket p3; p3.frame_type = SrsFrameTypeVideo; p3.nalu_type = SrsAvcNaluTypeIDR; p3.header.set_ssrc(200);
+    p3.header.set_sequence(50); p3.header.set_timestamp(100);
+    EXPECT_TRUE(track.on_layer_rtp(&p3, 0, &keyframe_ssrc));
+    EXPECT_EQ(200, (int)track.get_layer_ssrc());
+    EXPECT_EQ(1001, p3.header.get_sequence());
+    EXPECT_GT(p3.header.get_timestamp(), (uint32_t)9000);
+
+    SrsRtpPacket p4; p4.frame_type = SrsFrameTypeVideo; p4.nalu_type = SrsAvcNaluTypeNonIDR; p4.header.set_ssrc(200);
+    p4.header.set_sequence(51); p4.header.set_timestamp(100);
+    EXPECT_TRUE(track.on_layer_rtp(&p4, 0, &keyframe_ssrc));
+    EXPECT_EQ(1002, p4.header.get_sequence());
+    EXPECT_EQ(p3.header.get_timestamp(), p4.header.get_timestamp());
+}
+
+VOID TEST(KernelRTCTest, RtcpRRLostRate)
+{
+    SrsRtcpRR rr;
+    rr.set_lost_rate(0.25);
+    EXPECT_NEAR(0.25, rr.get_lost_rate(), 0.01);
+}
+
+VOID TEST(KernelRTCTest, FecSeqShifter)
+{
+    SrsRtcSeqShifter shifter;
+    EXPECT_EQ(100, shifter.get(100));
+
+    // Insert 2 packets after 100.
+    shifter.shift(100, 2);
+    EXPECT_EQ(100, shifter.get(100));
+    EXPECT_EQ(103, shifter.get(101));
+
+    // The late packet uses the offset when it should arrive.
+    shifter.shift(110, 1);
+    EXPECT_EQ(99, shifter.get(99));
+    EXPECT_EQ(107, shifter.get(105));
+    EXPECT_EQ(114, shifter.get(111));
+
+    // Remove a packet after 120.
+    shifter.shift(120, -1);
+    EXPECT_EQ(123, shifter.get(120));
+    EXPECT_EQ(123, shifter.get(121));
+
+    // Wrap around.
+    SrsRtcSeqShifter s2;
+    s2.shift(65535, 1);
+    EXPECT_EQ(65535, s2.get(65535));
+    EXPECT_EQ(1, s2.get(0));
+}
+
+// Build a RTP packet with seq and payload of size bytes.
+int mock_fec_media(char* buf, uint16_t seq, bool marker, int size)
+{
+    memset(buf, 0, 12);
+    buf[0] = (char)0x80;
+    buf[1] = (char)((marker ? 0x80 : 0) | 102);
+    buf[2] = (char)(seq >> 8); buf[3] = (char)seq;
+    buf[4] = 0x00; buf[5] = 0x01; buf[6] = 0x02; buf[7] = 0x03;
+    buf[8] = 0x0a; buf[9] = 0x0b; buf[10] = 0x0c; buf[11] = 0x0d;
+    for (int i = 0; i < size; i++) {
+        buf[12 + i] = (char)(seq + i);
+    }
+    return 12 + size;
+}
+
+VOID TEST(KernelRTCTest, FecEncodeDecode)
+{
+    srs_error_t err = srs_success;
+
+    SrsRtcFecEncoder encoder(123, 127);
+    SrsRtcFecDecoder decoder(127);
+
+    // No FEC if no loss.
+    encoder.on_loss(0);
+    EXPECT_EQ(0, encoder.ratio());
+
+    if (true) {
+        char buf[1500]; int nn = mock_fec_media(buf, 100, true, 100);
+        HELPER_EXPECT_SUCCESS(encoder.protect(buf, &nn, sizeof(buf)));
+        EXPECT_EQ(113, nn);
+        EXPECT_EQ(123, buf[1] & 0x7f);
+        EXPECT_EQ(102, buf[12]);
+
+        // Unwrap the RED packet.
+        vector<SrsRtcFecPacket*> recovered;
+        HELPER_EXPECT_SUCCESS(decoder.decode(buf, &nn, recovered));
+        EXPECT_EQ(112, nn);
+        EXPECT_TRUE(recovered.empty());
+
+        char expect[1500]; mock_fec_media(expect, 100, true, 100);
+        EXPECT_EQ(0, memcmp(expect, buf, nn));
+
+        vector<SrsRtpPacket*> fecs;
+        HELPER_EXPECT_SUCCESS(encoder.encode(fecs));
+        EXPECT_TRUE(fecs.empty());
+    }
+
+    // Protect a frame of 3 packets, with 1 FEC packet.
+    encoder.on_loss(0.2);
+    EXPECT_GT(encoder.ratio(), 0);
+
+    char media[3][1500]; int nn_media[3];
+    for (int i = 0; i < 3; i++) {
+        uint16_t seq = encoder.shift(101 + i);
+        EXPECT_EQ(101 + i, seq);
+
+        nn_media[i] = mock_fec_media(media[i], seq, i == 2, 100 + i * 10);
+        HELPER_EXPECT_SUCCESS(encoder.protect(media[i], &nn_media[i], sizeof(media[i])));
+    }
+
+    vector<SrsRtpPacket*> fecs;
+    HELPER_EXPECT_SUCCESS(encoder.encode(fecs));
+    ASSERT_EQ(1, (int)fecs.size());
+    EXPECT_EQ(104, fecs[0]->header.get_sequence());
+    EXPECT_EQ(123, fecs[0]->header.get_payload_type());
+
+    char fec[1500];
+    SrsBuffer b(fec, sizeof(fec));
+    HELPER_EXPECT_SUCCESS(fecs[0]->encode(&b));
+    int nn_fec = b.pos();
+    srs_freep(fecs[0]);
+
+    // The next media packets are shifted.
+    EXPECT_EQ(105, encoder.shift(104));
+
+    // Lost the second packet, recover it by FEC.
+    vector<SrsRtcFecPacket*> recovered;
+    HELPER_EXPECT_SUCCESS(decoder.decode(media[0], &nn_media[0], recovered));
+    HELPER_EXPECT_SUCCESS(decoder.decode(media[2], &nn_media[2], recovered));
+    EXPECT_TRUE(recovered.empty());
+
+    HELPER_EXPECT_SUCCESS(decoder.decode(fec, &nn_fec, recovered));
+    EXPECT_EQ(0, nn_fec);
+    ASSERT_EQ(1, (int)recovered.size());
+    EXPECT_EQ(1, (int)decoder.nn_recovered());
+
+    char expect[1500]; int nn_expect = mock_fec_media(expect, 102, false, 110);
+    EXPECT_EQ(102, recovered[0]->seq_);
+    ASSERT_EQ(nn_expect, recovered[0]->size_);
+    EXPECT_EQ(0, memcmp(expect, recovered[0]->data_, nn_expect));
+    srs_freep(recovered[0]);
+
+    // The FEC packet is removed from sequence space of publisher.
+    EXPECT_EQ(103, decoder.shift(103));
+    EXPECT_EQ(104, decoder.shift(105));
+}
+
+VOID TEST(KernelRTCTest, KeyframeArbiter)
+{
+    SrsRtcKeyframeArbiter arbiter;
+    arbiter.set_window(500 * SRS_UTIME_MILLISECONDS, 1 * SRS_UTIME_SECONDS);
+
+    srs_utime_t now = 10 * SRS_UTIME_SECONDS;
+    vector<uint32_t> ssrcs;
+
+    // The first PLI is sent, and others are coalesced before the keyframe.
+    EXPECT_TRUE(arbiter.on_request(100, now));
+    EXPECT_FALSE(arbiter.on_request(100, now + 10 * SRS_UTIME_MILLISECONDS));
+    EXPECT_FALSE(arbiter.on_request(100, now + 20 * SRS_UTIME_MILLISECONDS));
+
+    // The PLI of other SSRC is not coalesced.
+    EXPECT_TRUE(arbiter.on_request(200, now));
+
+    // Delay the PLI after keyframe, to keep the interval.
+    arbiter.on_keyframe(100, now + 100 * SRS_UTIME_MILLISECONDS);
+    EXPECT_FALSE(arbiter.on_request(100, now + 200 * SRS_UTIME_MILLISECONDS));
+    EXPECT_FALSE(arbiter.on_request(100, now + 300 * SRS_UTIME_MILLISECONDS));
+
+    arbiter.pending(now + 500 * SRS_UTIME_MILLISECONDS, ssrcs);
+    EXPECT_TRUE(ssrcs.empty());
+
+    arbiter.pending(now + 1100 * SRS_UTIME_MILLISECONDS, ssrcs);
+    ASSERT_EQ(1, (int)ssrcs.size());
+    EXPECT_EQ(100, (int)ssrcs.at(0));
+
+    // The delayed PLI is done by keyframe.
+    ssrcs.clear();
+    arbiter.on_keyframe(100, now + 1200 * SRS_UTIME_MILLISECONDS);
+    EXPECT_FALSE(arbiter.on_request(100, now + 1300 * SRS_UTIME_MILLISECONDS));
+    arbiter.on_keyframe(100, now + 2000 * SRS_UTIME_MILLISECONDS);
+    arbiter.pending(now + 5000 * SRS_UTIME_MILLISECONDS, ssrcs);
+    EXPECT_TRUE(ssrcs.empty());
+
+    // Resend if no keyframe in window.
+    EXPECT_TRUE(arbiter.on_request(200, now + 1 * SRS_UTIME_SECONDS));
+
+    arbiter.on_cached();
+
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    arbiter.dumps(obj);
+    EXPECT_EQ(8, obj->get_property("requests")->to_integer());
+    EXPECT_EQ(4, obj->get_property("sent")->to_integer());
+    EXPECT_EQ(3, obj->get_property("coalesced")->to_integer());
+    EXPECT_EQ(2, obj->get_property("delayed")->to_integer());
+    EXPECT_EQ(1, obj->get_property("cached")->to_integer());
+}
+
+// Build a FU-A packet of IDR, with payload of size bytes.
+int mock_fua_packet(char* buf, uint16_t seq, int size)
+{
+    int nn = mock_fec_media(buf, seq, false, size + 2);
+    buf[12] = (char)0x7c;
+    buf[13] = (char)0x85;
+    return nn;
+}
+
+VOID TEST(KernelRTCTest, RtpPacketPool)
+{
+    srs_error_t err = srs_success;
+
+    SrsRtcTrackDescription ds;
+    SrsRtcVideoRecvTrack track(NULL, &ds);
+
+    char data[1500];
+    int nn_data = mock_fua_packet(data, 100, 1000);
+
+    SrsRtpPacketPool pool(2);
+
+    // The first packet is allocated.
+    SrsRtpPacket* pkt = pool.allocate();
+    if (true) {
+        SrsBuffer b(pkt->wrap(data, nn_data), nn_data);
+        pkt->set_decode_handler(&track);
+        HELPER_EXPECT_SUCCESS(pkt->decode(&b));
+        EXPECT_TRUE(pkt->is_keyframe());
+        pool.recycle(pkt);
+        EXPECT_EQ(1, pool.size());
+    }
+
+    // Reuse the packet, buffer and payload.
+    int64_t nn_rtps = _srs_pps_objs_rtps->sugar;
+    int64_t nn_rfua = _srs_pps_objs_rfua->sugar;
+    int64_t nn_rbuf = _srs_pps_objs_rbuf->sugar;
+    for (int i = 0; i < 10; i++) {
+        SrsRtpPacket* p = pool.allocate();
+        EXPECT_EQ(pkt, p);
+        EXPECT_EQ(0, p->header.get_sequence());
+
+        nn_data = mock_fua_packet(data, 101 + i, 1000 - i);
+        SrsBuffer b(p->wrap(data, nn_data), nn_data);
+        p->set_decode_handler(&track);
+        HELPER_EXPECT_SUCCESS(p->decode(&b));
+        EXPECT_EQ(101 + i, p->header.get_sequence());
+
+        SrsRtpFUAPayload2* fua = dynamic_cast<SrsRtpFUAPayload2*>(p->payload());
+        ASSERT_TRUE(fua != NULL);
+        EXPECT_TRUE(fua->start);
+        EXPECT_EQ(SrsAvcNaluTypeIDR, fua->nalu_type);
+        EXPECT_EQ(1000 - i, fua->size);
+
+        pool.recycle(p);
+    }
+    EXPECT_EQ(nn_rtps, _srs_pps_objs_rtps->sugar);
+    EXPECT_EQ(nn_rfua, _srs_pps_objs_rfua->sugar);
+    EXPECT_EQ(nn_rbuf, _srs_pps_objs_rbuf->sugar);
+
+    // Never reuse the packet referenced by copies.
+    if (true) {
+        SrsRtpPacket* p = pool.allocate();
+        p->wrap(data, nn_data);
+        SrsRtpPacket* cp = p->copy();
+        SrsAutoFree(SrsRtpPacket, cp);
+
+        pool.recycle(p);
+        EXPECT_EQ(0, pool.size());
+
+        pool.recycle(cp->copy());
+        EXPECT_EQ(0, pool.size());
+    }
+
+    // Free the packet when pool is full.
+    if (true) {
+        pool.recycle(new SrsRtpPacket());
+        pool.recycle(new SrsRtpPacket());
+        pool.recycle(new SrsRtpPacket());
+        EXPECT_EQ(2, pool.size());
+    }
+}
+
+// Benchmark the decoder of RTP packets, to show the packets per second. It's disabled by default,
+// run it by --gtest_also_run_disabled_tests --gtest_filter=*RtpDecodeBenchmark.
+VOID TEST(KernelRTCTest, DISABLED_RtpDecodeBenchmark)
+{
+    srs_error_t err = srs_success;
+
+    SrsRtcTrackDescription ds;
+    SrsRtcVideoRecvTrack track(NULL, &ds);
+
+    char data[1500];
+    int nn_data = mock_fua_packet(data, 100, 1100);
+
+    const int nn = 100000;
+    for (int i = 0; i < 2; i++) {
+        // The second round reuse the packets in pool.
+        SrsRtpPacketPool pool(i);
+
+        srs_utime_t starttime = srs_update_system_time();
+        for (int j = 0; j < nn; j++) {
+            SrsRtpPacket* pkt = pool.allocate();
+            SrsBuffer b(pkt->wrap(data, nn_data), nn_data);
+            pkt->set_decode_handler(&track);
+            HELPER_EXPECT_SUCCESS(pkt->decode(&b));
+            pool.recycle(pkt);
+        }
+        srs_utime_t duration = srs_max(1, srs_update_system_time() - starttime);
+
+        printf("rtp decode, pool=%d, %d packets/s\n", i, (int)(nn * SRS_UTIME_SECONDS / duration));
+    }
+}
+
+// Protect the packets by the profile, which should be restored by the receiver.
+void mock_srtp_protect(SrsSrtpProfile profile)
+{
+    srs_error_t err = srs_success;
+
+    // Initialize libsrtp, which is done by the DTLS certificate for server.
+    srtp_init();
+
+    // The key is master key and salt, 30 bytes for AES-CM and 28 bytes for AES-GCM.
+    int nn_key = (profile == SrsSrtpProfileAeadAes128Gcm)? 28 : 30;
+    string ka(nn_key, 'a'), kb(nn_key, 'b');
+
+    SrsSRTP sender, receiver;
+    HELPER_EXPECT_SUCCESS(sender.initialize(kb, ka, profile));
+    HELPER_EXPECT_SUCCESS(receiver.initialize(ka, kb, profile));
+
+    for (int j = 0; j < 8; j++) {
+        char data[1500];
+        int nn_plaintext = mock_fua_packet(data, 100 + j, 1100);
+
+        int nb_cipher = nn_plaintext;
+        HELPER_EXPECT_SUCCESS(sender.protect_rtp(data, &nb_cipher));
+        EXPECT_GT(nb_cipher, nn_plaintext);
+
+        // The round trip restores the packet.
+        int nb_plaintext = nb_cipher;
+        HELPER_EXPECT_SUCCESS(receiver.unprotect_rtp(data, &nb_plaintext));
+        EXPECT_EQ(nn_plaintext, nb_plaintext);
+
+        char expect[1500];
+        mock_fua_packet(expect, 100 + j, 1100);
+        EXPECT_EQ(0, memcmp(expect, data, nn_plaintext));
+    }
+
+    // Replay is rejected.
+    if (true) {
+        char buf[1500];
+        int nb_cipher = mock_fua_packet(buf, 100, 1100);
+        HELPER_EXPECT_SUCCESS(sender.protect_rtp(buf, &nb_cipher));
+        HELPER_EXPECT_FAILED(receiver.unprotect_rtp(buf, &nb_cipher));
+    }
+}
+
+VOID TEST(KernelRTCTest, SrtpProtect)
+{
+    mock_srtp_protect(SrsSrtpProfileAes128CmSha1_80);
+}
+
+VOID TEST(KernelRTCTest, SrtpProtectGcm)
+{
+    // The GCM is only available when libsrtp is built with openssl, see --srtp-nasm.
+    if (!srs_srtp_gcm_supported()) {
+        HELPER_SKIP("srtp gcm not supported");
+    }
+
+    mock_srtp_protect(SrsSrtpProfileAeadAes128Gcm);
+}
+
+// Build a binding request with USERNAME, optional ICE-CONTROLLED, MESSAGE-INTEGRITY and FINGERPRINT.
+int mock_stun_request(char* buf, string username, string pwd, string tid, bool controlled)
+{
+    SrsBuffer b(buf, 1500);
+    b.write_2bytes(BindingRequest);
+    b.write_2bytes(0);
+    b.write_4bytes(kStunMagicCookie);
+    b.write_string(tid);
+
+    b.write_2bytes(Username);
+    b.write_2bytes(username.size());
+    b.write_string(username);
+    b.write_string(string((4 - username.size() % 4) % 4, 0));
+
+    if (controlled) {
+        b.write_2bytes(IceControlled);
+        b.write_2bytes(8);
+        b.write_8bytes(0x1234);
+    }
+
+    int length = b.pos() + 24 - 20;
+    buf[2] = char(length >> 8); buf[3] = char(length);
+
+    unsigned int nb_digest = 0;
+    uint8_t digest[20];
+    HMAC(EVP_sha1(), pwd.data(), pwd.size(), (uint8_t*)buf, b.pos(), digest, &nb_digest);
+    b.write_2bytes(MessageIntegrity);
+    b.write_2bytes(20);
+    b.write_bytes((char*)digest, 20);
+
+    length = b.pos() + 8 - 20;
+    buf[2] = char(length >> 8); buf[3] = char(length);
+
+    uint32_t crc32 = srs_crc32_ieee(buf, b.pos(), 0) ^ 0x5354554E;
+    b.write_2bytes(Fingerprint);
+    b.write_2bytes(4);
+    b.write_4bytes(crc32);
+
+    return b.pos();
+}
+
+VOID TEST(KernelRTCTest, StunResponder)
+{
+    srs_error_t err = srs_success;
+
+    string username = "m5x0n128:jvOm", pwd = "pwd0123456789abcdef";
+    string tid = "0123456789ab";
+
+    SrsStunResponder responder;
+    HELPER_EXPECT_SUCCESS(responder.initialize(pwd, username));
+
+    char req[1500];
+    int nn_req = mock_stun_request(req, username, pwd, tid, false);
+
+    // The request is decoded by the slow path.
+    SrsStunPacket ping;
+    HELPER_EXPECT_SUCCESS(ping.decode(req, nn_req));
+    EXPECT_TRUE(ping.is_binding_request());
+    EXPECT_STREQ(username.c_str(), ping.get_username().c_str());
+
+    EXPECT_TRUE(responder.match(req, nn_req));
+    EXPECT_TRUE(responder.verify(req, nn_req));
+
+    // The response is the same as encoded by the slow path.
+    if (true) {
+        char buf[1500];
+        int nb_buf = sizeof(buf);
+        HELPER_EXPECT_SUCCESS(responder.respond(req, 0x7f000001, 8000, buf, &nb_buf));
+
+        SrsStunPacket pong;
+        pong.set_message_type(BindingResponse);
+        pong.set_local_ufrag(ping.get_remote_ufrag());
+        pong.set_remote_ufrag(ping.get_local_ufrag());
+        pong.set_transcation_id(ping.get_transcation_id());
+        pong.set_mapped_address(0x7f000001);
+        pong.set_mapped_port(8000);
+
+        char expect[1500];
+        SrsBuffer b(expect, sizeof(expect));
+        HELPER_EXPECT_SUCCESS(pong.encode(pwd, &b));
+        EXPECT_EQ(b.pos(), nb_buf);
+        EXPECT_EQ(0, memcmp(expect, buf, nb_buf));
+
+        // The response is too large for buffer.
+        nb_buf = 10;
+        HELPER_EXPECT_FAILED(responder.respond(req, 0x7f000001, 8000, buf, &nb_buf));
+    }
+
+    // The ICE-CONTROLLED should be handled by slow path.
+    if (true) {
+        char buf[1500];
+        int nb_buf = mock_stun_request(buf, username, pwd, tid, true);
+        EXPECT_FALSE(responder.match(buf, nb_buf));
+        EXPECT_TRUE(responder.verify(buf, nb_buf));
+    }
+
+    // The request of other username or password.
+    if (true) {
+        char buf[1500];
+        int nb_buf = mock_stun_request(buf, "m5x0n128:jvOn", pwd, tid, false);
+        EXPECT_FALSE(responder.match(buf, nb_buf));
+        EXPECT_TRUE(responder.verify(buf, nb_buf));
+
+        nb_buf = mock_stun_request(buf, username, "pwd", tid, false);
+        EXPECT_FALSE(responder.match(buf, nb_buf));
+        EXPECT_FALSE(responder.verify(buf, nb_buf));
+    }
+
+    // The corrupt or truncated request.
+    if (true) {
+        char buf[1500];
+        memcpy(buf, req, nn_req);
+        buf[24] ^= 0x01;
+        EXPECT_FALSE(responder.match(buf, nn_req));
+        EXPECT_FALSE(responder.match(req, nn_req - 4));
+        EXPECT_FALSE(responder.match(req, 19));
+    }
+}
@@ -22,6 +22,7 @@ using namespace std;
 #include <srs_service_http_client.hpp>
 #include <srs_service_rtmp_conn.hpp>
 #include <srs_service_conn.hpp>
+#include <srs_service_log.hpp>
 #include <sys/socket.h>
 #include <netdb.h>
 
@@ -1452,3 +1453,235 @@ VOID TEST(TCPServerTest, ContextUtility)
     }
 }
 
+
+int mock_binary_log_encode(SrsBinaryLogEncoder* enc, char* data, int size, int level, const char* fmt, ...)
+{
+    SrsContextId cid;
+    cid.set_value("cid");
+
+    va_list ap;
+    va_start(ap, fmt);
+    int nn = enc->encode(data, size, level, NULL, cid, 0, fmt, ap);
+    va_end(ap);
+
+    enc->on_written(nn > 0);
+
+    return nn;
+}
+
+int mock_binary_log_encode_dropped(SrsBinaryLogEncoder* enc, char* data, int size, const char* fmt, ...)
+{
+    SrsContextId cid;
+    cid.set_value("cid");
+
+    va_list ap;
+    va_start(ap, fmt);
+    int nn = enc->encode(data, size, SrsLogLevelTrace, NULL, cid, 0, fmt, ap);
+    va_end(ap);
+
+    enc->on_written(false);
+
+    return nn;
+}
+
+string mock_binary_log_message(string text)
+{
+    size_t pos = text.find("] ");
+    return (pos == string::npos)? text : text.substr(pos + 2);
+}
+
+VOID TEST(ServiceLogTest, BinaryLogParse)
+{
+    if (true) {
+        vector<char> args; srs_binary_log_parse("Hello, world 100%%", args);
+        EXPECT_EQ(0, (int)args.size());
+    }
+
+    if (true) {
+        vector<char> args; srs_binary_log_parse("v=%d, %lld, %.2f, %s, %p, %" PRId64, args);
+        EXPECT_EQ(6, (int)args.size());
+        EXPECT_EQ('i', args[0]); EXPECT_EQ('L', args[1]); EXPECT_EQ('d', args[2]);
+        EXPECT_EQ('s', args[3]); EXPECT_EQ('p', args[4]); EXPECT_EQ('l', args[5]);
+    }
+
+    if (true) {
+        vector<char> args; srs_binary_log_parse("%*d, %.*s", args);
+        EXPECT_EQ(4, (int)args.size());
+        EXPECT_EQ('*', args[0]); EXPECT_EQ('i', args[1]);
+        EXPECT_EQ('.', args[2]); EXPECT_EQ('s', args[3]);
+    }
+
+    // The %n is ignored, never as a pointer.
+    if (true) {
+        vector<char> args; srs_binary_log_parse("%ld, %zu, %hd, %lc, %n", args);
+        EXPECT_EQ(5, (int)args.size());
+        EXPECT_EQ('l', args[0]); EXPECT_EQ('l', args[1]); EXPECT_EQ('i', args[2]);
+        EXPECT_EQ('i', args[3]); EXPECT_EQ('n', args[4]);
+    }
+}
+
+VOID TEST(ServiceLogTest, BinaryLogEncodeDecode)
+{
+    srs_error_t err = srs_success;
+
+    SrsBinaryLogEncoder enc(false);
+    SrsBinaryLogDecoder dec;
+    char data[1024];
+
+    // The header is written when log file is opened.
+    if (true) {
+        string preamble = enc.preamble();
+
+        string text; int nn = 0;
+        HELPER_EXPECT_SUCCESS(dec.decode(preamble.data(), preamble.size(), &nn, text));
+        EXPECT_EQ((int)preamble.size(), nn);
+        EXPECT_TRUE(text.empty());
+    }
+
+    // The format is defined for the first log.
+    if (true) {
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace,
+            "id=%d, bytes=%" PRId64 ", ratio=%.2f, url=%s, %.*s, 100%%", 10, (int64_t)1024, 0.5, "rtmp://x/live/s", 3, "abcdef");
+        EXPECT_GT(size, 0);
+
+        string text; int nn = 0, pos = 0;
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size - pos, &nn, text));
+        EXPECT_TRUE(text.empty()); pos += nn;
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size - pos, &nn, text));
+        pos += nn;
+
+        EXPECT_EQ(size, pos);
+        EXPECT_STREQ("id=10, bytes=1024, ratio=0.50, url=rtmp://x/live/s, abc, 100%", mock_binary_log_message(text).c_str());
+        EXPECT_TRUE(text.find("[Trace]") != string::npos);
+        EXPECT_TRUE(text.find("[cid]") != string::npos);
+    }
+
+    // The long is rendered as long long, and the %n is rendered as text.
+    if (true) {
+        int written = 0;
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace,
+            "a=%ld, b=%5lu, c=%zu, d=%lld, e=%n, f=%d", (long)-1, (unsigned long)2, (size_t)3, (long long)-4, &written, 5);
+        EXPECT_GT(size, 0);
+        EXPECT_EQ(0, written);
+
+        string text; int nn = 0, pos = 0;
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size - pos, &nn, text)); pos += nn;
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size - pos, &nn, text)); pos += nn;
+        EXPECT_EQ(size, pos);
+        EXPECT_STREQ("a=-1, b=    2, c=3, d=-4, e=%n, f=5", mock_binary_log_message(text).c_str());
+    }
+
+    // Only the event for the interned format.
+    if (true) {
+        const char* fmt = "name=%s, v=%d";
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelWarn, fmt, "srs", 1);
+        int size2 = mock_binary_log_encode(&enc, data + size, sizeof(data) - size, SrsLogLevelWarn, fmt, (const char*)NULL, 2);
+        EXPECT_GT(size2, 0);
+        EXPECT_LT(size2, size);
+
+        string text; int nn = 0, pos = 0;
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size + size2 - pos, &nn, text)); pos += nn;
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size + size2 - pos, &nn, text)); pos += nn;
+        EXPECT_STREQ("name=srs, v=1", mock_binary_log_message(text).c_str());
+        HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size + size2 - pos, &nn, text)); pos += nn;
+        EXPECT_STREQ("name=(null), v=2", mock_binary_log_message(text).c_str());
+        EXPECT_TRUE(text.find("[Warn]") != string::npos);
+    }
+
+    // No enough bytes for a record.
+    if (true) {
+        const char* fmt = "Hello";
+        mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, fmt);
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, fmt);
+        string text; int nn = 0;
+        HELPER_EXPECT_SUCCESS(dec.decode(data, size - 1, &nn, text));
+        EXPECT_EQ(0, nn);
+    }
+
+    // No enough space to encode.
+    if (true) {
+        EXPECT_EQ(0, mock_binary_log_encode(&enc, data, 8, SrsLogLevelTrace, "Hello"));
+    }
+    // The format is defined again if not written, for example, dropped by async log.
+    if (true) {
+        const char* fmt = "dropped v=%d";
+        int size = mock_binary_log_encode_dropped(&enc, data, sizeof(data), fmt, 1);
+        int size2 = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, fmt, 2);
+        EXPECT_EQ(size, size2);
+
+        int size3 = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, fmt, 3);
+        EXPECT_LT(size3, size2);
+    }
+}
+
+VOID TEST(ServiceLogTest, BinaryLogPreambleAndTruncate)
+{
+    srs_error_t err = srs_success;
+
+    SrsBinaryLogEncoder enc(false);
+    char data[1024];
+
+    // The format is defined by the first log.
+    const char* fmt = "name=%s, v=%d";
+    mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, fmt, "srs", 1);
+
+    // For a new log file, the event is decoded by the formats in preamble.
+    if (true) {
+        SrsBinaryLogDecoder dec;
+        string preamble = enc.preamble();
+
+        string text; int nn = 0, pos = 0;
+        HELPER_EXPECT_SUCCESS(dec.decode(preamble.data(), preamble.size(), &nn, text)); pos += nn;
+        HELPER_EXPECT_SUCCESS(dec.decode(preamble.data() + pos, preamble.size() - pos, &nn, text)); pos += nn;
+        EXPECT_EQ((int)preamble.size(), pos);
+        EXPECT_TRUE(text.empty());
+
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, fmt, "srs", 2);
+        HELPER_EXPECT_SUCCESS(dec.decode(data, size, &nn, text));
+        EXPECT_EQ(size, nn);
+        EXPECT_STREQ("name=srs, v=2", mock_binary_log_message(text).c_str());
+    }
+
+    // The format in writable memory is rendered as a string.
+    if (true) {
+        SrsBinaryLogDecoder dec;
+        string preamble = enc.preamble();
+        string text; int nn = 0, pos = 0;
+        while (pos < (int)preamble.size()) {
+            HELPER_EXPECT_SUCCESS(dec.decode(preamble.data() + pos, preamble.size() - pos, &nn, text)); pos += nn;
+        }
+
+        char dynamic[32];
+        snprintf(dynamic, sizeof(dynamic), "dynamic=%%d");
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, dynamic, 3);
+
+        pos = 0;
+        while (pos < size) {
+            HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size - pos, &nn, text)); pos += nn;
+        }
+        EXPECT_STREQ("dynamic=3", mock_binary_log_message(text).c_str());
+    }
+
+    // The long log is truncated, like text log.
+    if (true) {
+        SrsBinaryLogDecoder dec;
+        string preamble = enc.preamble();
+        string text; int nn = 0, pos = 0;
+        while (pos < (int)preamble.size()) {
+            HELPER_EXPECT_SUCCESS(dec.decode(preamble.data() + pos, preamble.size() - pos, &nn, text)); pos += nn;
+        }
+
+        string large(4096, 'x');
+        int size = mock_binary_log_encode(&enc, data, sizeof(data), SrsLogLevelTrace, "large=%s, v=%d", large.c_str(), 4);
+        EXPECT_GT(size, 0);
+        EXPECT_LE(size, (int)sizeof(data));
+
+        pos = 0;
+        while (pos < size) {
+            HELPER_EXPECT_SUCCESS(dec.decode(data + pos, size - pos, &nn, text)); pos += nn;
+        }
+        string msg = mock_binary_log_message(text);
+        EXPECT_EQ(0, (int)msg.find("large=xxx"));
+        EXPECT_LT(msg.size(), large.size());
+    }
+}